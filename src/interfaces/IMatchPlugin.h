@@ -18,6 +18,9 @@ public:
     virtual bool setMirrorCalibMatrix(const cv::Mat& mat) = 0;
     // 图像点转换为物理点
     virtual std::vector<cv::Point2f> getPhysicalPoint(const std::vector<cv::Point2f> imagePoint) = 0;
+    // 全部排版路径（原始路径及各副本）一次换算到振镜物理坐标：points 按副本依次连续存放，
+    // subpathStarts 为各子路径在 points 中的起点，末尾附总点数；未加载振镜标定或没有路径时返回 false
+    virtual bool getPhysicalPaths(std::vector<cv::Point2f>& points, std::vector<int>& subpathStarts) = 0;
     // 获取移动和旋转数据
     virtual CopyItems_Move_Rotate_Data getMoveRotateData() const = 0;
     // 获取移动和旋转数据的 QVariantMap 表示
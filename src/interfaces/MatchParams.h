@@ -1,5 +1,6 @@
 ﻿#pragma once
 #include <opencv2/opencv.hpp>
+#include <memory>
 #include <vector>
 #include <QVector>
 #include <QVariant>
@@ -27,6 +28,18 @@ struct MatchParams {
     // 为防止模板学习时将 ROI 边框当作特征点，支持忽略边界像素宽度（单位：px）
     // 当 >0 时会在模板学习阶段构造掩膜，屏蔽距离四边小于该阈值的区域
     int borderPadding = 1;
+
+    // 学习时把角度范围均分为若干段，由独立引擎并行生成后合并（1 为不分段）；
+    // 各金字塔层总是并行生成，分段只在层数少、角度范围大时进一步缩短学习时间
+    int learnAngleSplits = 1;
+
+    // 按需生成模型：学习时只划分角度/缩放区间，区间模板在搜索首次用到时生成并缓存（忽略 learnAngleSplits）。
+    // lazyCacheBins 为常驻区间上限（<=0 不限），超出时淘汰最久未用的区间；不限时每次搜索覆盖全部区间。
+    // lazyHotFirst：只搜索最近命中的区间及其相邻区间，有结果即停止（目标姿态集中时更快，但可能漏掉其它姿态的目标）
+    bool  lazyModel = false;
+    float lazyAngleBin = 10.f;
+    int   lazyCacheBins = 0;
+    bool  lazyHotFirst = false;
 };
 
 struct FindMatchParams
@@ -34,9 +47,22 @@ struct FindMatchParams
     int     maxCount = 5;// 最大数量
     bool    useSubPx = true;
     MatchCenterType centerType = MatchCenterType::SceneCenter;
-    double  scoreThreshold = 0.6;  // 分数阈值(0~1)，界面显示 70.00
+    double  scoreThreshold = 60.0; // 分数阈值(0~100，与引擎相似度及界面分数框同一尺度；MatchResult::score 为 0~1)
     bool    useRoi = false;         
     cv::Mat Mask; // 模板掩码
+    // 分层搜索：只在最粗金字塔层全图搜索，其余层只在候选附近的小窗口内细化；
+    // false 时各层独立全图搜索后合并（旧行为，用于对比回归）
+    bool    coarseToFine = true;
+    // 重复结果判据：<=0 时中心距离小于模板对角线 0.3 倍视为同一目标；
+    // >0 时改为旋转框交并比不低于该值视为同一目标（密集排列、目标彼此贴近时使用）
+    double  nmsIouThreshold = 0.0;
+    // 紧凑结果：只输出位姿/分数/模板编号/外接框，不逐个拷贝特征点，需要时调用 MatchResult::featurePoints()
+    bool    compactResults = false;
+    // 单次匹配的时限（毫秒，<=0 不限）：到时在下一个检查点（金字塔层/引擎调用/候选细化之间）停止，返回已确认的部分结果
+    int     timeoutMs = 0;
+    // 亚像素位姿精修：输出前把特征点沿梯度对齐到图像边缘（PoseRefiner），角度/位置精度不再受学习步长限制，
+    // 可配合较粗的 angle_step（2~4°）减少模板数
+    bool    refinePose = false;
 };
 
 
@@ -48,7 +74,24 @@ struct MatchResult {
     cv::Point2f   center;  // 基准点
     cv::RotatedRect rotatedRect; // 最小外接矩形框
     cv::Size2f    featureSize{0.f, 0.f}; // 保存特征点最小外接矩形尺寸，便于按真实模板大小绘制
-    std::vector<cv::Point2f> transformedFeaturePoints; // 该匹配下所有特征点的全图坐标
+    std::vector<cv::Point2f> transformedFeaturePoints; // 该匹配下所有特征点的全图坐标（紧凑结果为空）
+    int           templateId = -1; // 匹配引擎内的模板编号（对应离散的角度/缩放）
+    int           trackId = -1;    // 连续匹配模式下的跟踪编号，单次匹配为 -1
+    int           libraryId = -1;  // 模板库匹配时命中的模板编号（TemplateLibrary::addTemplate 的返回值），单模板匹配为 -1
+    // 学习时的特征点（训练坐标，各结果共享只读）及训练坐标 → 全图坐标的仿射变换，用于按需计算特征点
+    std::shared_ptr<const std::vector<cv::Point2f>> featureModel;
+    cv::Matx23f   featureTransform = cv::Matx23f::eye();
+
+    // 全图坐标下的特征点：已填充 transformedFeaturePoints 时直接返回，否则由共享特征点现算
+    std::vector<cv::Point2f> featurePoints() const
+    {
+        if (!transformedFeaturePoints.empty() || !featureModel || featureModel->empty()) {
+            return transformedFeaturePoints;
+        }
+        std::vector<cv::Point2f> points;
+        cv::transform(*featureModel, points, featureTransform);
+        return points;
+    }
 };
 struct MatchResults
 {
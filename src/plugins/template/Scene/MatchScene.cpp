@@ -172,13 +172,11 @@ void MatchScene::clear()
         emit totalPathPathChanged(m_totalPath);
     }
 
-    QList<QGraphicsItem*> allItems = items();
-    for(QGraphicsItem* item : allItems) {
-        if(item->type() == InteractivePathItem::Type) {
-            removeItem(item); 
-            delete item;
-        }
+    for (InteractivePathItem* item : m_pathItems) {
+        removeItem(item);
+        delete item;
     }
+    m_pathItems.clear();
 
 }
     
@@ -542,6 +540,7 @@ void MatchScene::DrawTotalPath(QVector<QPainterPath> paths)
         InteractivePathItem* item = new InteractivePathItem(p);
         item->setBrush(Qt::NoBrush);
         addItem(item);
+        m_pathItems.append(item);
     }
 }
 
@@ -12,6 +12,7 @@
 #include "template/template_global.h"
 
 class QGraphicsTextItem; // 用于显示图片尺寸的文本项前向声明（修改）
+class InteractivePathItem;
 
 // MatchScene: 继承自 ImageSceneBase 的可交互 ROI 选择场景
 class TEMPLATE_EXPORT MatchScene : public ImageSceneBase {
@@ -43,6 +44,7 @@ public:
     void DrawTotalPath(QVector<QPainterPath> paths); // 在场景中绘制合成后的 ROI 路径
 
     QVector<QPainterPath> getDrawPaths() const { return drawPaths; } // 获取当前绘制的路径集合 
+    const QVector<InteractivePathItem*>& pathItems() const { return m_pathItems; } // DrawTotalPath 生成的图元，按路径顺序（跳过空路径）
 
     
 
@@ -94,6 +96,7 @@ private:
     mutable cv::Rect m_lastMatchBbox; // 保存上次 extractMatchArea 计算并用于裁剪的像素坐标包围盒
     QGraphicsTextItem* m_imageSizeItem = nullptr; // 场景中显示当前图片大小的文本项（修改）
     QVector<QPainterPath> drawPaths; // 用于存储绘制的多个路径
+    QVector<InteractivePathItem*> m_pathItems; // 与 drawPaths 对应的可交互图元，clear() 时删除
     
 
 };
@@ -24,6 +24,7 @@
 #include <QCoreApplication>
 #include <QDir>
 #include <QStringList> // 使用 QStringList 维护候选路径列表
+#include <QSignalBlocker>
 
 #include "Scene/ImageDisplayScene.h"
 #include "../Scene/MatchScene.h"
@@ -87,6 +88,11 @@ void matchWidget::applyLoadedStyleSheet(QWidget* widget)
 
 matchWidget::~matchWidget()
 {
+    if (m_matchCancelToken) {
+        m_matchCancelToken->cancel(); // 让进行中的匹配尽快在检查点结束
+    }
+    m_matchWatcher.waitForFinished();
+    m_trackWatcher.waitForFinished(); // 后台跟踪任务引用 m_matchTracker
     if (m_ImageProcess) {
         delete m_ImageProcess;
         m_ImageProcess = nullptr;
@@ -152,6 +158,9 @@ void matchWidget::init()
     m_drawpathBtn = newButton(new QToolButton(this), QStringLiteral("显示路径"));
     connect(m_drawpathBtn, &QToolButton::clicked, this, &matchWidget::DrawPathBtnClicked);
 
+    m_learnPathBtn = newButton(new QToolButton(this), QStringLiteral("路径学习"));
+    connect(m_learnPathBtn, &QToolButton::clicked, this, &matchWidget::learnPathMatch);
+
     m_confirmDrawBtn = newButton(new QToolButton(this), QStringLiteral("一键排版"));
     connect(m_confirmDrawBtn, &QToolButton::clicked, [this]() { 
 
@@ -195,6 +204,7 @@ void matchWidget::init()
     btnLayout->addWidget(m_openImageBtn, 2, 1);
     btnLayout->addWidget(m_drawpathBtn, 3, 0);
     btnLayout->addWidget(m_confirmDrawBtn, 3, 1);
+    btnLayout->addWidget(m_learnPathBtn, 4, 0);
 
     QVBoxLayout* rightLayout = new QVBoxLayout; // 右侧整体纵向布局
     m_paraWidgetshow = new QCheckBox(QStringLiteral("设置参数"), this);
@@ -232,10 +242,29 @@ void matchWidget::init()
             ms->setSelectionTemplateEnabled(checked);
         }
     });
+    m_serverMatchCheckBox = new QCheckBox(QStringLiteral("服务端匹配"), this);
+    m_serverMatchCheckBox->setChecked(false);
+    connect(m_serverMatchCheckBox, &QCheckBox::toggled, this, [this](bool checked){
+        if (!setServerMatchEnabled(checked) && checked) {
+            QSignalBlocker blocker(m_serverMatchCheckBox);
+            m_serverMatchCheckBox->setChecked(false);
+        }
+    });
+    m_continuousMatchCheckBox = new QCheckBox(QStringLiteral("连续匹配"), this);
+    m_continuousMatchCheckBox->setChecked(false);
+    connect(m_continuousMatchCheckBox, &QCheckBox::toggled, this, [this](bool checked){
+        m_trackWatcher.waitForFinished();
+        m_matchTracker.reset(); // 重新开始时从全图搜索建立目标
+        if (checked) {
+            startTrackingFrame();
+        }
+    });
     QHBoxLayout* checkBoxLayout = new QHBoxLayout; // 右侧整体纵向布局
     checkBoxLayout->addWidget(m_paraWidgetshow);
     checkBoxLayout->addWidget(m_matchselectCheckBox);
     rightLayout->addLayout(checkBoxLayout);
+    rightLayout->addWidget(m_serverMatchCheckBox);
+    rightLayout->addWidget(m_continuousMatchCheckBox);
     rightLayout->addWidget(showParaWidget, 3, Qt::AlignHCenter);
     rightLayout->addLayout(btnLayout);
     rightLayout->addStretch();
@@ -259,7 +288,8 @@ void matchWidget::init()
     imageView->setSizePolicy(QSizePolicy::Expanding, QSizePolicy::Expanding);
 
     // 连接异步匹配完成信号
-    connect(&m_matchWatcher, &QFutureWatcher<std::vector<MatchResult>>::finished, this, &matchWidget::onMatchFinished);
+    connect(&m_matchWatcher, &QFutureWatcher<TemplateManager::MatchJobResult>::finished, this, &matchWidget::onMatchFinished);
+    connect(&m_trackWatcher, &QFutureWatcher<std::vector<MatchResult>>::finished, this, &matchWidget::onTrackFinished);
 
     QImage qimg; // 临时 QImage 用于显示
     try {
@@ -330,7 +360,11 @@ bool matchWidget::learnMatch()
     }
 
     buildMatchParams();
-    if (!m_templateManager.learnTemplate(m_currentImage, templateMat, m_MatchParams)) {
+    m_trackWatcher.waitForFinished(); // 跟踪任务仍在使用旧模型
+    m_matchTracker.reset();
+    // 相同模板与参数已学习过时直接加载模型包，免去逐角度/缩放重新生成模板
+    const QString modelCacheDir = QCoreApplication::applicationDirPath() + "/models";
+    if (!m_templateManager.learnTemplateCached(m_currentImage, templateMat, m_MatchParams, modelCacheDir)) {
         QMessageBox::warning(this, QStringLiteral("模板提取"), QStringLiteral("模板提取失败，请检查图像质量。"));
         return false;
     }
@@ -376,6 +410,49 @@ bool matchWidget::learnMatch()
     return true;
 }
 
+// 由加工路径直接生成模板（不需要图像与 ROI）
+bool matchWidget::learnPathMatch()
+{
+    scaleinitData(); // 路径换算到图像像素坐标
+    if (m_cale_initParam.combinedPath.isEmpty()) {
+        QMessageBox::information(this, QStringLiteral("模板"), QStringLiteral("没有加工路径"));
+        return false;
+    }
+
+    buildMatchParams();
+    m_trackWatcher.waitForFinished(); // 跟踪任务仍在使用旧模型
+    m_matchTracker.reset();
+    if (!m_templateManager.learnTemplateFromPath(m_cale_initParam.combinedPath, m_MatchParams)) {
+        QMessageBox::warning(this, QStringLiteral("模板提取"), QStringLiteral("路径模板生成失败，请检查加工路径。"));
+        return false;
+    }
+    m_learnedFeaturePoints = m_templateManager.currentFeaturePoints();
+    m_learnedKeypoints.clear();
+    m_learnedKeypoints.reserve(m_learnedFeaturePoints.size());
+    for (const auto& pt : m_learnedFeaturePoints) {
+        m_learnedKeypoints.emplace_back(pt, 1.0f);
+    }
+    m_hasLearnedTemplate = true;
+
+    if (m_RoiDisplayScene) {
+        QImage templmg;
+        if (TIGER_BSVISION::cvImage2qImage(templmg, m_templateManager.templateImage())) {
+            m_RoiDisplayScene->setOriginalPixmap(QPixmap::fromImage(templmg));
+            m_RoiDisplayScene->setSourceImageSize(templmg.size());
+            m_RoiDisplayScene->clearOverlays();
+
+            QPen ptPen(Qt::green);
+            ptPen.setWidth(1);
+            for (const auto& kp : m_learnedKeypoints) {
+                m_RoiDisplayScene->addOverlayPoint(QPointF(kp.pt.x, kp.pt.y), ptPen, 2);
+            }
+        }
+        m_RoiDisplayScene->resetImage();
+    }
+    qInfo().noquote() << "Learned" << m_learnedFeaturePoints.size() << "feature points from path.";
+    return true;
+}
+
 void matchWidget::clearToggled()
 {
     if (m_ImageDisplayScene) {
@@ -408,39 +485,75 @@ void matchWidget::executeMatch(bool useRoi = false)
         QMessageBox::warning(this, QStringLiteral("匹配失败"), QStringLiteral("请框选正确的模板区域。"));
         return;
     }
-    // 禁用按钮，防止重复点击
-    m_confirmMatchBtn->setEnabled(false);
-    
+    // 上一次匹配仍在进行时取消它（在下一个检查点结束），不必等待慢速的全范围搜索
+    if (m_matchCancelToken) {
+        m_matchCancelToken->cancel();
+    }
+
     // 准备匹配参数
     buildFindMatchParams(useRoi);
     FindMatchParams findParams = m_FindMatchParams;
     if (!useRoi) {
         findParams.Mask.release(); // 全图匹配直接清空掩膜
     } 
-    QFuture<std::vector<MatchResult>> future = QtConcurrent::run([this, findParams]() {
-        return m_templateManager.matchTemplate(m_currentImage, findParams);
+    // 任务持有当前帧的快照，之后到达的新帧只替换 m_currentImage，不影响本次匹配
+    TemplateManager::MatchJob job = TemplateManager::makeMatchJob(m_currentImage, findParams);
+    m_matchCancelToken = job.cancelToken;
+    QFuture<TemplateManager::MatchJobResult> future = QtConcurrent::run([this, job]() {
+        return m_templateManager.runMatchJob(job);
     });
 
     m_matchWatcher.setFuture(future);
 }
 
-void matchWidget::onMatchFinished()
+void matchWidget::startTrackingFrame()
 {
-    // 恢复按钮状态
-    if (m_hasLearnedTemplate) {
-        m_confirmMatchBtn->setEnabled(true);
+    if (m_currentImage.empty() || !m_templateManager.hasTemplate() || m_trackWatcher.isRunning()) {
+        return; // 上一帧仍在处理时丢弃本帧，跟踪节奏跟随处理能力
+    }
+    if (m_serverMatchCheckBox && m_serverMatchCheckBox->isChecked()) {
+        return; // 服务端匹配模式下结果由推流服务器回传
     }
+    buildFindMatchParams(false);
+    FindMatchParams findParams = m_FindMatchParams;
+    findParams.Mask.release();
+    const cv::Mat frame = m_currentImage;
+    QFuture<std::vector<MatchResult>> future = QtConcurrent::run([this, frame, findParams]() {
+        m_matchTracker.update(frame, findParams);
+        return m_matchTracker.confirmedResults();
+    });
+    m_trackWatcher.setFuture(future);
+}
 
-    // 获取结果并渲染
-    std::vector<MatchResult> results = m_matchWatcher.result();
-    m_lastMatchResults = results; // 保存结果以备后续使用
-    renderMatchResults(results);
+void matchWidget::onTrackFinished()
+{
+    std::vector<MatchResult> results = m_trackWatcher.result();
+    m_lastMatchResults = results;
+    renderMatchResults(results, true);
+}
+
+void matchWidget::onMatchFinished()
+{
+    // 获取结果并渲染；被新请求取消的任务不再显示
+    const TemplateManager::MatchJobResult jobResult = m_matchWatcher.result();
+    if (jobResult.status == TemplateManager::MatchStatus::Cancelled || jobResult.status == TemplateManager::MatchStatus::Stale) {
+        return;
+    }
+    m_matchCancelToken.reset();
+    m_lastMatchResults = jobResult.results; // 保存结果以备后续使用
+    renderMatchResults(jobResult.results);
 }
 
-void matchWidget::renderMatchResults(const std::vector<MatchResult> &results)
+void matchWidget::renderMatchResults(const std::vector<MatchResult> &results, bool quiet)
 {
     if(results.empty()) {
-        QMessageBox::information(this, QStringLiteral("匹配完成"), QStringLiteral("未找到匹配结果"));
+        if (quiet) {
+            if (m_ImageDisplayScene) {
+                m_ImageDisplayScene->clearOverlays();
+            }
+        } else {
+            QMessageBox::information(this, QStringLiteral("匹配完成"), QStringLiteral("未找到匹配结果"));
+        }
         return;
     }
     if (m_ImageDisplayScene) {
@@ -457,8 +570,8 @@ void matchWidget::renderMatchResults(const std::vector<MatchResult> &results)
 
         for (const auto &res : results) {
             // 如果有变换后的特征点，计算其最小外接旋转矩形并绘制为多边形
-            if (!res.transformedFeaturePoints.empty()) {
-                std::vector<cv::Point2f> pts = res.transformedFeaturePoints;
+            const std::vector<cv::Point2f> pts = res.featurePoints();
+            if (!pts.empty()) {
                 cv::RotatedRect rr = res.rotatedRect;
                 cv::Point2f boxPts[4];
                 rr.points(boxPts);
@@ -476,10 +589,20 @@ void matchWidget::renderMatchResults(const std::vector<MatchResult> &results)
                 m_ImageDisplayScene->addOverlayPolygon(poly, rectPen);
                 m_ImageDisplayScene->addOverlayPolygon(minpoly, resultsPenRect);
                 
-                for (const auto &p : res.transformedFeaturePoints) {
+                for (const auto &p : pts) {
                     m_ImageDisplayScene->addOverlayPoint(QPointF(p.x, p.y), ptPen, 2.0);
                 }
                 m_ImageDisplayScene->addOverlayPoint(QPointF(res.center.x, res.center.y), CertenPen, 4.0);
+            } else if (res.rotatedRect.size.area() > 0.f) {
+                // 服务端匹配只回传旋转矩形，不含特征点
+                cv::Point2f boxPts[4];
+                res.rotatedRect.points(boxPts);
+                QPolygonF poly;
+                for (int i = 0; i < 4; ++i) {
+                    poly << QPointF(boxPts[i].x, boxPts[i].y);
+                }
+                m_ImageDisplayScene->addOverlayPolygon(poly, rectPen);
+                m_ImageDisplayScene->addOverlayPoint(QPointF(res.center.x, res.center.y), CertenPen, 4.0);
             } else {
                 QRect qr(res.Roiarea.x, res.Roiarea.y, res.Roiarea.width, res.Roiarea.height);
                 m_ImageDisplayScene->addOverlayRect(qr, rectPen);
@@ -511,7 +634,7 @@ bool matchWidget::setcurrentImage(const cv::Mat &image)
     if (image.empty()) {
         return false;
     }
-    m_currentImage = image.clone();
+    m_currentImage = image; // 共享数据即可：接收器不会覆盖仍被持有的帧，其余来源都是新分配的图像
     QImage qimg; // 临时 QImage 用于显示
      if (!m_currentImage.empty() && TIGER_BSVISION::cvImage2qImage(qimg, m_currentImage)) { 
             m_ImageDisplayScene->setOriginalPixmap(QPixmap::fromImage(qimg));
@@ -540,6 +663,7 @@ void matchWidget::OpenImage()
         QMessageBox::warning(this, QStringLiteral("错误"), QStringLiteral("无法加载所选图像文件"));
         return;
     }
+    m_frameGeometry = StreamProtocol::FrameGeometry(); // 本地图像即整幅坐标
     setcurrentImage(img);
 }
 
@@ -551,12 +675,14 @@ bool matchWidget::setMoveRotateData()
     if(m_lastMatchResults.empty()) {
         return false;
     }
+    // initPoint 位于传感器整幅坐标，结果需先换算到同一坐标系
+    const std::vector<MatchResult> sensorResults = getMatchResults();
     m_MoveRotateData.clear();
     QVector<double> distances;
-    distances.reserve(m_lastMatchResults.size());
-    for (int i = 0; i < static_cast<int>(m_lastMatchResults.size()); ++i) {
-        double dx = m_lastMatchResults[i].center.x - initPoint.x();
-        double dy = m_lastMatchResults[i].center.y - initPoint.y();
+    distances.reserve(sensorResults.size());
+    for (int i = 0; i < static_cast<int>(sensorResults.size()); ++i) {
+        double dx = sensorResults[i].center.x - initPoint.x();
+        double dy = sensorResults[i].center.y - initPoint.y();
         double distance = std::sqrt(dx * dx + dy * dy);
         distances.append(distance);
     }
@@ -566,13 +692,13 @@ bool matchWidget::setMoveRotateData()
             disMinIndex = i;
         }
     }
-    for(int i = 0; i < static_cast<int>(m_lastMatchResults.size()); ++i){
+    for(int i = 0; i < static_cast<int>(sensorResults.size()); ++i){
         if(i == disMinIndex){
             continue;
         }
-        double dx = m_lastMatchResults[i].center.x -m_lastMatchResults[disMinIndex].center.x;
-        double dy = m_lastMatchResults[i].center.y - m_lastMatchResults[disMinIndex].center.y;
-        double angle = m_lastMatchResults[i].angle - m_lastMatchResults[disMinIndex].angle;
+        double dx = sensorResults[i].center.x -sensorResults[disMinIndex].center.x;
+        double dy = sensorResults[i].center.y - sensorResults[disMinIndex].center.y;
+        double angle = sensorResults[i].angle - sensorResults[disMinIndex].angle;
         m_MoveRotateData.addData(QPointF(dx, dy), -angle);
     }
 
@@ -589,14 +715,66 @@ std::vector<cv::Point2f> matchWidget::getPhysicalPoint(const std::vector<cv::Poi
     if(!m_isCalibLoaded_Mirror || HomographyMatrix.empty() || imagePoint.empty()){
         return {};
     }
+    std::vector<cv::Point2f> sensorPoints = imagePoint;
+    if (!m_frameGeometry.isIdentity()) {
+        // 振镜标定基于传感器整幅坐标，先把当前（裁剪/降采样）图像坐标换算回去
+        for (auto& pt : sensorPoints) {
+            pt = m_frameGeometry.toSensor(pt);
+        }
+    }
     std::vector<cv::Point2f> physicalPoints;
-    cv::perspectiveTransform(imagePoint, physicalPoints, HomographyMatrix);
+    cv::perspectiveTransform(sensorPoints, physicalPoints, HomographyMatrix);
     return physicalPoints;
 }
 
+bool matchWidget::getPhysicalPaths(std::vector<cv::Point2f>& points, std::vector<int>& subpathStarts)
+{
+    points.clear();
+    subpathStarts.clear();
+    if (!m_isCalibLoaded_Mirror || HomographyMatrix.rows != 3 || HomographyMatrix.cols != 3
+        || m_pathBatch.isEmpty() || m_pathImageTransforms.empty()) {
+        return false;
+    }
+    // 图像 → 传感器整幅坐标（推流裁剪/降采样）→ 振镜，与各副本的图像坐标变换合成为每个副本一个矩阵
+    cv::Matx33d sensorFromImage = cv::Matx33d::eye();
+    if (!m_frameGeometry.isIdentity()) {
+        sensorFromImage = cv::Matx33d(m_frameGeometry.scale, 0.0, m_frameGeometry.crop.x,
+                                      0.0, m_frameGeometry.scale, m_frameGeometry.crop.y,
+                                      0.0, 0.0, 1.0);
+    }
+    const cv::Matx33d galvoFromImage = cv::Matx33d(HomographyMatrix) * sensorFromImage;
+    std::vector<cv::Matx33d> transforms;
+    transforms.reserve(m_pathImageTransforms.size());
+    for (const cv::Matx33d& imageTransform : m_pathImageTransforms) {
+        transforms.push_back(galvoFromImage * imageTransform);
+    }
+    points = m_pathBatch.transform(transforms);
+
+    const std::vector<int>& starts = m_pathBatch.subpathStarts();
+    const int count = m_pathBatch.pointCount();
+    subpathStarts.reserve(transforms.size() * (starts.size() - 1) + 1);
+    for (size_t i = 0; i < transforms.size(); ++i) {
+        for (size_t s = 0; s + 1 < starts.size(); ++s) {
+            subpathStarts.push_back(static_cast<int>(i) * count + starts[s]);
+        }
+    }
+    subpathStarts.push_back(static_cast<int>(points.size()));
+    return true;
+}
+
+std::vector<MatchResult> matchWidget::getMatchResults() const
+{
+    std::vector<MatchResult> results = m_lastMatchResults;
+    for (auto& res : results) {
+        m_frameGeometry.mapToSensor(res);
+    }
+    return results;
+}
+
 void matchWidget::connectUDPReceiver()
 {
     auto* m_UDPMatReceiver = new UDPMatReceiver(this);
+    m_udpReceiver = m_UDPMatReceiver;
 
     connect(m_UDPMatReceiver, &UDPMatReceiver::statusText, this, [](const QString& s){
     qDebug() << s;
@@ -607,10 +785,10 @@ void matchWidget::connectUDPReceiver()
     auto udpDataReceived = std::make_shared<bool>(false); // 使用共享指针记录是否收到数据，避免局部变量悬空
     auto udpAttemptCount = std::make_shared<int>(0); // 使用共享指针记录已尝试次数
 
-    connect(m_UDPMatReceiver, &UDPMatReceiver::frameReady, this, [&, udpDataReceived](const cv::Mat& frame){
+    connect(m_UDPMatReceiver, &UDPMatReceiver::frameReadyWithGeometry, this,
+            [&, udpDataReceived](const cv::Mat& frame, const StreamProtocol::FrameGeometry& geometry){
         *udpDataReceived = true; // 收到首帧标记成功
-        cv::Mat local = frame.clone(); // 拷贝一份图像避免线程安全问题
-        setcurrentImage(m_ImageProcess->CalibImage(local)); // 校正后更新到界面
+        onFrameReceived(frame, geometry);
     });
     // 注意：0.0.0.0 是服务器监听地址（表示监听所有网卡），客户端发送必须指定具体 IP。
     // 如果服务器在本地，用 "127.0.0.1"；如果在树莓派/其他机器，请输入它的局域网 IP（如 "192.168.1.x"）。
@@ -634,6 +812,88 @@ void matchWidget::connectUDPReceiver()
         m_UDPMatReceiver->start("192.168.137.131", 9000); // 发起一次握手尝试等待数据
     });
     udpRetryTimer->start(); // 启动定时器开始尝试接收数据
+
+    // 服务端匹配模式：结果直接叠加显示，缩略图按当前整帧尺寸放大后作为背景
+    connect(m_UDPMatReceiver, &UDPMatReceiver::matchResultsReady, this, [this](const MatchResults& results, quint32){
+        m_frameGeometry = StreamProtocol::FrameGeometry(); // 服务端结果已是传感器整幅坐标
+        m_lastMatchResults.assign(results.results.begin(), results.results.end());
+        renderMatchResults(m_lastMatchResults, true);
+    });
+    connect(m_UDPMatReceiver, &UDPMatReceiver::thumbnailReady, this, [this](const cv::Mat& thumbnail, quint32){
+        if (thumbnail.empty()) {
+            return;
+        }
+        // 缩略图只用于显示：放大到当前帧尺寸，使服务端结果的坐标照常叠加；
+        // 不替换 m_currentImage，本地匹配、学习模板与保存图像仍使用全分辨率帧
+        cv::Mat display;
+        if (!m_currentImage.empty()) {
+            cv::resize(thumbnail, display, m_currentImage.size(), 0, 0, cv::INTER_LINEAR);
+        } else {
+            display = thumbnail;
+        }
+        QImage qimg;
+        if (!TIGER_BSVISION::cvImage2qImage(qimg, display)) {
+            return;
+        }
+        m_ImageDisplayScene->setOriginalPixmap(QPixmap::fromImage(qimg));
+        m_ImageDisplayScene->setSourceImageSize(qimg.size());
+        renderMatchResults(m_lastMatchResults, true);
+    });
+    connect(m_UDPMatReceiver, &UDPMatReceiver::serverMatchModeChanged, this, [this](bool active){
+        if (m_serverMatchCheckBox && m_serverMatchCheckBox->isChecked() != active) {
+            QSignalBlocker blocker(m_serverMatchCheckBox);
+            m_serverMatchCheckBox->setChecked(active);
+        }
+    });
+}
+
+void matchWidget::onFrameReceived(const cv::Mat& frame, const StreamProtocol::FrameGeometry& geometry)
+{
+    // 接收器只会复用使用方已释放的输出图像，这里持有引用即可，无需再拷贝
+    cv::Mat image = frame;
+    m_frameGeometry = geometry;
+    if (geometry.isIdentity()) {
+        setcurrentImage(m_ImageProcess->CalibImage(image)); // 校正后更新到界面
+    } else {
+        setcurrentImage(image); // 去畸变映射表按整幅传感器图像计算，裁剪/降采样帧不做校正
+    }
+    if (m_continuousMatchCheckBox && m_continuousMatchCheckBox->isChecked()) {
+        startTrackingFrame();
+    }
+}
+
+void matchWidget::connectShmReceiver(const QString& name)
+{
+    // 采集进程与界面同机时直接走共享内存，使用方式与 UDP 接收器一致
+    auto* receiver = new ShmFrameReceiver(this);
+    connect(receiver, &IFrameReceiver::statusText, this, [](const QString& s){
+        qDebug() << s;
+    });
+    connect(receiver, &IFrameReceiver::frameReadyWithGeometry, this, &matchWidget::onFrameReceived);
+    receiver->start(name);
+}
+
+bool matchWidget::setServerMatchEnabled(bool enable)
+{
+    if (!m_udpReceiver) {
+        if (enable) {
+            QMessageBox::warning(this, QStringLiteral("服务端匹配"), QStringLiteral("请先连接推流服务器。"));
+        }
+        return false;
+    }
+    if (!enable) {
+        m_udpReceiver->stopServerMatching();
+        return true;
+    }
+    if (!m_templateManager.hasTemplate()) {
+        QMessageBox::warning(this, QStringLiteral("服务端匹配"), QStringLiteral("请先学习模板。"));
+        return false;
+    }
+    buildFindMatchParams(false);
+    // 每 30 帧回传一张 1/4 缩略图用于显示，匹配结果每帧回传
+    return m_udpReceiver->uploadMatchModel(m_templateManager.templateImage(),
+                                           m_templateManager.learnParams(),
+                                           m_FindMatchParams, 30, 0.25f);
 }
 
  QVariantMap matchWidget::getMoveRotateDataMap() const{
@@ -720,11 +980,15 @@ QVector<QPainterPath> matchWidget::copyPainterPathWithTransform(const QPainterPa
 {
     auto ms = qobject_cast<MatchScene*>(m_ImageDisplayScene);
     QVector<QPainterPath> newPaths;
-    newPaths.append(originalPath); // 包含原始路径
+    // 路径只展平一次，各副本的变换合成为矩阵后对同一点缓冲批量计算；第 0 项为原始路径。
+    // 所有项（含第 0 项）都按场景坐标显示，拖拽后用同一换算更新各项的图像坐标变换
+    m_pathBatch = PathBatchTransformer(originalPath);
+    m_pathImageTransforms.assign(1, cv::Matx33d::eye());
+    int copyCount = moveOffsets.size();
     if (moveOffsets.size() != angles.size()) {
         qWarning() << "copyPainterPathWithTransform：偏移量数量(" << moveOffsets.size() 
                    << ")与角度数量(" << angles.size() << ")不一致！";
-        return newPaths;
+        copyCount = 0;
     }
     QTransform imgToScene;
     if (ms) {
@@ -736,13 +1000,17 @@ QVector<QPainterPath> matchWidget::copyPainterPathWithTransform(const QPainterPa
                                 p0.x(), p0.y());
     }
 
-    QPainterPath scenePath = ms ? imgToScene.map(originalPath) : originalPath;
+    m_sceneFromImage = PathBatchTransformer::fromQTransform(imgToScene);
+    const cv::Matx33d imageFromScene = m_sceneFromImage.inv();
+    std::vector<cv::Matx33d> displayTransforms; // 各项：图像坐标 → 场景坐标下的摆放位置
+    displayTransforms.reserve(static_cast<size_t>(copyCount) + 1);
+    displayTransforms.push_back(m_sceneFromImage);
 
     // 计算场景坐标系下的旋转轴心
     QPointF pivotScene = ms ? ms->imageToScenePoint(pivotPoint) : pivotPoint;
     QPointF vecRef = ms ? ms->imageToScenePoint(QPointF(0,0)) : QPointF(0,0);
 
-    for (int i = 0; i < moveOffsets.size(); ++i) {
+    for (int i = 0; i < copyCount; ++i) {
         //const QPointF& offsetImg = moveOffsets[i]; // 这是 Image 坐标下的位移 vector
         QPointF offsetImg = QPointF();
         offsetImg.setX(moveOffsets[i].x());
@@ -753,13 +1021,15 @@ QVector<QPainterPath> matchWidget::copyPainterPathWithTransform(const QPainterPa
             offsetScene = pOffset - vecRef;
         }
         double angle = angles[i];
-        QTransform transform;
-        transform.translate(pivotScene.x() + offsetScene.x(), pivotScene.y() + offsetScene.y()); 
-        transform.rotate(angle);
-        transform.translate(-pivotScene.x(), -pivotScene.y()); 
-        // 使用已经转换到场景坐标的 path
-        QPainterPath newPath = transform.map(scenePath);
-        newPaths.append(newPath);
+        // 场景坐标下绕轴心旋转再平移；图像坐标先换到场景坐标
+        const cv::Matx33d sceneRigid = PathBatchTransformer::rigid(cv::Point2f(pivotScene.x(), pivotScene.y()),
+                                                                   cv::Point2f(offsetScene.x(), offsetScene.y()), angle);
+        displayTransforms.push_back(sceneRigid * m_sceneFromImage);
+        m_pathImageTransforms.push_back(imageFromScene * sceneRigid * m_sceneFromImage);
+    }
+    const std::vector<cv::Point2f> displayPoints = m_pathBatch.transform(displayTransforms);
+    for (size_t i = 0; i < displayTransforms.size(); ++i) {
+        newPaths.append(m_pathBatch.toPainterPath(displayPoints.data() + i * static_cast<size_t>(m_pathBatch.pointCount())));
     }
     return newPaths;
 }
@@ -787,21 +1057,10 @@ void matchWidget::scaleinitData()
 bool matchWidget::confirmDrawBtnClicked()
 {
     if (m_drawPaths.isEmpty()) return false;
-    if (!m_ImageDisplayScene) return false;
-    // 获取场景中所有的图元
-    QList<QGraphicsItem*> items = m_ImageDisplayScene->items();
-    QVector<InteractivePathItem*> pathItems;
-    
-    // 筛选出 InteractivePathItem 类型的图元
-    for (QGraphicsItem* item : items) {
-        if (item->type() == InteractivePathItem::Type) {
-            pathItems.append(static_cast<InteractivePathItem*>(item));
-        }
-    }
-
-    // items() 通常按 Z 轴顺序（最上层在前）返回，添加顺序通常是最早的在最下层
-    // 因此需要反转以匹配原始 m_drawPaths 的顺序
-    std::reverse(pathItems.begin(), pathItems.end());
+    auto ms = qobject_cast<MatchScene*>(m_ImageDisplayScene);
+    if (!ms) return false;
+    // DrawTotalPath 按 m_drawPaths 的顺序记录了路径图元，不再遍历场景全部图元
+    const QVector<InteractivePathItem*>& pathItems = ms->pathItems();
 
     // 检查数量是否一致（可选）
     if (pathItems.size() != m_drawPaths.size()) {
@@ -828,6 +1087,11 @@ bool matchWidget::confirmDrawBtnClicked()
             continue;
         }
         anyChanged = true;
+        // 同步批量变换矩阵：各项显示路径都在场景坐标下，拖拽/旋转按同一换算折回图像坐标下的变换
+        if (static_cast<size_t>(i) < m_pathImageTransforms.size()) {
+            const cv::Matx33d drag = PathBatchTransformer::fromQTransform(item->sceneTransform());
+            m_pathImageTransforms[i] = m_sceneFromImage.inv() * drag * m_sceneFromImage * m_pathImageTransforms[i];
+        }
 
         if (i == 0) {
             baseOffset = offset;
@@ -8,6 +8,8 @@
 
 #include "tools/bscvTool.h"
 #include "template/core/TemplateManager.h"
+#include "template/core/MatchTracker.h"
+#include "template/core/PathBatchTransformer.h"
 #include "template/template_global.h"
 #include "../../../interfaces/IMatchPlugin.h"
 #include "../camera/camera.h"
@@ -16,6 +18,7 @@
 #include "../../../interfaces/HeightPluginInterface.h"
 #include "paraWidget.h"
 #include "template/core/client/UDPMatReceiver.h"
+#include "template/core/client/ShmFrameReceiver.h"
 #include "../camera/ImageProcess.h"
 #include "../common/Widget/baseWidget.h"
 #include "../common/Widget/CustomTitleBar.h"
@@ -45,6 +48,8 @@ public:
     bool hasLearnedTemplate() const override;
     bool setMoveRotateData();
     void connectUDPReceiver();
+    void connectShmReceiver(const QString& name = QStringLiteral("heightVisionFrames")); // 同机共享内存取图
+    bool setServerMatchEnabled(bool enable); // 服务端匹配模式：上传模板后由推流服务器匹配，只回传结果
     
 public:
     virtual bool setinitData(const initOrionVisionParam& para) override {
@@ -55,7 +60,8 @@ public:
     virtual CopyItems_Move_Rotate_Data getMoveRotateData() const { return m_MoveRotateData; }
     virtual QVariantMap getMoveRotateDataMap() const;
 
-    virtual std::vector<MatchResult> getMatchResults() const {return m_lastMatchResults;}
+    // 返回传感器整幅坐标下的匹配结果（推流协商了裁剪/降采样时自动换算）
+    virtual std::vector<MatchResult> getMatchResults() const;
 
     virtual bool setMirrorCalibMatrix(const cv::Mat& mat) {
         if(mat.empty()){
@@ -71,6 +77,7 @@ public:
     }
 
     virtual std::vector<cv::Point2f> getPhysicalPoint(const std::vector<cv::Point2f> imagePoint);
+    virtual bool getPhysicalPaths(std::vector<cv::Point2f>& points, std::vector<int>& subpathStarts) override;
 
 signals:
     virtual void sendDrawPath(); // 匹配完成信号
@@ -78,9 +85,12 @@ signals:
 private slots:
     void clearToggled();
     bool learnMatch();
+    bool learnPathMatch(); // 由加工路径直接生成模板
     void confirmMatch(); // 在整幅图像上进行匹配并显示结果
     void OpenImage();
     void onMatchFinished();
+    void onTrackFinished();
+    void onFrameReceived(const cv::Mat& frame, const StreamProtocol::FrameGeometry& geometry);
     void DrawPathBtnClicked();
     bool confirmDrawBtnClicked();
 
@@ -90,12 +100,13 @@ private slots:
 private:
     void init();
     void executeMatch(bool useRoi);
+    void startTrackingFrame(); // 连续匹配模式：用当前帧更新位姿跟踪（上一帧未处理完时跳过）
     void buildMatchParams();
     void buildFindMatchParams(bool useRoi);
 
     void applyLoadedStyleSheet(QWidget* widget);
 
-    void renderMatchResults(const std::vector<MatchResult> &results);
+    void renderMatchResults(const std::vector<MatchResult> &results, bool quiet = false);
     QVector<QPainterPath> copyPainterPathWithTransform(const QPainterPath& originalPath,
                                                       const QVector<QPointF>& moveOffsets,
                                                       const QVector<double>& angles,
@@ -116,6 +127,7 @@ private:
     QToolButton* m_loadcalibBtn;
     QToolButton* m_drawpathBtn;
     QToolButton* m_confirmDrawBtn;
+    QToolButton* m_learnPathBtn;
 
     QToolButton* m_CameraCalibBtn;
     QToolButton* m_testHeightBtn;
@@ -146,10 +158,13 @@ private:
     QSpinBox* m_penWidthSpin = nullptr;
     QCheckBox* m_paraWidgetshow; // 是否显示参数设置面板
     QCheckBox* m_matchselectCheckBox; // 是否模板选择
+    QCheckBox* m_serverMatchCheckBox = nullptr; // 是否启用服务端匹配
+    QCheckBox* m_continuousMatchCheckBox = nullptr; // 是否对每一帧连续匹配并跟踪目标
 
 
     cv::Mat m_currentImage;
     TemplateManager m_templateManager;
+    MatchTracker m_matchTracker{m_templateManager}; // 连续匹配模式的目标跟踪，只在 m_trackWatcher 的后台任务中更新
 
     cv::Mat m_learnedTemplate; // 学习后裁剪得到的模板图像
     std::vector<cv::Point2f> m_learnedFeaturePoints; // 模板上的特征点集合
@@ -160,13 +175,17 @@ private:
     bool m_TemplateAreaConfirmed = false; // 标记模板区域是否已被用户确认
     
     // 异步匹配
-    QFutureWatcher<std::vector<MatchResult>> m_matchWatcher;
+    QFutureWatcher<TemplateManager::MatchJobResult> m_matchWatcher;
+    std::shared_ptr<TemplateManager::CancelToken> m_matchCancelToken; // 当前单次匹配任务，再次点击匹配时取消
+    QFutureWatcher<std::vector<MatchResult>> m_trackWatcher;
 
     MatchParams m_MatchParams;
     FindMatchParams m_FindMatchParams;
     std::vector<MatchResult> m_lastMatchResults; // 保存上一次匹配结果
 
     ImageProcess* m_ImageProcess;
+    UDPMatReceiver* m_udpReceiver = nullptr; // 推流接收器（connectUDPReceiver 创建）
+    StreamProtocol::FrameGeometry m_frameGeometry; // 当前显示图像 -> 传感器整幅坐标映射
 
     CopyItems_Move_Rotate_Data m_MoveRotateData;
 
@@ -178,6 +197,10 @@ private:
     initOrionVisionParam m_cale_initParam;
     QPointF initPoint;
     QVector<QPainterPath> m_drawPaths;
+    // 排版路径的展平缓冲与各副本（第 0 项为原始路径）在图像坐标下的变换，用于批量输出振镜坐标
+    PathBatchTransformer m_pathBatch;
+    std::vector<cv::Matx33d> m_pathImageTransforms;
+    cv::Matx33d m_sceneFromImage = cv::Matx33d::eye();
 
     double m_scaleX;
     double m_scaleY;
@@ -0,0 +1,136 @@
+// 离线批量匹配命令行工具：加载模型包（TemplateManager::saveModel 保存的目录），
+// 对图像文件、目录或列表文件中的图像批量匹配，逐张输出 CSV/JSON 行，并输出吞吐量与延迟分位数汇总。
+//
+// 用法：TemplateBatchMatch --model <模型目录> [--output results.csv|results.jsonl] [--summary summary.json]
+//                          [--workers N] [--match-threads N] [--score 60] [--max-count 5] [--timeout 0]
+//                          [--list images.txt] [--recursive] [--refine] <图像或目录>...
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QTextStream>
+#include <cstdio>
+#include "template/core/BatchMatcher.h"
+#include "template/core/TemplateManager.h"
+
+namespace {
+// 列表文件每行一个路径，忽略空行与 # 开头的注释
+QStringList readImageList(const QString& listFile)
+{
+    QStringList paths;
+    QFile file(listFile);
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+        qWarning().noquote() << QStringLiteral("无法读取图像列表：%1").arg(listFile);
+        return paths;
+    }
+    QTextStream stream(&file);
+    while (!stream.atEnd()) {
+        const QString line = stream.readLine().trimmed();
+        if (!line.isEmpty() && !line.startsWith(QLatin1Char('#'))) {
+            paths.append(line);
+        }
+    }
+    return paths;
+}
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("TemplateBatchMatch"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("对图像文件/目录批量执行模板匹配，输出 CSV/JSON 结果与耗时统计"));
+    parser.addHelpOption();
+    const QCommandLineOption modelOption(QStringLiteral("model"), QStringLiteral("模型包目录"), QStringLiteral("dir"));
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("结果文件（.json/.jsonl 输出 JSON 行，其余输出 CSV），缺省输出到标准输出"), QStringLiteral("file"));
+    const QCommandLineOption formatOption(QStringLiteral("format"), QStringLiteral("csv 或 json，缺省按结果文件扩展名"), QStringLiteral("format"));
+    const QCommandLineOption summaryOption(QStringLiteral("summary"), QStringLiteral("汇总 JSON 文件，缺省输出到标准错误"), QStringLiteral("file"));
+    const QCommandLineOption listOption(QStringLiteral("list"), QStringLiteral("图像列表文件（每行一个路径）"), QStringLiteral("file"));
+    const QCommandLineOption workersOption(QStringLiteral("workers"), QStringLiteral("并发处理的图像数，0 表示 CPU 核数"), QStringLiteral("n"), QStringLiteral("0"));
+    const QCommandLineOption matchThreadsOption(QStringLiteral("match-threads"), QStringLiteral("单张图像匹配内部的线程数，缺省多图并发时为 1"), QStringLiteral("n"));
+    const QCommandLineOption scoreOption(QStringLiteral("score"), QStringLiteral("分数阈值（0~100）"), QStringLiteral("value"), QStringLiteral("60"));
+    const QCommandLineOption maxCountOption(QStringLiteral("max-count"), QStringLiteral("每张图像最多结果数"), QStringLiteral("n"), QStringLiteral("5"));
+    const QCommandLineOption timeoutOption(QStringLiteral("timeout"), QStringLiteral("单张匹配时限（毫秒，0 不限）"), QStringLiteral("ms"), QStringLiteral("0"));
+    const QCommandLineOption recursiveOption(QStringLiteral("recursive"), QStringLiteral("目录输入包含子目录"));
+    const QCommandLineOption refineOption(QStringLiteral("refine"), QStringLiteral("输出前做亚像素位姿精修"));
+    parser.addOptions({modelOption, outputOption, formatOption, summaryOption, listOption, workersOption,
+                       matchThreadsOption, scoreOption, maxCountOption, timeoutOption, recursiveOption, refineOption});
+    parser.addPositionalArgument(QStringLiteral("inputs"), QStringLiteral("图像文件或目录"), QStringLiteral("[inputs...]"));
+    parser.process(app);
+
+    if (!parser.isSet(modelOption)) {
+        qCritical().noquote() << QStringLiteral("缺少 --model 模型包目录");
+        parser.showHelp(1);
+    }
+    TemplateManager manager;
+    if (!manager.loadModel(parser.value(modelOption))) {
+        qCritical().noquote() << QStringLiteral("模型包加载失败：%1").arg(parser.value(modelOption));
+        return 1;
+    }
+
+    QStringList inputs = parser.positionalArguments();
+    if (parser.isSet(listOption)) {
+        inputs.append(readImageList(parser.value(listOption)));
+    }
+    const QStringList images = BatchMatcher::collectImages(inputs, parser.isSet(recursiveOption));
+    if (images.isEmpty()) {
+        qCritical().noquote() << QStringLiteral("没有找到输入图像");
+        return 1;
+    }
+
+    BatchMatcher::Options options;
+    options.workers = parser.value(workersOption).toInt();
+    options.params.scoreThreshold = parser.value(scoreOption).toDouble();
+    options.params.maxCount = parser.value(maxCountOption).toInt();
+    options.params.timeoutMs = parser.value(timeoutOption).toInt();
+    options.params.compactResults = true; // 输出不含特征点
+    options.params.refinePose = parser.isSet(refineOption);
+    // 多图并发时每张图像内部不再并行，避免线程过度订阅；单图顺序处理时沿用自动线程数
+    if (parser.isSet(matchThreadsOption)) {
+        TemplateManager::setMaxMatchThreads(parser.value(matchThreadsOption).toInt());
+    } else if (options.workers != 1) {
+        TemplateManager::setMaxMatchThreads(1);
+    }
+
+    QFile output;
+    if (parser.isSet(outputOption)) {
+        output.setFileName(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical().noquote() << QStringLiteral("无法写入结果文件：%1").arg(output.fileName());
+            return 1;
+        }
+    } else if (!output.open(stdout, QIODevice::WriteOnly)) {
+        return 1;
+    }
+    QString format = parser.value(formatOption).toLower();
+    if (format.isEmpty()) {
+        const QString suffix = QFileInfo(output.fileName()).suffix().toLower();
+        format = suffix == QStringLiteral("json") || suffix == QStringLiteral("jsonl") ? QStringLiteral("json") : QStringLiteral("csv");
+    }
+    const bool json = format == QStringLiteral("json");
+    if (!json) {
+        output.write(BatchMatcher::csvHeader().toUtf8());
+    }
+
+    BatchMatcher matcher(manager);
+    const BatchMatcher::Summary summary = matcher.run(images, options, [&output, json](const BatchMatcher::ImageResult& image) {
+        output.write(json ? BatchMatcher::toJsonLine(image) : BatchMatcher::toCsvRows(image).toUtf8());
+        output.flush();
+    });
+    output.close();
+
+    const QByteArray summaryJson = BatchMatcher::toJson(summary);
+    if (parser.isSet(summaryOption)) {
+        QFile summaryFile(parser.value(summaryOption));
+        if (!summaryFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical().noquote() << QStringLiteral("无法写入汇总文件：%1").arg(summaryFile.fileName());
+            return 1;
+        }
+        summaryFile.write(summaryJson);
+    } else {
+        std::fwrite(summaryJson.constData(), 1, static_cast<size_t>(summaryJson.size()), stderr);
+    }
+    return summary.failed == summary.images ? 1 : 0;
+}
@@ -0,0 +1,158 @@
+// 合成数据集精度/速度回归命令行工具：按固定种子生成带真值的合成场景（旋转、缩放、噪声、遮挡、杂乱背景），
+// 用固定的学习/匹配参数运行 TemplateManager，输出召回率、精确率、位姿误差与各阶段耗时的 JSON 报告；
+// 指定基线报告时比较总体指标，出现回退返回 2，便于在参数调整或匹配库升级前后对比。实现路径之间的一致性由 TemplateTests（ctest）检查。
+//
+// 用法：TemplateBenchmark [--output report.json] [--baseline old.json] [--max-recall-drop 0.02] [--max-slowdown 0.25]
+//                         [--scenes 10] [--instances 3] [--seed 20240601] [--score 70] [--angle-step 1]
+//                         [--features 128] [--scale-min 0.95] [--scale-max 1.05] [--scale-step 0.05] [--refine]
+//                         [--match-threads 1] [--scenes-output scenes.jsonl] [--dump dir] [--studies threads]
+// --studies 在报告的 studies 中追加配置对比：threads 为单次匹配 1/2/4/8 线程的耗时与加速比，
+// coarseToFine 为逐层全图搜索与由粗到精搜索的耗时与精度，refine 为角度步长 1/2/4 度下不精修/精修的精度与速度取舍。
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <algorithm>
+#include <cstdio>
+#include <opencv2/imgcodecs.hpp>
+#include "template/core/SyntheticBenchmark.h"
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("TemplateBenchmark"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("在合成场景上评估模板匹配的精度与速度，输出 JSON 报告并可与基线比较"));
+    parser.addHelpOption();
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("报告文件，缺省输出到标准输出"), QStringLiteral("file"));
+    const QCommandLineOption baselineOption(QStringLiteral("baseline"), QStringLiteral("基线报告（本工具之前的输出）"), QStringLiteral("file"));
+    const QCommandLineOption recallDropOption(QStringLiteral("max-recall-drop"), QStringLiteral("召回率/精确率允许下降的绝对值"), QStringLiteral("value"), QStringLiteral("0.02"));
+    const QCommandLineOption slowdownOption(QStringLiteral("max-slowdown"), QStringLiteral("平均匹配耗时允许增加的比例"), QStringLiteral("value"), QStringLiteral("0.25"));
+    const QCommandLineOption scenesOption(QStringLiteral("scenes"), QStringLiteral("每个形状、每种条件的场景数"), QStringLiteral("n"), QStringLiteral("10"));
+    const QCommandLineOption instancesOption(QStringLiteral("instances"), QStringLiteral("每个场景的实例数"), QStringLiteral("n"), QStringLiteral("3"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("随机种子"), QStringLiteral("n"), QStringLiteral("20240601"));
+    const QCommandLineOption scoreOption(QStringLiteral("score"), QStringLiteral("分数阈值（0~100）"), QStringLiteral("value"), QStringLiteral("70"));
+    const QCommandLineOption angleStepOption(QStringLiteral("angle-step"), QStringLiteral("学习角度步长（度）"), QStringLiteral("value"), QStringLiteral("1"));
+    const QCommandLineOption featuresOption(QStringLiteral("features"), QStringLiteral("学习特征点数"), QStringLiteral("n"), QStringLiteral("128"));
+    const QCommandLineOption scaleMinOption(QStringLiteral("scale-min"), QStringLiteral("最小缩放"), QStringLiteral("value"), QStringLiteral("0.95"));
+    const QCommandLineOption scaleMaxOption(QStringLiteral("scale-max"), QStringLiteral("最大缩放"), QStringLiteral("value"), QStringLiteral("1.05"));
+    const QCommandLineOption scaleStepOption(QStringLiteral("scale-step"), QStringLiteral("缩放步长"), QStringLiteral("value"), QStringLiteral("0.05"));
+    const QCommandLineOption refineOption(QStringLiteral("refine"), QStringLiteral("输出前做亚像素位姿精修"));
+    const QCommandLineOption matchThreadsOption(QStringLiteral("match-threads"), QStringLiteral("单次匹配内部的线程数，0 为自动"), QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption scenesOutputOption(QStringLiteral("scenes-output"), QStringLiteral("逐场景真值与结果（JSON 行）"), QStringLiteral("file"));
+    const QCommandLineOption dumpOption(QStringLiteral("dump"), QStringLiteral("保存模板与场景图像的目录"), QStringLiteral("dir"));
+    const QCommandLineOption studiesOption(QStringLiteral("studies"), QStringLiteral("追加的配置对比，逗号分隔（threads、coarseToFine、refine）"), QStringLiteral("list"));
+    parser.addOptions({outputOption, baselineOption, recallDropOption, slowdownOption, scenesOption, instancesOption, seedOption,
+                       scoreOption, angleStepOption, featuresOption, scaleMinOption, scaleMaxOption, scaleStepOption, refineOption,
+                       matchThreadsOption, scenesOutputOption, dumpOption, studiesOption});
+    parser.process(app);
+
+    SyntheticBenchmark::Options options;
+    options.scenesPerCondition = std::max(1, parser.value(scenesOption).toInt());
+    options.instancesPerScene = std::max(1, parser.value(instancesOption).toInt());
+    options.seed = parser.value(seedOption).toULongLong();
+    options.learn.angleRange = 360.0;
+    options.learn.angle_step = parser.value(angleStepOption).toFloat();
+    options.learn.FeaturePointNum = static_cast<size_t>(std::max(8, parser.value(featuresOption).toInt()));
+    options.learn.scale_min = parser.value(scaleMinOption).toFloat();
+    options.learn.scale_max = parser.value(scaleMaxOption).toFloat();
+    options.learn.scale_step = parser.value(scaleStepOption).toFloat();
+    options.find.scoreThreshold = parser.value(scoreOption).toDouble();
+    options.find.maxCount = options.instancesPerScene + 2; // 多留名额，误检才会体现在精确率中
+    options.find.compactResults = true;
+    options.find.refinePose = parser.isSet(refineOption);
+    // 缺省单线程匹配，耗时不受机器核数与负载波动影响，便于跨版本比较
+    TemplateManager::setMaxMatchThreads(parser.value(matchThreadsOption).toInt());
+
+    QJsonObject baseline;
+    if (parser.isSet(baselineOption)) {
+        QFile baselineFile(parser.value(baselineOption));
+        if (!baselineFile.open(QIODevice::ReadOnly)) {
+            qCritical().noquote() << QStringLiteral("无法读取基线报告：%1").arg(baselineFile.fileName());
+            return 1;
+        }
+        const QJsonDocument document = QJsonDocument::fromJson(baselineFile.readAll());
+        if (!document.isObject()) {
+            qCritical().noquote() << QStringLiteral("基线报告不是 JSON 对象：%1").arg(baselineFile.fileName());
+            return 1;
+        }
+        baseline = document.object();
+    }
+
+    QFile scenesOutput;
+    if (parser.isSet(scenesOutputOption)) {
+        scenesOutput.setFileName(parser.value(scenesOutputOption));
+        if (!scenesOutput.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical().noquote() << QStringLiteral("无法写入场景结果文件：%1").arg(scenesOutput.fileName());
+            return 1;
+        }
+    }
+    const QString dumpDir = parser.value(dumpOption);
+    if (!dumpDir.isEmpty() && !QDir().mkpath(dumpDir)) {
+        qCritical().noquote() << QStringLiteral("无法创建目录：%1").arg(dumpDir);
+        return 1;
+    }
+
+    const SyntheticBenchmark benchmark(options);
+    if (!dumpDir.isEmpty()) {
+        for (const SyntheticBenchmark::Shape& shape : SyntheticBenchmark::builtinShapes()) {
+            cv::imwrite(QDir(dumpDir).filePath(shape.name + QStringLiteral("_template.png")).toLocal8Bit().constData(), shape.templateImage);
+        }
+    }
+    SyntheticBenchmark::Report report = benchmark.run(
+        [&scenesOutput, &dumpDir](const SyntheticBenchmark::Scene& scene, const SyntheticBenchmark::Shape& shape,
+                                  const cv::Point2f& trainCenter, const TemplateManager::MatchJobResult& job) {
+            if (scenesOutput.isOpen()) {
+                scenesOutput.write(SyntheticBenchmark::sceneToJsonLine(scene, shape.name, trainCenter, job));
+            }
+            if (!dumpDir.isEmpty()) {
+                const QString name = QStringLiteral("%1_%2_%3.png")
+                                         .arg(shape.name, SyntheticBenchmark::conditionKey(scene.condition))
+                                         .arg(scene.index, 3, 10, QLatin1Char('0'));
+                cv::imwrite(QDir(dumpDir).filePath(name).toLocal8Bit().constData(), scene.image);
+            }
+        });
+    scenesOutput.close();
+    const QStringList studies = parser.value(studiesOption).split(QLatin1Char(','));
+    for (const QString& study : studies) {
+        if (study.isEmpty()) {
+            continue;
+        } else if (study == QStringLiteral("threads")) {
+            report.studies.push_back(benchmark.measureMatchThreads({1, 2, 4, 8}));
+        } else if (study == QStringLiteral("coarseToFine")) {
+            report.studies.push_back(benchmark.measureCoarseToFine());
+        } else if (study == QStringLiteral("refine")) {
+            report.studies.push_back(benchmark.measurePoseRefinement({1.f, 2.f, 4.f}));
+        } else {
+            qWarning().noquote() << QStringLiteral("未知的配置对比：%1").arg(study);
+        }
+    }
+
+    const QByteArray reportJson = SyntheticBenchmark::toJson(report);
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical().noquote() << QStringLiteral("无法写入报告文件：%1").arg(output.fileName());
+            return 1;
+        }
+        output.write(reportJson);
+    } else {
+        std::fwrite(reportJson.constData(), 1, static_cast<size_t>(reportJson.size()), stdout);
+    }
+
+    if (!baseline.isEmpty()) {
+        const QStringList regressions = SyntheticBenchmark::compare(baseline, report, parser.value(recallDropOption).toDouble(),
+                                                                    parser.value(slowdownOption).toDouble());
+        for (const QString& regression : regressions) {
+            qWarning().noquote() << QStringLiteral("相对基线回退：%1").arg(regression);
+        }
+        if (!regressions.isEmpty()) {
+            return 2;
+        }
+        qInfo().noquote() << QStringLiteral("与基线相比没有回退");
+    }
+    return report.overall.truths > 0 ? 0 : 1;
+}
@@ -0,0 +1,628 @@
+// 帧传输基准命令行工具：在同一进程内由发送线程产生合成相机帧，用实际使用的接收器（ShmFrameReceiver / UDPMatReceiver）接收，
+// 对比同机共享内存帧环与 JPEG + UDP 回环两种传输：延迟阶段逐帧等待送达（发送开始到接收器发出 frameReady），
+// 吞吐阶段连续发送不等待，统计送达帧率与丢帧；输出 JSON 报告。
+// --streams N 时另在同一 UDP 端口上交错发送 N 路模拟流（各路像素格式/降采样不同），逐路核对 UDPMatReceiver 的
+// 分路统计与实际送达的帧，检查未通过返回 2。
+//
+// 用法：TemplateTransportBench [--output report.json] [--transport both|shm|udp|none] [--width 1280] [--height 1024]
+//                              [--channels 1] [--frames 200] [--seconds 3] [--seed 20240601]
+//                              [--streams 4] [--stream-frames 150] [--stream-fps 30]
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QStringList>
+#include <QUdpSocket>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <opencv2/imgproc.hpp>
+#include "template/core/client/ShmFrameReceiver.h"
+#include "template/core/client/ShmFrameRing.h"
+#include "template/core/client/StreamProtocol.h"
+#include "template/core/client/UDPMatReceiver.h"
+
+namespace {
+
+struct Options {
+    cv::Size size{1280, 1024};
+    int      channels = 1;
+    int      frames = 200;     // 延迟阶段的帧数
+    double   seconds = 3.0;    // 吞吐阶段的时长
+    uint64_t seed = 20240601;
+};
+
+// 发送线程与主线程（接收器所在线程）共享的计数
+struct Shared {
+    enum Phase { WarmUp, Latency, Throughput, Done };
+    std::atomic<int>      phase{WarmUp};
+    std::atomic<uint64_t> delivered{0};
+    std::atomic<uint64_t> sentUs{0}; // 延迟阶段当前帧开始发送的时刻
+};
+
+// 一种传输的测量结果；latenciesMs 只由主线程写，其余只由发送线程写，发送线程结束后汇总
+struct TransportResult {
+    QString  name;
+    QString  error;
+    std::vector<double> latenciesMs;
+    int      latencyLost = 0;       // 延迟阶段超时未送达的帧
+    uint64_t wireBytes = 0;         // 吞吐阶段发送的字节（UDP 含包头，共享内存为像素字节）
+    uint64_t throughputSent = 0;
+    uint64_t throughputDelivered = 0;
+    double   throughputSeconds = 0.0;
+};
+
+// 发送一帧，返回写入传输的字节数，0 表示失败
+using SendFrame = std::function<uint64_t(const cv::Mat& frame, uint32_t frameId)>;
+
+// 合成相机帧：渐变背景 + 随机几何图形 + 传感器噪声，JPEG 压缩率接近真实工件图像
+std::vector<cv::Mat> makeFrames(const Options& options, int count)
+{
+    std::vector<cv::Mat> frames;
+    for (int i = 0; i < count; ++i) {
+        cv::RNG rng(options.seed + static_cast<uint64_t>(i));
+        cv::Mat gray(options.size, CV_8UC1);
+        for (int y = 0; y < gray.rows; ++y) {
+            gray.row(y).setTo(cv::Scalar(40 + 80 * y / std::max(1, gray.rows - 1)));
+        }
+        for (int k = 0; k < 30; ++k) {
+            const cv::Point center(rng.uniform(0, gray.cols), rng.uniform(0, gray.rows));
+            const int radius = rng.uniform(10, std::max(11, gray.cols / 12));
+            const cv::Scalar color(rng.uniform(0, 256));
+            if (k % 2 == 0) {
+                cv::circle(gray, center, radius, color, cv::FILLED, cv::LINE_AA);
+            } else {
+                cv::rectangle(gray, center, center + cv::Point(radius, radius / 2), color, cv::FILLED, cv::LINE_AA);
+            }
+        }
+        cv::Mat noise(gray.size(), CV_8UC1);
+        rng.fill(noise, cv::RNG::NORMAL, 0, 3);
+        cv::add(gray, noise, gray);
+        if (options.channels == 3) {
+            cv::Mat bgr;
+            cv::cvtColor(gray, bgr, cv::COLOR_GRAY2BGR);
+            frames.push_back(bgr);
+        } else {
+            frames.push_back(gray);
+        }
+    }
+    return frames;
+}
+
+bool waitDelivered(const Shared& shared, uint64_t target, uint64_t timeoutUs)
+{
+    const uint64_t start = ShmFrameRing::nowUs();
+    while (shared.delivered.load() < target) {
+        if (ShmFrameRing::nowUs() - start > timeoutUs) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+    }
+    return true;
+}
+
+// 模拟推流服务端：等待接收器的握手包记下其地址，之后向其发送数据报。
+// 内含 QUdpSocket，只在发送线程中创建、使用与销毁
+class LoopbackServer {
+public:
+    bool bind(QString& error)
+    {
+        m_socket.setSocketOption(QAbstractSocket::SendBufferSizeSocketOption, 20 * 1024 * 1024);
+        if (!m_socket.bind(QHostAddress::LocalHost, 0)) {
+            error = QStringLiteral("udp bind 失败：%1").arg(m_socket.errorString());
+            return false;
+        }
+        return true;
+    }
+    quint16 port() const { return m_socket.localPort(); }
+    // 读掉接收器发来的握手/保活包；还不知道接收器地址时最多等待 timeoutMs
+    bool readPeer(int timeoutMs)
+    {
+        while (m_socket.hasPendingDatagrams() || (m_peerPort == 0 && m_socket.waitForReadyRead(timeoutMs))) {
+            QByteArray datagram(static_cast<int>(std::max<qint64>(1, m_socket.pendingDatagramSize())), Qt::Uninitialized);
+            m_socket.readDatagram(datagram.data(), datagram.size(), &m_peer, &m_peerPort);
+        }
+        return m_peerPort != 0;
+    }
+    // 按协商模式发送一帧（FrameHeader + FrameData 分片），返回发送的字节数，0 表示失败
+    uint64_t sendFrame(const StreamProtocol::FrameDescriptor& desc, const std::vector<uint8_t>& payload)
+    {
+        uint64_t bytes = 0;
+        for (const auto& packet : StreamProtocol::packetizeFrame(desc, m_transferId++, payload)) {
+            const uint64_t sent = sendPacket(packet);
+            if (sent == 0) {
+                return 0;
+            }
+            bytes += sent;
+        }
+        return bytes;
+    }
+    uint64_t sendPacket(const std::vector<uint8_t>& packet)
+    {
+        const qint64 sent = m_socket.writeDatagram(reinterpret_cast<const char*>(packet.data()),
+                                                   static_cast<qint64>(packet.size()), m_peer, m_peerPort);
+        return sent < 0 ? 0 : static_cast<uint64_t>(sent);
+    }
+    uint32_t nextTransferId() { return m_transferId++; }
+
+private:
+    QUdpSocket   m_socket;
+    QHostAddress m_peer;
+    quint16      m_peerPort = 0;
+    uint32_t     m_transferId = 1;
+};
+
+// 发送线程主体：预热到首帧送达，逐帧测延迟，再连续发送测吞吐
+void produce(const Options& options, const std::vector<cv::Mat>& frames, const SendFrame& send, Shared& shared,
+             TransportResult& result)
+{
+    uint32_t frameId = 0;
+    const uint64_t warmUpStart = ShmFrameRing::nowUs();
+    while (shared.delivered.load() == 0) {
+        if (ShmFrameRing::nowUs() - warmUpStart > 5000000) {
+            result.error = QStringLiteral("5 秒内没有帧送达接收器");
+            return;
+        }
+        send(frames[frameId % frames.size()], frameId);
+        ++frameId;
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200)); // 预热中途发出的帧全部送达后再计时
+
+    shared.phase = Shared::Latency;
+    for (int i = 0; i < options.frames; ++i) {
+        const uint64_t target = shared.delivered.load() + 1;
+        shared.sentUs = ShmFrameRing::nowUs();
+        if (send(frames[frameId % frames.size()], frameId) == 0) {
+            result.error = QStringLiteral("发送失败");
+            return;
+        }
+        ++frameId;
+        if (!waitDelivered(shared, target, 1000000)) {
+            ++result.latencyLost;
+        }
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    shared.phase = Shared::Throughput;
+    const uint64_t deliveredBefore = shared.delivered.load();
+    const uint64_t start = ShmFrameRing::nowUs();
+    const uint64_t durationUs = static_cast<uint64_t>(options.seconds * 1e6);
+    uint64_t now = start;
+    while (now - start < durationUs) {
+        result.wireBytes += send(frames[frameId % frames.size()], frameId);
+        ++frameId;
+        ++result.throughputSent;
+        now = ShmFrameRing::nowUs();
+    }
+    result.throughputDelivered = shared.delivered.load() - deliveredBefore;
+    result.throughputSeconds = (now - start) / 1e6;
+    shared.phase = Shared::Done;
+}
+
+// 启动接收器与发送线程，运行事件循环直到发送线程结束；setup 在发送线程中准备发送端，失败时返回 false
+TransportResult runTransport(const QString& name, const Options& options, const std::vector<cv::Mat>& frames,
+                             IFrameReceiver& receiver, const std::function<void()>& startReceiver,
+                             const std::function<bool(SendFrame&, QString&)>& setup)
+{
+    TransportResult result;
+    result.name = name;
+    Shared shared;
+    const auto onFrame = [&shared, &result](const cv::Mat&) {
+        if (shared.phase.load() == Shared::Latency) {
+            result.latenciesMs.push_back((ShmFrameRing::nowUs() - shared.sentUs.load()) / 1000.0);
+        }
+        ++shared.delivered;
+    };
+    const QMetaObject::Connection connection = QObject::connect(&receiver, &IFrameReceiver::frameReady, &receiver, onFrame);
+
+    std::promise<bool> ready;
+    std::future<bool> readyFuture = ready.get_future();
+    std::thread producer([&]() {
+        SendFrame send;
+        QString error;
+        const bool ok = setup(send, error);
+        ready.set_value(ok);
+        if (ok) {
+            produce(options, frames, send, shared, result);
+        } else {
+            result.error = error;
+        }
+        QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+    });
+    if (readyFuture.get()) {
+        startReceiver();
+    }
+    QCoreApplication::exec();
+    producer.join();
+    receiver.stop();
+    QObject::disconnect(connection);
+    return result;
+}
+
+double percentile(std::vector<double> values, double ratio)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const size_t index = std::min(values.size() - 1, static_cast<size_t>(ratio * (values.size() - 1) + 0.5));
+    return values[index];
+}
+
+QJsonObject toJson(const TransportResult& result)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("transport"), result.name);
+    if (!result.error.isEmpty()) {
+        object.insert(QStringLiteral("error"), result.error);
+        return object;
+    }
+    double sum = 0.0;
+    for (double ms : result.latenciesMs) {
+        sum += ms;
+    }
+    QJsonObject latency;
+    latency.insert(QStringLiteral("frames"), static_cast<int>(result.latenciesMs.size()));
+    latency.insert(QStringLiteral("lost"), result.latencyLost);
+    latency.insert(QStringLiteral("meanMs"), result.latenciesMs.empty() ? 0.0 : sum / result.latenciesMs.size());
+    latency.insert(QStringLiteral("p50Ms"), percentile(result.latenciesMs, 0.5));
+    latency.insert(QStringLiteral("p90Ms"), percentile(result.latenciesMs, 0.9));
+    latency.insert(QStringLiteral("p99Ms"), percentile(result.latenciesMs, 0.99));
+    latency.insert(QStringLiteral("maxMs"), percentile(result.latenciesMs, 1.0));
+    object.insert(QStringLiteral("latency"), latency);
+
+    QJsonObject throughput;
+    const double seconds = std::max(1e-9, result.throughputSeconds);
+    throughput.insert(QStringLiteral("seconds"), result.throughputSeconds);
+    throughput.insert(QStringLiteral("sent"), static_cast<double>(result.throughputSent));
+    throughput.insert(QStringLiteral("delivered"), static_cast<double>(result.throughputDelivered));
+    throughput.insert(QStringLiteral("sentFps"), result.throughputSent / seconds);
+    throughput.insert(QStringLiteral("deliveredFps"), result.throughputDelivered / seconds);
+    throughput.insert(QStringLiteral("wireMBps"), result.wireBytes / seconds / 1e6);
+    throughput.insert(QStringLiteral("bytesPerFrame"),
+                      result.throughputSent > 0 ? static_cast<double>(result.wireBytes) / result.throughputSent : 0.0);
+    object.insert(QStringLiteral("throughput"), throughput);
+    return object;
+}
+
+// 多路流检查中的一路：按各自的请求（像素格式/降采样）编码，传输尺寸由请求推算
+struct StreamCase {
+    StreamProtocol::StreamRequest request;
+    cv::Size expectedSize;
+    uint64_t sent = 0;        // 发送线程写：已发送帧数
+    uint64_t signalled = 0;   // 主线程写：streamFrameReady 次数
+    uint64_t wrongSize = 0;   // 主线程写：尺寸与本路请求不符的帧（各路重组状态串了）
+    bool     hasStats = false;
+    StreamStatsSnapshot stats;
+    QStringList failures;
+};
+
+std::vector<StreamCase> makeStreamCases(int count, const cv::Size& frameSize)
+{
+    std::vector<StreamCase> cases(static_cast<size_t>(count));
+    for (int k = 0; k < count; ++k) {
+        StreamCase& c = cases[static_cast<size_t>(k)];
+        c.request.streamId = static_cast<uint16_t>(k);
+        c.request.format = k % 2 == 0 ? StreamProtocol::PixelFormat::Jpeg : StreamProtocol::PixelFormat::Gray8;
+        c.request.downscale = 1.0f + static_cast<float>(k % 3);
+        c.expectedSize = cv::Size(std::max(1, cvRound(frameSize.width / c.request.downscale)),
+                                  std::max(1, cvRound(frameSize.height / c.request.downscale)));
+    }
+    return cases;
+}
+
+// 各路每轮各发一帧，分片在各路之间轮流发送（接收端必须按 streamId 分别重组），按 fps 定速；
+// 发送完等待解码排空后读取 UDPMatReceiver::streamStats。返回错误说明，空表示运行完成
+QString runStreams(const std::vector<cv::Mat>& frames, int framesPerStream, double fps, std::vector<StreamCase>& cases)
+{
+    UDPMatReceiver receiver;
+    QObject::connect(&receiver, &UDPMatReceiver::streamFrameReady, &receiver,
+                     [&cases](quint16 streamId, const cv::Mat& frame, const StreamProtocol::FrameGeometry&) {
+                         if (streamId >= cases.size()) {
+                             return;
+                         }
+                         StreamCase& c = cases[streamId];
+                         ++c.signalled;
+                         if (frame.size() != c.expectedSize) {
+                             ++c.wrongSize;
+                         }
+                     });
+
+    QString error;
+    std::promise<quint16> portPromise;
+    std::future<quint16> portFuture = portPromise.get_future();
+    std::thread sender([&]() {
+        LoopbackServer server;
+        if (!server.bind(error)) {
+            portPromise.set_value(0);
+            QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+            return;
+        }
+        portPromise.set_value(server.port());
+        if (!server.readPeer(3000)) {
+            error = QStringLiteral("3 秒内没有收到接收器的握手包");
+            QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+            return;
+        }
+        const auto interval = std::chrono::microseconds(static_cast<int64_t>(1e6 / fps));
+        auto next = std::chrono::steady_clock::now();
+        std::vector<std::vector<std::vector<uint8_t>>> packets(cases.size());
+        for (int f = 0; f < framesPerStream && error.isEmpty(); ++f) {
+            for (size_t k = 0; k < cases.size(); ++k) {
+                StreamProtocol::FrameDescriptor desc;
+                std::vector<uint8_t> payload;
+                if (!StreamProtocol::encodeFramePayload(frames[static_cast<size_t>(f) % frames.size()], cases[k].request,
+                                                        desc, payload)) {
+                    error = QStringLiteral("流 %1 编码失败").arg(k);
+                    break;
+                }
+                desc.frameId = static_cast<uint32_t>(f);
+                desc.captureTimeUs = ShmFrameRing::nowUs();
+                packets[k] = StreamProtocol::packetizeFrame(desc, server.nextTransferId(), payload);
+            }
+            for (size_t i = 0; error.isEmpty(); ++i) {
+                bool any = false;
+                for (size_t k = 0; k < cases.size(); ++k) {
+                    if (i < packets[k].size()) {
+                        server.sendPacket(packets[k][i]);
+                        any = true;
+                    }
+                }
+                if (!any) {
+                    break;
+                }
+            }
+            for (StreamCase& c : cases) {
+                ++c.sent;
+            }
+            server.readPeer(0); // 读掉保活包
+            next += interval;
+            std::this_thread::sleep_until(next);
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(300)); // 等待最后几帧解码完成
+        QMetaObject::invokeMethod(QCoreApplication::instance(), "quit", Qt::QueuedConnection);
+    });
+    const quint16 port = portFuture.get();
+    if (port != 0) {
+        receiver.start(QStringLiteral("127.0.0.1"), port);
+    }
+    QCoreApplication::exec();
+    sender.join();
+    for (size_t k = 0; k < cases.size(); ++k) {
+        cases[k].hasStats = receiver.streamStats(static_cast<quint16>(k), cases[k].stats);
+    }
+    receiver.stop();
+    return error;
+}
+
+// 逐路核对：统计存在；统计的解码帧数与 streamFrameReady 次数一致；没有串流；没有解码错误；
+// 已解码 + 丢失 + 丢弃与发送数最多差 1（读取统计时最后一帧可能仍未收齐）；回环上送达率不低于 90%
+void checkStream(StreamCase& c)
+{
+    if (!c.hasStats) {
+        c.failures.append(QStringLiteral("接收端没有该路统计"));
+        return;
+    }
+    const StreamStatsSnapshot& st = c.stats;
+    if (st.frames != c.signalled) {
+        c.failures.append(QStringLiteral("统计帧数 %1 与实际送达 %2 不一致").arg(st.frames).arg(c.signalled));
+    }
+    if (c.wrongSize > 0) {
+        c.failures.append(QStringLiteral("%1 帧尺寸与本路请求不符").arg(c.wrongSize));
+    }
+    if (st.decodeErrors > 0) {
+        c.failures.append(QStringLiteral("%1 帧解码失败").arg(st.decodeErrors));
+    }
+    const uint64_t accounted = st.frames + st.lostFrames + st.droppedFrames + st.decodeErrors;
+    if (accounted > c.sent || c.sent - accounted > 1) {
+        c.failures.append(QStringLiteral("解码 %1 + 丢失 %2 + 丢弃 %3 + 错误 %4 与发送 %5 对不上")
+                              .arg(st.frames).arg(st.lostFrames).arg(st.droppedFrames).arg(st.decodeErrors).arg(c.sent));
+    }
+    if (st.frames * 10 < c.sent * 9) {
+        c.failures.append(QStringLiteral("送达 %1/%2 帧，低于 90%").arg(st.frames).arg(c.sent));
+    }
+    if (st.bytes == 0) {
+        c.failures.append(QStringLiteral("接收字节数为 0"));
+    }
+}
+
+QJsonObject toJson(const StreamCase& c)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("streamId"), static_cast<int>(c.request.streamId));
+    object.insert(QStringLiteral("format"), c.request.format == StreamProtocol::PixelFormat::Jpeg ? QStringLiteral("jpeg")
+                                                                                                  : QStringLiteral("gray8"));
+    object.insert(QStringLiteral("width"), c.expectedSize.width);
+    object.insert(QStringLiteral("height"), c.expectedSize.height);
+    object.insert(QStringLiteral("sent"), static_cast<double>(c.sent));
+    object.insert(QStringLiteral("signalled"), static_cast<double>(c.signalled));
+    object.insert(QStringLiteral("wrongSize"), static_cast<double>(c.wrongSize));
+    const StreamStatsSnapshot& st = c.stats;
+    QJsonObject stats;
+    stats.insert(QStringLiteral("frames"), static_cast<double>(st.frames));
+    stats.insert(QStringLiteral("bytes"), static_cast<double>(st.bytes));
+    stats.insert(QStringLiteral("lostFrames"), static_cast<double>(st.lostFrames));
+    stats.insert(QStringLiteral("droppedFrames"), static_cast<double>(st.droppedFrames));
+    stats.insert(QStringLiteral("decodeErrors"), static_cast<double>(st.decodeErrors));
+    stats.insert(QStringLiteral("fps"), st.fps);
+    stats.insert(QStringLiteral("bitrateKbps"), st.bitrateKbps);
+    stats.insert(QStringLiteral("lossRate"), st.lossRate);
+    stats.insert(QStringLiteral("avgDecodeMs"), st.avgDecodeMs);
+    stats.insert(QStringLiteral("maxDecodeMs"), st.maxDecodeMs);
+    stats.insert(QStringLiteral("maxQueueDepth"), static_cast<int>(st.maxQueueDepth));
+    object.insert(QStringLiteral("stats"), stats);
+    object.insert(QStringLiteral("passed"), c.failures.isEmpty());
+    QJsonArray failures;
+    for (const QString& failure : c.failures) {
+        failures.append(failure);
+    }
+    object.insert(QStringLiteral("failures"), failures);
+    return object;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("TemplateTransportBench"));
+    UDPMatReceiver::registerMetaTypes();
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("对比同机共享内存帧环与 JPEG + UDP 回环的帧传输延迟与吞吐"));
+    parser.addHelpOption();
+    const QCommandLineOption outputOption(QStringLiteral("output"), QStringLiteral("报告文件，缺省输出到标准输出"), QStringLiteral("file"));
+    const QCommandLineOption transportOption(QStringLiteral("transport"), QStringLiteral("both、shm、udp 或 none"), QStringLiteral("name"), QStringLiteral("both"));
+    const QCommandLineOption widthOption(QStringLiteral("width"), QStringLiteral("帧宽度"), QStringLiteral("n"), QStringLiteral("1280"));
+    const QCommandLineOption heightOption(QStringLiteral("height"), QStringLiteral("帧高度"), QStringLiteral("n"), QStringLiteral("1024"));
+    const QCommandLineOption channelsOption(QStringLiteral("channels"), QStringLiteral("通道数（1 或 3）"), QStringLiteral("n"), QStringLiteral("1"));
+    const QCommandLineOption framesOption(QStringLiteral("frames"), QStringLiteral("延迟阶段逐帧测量的帧数"), QStringLiteral("n"), QStringLiteral("200"));
+    const QCommandLineOption secondsOption(QStringLiteral("seconds"), QStringLiteral("吞吐阶段连续发送的时长（秒）"), QStringLiteral("value"), QStringLiteral("3"));
+    const QCommandLineOption seedOption(QStringLiteral("seed"), QStringLiteral("合成帧的随机种子"), QStringLiteral("n"), QStringLiteral("20240601"));
+    const QCommandLineOption streamsOption(QStringLiteral("streams"), QStringLiteral("多路流检查的路数，0 为不运行"), QStringLiteral("n"), QStringLiteral("0"));
+    const QCommandLineOption streamFramesOption(QStringLiteral("stream-frames"), QStringLiteral("多路流检查中每路发送的帧数"), QStringLiteral("n"), QStringLiteral("150"));
+    const QCommandLineOption streamFpsOption(QStringLiteral("stream-fps"), QStringLiteral("多路流检查中每路的帧率"), QStringLiteral("value"), QStringLiteral("30"));
+    parser.addOptions({outputOption, transportOption, widthOption, heightOption, channelsOption, framesOption, secondsOption,
+                       seedOption, streamsOption, streamFramesOption, streamFpsOption});
+    parser.process(app);
+
+    Options options;
+    options.size = cv::Size(std::max(16, parser.value(widthOption).toInt()), std::max(16, parser.value(heightOption).toInt()));
+    options.channels = parser.value(channelsOption).toInt() == 3 ? 3 : 1;
+    options.frames = std::max(1, parser.value(framesOption).toInt());
+    options.seconds = std::max(0.1, parser.value(secondsOption).toDouble());
+    options.seed = parser.value(seedOption).toULongLong();
+    const QString transport = parser.value(transportOption);
+    if (transport != QStringLiteral("both") && transport != QStringLiteral("shm") && transport != QStringLiteral("udp")
+        && transport != QStringLiteral("none")) {
+        qCritical().noquote() << QStringLiteral("未知的传输：%1").arg(transport);
+        return 1;
+    }
+    const std::vector<cv::Mat> frames = makeFrames(options, 8);
+    const uint32_t frameBytes = static_cast<uint32_t>(frames.front().total() * frames.front().elemSize());
+
+    std::vector<TransportResult> results;
+    if (transport == QStringLiteral("both") || transport == QStringLiteral("shm")) {
+        const std::string ringName = "templateTransportBench";
+        ShmFrameRing::Writer writer;
+        ShmFrameReceiver receiver;
+        results.push_back(runTransport(
+            QStringLiteral("shm"), options, frames, receiver,
+            [&receiver, &ringName]() { receiver.start(QString::fromStdString(ringName), 0); },
+            [&writer, &ringName, frameBytes](SendFrame& send, QString& error) {
+                std::string openError;
+                if (!writer.open(ringName, 4, frameBytes, openError)) {
+                    error = QStringLiteral("无法创建共享内存：%1").arg(QString::fromStdString(openError));
+                    return false;
+                }
+                send = [&writer, frameBytes](const cv::Mat& frame, uint32_t) -> uint64_t {
+                    return writer.publish(frame, ShmFrameRing::nowUs()) ? frameBytes : 0;
+                };
+                return true;
+            }));
+        writer.close();
+    }
+    if (transport == QStringLiteral("both") || transport == QStringLiteral("udp")) {
+        // 发送端按协商模式（JPEG）逐帧分片发送
+        std::promise<quint16> portPromise;
+        std::future<quint16> portFuture = portPromise.get_future();
+        UDPMatReceiver receiver;
+        results.push_back(runTransport(
+            QStringLiteral("udp"), options, frames, receiver,
+            [&receiver, &portFuture]() { receiver.start(QStringLiteral("127.0.0.1"), portFuture.get()); },
+            [&portPromise](SendFrame& send, QString& error) {
+                // 服务端由 send 持有，随发送线程中的 send 一起销毁（QObject 须在所属线程析构）
+                auto server = std::make_shared<LoopbackServer>();
+                if (!server->bind(error)) {
+                    portPromise.set_value(0);
+                    return false;
+                }
+                portPromise.set_value(server->port());
+                send = [server](const cv::Mat& frame, uint32_t frameId) -> uint64_t {
+                    if (!server->readPeer(1000)) {
+                        return 0;
+                    }
+                    StreamProtocol::StreamRequest request;
+                    StreamProtocol::FrameDescriptor desc;
+                    std::vector<uint8_t> payload;
+                    if (!StreamProtocol::encodeFramePayload(frame, request, desc, payload)) {
+                        return 0;
+                    }
+                    desc.frameId = frameId;
+                    desc.captureTimeUs = ShmFrameRing::nowUs();
+                    return server->sendFrame(desc, payload);
+                };
+                return true;
+            }));
+    }
+
+    QJsonObject report;
+    QJsonObject frameInfo;
+    frameInfo.insert(QStringLiteral("width"), options.size.width);
+    frameInfo.insert(QStringLiteral("height"), options.size.height);
+    frameInfo.insert(QStringLiteral("channels"), options.channels);
+    frameInfo.insert(QStringLiteral("rawBytes"), static_cast<double>(frameBytes));
+    report.insert(QStringLiteral("frame"), frameInfo);
+    QJsonArray transports;
+    bool failed = false;
+    for (const TransportResult& result : results) {
+        transports.append(toJson(result));
+        if (!result.error.isEmpty()) {
+            qWarning().noquote() << QStringLiteral("%1 传输测量失败：%2").arg(result.name, result.error);
+            failed = true;
+        }
+    }
+    report.insert(QStringLiteral("transports"), transports);
+
+    bool streamsPassed = true;
+    const int streamCount = std::min(parser.value(streamsOption).toInt(), 64);
+    if (streamCount > 0) {
+        std::vector<StreamCase> cases = makeStreamCases(streamCount, options.size);
+        const QString error = runStreams(frames, std::max(1, parser.value(streamFramesOption).toInt()),
+                                         std::max(1.0, parser.value(streamFpsOption).toDouble()), cases);
+        QJsonObject streams;
+        QJsonArray streamArray;
+        if (!error.isEmpty()) {
+            qWarning().noquote() << QStringLiteral("多路流检查运行失败：%1").arg(error);
+            streams.insert(QStringLiteral("error"), error);
+            streamsPassed = false;
+        }
+        for (StreamCase& c : cases) {
+            checkStream(c);
+            for (const QString& failure : c.failures) {
+                qWarning().noquote() << QStringLiteral("流 %1：%2").arg(c.request.streamId).arg(failure);
+            }
+            streamsPassed = streamsPassed && c.failures.isEmpty();
+            streamArray.append(toJson(c));
+        }
+        streams.insert(QStringLiteral("passed"), streamsPassed);
+        streams.insert(QStringLiteral("streams"), streamArray);
+        report.insert(QStringLiteral("multiStream"), streams);
+    }
+
+    const QByteArray reportJson = QJsonDocument(report).toJson(QJsonDocument::Indented);
+    if (parser.isSet(outputOption)) {
+        QFile output(parser.value(outputOption));
+        if (!output.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            qCritical().noquote() << QStringLiteral("无法写入报告文件：%1").arg(output.fileName());
+            return 1;
+        }
+        output.write(reportJson);
+    } else {
+        std::fwrite(reportJson.constData(), 1, static_cast<size_t>(reportJson.size()), stdout);
+    }
+    if (failed) {
+        return 1;
+    }
+    return streamsPassed ? 0 : 2;
+}
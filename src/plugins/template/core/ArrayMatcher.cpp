@@ -0,0 +1,365 @@
+#include "ArrayMatcher.h"
+#include <QDebug>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <limits>
+
+namespace {
+constexpr double kPi = 3.14159265358979323846;
+
+float lengthOf(const cv::Point2f& v)
+{
+    return std::hypot(v.x, v.y);
+}
+
+// 已知各点的格点下标（x 为列、y 为行）时最小二乘求原点与间距向量；
+// 下标只在一个方向变化（单行/单列）或退化时保留传入的间距向量，只求缺失的量
+void solveLattice(const std::vector<cv::Point2f>& points, const std::vector<cv::Point>& indices,
+                  cv::Point2f& origin, cv::Point2f& colPitch, cv::Point2f& rowPitch)
+{
+    const int n = static_cast<int>(points.size());
+    if (n == 0) {
+        return;
+    }
+    bool varyCol = false;
+    bool varyRow = false;
+    for (const cv::Point& index : indices) {
+        varyCol = varyCol || index.x != indices.front().x;
+        varyRow = varyRow || index.y != indices.front().y;
+    }
+    const int unknowns = 1 + (varyCol ? 1 : 0) + (varyRow ? 1 : 0);
+    cv::Mat design(n, unknowns, CV_64F);
+    cv::Mat targetX(n, 1, CV_64F);
+    cv::Mat targetY(n, 1, CV_64F);
+    for (int i = 0; i < n; ++i) {
+        int column = 0;
+        design.at<double>(i, column++) = 1.0;
+        double x = points[i].x;
+        double y = points[i].y;
+        if (varyCol) {
+            design.at<double>(i, column++) = indices[i].x;
+        } else {
+            x -= colPitch.x * indices[i].x;
+            y -= colPitch.y * indices[i].x;
+        }
+        if (varyRow) {
+            design.at<double>(i, column++) = indices[i].y;
+        } else {
+            x -= rowPitch.x * indices[i].y;
+            y -= rowPitch.y * indices[i].y;
+        }
+        targetX.at<double>(i) = x;
+        targetY.at<double>(i) = y;
+    }
+    // 下标共线（例如只有对角线上的点）时法方程奇异，退回只求原点
+    const cv::Mat normal = design.t() * design;
+    if (unknowns > 1 && std::abs(cv::determinant(normal)) < 1e-6) {
+        cv::Point2f sum(0.f, 0.f);
+        for (int i = 0; i < n; ++i) {
+            sum += points[i] - colPitch * static_cast<float>(indices[i].x) - rowPitch * static_cast<float>(indices[i].y);
+        }
+        origin = sum * (1.f / static_cast<float>(n));
+        return;
+    }
+    cv::Mat solutionX;
+    cv::Mat solutionY;
+    cv::solve(design, targetX, solutionX, cv::DECOMP_SVD);
+    cv::solve(design, targetY, solutionY, cv::DECOMP_SVD);
+    int column = 0;
+    origin = cv::Point2f(static_cast<float>(solutionX.at<double>(column)), static_cast<float>(solutionY.at<double>(column)));
+    ++column;
+    if (varyCol) {
+        colPitch = cv::Point2f(static_cast<float>(solutionX.at<double>(column)), static_cast<float>(solutionY.at<double>(column)));
+        ++column;
+    }
+    if (varyRow) {
+        rowPitch = cv::Point2f(static_cast<float>(solutionX.at<double>(column)), static_cast<float>(solutionY.at<double>(column)));
+    }
+}
+
+// 在 [offsetMin, offsetMax] 内选择窗口起点，使 count 个格点中落在图像内的最多
+int bestWindowOffset(int offsetMin, int offsetMax, const std::function<int(int)>& visibleCount)
+{
+    int best = offsetMin;
+    int bestCount = -1;
+    for (int offset = offsetMin; offset <= offsetMax; ++offset) {
+        const int count = visibleCount(offset);
+        if (count > bestCount) {
+            best = offset;
+            bestCount = count;
+        }
+    }
+    return best;
+}
+} // namespace
+
+ArrayMatcher::ArrayMatcher(const TemplateManager& manager)
+    : m_manager(manager)
+{
+}
+
+ArrayMatcher::Lattice ArrayMatcher::fitLattice(const std::vector<cv::Point2f>& centers, float minSpacing, float tolerance,
+                                               std::vector<char>& inliers)
+{
+    Lattice lattice;
+    inliers.assign(centers.size(), 0);
+    if (centers.size() < 2) {
+        return lattice;
+    }
+
+    // 1. 两两位移中最短的作为第一个间距向量，与之夹角超过 30° 的最短位移作为第二个
+    std::vector<cv::Point2f> offsets;
+    for (size_t i = 0; i < centers.size(); ++i) {
+        for (size_t j = i + 1; j < centers.size(); ++j) {
+            cv::Point2f d = centers[j] - centers[i];
+            if (lengthOf(d) < minSpacing) {
+                continue; // 重复实例
+            }
+            if (d.x < 0.f || (d.x == 0.f && d.y < 0.f)) {
+                d = -d;
+            }
+            offsets.push_back(d);
+        }
+    }
+    if (offsets.empty()) {
+        return lattice;
+    }
+    std::sort(offsets.begin(), offsets.end(), [](const cv::Point2f& lhs, const cv::Point2f& rhs) {
+        return lengthOf(lhs) < lengthOf(rhs);
+    });
+    cv::Point2f first = offsets.front();
+    cv::Point2f second(0.f, 0.f);
+    for (const cv::Point2f& d : offsets) {
+        const float sine = std::abs(first.x * d.y - first.y * d.x) / (lengthOf(first) * lengthOf(d));
+        if (sine > 0.5f) {
+            second = d;
+            break;
+        }
+    }
+    const bool collinear = lengthOf(second) <= 0.f;
+    if (collinear) {
+        second = cv::Point2f(-first.y, first.x); // 单行/单列：另一方向按等间距正交补齐，只影响行列数的预测
+    }
+
+    // 2. 更接近水平的向量作为列方向，列方向朝右、行方向朝下
+    cv::Point2f colPitch = std::abs(first.x) >= std::abs(second.x) ? first : second;
+    cv::Point2f rowPitch = std::abs(first.x) >= std::abs(second.x) ? second : first;
+    if (colPitch.x < 0.f) {
+        colPitch = -colPitch;
+    }
+    if (rowPitch.y < 0.f) {
+        rowPitch = -rowPitch;
+    }
+
+    // 3. 以第一个点为原点按当前基底取整得到格点下标，偏离超出容差的视为网格外
+    const float spacing = std::min(lengthOf(colPitch), lengthOf(rowPitch));
+    const cv::Matx22f basis(colPitch.x, rowPitch.x, colPitch.y, rowPitch.y);
+    const cv::Matx22f inverse = basis.inv();
+    std::vector<cv::Point2f> fitPoints;
+    std::vector<cv::Point> fitIndices;
+    for (size_t i = 0; i < centers.size(); ++i) {
+        const cv::Vec2f uv = inverse * cv::Vec2f(centers[i].x - centers[0].x, centers[i].y - centers[0].y);
+        const cv::Point index(static_cast<int>(std::lround(uv[0])), static_cast<int>(std::lround(uv[1])));
+        const cv::Point2f predicted = centers[0] + colPitch * static_cast<float>(index.x) + rowPitch * static_cast<float>(index.y);
+        if (lengthOf(centers[i] - predicted) <= tolerance * spacing) {
+            inliers[i] = 1;
+            fitPoints.push_back(centers[i]);
+            fitIndices.push_back(index);
+        }
+    }
+    if (fitPoints.size() < 2) {
+        return lattice;
+    }
+
+    // 4. 最小二乘精修，并把原点移到左上角的格点
+    cv::Point2f origin = centers[0];
+    solveLattice(fitPoints, fitIndices, origin, colPitch, rowPitch);
+    cv::Point minIndex = fitIndices.front();
+    cv::Point maxIndex = fitIndices.front();
+    for (const cv::Point& index : fitIndices) {
+        minIndex.x = std::min(minIndex.x, index.x);
+        minIndex.y = std::min(minIndex.y, index.y);
+        maxIndex.x = std::max(maxIndex.x, index.x);
+        maxIndex.y = std::max(maxIndex.y, index.y);
+    }
+    lattice.origin = origin + colPitch * static_cast<float>(minIndex.x) + rowPitch * static_cast<float>(minIndex.y);
+    lattice.colPitch = colPitch;
+    lattice.rowPitch = rowPitch;
+    lattice.cols = maxIndex.x - minIndex.x + 1;
+    lattice.rows = maxIndex.y - minIndex.y + 1;
+    lattice.angle = std::atan2(colPitch.y, colPitch.x) * 180.0 / kPi;
+    lattice.valid = lengthOf(colPitch) >= minSpacing && lengthOf(rowPitch) >= minSpacing;
+    if (collinear && lattice.rows > 1 && lattice.cols > 1) {
+        lattice.valid = false;
+    }
+    return lattice;
+}
+
+ArrayMatcher::Result ArrayMatcher::match(const cv::Mat& src, const FindMatchParams& params) const
+{
+    Result result;
+    if (src.empty() || !m_manager.hasTemplate()) {
+        return result;
+    }
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // 1. 全图只找少量锚点实例
+    FindMatchParams anchorParams = params;
+    anchorParams.maxCount = std::max(2, m_params.anchorCount);
+    const std::vector<MatchResult> anchors = m_manager.matchTemplate(src, anchorParams);
+    std::vector<cv::Point2f> centers;
+    float minSpacing = 1.f;
+    for (const MatchResult& anchor : anchors) {
+        centers.push_back(anchor.center);
+        minSpacing = std::max(minSpacing, 0.3f * std::hypot(anchor.featureSize.width, anchor.featureSize.height));
+    }
+
+    // 2. 拟合网格
+    std::vector<char> inliers;
+    Lattice lattice = fitLattice(centers, minSpacing, m_params.fitTolerance, inliers);
+    if (!lattice.valid) {
+        qWarning().noquote() << QStringLiteral("阵列匹配：%1 个锚点不足以确定网格").arg(static_cast<int>(anchors.size()));
+        result.extras = anchors;
+        return result;
+    }
+    double sinSum = 0.0;
+    double cosSum = 0.0;
+    double scaleSum = 0.0;
+    int inlierCount = 0;
+    for (size_t i = 0; i < anchors.size(); ++i) {
+        if (!inliers[i]) {
+            continue;
+        }
+        sinSum += std::sin(anchors[i].angle * kPi / 180.0);
+        cosSum += std::cos(anchors[i].angle * kPi / 180.0);
+        scaleSum += anchors[i].scale;
+        ++inlierCount;
+    }
+    lattice.partAngle = std::atan2(sinSum, cosSum) * 180.0 / kPi;
+    lattice.partScale = scaleSum / std::max(1, inlierCount);
+
+    // 3. 确定要验证的行列范围：给定行列数时在包含全部锚点的窗口中选图像内格点最多的一个，
+    // 未给定时沿两个方向扩展到图像边界
+    const cv::Rect2f imageRect(0.f, 0.f, static_cast<float>(src.cols), static_cast<float>(src.rows));
+    const auto inImage = [&](int row, int col) { return imageRect.contains(lattice.slotCenter(row, col)); };
+    const float spacing = std::min(lengthOf(lattice.colPitch), lengthOf(lattice.rowPitch));
+    const int reach = static_cast<int>(std::ceil(std::hypot(src.cols, src.rows) / std::max(1.f, spacing)));
+    int colBegin = -reach;
+    int colEnd = lattice.cols + reach;
+    int rowBegin = -reach;
+    int rowEnd = lattice.rows + reach;
+    if (m_params.cols > 0) {
+        colBegin = bestWindowOffset(std::min(0, lattice.cols - m_params.cols), std::max(0, lattice.cols - m_params.cols),
+                                    [&](int offset) {
+                                        int count = 0;
+                                        for (int col = offset; col < offset + m_params.cols; ++col) {
+                                            count += inImage(lattice.rows / 2, col) ? 1 : 0;
+                                        }
+                                        return count;
+                                    });
+        colEnd = colBegin + m_params.cols;
+    }
+    if (m_params.rows > 0) {
+        rowBegin = bestWindowOffset(std::min(0, lattice.rows - m_params.rows), std::max(0, lattice.rows - m_params.rows),
+                                    [&](int offset) {
+                                        int count = 0;
+                                        for (int row = offset; row < offset + m_params.rows; ++row) {
+                                            count += inImage(row, lattice.cols / 2) ? 1 : 0;
+                                        }
+                                        return count;
+                                    });
+        rowEnd = rowBegin + m_params.rows;
+    }
+
+    std::vector<TemplateManager::PosePrior> priors;
+    for (int row = rowBegin; row < rowEnd; ++row) {
+        for (int col = colBegin; col < colEnd; ++col) {
+            if (!inImage(row, col)) {
+                continue;
+            }
+            Slot slot;
+            slot.row = row;
+            slot.col = col;
+            slot.predicted = lattice.slotCenter(row, col);
+            result.gridSlots.push_back(slot);
+
+            TemplateManager::PosePrior prior;
+            prior.center = slot.predicted;
+            prior.angle = lattice.partAngle;
+            prior.scale = lattice.partScale;
+            prior.positionRadius = m_params.slotRadius * spacing;
+            prior.angleBand = m_params.angleBand;
+            prior.scaleBand = m_params.scaleBand;
+            priors.push_back(prior);
+        }
+    }
+    if (!result.gridSlots.empty()) {
+        // 行列号从 0 开始：给定行列数时以料盘窗口起点为 0，否则以图像内最靠前的格点为 0
+        int firstRow = std::numeric_limits<int>::max();
+        int firstCol = std::numeric_limits<int>::max();
+        int lastRow = std::numeric_limits<int>::min();
+        int lastCol = std::numeric_limits<int>::min();
+        for (const Slot& slot : result.gridSlots) {
+            firstRow = std::min(firstRow, slot.row);
+            firstCol = std::min(firstCol, slot.col);
+            lastRow = std::max(lastRow, slot.row);
+            lastCol = std::max(lastCol, slot.col);
+        }
+        const int baseRow = m_params.rows > 0 ? rowBegin : firstRow;
+        const int baseCol = m_params.cols > 0 ? colBegin : firstCol;
+        for (Slot& slot : result.gridSlots) {
+            slot.row -= baseRow;
+            slot.col -= baseCol;
+        }
+        lattice.origin = lattice.slotCenter(baseRow, baseCol);
+        lattice.rows = m_params.rows > 0 ? m_params.rows : lastRow - firstRow + 1;
+        lattice.cols = m_params.cols > 0 ? m_params.cols : lastCol - firstCol + 1;
+    }
+
+    // 4. 每个槽位只在预测位置附近验证
+    std::vector<char> found;
+    const std::vector<MatchResult> verified = m_manager.matchAround(src, priors, params, found);
+    std::vector<cv::Point2f> occupiedPoints;
+    std::vector<cv::Point> occupiedIndices;
+    for (size_t i = 0; i < result.gridSlots.size(); ++i) {
+        Slot& slot = result.gridSlots[i];
+        slot.occupied = found[i] != 0;
+        if (slot.occupied) {
+            slot.result = verified[i];
+            occupiedPoints.push_back(slot.result.center);
+            occupiedIndices.emplace_back(slot.col, slot.row);
+            ++result.occupiedCount;
+        } else {
+            ++result.emptyCount;
+        }
+    }
+    // 用全部有料槽位重新精修网格，供输出使用
+    if (occupiedPoints.size() >= 3) {
+        solveLattice(occupiedPoints, occupiedIndices, lattice.origin, lattice.colPitch, lattice.rowPitch);
+        lattice.angle = std::atan2(lattice.colPitch.y, lattice.colPitch.x) * 180.0 / kPi;
+    }
+    result.lattice = lattice;
+
+    // 5. 不在格点上的锚点（以及落在给定行列范围之外的锚点）报告为多余实例
+    const float slotRadius = m_params.slotRadius * spacing;
+    for (size_t i = 0; i < anchors.size(); ++i) {
+        const bool onSlot = inliers[i] && std::any_of(result.gridSlots.begin(), result.gridSlots.end(), [&](const Slot& slot) {
+            return lengthOf(slot.predicted - anchors[i].center) <= slotRadius;
+        });
+        if (!onSlot) {
+            result.extras.push_back(anchors[i]);
+        }
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    qInfo().noquote() << QStringLiteral("阵列匹配：%1x%2 网格，有料 %3，空位 %4，多余 %5，耗时 %6 ms")
+                          .arg(lattice.rows)
+                          .arg(lattice.cols)
+                          .arg(result.occupiedCount)
+                          .arg(result.emptyCount)
+                          .arg(static_cast<int>(result.extras.size()))
+                          .arg(elapsedMs, 0, 'f', 2);
+    return result;
+}
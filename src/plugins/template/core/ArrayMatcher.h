@@ -0,0 +1,69 @@
+#pragma once
+#include <vector>
+#include "TemplateManager.h"
+#include "template/template_global.h"
+
+// 阵列（料盘）匹配：先全图搜索少量锚点实例，由锚点拟合规则网格（原点、行/列间距向量、旋转），
+// 再对每个预测槽位只在其附近的小窗口、窄角度带内验证（TemplateManager::matchAround），
+// 报告有料/空位槽位以及落在网格之外的多余实例。10x10 料盘相当于一次少量结果的全图搜索加约 100 次局部搜索。
+// 网格的行列数未知（rows/cols <= 0）时按图像范围内能预测到的全部格点验证。
+class TEMPLATE_EXPORT ArrayMatcher {
+public:
+    struct Params {
+        int    rows = 0;             // 料盘行数，<=0 表示不限（按图像范围）
+        int    cols = 0;             // 料盘列数，<=0 表示不限
+        int    anchorCount = 9;      // 全图搜索的锚点数，至少需要 3 个不共线的相邻实例才能确定两个间距向量
+        float  slotRadius = 0.25f;   // 槽位验证窗口半径，占较短间距的比例
+        double angleBand = 5.0;      // 槽位验证的角度带宽（度），以锚点的平均角度为中心
+        double scaleBand = 0.03;
+        float  fitTolerance = 0.2f;  // 锚点偏离格点超过较短间距的该比例视为网格之外的多余实例
+    };
+
+    // 拟合得到的网格：第 row 行第 col 列的格点为 origin + col * colPitch + row * rowPitch
+    struct Lattice {
+        cv::Point2f origin{0.f, 0.f};
+        cv::Point2f colPitch{0.f, 0.f};
+        cv::Point2f rowPitch{0.f, 0.f};
+        double      angle = 0.0;     // 列方向相对图像 x 轴的角度（度）
+        double      partAngle = 0.0; // 锚点实例的平均匹配角度（度），槽位验证的角度先验
+        double      partScale = 1.0;
+        int         rows = 0;
+        int         cols = 0;
+        bool        valid = false;
+
+        cv::Point2f slotCenter(int row, int col) const { return origin + colPitch * static_cast<float>(col) + rowPitch * static_cast<float>(row); }
+    };
+
+    struct Slot {
+        int         row = 0;
+        int         col = 0;
+        cv::Point2f predicted{0.f, 0.f};
+        bool        occupied = false;
+        MatchResult result; // occupied 时有效
+    };
+
+    struct Result {
+        Lattice lattice;
+        std::vector<Slot> gridSlots;      // 按行优先排列
+        std::vector<MatchResult> extras;  // 锚点中不在任何格点上的实例
+        int occupiedCount = 0;
+        int emptyCount = 0;
+    };
+
+    explicit ArrayMatcher(const TemplateManager& manager);
+
+    void setParams(const Params& params) { m_params = params; }
+    const Params& params() const { return m_params; }
+
+    // params 的 scoreThreshold/Mask/useRoi/timeoutMs 对锚点搜索与槽位验证都生效，maxCount 被 anchorCount 取代；
+    // 锚点不足以确定网格时 lattice.valid 为 false，gridSlots 为空，锚点全部作为 extras 返回
+    Result match(const cv::Mat& src, const FindMatchParams& params) const;
+
+    // 由实例中心拟合网格（最小二乘），inliers 返回每个点是否落在格点上；点数不足或共线且行列数都大于 1 时返回无效网格
+    static Lattice fitLattice(const std::vector<cv::Point2f>& centers, float minSpacing, float tolerance,
+                              std::vector<char>& inliers);
+
+private:
+    const TemplateManager& m_manager;
+    Params m_params;
+};
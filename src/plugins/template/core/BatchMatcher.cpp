@@ -0,0 +1,284 @@
+#include "BatchMatcher.h"
+#include <QDebug>
+#include <QDir>
+#include <QDirIterator>
+#include <QFileInfo>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <opencv2/imgcodecs.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+namespace {
+const QStringList& imageNameFilters()
+{
+    static const QStringList filters{QStringLiteral("*.png"), QStringLiteral("*.jpg"), QStringLiteral("*.jpeg"),
+                                     QStringLiteral("*.bmp"), QStringLiteral("*.tif"), QStringLiteral("*.tiff")};
+    return filters;
+}
+
+// 输出文件中的状态用英文标识，便于脚本过滤
+QString statusKey(const BatchMatcher::ImageResult& image)
+{
+    if (!image.loaded) {
+        return QStringLiteral("load_failed");
+    }
+    switch (image.status) {
+    case TemplateManager::MatchStatus::TimedOut:
+        return QStringLiteral("timed_out");
+    case TemplateManager::MatchStatus::Cancelled:
+        return QStringLiteral("cancelled");
+    case TemplateManager::MatchStatus::Stale:
+        return QStringLiteral("stale");
+    default:
+        return QStringLiteral("completed");
+    }
+}
+
+QString csvQuoted(QString text)
+{
+    text.replace(QStringLiteral("\""), QStringLiteral("\"\""));
+    return QStringLiteral("\"") + text + QStringLiteral("\"");
+}
+
+QString number(double value, int precision)
+{
+    return QString::number(value, 'f', precision);
+}
+} // namespace
+
+BatchMatcher::BatchMatcher(const TemplateManager& manager)
+    : m_manager(manager)
+{
+}
+
+QStringList BatchMatcher::collectImages(const QStringList& inputs, bool recursive)
+{
+    QStringList images;
+    for (const QString& input : inputs) {
+        const QFileInfo info(input);
+        if (!info.isDir()) {
+            images.append(input);
+            continue;
+        }
+        QStringList found;
+        QDirIterator it(input, imageNameFilters(), QDir::Files,
+                        recursive ? QDirIterator::Subdirectories : QDirIterator::NoIteratorFlags);
+        while (it.hasNext()) {
+            found.append(it.next());
+        }
+        found.sort();
+        images.append(found);
+    }
+    return images;
+}
+
+BatchMatcher::Summary BatchMatcher::run(const QStringList& images, const Options& options, const ResultCallback& onResult) const
+{
+    Summary summary;
+    summary.images = images.size();
+    if (images.isEmpty() || !m_manager.hasTemplate()) {
+        return summary;
+    }
+    const auto startTime = std::chrono::steady_clock::now();
+    int workers = options.workers > 0 ? options.workers : QThread::idealThreadCount();
+    workers = std::max(1, std::min(workers, images.size()));
+
+    std::atomic<int> next{0};
+    std::mutex outputMutex;
+    std::vector<double> latencies;
+    latencies.reserve(static_cast<size_t>(images.size()));
+    // 多个工作线程不能共用主引擎（引擎搜索不加锁），匹配开始前为每个工作线程借出一组独占副本
+    std::vector<std::unique_ptr<TemplateManager::EngineSet>> engineSets(static_cast<size_t>(workers));
+    if (workers > 1) {
+        for (auto& engines : engineSets) {
+            engines = m_manager.acquireEngineSet();
+        }
+    }
+    // 每个工作线程依次领取下一张图像：读图、匹配，再在锁内汇总并回调输出
+    const auto worker = [&](int workerIndex) {
+        const TemplateManager::EngineSet* engines = engineSets[static_cast<size_t>(workerIndex)].get();
+        for (int index = next.fetch_add(1); index < images.size(); index = next.fetch_add(1)) {
+            ImageResult image;
+            image.index = index;
+            image.path = images.at(index);
+            const auto loadStart = std::chrono::steady_clock::now();
+            const cv::Mat frame = cv::imread(image.path.toLocal8Bit().constData(), cv::IMREAD_COLOR);
+            image.loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+            image.loaded = !frame.empty();
+            if (image.loaded) {
+                image.imageSize = frame.size();
+                TemplateManager::MatchJob matchJob = TemplateManager::makeMatchJob(frame, options.params);
+                matchJob.engines = engines;
+                TemplateManager::MatchJobResult job = m_manager.runMatchJob(matchJob);
+                image.status = job.status;
+                image.results = std::move(job.results);
+                image.matchMs = job.elapsedMs;
+            }
+
+            std::lock_guard<std::mutex> lock(outputMutex);
+            if (!image.loaded) {
+                ++summary.failed;
+                qWarning().noquote() << QStringLiteral("批量匹配无法读取图像：%1").arg(image.path);
+            } else {
+                latencies.push_back(image.matchMs);
+                summary.results += static_cast<int>(image.results.size());
+                summary.matchedImages += image.results.empty() ? 0 : 1;
+                summary.timedOut += image.status == TemplateManager::MatchStatus::TimedOut ? 1 : 0;
+            }
+            if (onResult) {
+                onResult(image);
+            }
+        }
+    };
+
+    // 独立线程池：工作线程内的 matchTemplate 还会使用匹配线程池，两者分开避免互相等待
+    QThreadPool pool;
+    pool.setMaxThreadCount(workers);
+    QVector<QFuture<void>> futures;
+    futures.reserve(workers - 1);
+    for (int i = 1; i < workers; ++i) {
+        futures.append(QtConcurrent::run(&pool, [&worker, i]() { worker(i); }));
+    }
+    worker(0); // 调用线程也参与处理
+    for (QFuture<void>& future : futures) {
+        future.waitForFinished();
+    }
+    for (auto& engines : engineSets) {
+        if (engines) {
+            m_manager.releaseEngineSet(std::move(engines));
+        }
+    }
+
+    summary.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    summary.imagesPerSecond = summary.wallMs > 0.0 ? 1000.0 * summary.images / summary.wallMs : 0.0;
+    if (!latencies.empty()) {
+        double total = 0.0;
+        for (double value : latencies) {
+            total += value;
+        }
+        summary.meanMs = total / static_cast<double>(latencies.size());
+        summary.p50Ms = percentile(latencies, 50.0);
+        summary.p90Ms = percentile(latencies, 90.0);
+        summary.p99Ms = percentile(latencies, 99.0);
+        summary.maxMs = *std::max_element(latencies.begin(), latencies.end());
+    }
+    qInfo().noquote() << QStringLiteral("批量匹配 %1 张图像（%2 并发）：失败 %3，有结果 %4，结果数 %5，耗时 %6 ms，%7 张/秒，"
+                                        "单张 P50 %8 ms / P90 %9 ms / P99 %10 ms")
+                          .arg(summary.images)
+                          .arg(workers)
+                          .arg(summary.failed)
+                          .arg(summary.matchedImages)
+                          .arg(summary.results)
+                          .arg(summary.wallMs, 0, 'f', 1)
+                          .arg(summary.imagesPerSecond, 0, 'f', 2)
+                          .arg(summary.p50Ms, 0, 'f', 2)
+                          .arg(summary.p90Ms, 0, 'f', 2)
+                          .arg(summary.p99Ms, 0, 'f', 2);
+    return summary;
+}
+
+double BatchMatcher::percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) {
+        return 0.0;
+    }
+    std::sort(values.begin(), values.end());
+    const double rank = std::min(std::max(p, 0.0), 100.0) / 100.0 * static_cast<double>(values.size() - 1);
+    const size_t lower = static_cast<size_t>(rank);
+    const size_t upper = std::min(lower + 1, values.size() - 1);
+    const double fraction = rank - static_cast<double>(lower);
+    return values[lower] + (values[upper] - values[lower]) * fraction;
+}
+
+QString BatchMatcher::csvHeader()
+{
+    return QStringLiteral("image_index,image,status,width,height,load_ms,match_ms,result_index,score,x,y,angle,scale,"
+                          "rect_cx,rect_cy,rect_w,rect_h,rect_angle\n");
+}
+
+QString BatchMatcher::toCsvRows(const ImageResult& image)
+{
+    // 路径可能含 %n，不经过 arg 替换
+    const QString prefix = QString::number(image.index) + QStringLiteral(",") + csvQuoted(image.path)
+                           + QStringLiteral(",%1,%2,%3,%4,%5")
+                                 .arg(statusKey(image))
+                                 .arg(image.imageSize.width)
+                                 .arg(image.imageSize.height)
+                                 .arg(number(image.loadMs, 3))
+                                 .arg(number(image.matchMs, 3));
+    if (image.results.empty()) {
+        return prefix + QStringLiteral(",,,,,,,,,,,\n");
+    }
+    QString rows;
+    for (size_t i = 0; i < image.results.size(); ++i) {
+        const MatchResult& item = image.results[i];
+        rows += prefix
+                + QStringLiteral(",%1,%2,%3,%4,%5,%6,%7,%8,%9,%10,%11\n")
+                      .arg(static_cast<int>(i))
+                      .arg(number(item.score, 4))
+                      .arg(number(item.center.x, 3))
+                      .arg(number(item.center.y, 3))
+                      .arg(number(item.angle, 3))
+                      .arg(number(item.scale, 4))
+                      .arg(number(item.rotatedRect.center.x, 3))
+                      .arg(number(item.rotatedRect.center.y, 3))
+                      .arg(number(item.rotatedRect.size.width, 3))
+                      .arg(number(item.rotatedRect.size.height, 3))
+                      .arg(number(item.rotatedRect.angle, 3));
+    }
+    return rows;
+}
+
+QByteArray BatchMatcher::toJsonLine(const ImageResult& image)
+{
+    QJsonArray results;
+    for (const MatchResult& item : image.results) {
+        QJsonObject result;
+        result.insert(QStringLiteral("score"), item.score);
+        result.insert(QStringLiteral("x"), item.center.x);
+        result.insert(QStringLiteral("y"), item.center.y);
+        result.insert(QStringLiteral("angle"), item.angle);
+        result.insert(QStringLiteral("scale"), item.scale);
+        result.insert(QStringLiteral("rotatedRect"), QJsonObject{{QStringLiteral("cx"), item.rotatedRect.center.x},
+                                                                 {QStringLiteral("cy"), item.rotatedRect.center.y},
+                                                                 {QStringLiteral("w"), item.rotatedRect.size.width},
+                                                                 {QStringLiteral("h"), item.rotatedRect.size.height},
+                                                                 {QStringLiteral("angle"), item.rotatedRect.angle}});
+        results.append(result);
+    }
+    QJsonObject line;
+    line.insert(QStringLiteral("index"), image.index);
+    line.insert(QStringLiteral("image"), image.path);
+    line.insert(QStringLiteral("status"), statusKey(image));
+    line.insert(QStringLiteral("width"), image.imageSize.width);
+    line.insert(QStringLiteral("height"), image.imageSize.height);
+    line.insert(QStringLiteral("loadMs"), image.loadMs);
+    line.insert(QStringLiteral("matchMs"), image.matchMs);
+    line.insert(QStringLiteral("results"), results);
+    return QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QByteArray BatchMatcher::toJson(const Summary& summary)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("images"), summary.images);
+    object.insert(QStringLiteral("failed"), summary.failed);
+    object.insert(QStringLiteral("matchedImages"), summary.matchedImages);
+    object.insert(QStringLiteral("timedOut"), summary.timedOut);
+    object.insert(QStringLiteral("results"), summary.results);
+    object.insert(QStringLiteral("wallMs"), summary.wallMs);
+    object.insert(QStringLiteral("imagesPerSecond"), summary.imagesPerSecond);
+    object.insert(QStringLiteral("meanMs"), summary.meanMs);
+    object.insert(QStringLiteral("p50Ms"), summary.p50Ms);
+    object.insert(QStringLiteral("p90Ms"), summary.p90Ms);
+    object.insert(QStringLiteral("p99Ms"), summary.p99Ms);
+    object.insert(QStringLiteral("maxMs"), summary.maxMs);
+    return QJsonDocument(object).toJson(QJsonDocument::Indented);
+}
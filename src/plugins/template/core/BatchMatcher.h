@@ -0,0 +1,66 @@
+#pragma once
+#include <functional>
+#include <vector>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include "TemplateManager.h"
+#include "template/template_global.h"
+
+// 离线批量匹配：同一个已学习（或已加载模型包）的模板依次匹配大量存档图像，
+// 用独立的线程池按固定并发数处理（与匹配内部使用的线程池分开，不会互相等待），
+// 每张图像的结果与耗时通过回调输出（CSV/JSON 行），最后汇总吞吐量与延迟分位数，用于离线调参。
+class TEMPLATE_EXPORT BatchMatcher {
+public:
+    struct Options {
+        FindMatchParams params;  // 每张图像的匹配参数（timeoutMs 按单张计时）
+        int  workers = 0;        // 并发处理的图像数，<=0 表示 CPU 核数
+    };
+
+    struct ImageResult {
+        int     index = 0;        // 在输入列表中的序号（回调按完成顺序调用）
+        QString path;
+        bool    loaded = false;
+        cv::Size imageSize;
+        TemplateManager::MatchStatus status = TemplateManager::MatchStatus::Completed;
+        std::vector<MatchResult> results;
+        double  loadMs = 0.0;
+        double  matchMs = 0.0;
+    };
+
+    struct Summary {
+        int    images = 0;
+        int    failed = 0;        // 无法读取的图像数
+        int    matchedImages = 0; // 至少有一个结果的图像数
+        int    timedOut = 0;
+        int    results = 0;
+        double wallMs = 0.0;
+        double imagesPerSecond = 0.0;
+        // 单张匹配耗时（不含读图）
+        double meanMs = 0.0;
+        double p50Ms = 0.0;
+        double p90Ms = 0.0;
+        double p99Ms = 0.0;
+        double maxMs = 0.0;
+    };
+
+    // 回调在工作线程中串行调用（内部加锁），可直接写同一个输出文件
+    using ResultCallback = std::function<void(const ImageResult&)>;
+
+    explicit BatchMatcher(const TemplateManager& manager);
+
+    // 展开输入：文件原样保留，目录取其中的图像文件（按文件名排序，recursive 时包含子目录）
+    static QStringList collectImages(const QStringList& inputs, bool recursive = false);
+    Summary run(const QStringList& images, const Options& options, const ResultCallback& onResult = ResultCallback()) const;
+
+    // 输出格式：CSV 每个结果一行（无结果的图像输出一行空结果），JSON 每张图像一行
+    static QString csvHeader();
+    static QString toCsvRows(const ImageResult& image);
+    static QByteArray toJsonLine(const ImageResult& image);
+    static QByteArray toJson(const Summary& summary);
+    // 线性插值分位数，p 取 0~100
+    static double percentile(std::vector<double> values, double p);
+
+private:
+    const TemplateManager& m_manager;
+};
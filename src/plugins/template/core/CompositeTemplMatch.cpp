@@ -0,0 +1,328 @@
+#include "CompositeTemplMatch.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <opencv2/core.hpp>
+#ifdef BSCV_BUILTIN_MATCHER
+#include <shapematch/shapeMatch.h>
+#endif
+
+namespace {
+const char* const kCompositeFormat = "CompositeTemplMatch";
+
+std::string partFileName(const std::string& fileName, size_t part)
+{
+    return fileName + ".part" + std::to_string(part);
+}
+
+cv::Point2f matchCenter(const TIGER_BSVISION::Match& match)
+{
+    return cv::Point2f(static_cast<float>(match.x) + 0.5f * static_cast<float>(match.width),
+                       static_cast<float>(match.y) + 0.5f * static_cast<float>(match.height));
+}
+
+// 引擎实际生成的模板数；预编译引擎没有对应接口，返回 -1（无法核对）
+int reportedTemplateCount(const TIGER_BSVISION::ITemplMatch& engine)
+{
+#ifdef BSCV_BUILTIN_MATCHER
+    if (const auto* builtin = dynamic_cast<const TIGER_BSVISION::ShapeMatchEngine*>(&engine)) {
+        return static_cast<int>(builtin->memoryUsage().templates);
+    }
+#endif
+    (void)engine;
+    return -1;
+}
+} // namespace
+
+std::vector<CompositeTemplMatch::AngleRange> CompositeTemplMatch::splitAngleRange(float start, float extent, float step, int parts)
+{
+    if (parts <= 1 || step <= 0.f || extent <= 0.f) {
+        AngleRange whole;
+        whole.start = start;
+        whole.extent = extent;
+        whole.angleCount = (step <= 0.f || extent <= 0.f) ? 1 : static_cast<int>(std::floor(extent / step + 1e-4f)) + 1;
+        return {whole};
+    }
+    int total = static_cast<int>(std::floor(extent / step + 1e-4f)) + 1;
+    if (extent >= 360.f - 1e-3f) {
+        // 整圈：start+360 与 start 是同一角度，不分段时也只生成一次
+        total = std::max(1, static_cast<int>(std::ceil(360.f / step - 1e-4f)));
+    }
+    parts = std::min(parts, total);
+    std::vector<AngleRange> ranges;
+    ranges.reserve(static_cast<size_t>(parts));
+    for (int p = 0; p < parts; ++p) {
+        const int first = total * p / parts;
+        const int last = total * (p + 1) / parts; // 不含
+        AngleRange range;
+        range.start = start + step * static_cast<float>(first);
+        // 多留半个步长，避免浮点误差使最后一个角度被引擎舍掉；不会多出一个角度
+        range.extent = step * (static_cast<float>(last - first - 1) + 0.5f);
+        range.angleCount = last - first;
+        ranges.push_back(range);
+    }
+    return ranges;
+}
+
+int CompositeTemplMatch::scaleCount(float scaleMin, float scaleMax, float scaleStep)
+{
+    const float low = std::min(scaleMin, scaleMax);
+    const float high = std::max(scaleMin, scaleMax);
+    if (scaleStep <= 0.f || high - low < 1e-6f) {
+        return 1;
+    }
+    return static_cast<int>(std::floor((high - low) / scaleStep + 1e-4f)) + 1;
+}
+
+std::vector<TIGER_BSVISION::Match> CompositeTemplMatch::suppressDuplicates(std::vector<TIGER_BSVISION::Match> matches)
+{
+    std::stable_sort(matches.begin(), matches.end(),
+                     [](const TIGER_BSVISION::Match& lhs, const TIGER_BSVISION::Match& rhs) { return lhs.similarity > rhs.similarity; });
+    std::vector<TIGER_BSVISION::Match> kept;
+    kept.reserve(matches.size());
+    for (auto& match : matches) {
+        const cv::Point2f center = matchCenter(match);
+        const bool duplicate = std::any_of(kept.begin(), kept.end(), [&center](const TIGER_BSVISION::Match& existing) {
+            const float radius = 0.5f * static_cast<float>(std::max(1, std::min(existing.width, existing.height)));
+            const cv::Point2f d = center - matchCenter(existing);
+            return d.x * d.x + d.y * d.y < radius * radius;
+        });
+        if (!duplicate) {
+            kept.push_back(std::move(match));
+        }
+    }
+    return kept;
+}
+
+bool CompositeTemplMatch::isCompositeModelFile(const std::string& fileName)
+{
+    std::ifstream in(fileName, std::ios::binary);
+    if (!in) {
+        return false;
+    }
+    char head[256] = {0};
+    in.read(head, sizeof(head) - 1);
+    return std::string(head, static_cast<size_t>(in.gcount())).find(kCompositeFormat) != std::string::npos;
+}
+
+CompositeTemplMatch::CompositeTemplMatch(int partCount)
+    : m_requestedParts(std::max(1, partCount))
+{
+}
+
+CompositeTemplMatch::CompositeTemplMatch(std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>> parts,
+                                         std::vector<int> templateCounts)
+    : m_requestedParts(std::max<int>(1, static_cast<int>(parts.size())))
+    , m_parts(std::move(parts))
+    , m_templateCounts(std::move(templateCounts))
+{
+    if (!templateCountsMatch(m_parts, m_templateCounts)) {
+        clear();
+    }
+}
+
+CompositeTemplMatch* CompositeTemplMatch::clone() const
+{
+    std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>> parts;
+    parts.reserve(m_parts.size());
+    for (const auto& part : m_parts) {
+        parts.emplace_back(TIGER_BSVISION::newTemplMatch(part.get()));
+    }
+    return new CompositeTemplMatch(std::move(parts), m_templateCounts);
+}
+
+bool CompositeTemplMatch::create_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                             float _angle_start, float _angle_extent,
+                                             float _angle_step, float _scale_min, float _scale_max, float _scale_step,
+                                             float _weak_thresh, float _strong_thresh,
+                                             size_t _num_features,
+                                             TIGER_BSVISION::CPolarityType _type)
+{
+    // 直接调用时串行构建各段；并行构建由 TemplateManager 调度后经第二个构造函数合并
+    clear();
+    const int scales = scaleCount(_scale_min, _scale_max, _scale_step);
+    for (const AngleRange& range : splitAngleRange(_angle_start, _angle_extent, _angle_step, m_requestedParts)) {
+        std::unique_ptr<TIGER_BSVISION::ITemplMatch> part(TIGER_BSVISION::newTemplMatch());
+        if (!part || !part->create_shape_model(_image, _mask, range.start, range.extent, _angle_step,
+                                               _scale_min, _scale_max, _scale_step,
+                                               _weak_thresh, _strong_thresh, _num_features, _type)) {
+            clear();
+            return false;
+        }
+        m_parts.push_back(std::move(part));
+        m_templateCounts.push_back(range.angleCount * scales);
+    }
+    if (!templateCountsMatch(m_parts, m_templateCounts)) {
+        clear();
+        return false;
+    }
+    return !m_parts.empty();
+}
+
+bool CompositeTemplMatch::create_one_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                                 float _weak_thresh, float _strong_thresh,
+                                                 size_t _num_features, TIGER_BSVISION::CPolarityType _type)
+{
+    clear();
+    std::unique_ptr<TIGER_BSVISION::ITemplMatch> part(TIGER_BSVISION::newTemplMatch());
+    if (!part || !part->create_one_shape_model(_image, _mask, _weak_thresh, _strong_thresh, _num_features, _type)) {
+        return false;
+    }
+    m_parts.push_back(std::move(part));
+    m_templateCounts.push_back(1);
+    return true;
+}
+
+std::vector<TIGER_BSVISION::Match> CompositeTemplMatch::find_shape_model(cv::InputArray _image, cv::InputArray _mask, float _threshold)
+{
+    std::vector<TIGER_BSVISION::Match> all;
+    const cv::Mat image = _image.getMat();
+    const cv::Mat mask = _mask.getMat();
+    int offset = 0;
+    for (size_t i = 0; i < m_parts.size(); ++i) {
+        std::vector<TIGER_BSVISION::Match> partMatches = m_parts[i]->find_shape_model(image, mask, _threshold);
+        for (auto& match : partMatches) {
+            match.template_id += offset;
+            all.push_back(std::move(match));
+        }
+        offset += m_templateCounts[i];
+    }
+    return all;
+}
+
+std::vector<TIGER_BSVISION::Match> CompositeTemplMatch::find_pic_model(cv::InputArray _image, cv::InputArray _model, cv::InputArray _mask,
+                                                                       cv::InputArray _model_mask, float _threshold,
+                                                                       float _angle_start, float _angle_extent,
+                                                                       float _angle_step, float _scale_min,
+                                                                       float _scale_max, float _scale_step,
+                                                                       float _weak_thresh, size_t _num_features)
+{
+    CompositeTemplMatch composite(m_requestedParts);
+    if (!composite.create_shape_model(_model, _model_mask, _angle_start, _angle_extent, _angle_step,
+                                      _scale_min, _scale_max, _scale_step, _weak_thresh, 60.0f, _num_features,
+                                      TIGER_BSVISION::cptIgnore)) {
+        return {};
+    }
+    return composite.find_shape_model(_image, _mask, _threshold);
+}
+
+bool CompositeTemplMatch::locate(int id, size_t& part, int& localId) const
+{
+    if (id < 0) {
+        return false;
+    }
+    for (size_t i = 0; i < m_parts.size(); ++i) {
+        if (id < m_templateCounts[i]) {
+            part = i;
+            localId = id;
+            return true;
+        }
+        id -= m_templateCounts[i];
+    }
+    return false;
+}
+
+TIGER_BSVISION::Template CompositeTemplMatch::getTempl(int p_id) const
+{
+    size_t part = 0;
+    int localId = 0;
+    return locate(p_id, part, localId) ? m_parts[part]->getTempl(localId) : TIGER_BSVISION::Template();
+}
+
+float CompositeTemplMatch::getAngle(int p_id) const
+{
+    size_t part = 0;
+    int localId = 0;
+    return locate(p_id, part, localId) ? m_parts[part]->getAngle(localId) : 0.f;
+}
+
+float CompositeTemplMatch::getScale(int p_id) const
+{
+    size_t part = 0;
+    int localId = 0;
+    return locate(p_id, part, localId) ? m_parts[part]->getScale(localId) : 1.f;
+}
+
+// 索引文件只记录分段数与每段模板数，各段模型写到 <fileName>.part<i>
+bool CompositeTemplMatch::write_shape_model(const cv::String _fileName) const
+{
+    if (isEmpty()) {
+        return false;
+    }
+    for (size_t i = 0; i < m_parts.size(); ++i) {
+        if (!m_parts[i]->write_shape_model(partFileName(_fileName, i))) {
+            return false;
+        }
+    }
+    try {
+        cv::FileStorage fs(_fileName, cv::FileStorage::WRITE | cv::FileStorage::FORMAT_YAML);
+        if (!fs.isOpened()) {
+            return false;
+        }
+        fs << "format" << kCompositeFormat;
+        fs << "template_counts" << m_templateCounts;
+        return true;
+    } catch (const cv::Exception&) {
+        return false;
+    }
+}
+
+bool CompositeTemplMatch::read_shape_model(const cv::String _fileName)
+{
+    std::vector<int> counts;
+    try {
+        cv::FileStorage fs(_fileName, cv::FileStorage::READ);
+        if (!fs.isOpened() || static_cast<std::string>(fs["format"]) != kCompositeFormat) {
+            return false;
+        }
+        fs["template_counts"] >> counts;
+    } catch (const cv::Exception&) {
+        return false;
+    }
+    if (counts.empty()) {
+        return false;
+    }
+    std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>> parts;
+    for (size_t i = 0; i < counts.size(); ++i) {
+        std::unique_ptr<TIGER_BSVISION::ITemplMatch> part(TIGER_BSVISION::newTemplMatch());
+        if (!part || !part->read_shape_model(partFileName(_fileName, i))) {
+            return false;
+        }
+        parts.push_back(std::move(part));
+    }
+    if (!templateCountsMatch(parts, counts)) {
+        return false; // 索引与分段模型不一致，保留当前模型不变
+    }
+    m_parts = std::move(parts);
+    m_templateCounts = std::move(counts);
+    m_requestedParts = static_cast<int>(m_parts.size());
+    return true;
+}
+
+bool CompositeTemplMatch::templateCountsMatch(const std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>>& parts,
+                                              const std::vector<int>& templateCounts)
+{
+    if (templateCounts.size() != parts.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < parts.size(); ++i) {
+        const int reported = parts[i] ? reportedTemplateCount(*parts[i]) : -1;
+        if (reported >= 0 && reported != templateCounts[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CompositeTemplMatch::isEmpty() const
+{
+    return m_parts.empty()
+           || std::any_of(m_parts.begin(), m_parts.end(),
+                          [](const std::unique_ptr<TIGER_BSVISION::ITemplMatch>& part) { return !part || part->isEmpty(); });
+}
+
+void CompositeTemplMatch::clear()
+{
+    m_parts.clear();
+    m_templateCounts.clear();
+}
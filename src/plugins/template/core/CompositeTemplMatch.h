@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <vector>
+#include <bscv/templmatch.h>
+
+// 把同一模板按角度分段、由多个引擎分别生成的模型合并成一个 ITemplMatch：
+// 学习时各段可以并行构建，匹配时依次查询各段并合并结果，对调用方与单个引擎等价。
+// 跨段不做额外去重（各段模板互不重叠，重复目标与单个引擎一样交给 TemplateManager 的 NMS），保证与不分段输出一致。
+// 模板编号按段顺序连续编排：段 i 的局部编号加上前面各段的模板数。
+class CompositeTemplMatch : public TIGER_BSVISION::ITemplMatch {
+public:
+    // 角度分段：与不分段时生成的离散角度集合完全一致，只是切成连续的几段
+    struct AngleRange {
+        float start = 0.f;
+        float extent = 0.f;
+        int   angleCount = 1;
+    };
+    // 把 [start, start+extent] 按 step 离散后均分为至多 parts 段（整圈时不重复首尾角度）
+    static std::vector<AngleRange> splitAngleRange(float start, float extent, float step, int parts);
+    // 缩放步进数，与角度数相乘即每段的模板数
+    static int scaleCount(float scaleMin, float scaleMax, float scaleStep);
+    // 合并多个引擎的结果：按分数降序，中心距离小于半个模板尺寸的视为同一目标只保留最高分（按需模型的相邻区间使用）
+    static std::vector<TIGER_BSVISION::Match> suppressDuplicates(std::vector<TIGER_BSVISION::Match> matches);
+    // 判断 write_shape_model 写出的文件是否为分段模型索引（只读文件头，不解析分段模型）
+    static bool isCompositeModelFile(const std::string& fileName);
+    // 编号换算依赖每段的模板数（角度数 × 缩放数）：parts 与 templateCounts 一一对应，
+    // 且引擎能报告模板数时两者一致才返回 true（预编译引擎无法核对，视为一致）
+    static bool templateCountsMatch(const std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>>& parts,
+                                    const std::vector<int>& templateCounts);
+
+    explicit CompositeTemplMatch(int partCount = 2);
+    // parts 与 templateCounts 一一对应，templateCounts[i] 为第 i 段的模板数；
+    // 调用方应先用 templateCountsMatch 核对，不一致时构造为空模型（isEmpty() 为 true）
+    CompositeTemplMatch(std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>> parts, std::vector<int> templateCounts);
+
+    // 复制各段引擎（newTemplMatch(ITemplMatch*)），供并行匹配使用
+    CompositeTemplMatch* clone() const;
+    size_t partCount() const { return m_parts.size(); }
+    // 第 i 段引擎及其模板数（内存统计用），越界返回 nullptr / 0
+    const TIGER_BSVISION::ITemplMatch* part(size_t i) const { return i < m_parts.size() ? m_parts[i].get() : nullptr; }
+    int templateCount(size_t i) const { return i < m_templateCounts.size() ? m_templateCounts[i] : 0; }
+
+    bool create_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                            float _angle_start, float _angle_extent,
+                            float _angle_step, float _scale_min, float _scale_max, float _scale_step,
+                            float _weak_thresh, float _strong_thresh,
+                            size_t _num_features,
+                            TIGER_BSVISION::CPolarityType _type) override;
+    bool create_one_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                float _weak_thresh, float _strong_thresh,
+                                size_t _num_features, TIGER_BSVISION::CPolarityType _type) override;
+
+    std::vector<TIGER_BSVISION::Match> find_shape_model(cv::InputArray _image, cv::InputArray _mask, float _threshold) override;
+    std::vector<TIGER_BSVISION::Match> find_pic_model(cv::InputArray _image, cv::InputArray _model, cv::InputArray _mask,
+                                                      cv::InputArray _model_mask, float _threshold,
+                                                      float _angle_start, float _angle_extent,
+                                                      float _angle_step, float _scale_min,
+                                                      float _scale_max, float _scale_step,
+                                                      float _weak_thresh, size_t _num_features) override;
+
+    TIGER_BSVISION::Template getTempl(int p_id) const override;
+    float getAngle(int p_id) const override;
+    float getScale(int p_id) const override;
+
+    bool write_shape_model(const cv::String _fileName) const override;
+    bool read_shape_model(const cv::String _fileName) override;
+
+    bool isEmpty() const override;
+    void clear() override;
+
+private:
+    // 全局模板编号 → (段, 段内编号)，越界返回 false
+    bool locate(int id, size_t& part, int& localId) const;
+
+    int m_requestedParts = 2;
+    std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>> m_parts;
+    std::vector<int> m_templateCounts;
+};
@@ -0,0 +1,161 @@
+#include "ImagePyramid.h"
+#include <algorithm>
+#include <opencv2/imgproc.hpp>
+
+void ImagePyramid::reset(const cv::Mat& src, const cv::Mat& mask)
+{
+    for (Level& level : m_levels) {
+        level.imageReady = false;
+        level.maskReady = false;
+        level.maskedReady = false;
+    }
+
+    Level& base = m_levels[0];
+    if (src.empty()) {
+        base.image.release();
+    } else if (src.channels() == 1 && src.isContinuous()) {
+        base.image = src; // 灰度输入只读引用，不拷贝
+    } else if (src.channels() == 1) {
+        src.copyTo(m_gray); // 不连续（ROI 视图）：拷贝成连续缓冲，同尺寸时复用 m_gray
+        base.image = m_gray;
+    } else {
+        const int code = src.channels() == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY;
+        cv::cvtColor(src, m_gray, code); // 同尺寸时复用 m_gray
+        base.image = m_gray;
+    }
+    base.imageReady = !base.image.empty();
+
+    m_hasMask = !mask.empty() && !base.image.empty();
+    if (!m_hasMask) {
+        base.maskChain.release();
+        return;
+    }
+    if (mask.type() == CV_8UC1 && mask.isContinuous()) {
+        base.maskChain = mask;
+    } else if (mask.type() == CV_8UC1) {
+        mask.copyTo(m_maskGray);
+        base.maskChain = m_maskGray;
+    } else if (mask.channels() > 1) {
+        cv::cvtColor(mask, m_maskGray, cv::COLOR_BGR2GRAY); // 多通道掩膜转为灰度
+        base.maskChain = m_maskGray;
+    } else {
+        mask.convertTo(m_maskGray, CV_8U); // 确保数据类型为 8 位无符号整型
+        base.maskChain = m_maskGray;
+    }
+}
+
+void ImagePyramid::release()
+{
+    // 第 0 层可能引用调用方的图像/掩膜，放回池前断开，避免延长外部图像的生命周期
+    m_levels[0].image = cv::Mat();
+    m_levels[0].maskChain = cv::Mat();
+    for (Level& level : m_levels) {
+        if (level.imageAliased) {
+            level.image = cv::Mat();
+            level.imageAliased = false;
+        }
+        if (level.maskAliased) {
+            level.maskChain = cv::Mat();
+            level.maskAliased = false;
+        }
+        level.imageReady = false;
+        level.maskReady = false;
+        level.maskedReady = false;
+    }
+    m_hasMask = false;
+}
+
+size_t ImagePyramid::bufferBytes() const
+{
+    const auto bytes = [](const cv::Mat& mat) { return mat.total() * mat.elemSize(); };
+    size_t total = bytes(m_gray) + bytes(m_maskGray);
+    for (size_t i = 0; i < m_levels.size(); ++i) {
+        const Level& level = m_levels[i];
+        // 第 0 层 image/maskChain 引用外部输入或上面两个缓冲，不重复计算
+        if (i > 0 && !level.imageAliased) {
+            total += bytes(level.image);
+        }
+        if (i > 0 && !level.maskAliased) {
+            total += bytes(level.maskChain);
+        }
+        total += bytes(level.mask) + bytes(level.masked);
+    }
+    return total;
+}
+
+int ImagePyramid::clampLevel(int level) const
+{
+    return std::clamp(level, 0, kMaxLevels);
+}
+
+const cv::Mat& ImagePyramid::image(int level)
+{
+    level = clampLevel(level);
+    Level& current = m_levels[level];
+    if (current.imageReady || level == 0) {
+        return current.image;
+    }
+    const cv::Mat& previous = image(level - 1);
+    if (current.imageAliased) {
+        current.image = cv::Mat(); // 上一帧此层引用的是上一层，断开后再写
+        current.imageAliased = false;
+    }
+    if (previous.cols < 2 || previous.rows < 2) {
+        current.image = previous; // 已无法继续降采样
+        current.imageAliased = true;
+    } else {
+        cv::pyrDown(previous, current.image);
+    }
+    current.imageReady = true;
+    return current.image;
+}
+
+const cv::Mat& ImagePyramid::mask(int level)
+{
+    static const cv::Mat kEmpty;
+    if (!m_hasMask) {
+        return kEmpty;
+    }
+    level = clampLevel(level);
+    Level& current = m_levels[level];
+    if (current.maskReady) {
+        return current.mask;
+    }
+    if (level > 0) {
+        mask(level - 1); // 确保上一层的降采样链已生成
+        const cv::Mat& previous = m_levels[level - 1].maskChain;
+        if (current.maskAliased) {
+            current.maskChain = cv::Mat();
+            current.maskAliased = false;
+        }
+        if (previous.cols < 2 || previous.rows < 2) {
+            current.maskChain = previous;
+            current.maskAliased = true;
+        } else {
+            cv::pyrDown(previous, current.maskChain);
+        }
+    }
+    cv::threshold(current.maskChain, current.mask, 1, 255, cv::THRESH_BINARY);
+    current.maskReady = true;
+    return current.mask;
+}
+
+const cv::Mat& ImagePyramid::maskedImage(int level)
+{
+    level = clampLevel(level);
+    Level& current = m_levels[level];
+    if (current.maskedReady) {
+        return current.masked;
+    }
+    const cv::Mat& levelImage = image(level);
+    const cv::Mat& levelMask = mask(level);
+    if (levelMask.empty()) {
+        return levelImage;
+    }
+    // 复用缓冲时先清零：bitwise_and 带掩膜只写掩膜内像素
+    current.masked.create(levelImage.size(), levelImage.type());
+    current.masked.setTo(cv::Scalar::all(0));
+    cv::bitwise_and(levelImage, levelImage, current.masked, levelMask);
+    current.maskedReady = true;
+    return current.masked;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <array>
+#include <opencv2/core.hpp>
+#include "template/template_global.h"
+
+// 单帧搜索图金字塔：灰度转换、掩膜规整与逐层降采样都只做一次，各层按需由上一层 pyrDown 得到。
+// 对象可跨帧复用：同尺寸的后续帧直接覆盖已有缓冲，不再分配内存。
+// 非线程安全，由 TemplateManager 的缓冲池保证同一时刻只有一次匹配在使用。
+class TEMPLATE_EXPORT ImagePyramid {
+public:
+    static constexpr int kMaxLevels = 8;
+
+    // 设置第 0 层：内存连续的单通道输入直接引用不拷贝，不连续的输入（ROI 视图等）拷贝、彩色输入转灰度到内部缓冲；
+    // mask 可为空，尺寸须与 src 一致（由调用方校验），多通道/非 8 位会先规整为 8 位单通道，不连续时同样拷贝。
+    // 引用的输入从 reset 持有到下一次 reset 或 release()（TemplateManager 在本次匹配结束、归还缓冲池时调用），
+    // 期间调用方不得原地修改输入
+    void reset(const cv::Mat& src, const cv::Mat& mask = cv::Mat());
+    // 放回缓冲池前调用：释放对外部图像的引用，保留内部缓冲供下一帧复用
+    void release();
+
+    bool empty() const { return m_levels[0].image.empty(); }
+    bool hasMask() const { return m_hasMask; }
+    cv::Size size() const { return m_levels[0].image.size(); }
+    // 内部缓冲占用的字节数（不含引用的外部输入图像），用于内存统计
+    size_t bufferBytes() const;
+
+    // 第 level 层灰度图（level 超出 kMaxLevels 或图像已降到 1 像素时返回能达到的最深层）
+    const cv::Mat& image(int level);
+    // 第 level 层二值掩膜（>1 置 255），无掩膜时为空
+    const cv::Mat& mask(int level);
+    // 第 level 层图像按掩膜清零外部区域（掩膜外像素为 0）
+    const cv::Mat& maskedImage(int level);
+
+private:
+    struct Level {
+        cv::Mat image;
+        cv::Mat maskChain; // 未二值化的降采样掩膜，保证逐层结果与从第 0 层连续降采样一致
+        cv::Mat mask;
+        cv::Mat masked;
+        bool imageReady = false;
+        bool maskReady = false;
+        bool maskedReady = false;
+        bool imageAliased = false; // image/maskChain 直接引用上一层（图像过小无法降采样），不能原地覆盖
+        bool maskAliased = false;
+    };
+    int clampLevel(int level) const;
+
+    std::array<Level, kMaxLevels + 1> m_levels;
+    cv::Mat m_gray;     // 彩色输入的灰度缓冲，或不连续灰度输入的拷贝
+    cv::Mat m_maskGray; // 非 8 位单通道或不连续掩膜的规整缓冲
+    bool    m_hasMask = false;
+};
@@ -0,0 +1,495 @@
+#include "LazyTemplMatch.h"
+#include "CompositeTemplMatch.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+#include <numeric>
+
+namespace {
+constexpr int kScaleStepsPerBin = 5;   // 每个 bin 覆盖的缩放步数
+constexpr uint64_t kHotSearches = 32;  // 最近多少次搜索内命中过的 bin 视为热点，每次优先搜索
+} // namespace
+
+struct LazyTemplMatch::Cache {
+    struct Bin {
+        CompositeTemplMatch::AngleRange angle;
+        int      angleIndex = 0;
+        int      scaleIndex = 0;
+        float    scaleMin = 1.f;
+        float    scaleMax = 1.f;
+        int      templateCount = 0;
+        int      offset = 0;          // 该 bin 第一个模板的全局编号
+        std::shared_ptr<TIGER_BSVISION::ITemplMatch> master; // 只用于复制，不直接搜索
+        uint64_t generation = 0;      // 每次重新生成递增，实例据此判断本地副本是否过期
+        uint64_t lastUsed = 0;
+        uint64_t lastMatch = 0;       // 最近一次产生结果的搜索序号，0 表示从未命中
+        bool     failed = false;      // 生成失败的 bin 不再重试
+    };
+
+    std::mutex mutex;
+    cv::Mat    image;
+    cv::Mat    mask;
+    float      angleStep = 1.f;
+    float      scaleStep = 0.f;
+    float      weakThresh = 30.f;
+    float      strongThresh = 60.f;
+    size_t     numFeatures = 64;
+    TIGER_BSVISION::CPolarityType polarity = TIGER_BSVISION::cptIgnore;
+    std::vector<Bin> bins;
+    int        angleBins = 1;
+    int        scaleBins = 1;
+    bool       circular = false;
+    size_t     capacity = 0;
+    uint64_t   clock = 0;
+    uint64_t   tick = 0;
+    uint64_t   nextGeneration = 1;
+    size_t     anchor = 0;
+    size_t     expandCursor = 0;
+    std::vector<size_t> expandOrder; // 相对 anchor 由近及远
+    Stats      stats;
+
+    int angleDistance(int a, int b) const
+    {
+        const int d = std::abs(a - b);
+        return circular ? std::min(d, angleBins - d) : d;
+    }
+
+    void rebuildOrder()
+    {
+        expandOrder.resize(bins.size());
+        std::iota(expandOrder.begin(), expandOrder.end(), size_t(0));
+        const Bin& center = bins[anchor];
+        auto key = [this, &center](size_t index) {
+            const Bin& bin = bins[index];
+            return angleDistance(bin.angleIndex, center.angleIndex) * (scaleBins + 1)
+                   + std::abs(bin.scaleIndex - center.scaleIndex);
+        };
+        std::stable_sort(expandOrder.begin(), expandOrder.end(),
+                         [&key](size_t lhs, size_t rhs) { return key(lhs) < key(rhs); });
+        expandCursor = 0;
+    }
+
+    std::vector<size_t> neighbours(size_t index) const
+    {
+        std::vector<size_t> out;
+        const Bin& center = bins[index];
+        for (size_t i = 0; i < bins.size(); ++i) {
+            if (i != index && angleDistance(bins[i].angleIndex, center.angleIndex) <= 1
+                && std::abs(bins[i].scaleIndex - center.scaleIndex) <= 1) {
+                out.push_back(i);
+            }
+        }
+        return out;
+    }
+
+    size_t residentCount() const
+    {
+        return static_cast<size_t>(std::count_if(bins.begin(), bins.end(), [](const Bin& bin) { return static_cast<bool>(bin.master); }));
+    }
+
+    void evictIfNeeded(size_t keep)
+    {
+        while (capacity > 0 && residentCount() > capacity) {
+            size_t victim = bins.size();
+            for (size_t i = 0; i < bins.size(); ++i) {
+                if (i != keep && bins[i].master && (victim == bins.size() || bins[i].lastUsed < bins[victim].lastUsed)) {
+                    victim = i;
+                }
+            }
+            if (victim == bins.size()) {
+                return;
+            }
+            bins[victim].master.reset();
+            ++stats.evictions;
+        }
+    }
+
+    // 调用方持锁；返回 bin 是否可用
+    bool ensureBuilt(size_t index)
+    {
+        Bin& bin = bins[index];
+        if (bin.master) {
+            ++stats.hits;
+            return true;
+        }
+        if (bin.failed) {
+            return false;
+        }
+        ++stats.misses;
+        const auto start = std::chrono::steady_clock::now();
+        std::shared_ptr<TIGER_BSVISION::ITemplMatch> engine(TIGER_BSVISION::newTemplMatch());
+        const bool ok = engine && engine->create_shape_model(image, mask, bin.angle.start, bin.angle.extent, angleStep,
+                                                             bin.scaleMin, bin.scaleMax, scaleStep,
+                                                             weakThresh, strongThresh, numFeatures, polarity);
+        stats.buildMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        if (!ok) {
+            bin.failed = true;
+            return false;
+        }
+        bin.master = std::move(engine);
+        bin.generation = nextGeneration++;
+        evictIfNeeded(index);
+        return true;
+    }
+};
+
+LazyTemplMatch::LazyTemplMatch(float angleBinDeg, int cacheBins, bool hotFirst)
+    : m_angleBinDeg(angleBinDeg > 0.f ? angleBinDeg : 10.f)
+    , m_cacheBins(std::max(0, cacheBins))
+    , m_hotFirst(hotFirst)
+{
+}
+
+LazyTemplMatch::~LazyTemplMatch() = default;
+
+LazyTemplMatch* LazyTemplMatch::clone() const
+{
+    auto* copy = new LazyTemplMatch(m_angleBinDeg, m_cacheBins, m_hotFirst);
+    copy->m_cache = m_cache; // 共享缓存，本地 bin 副本按需重新复制
+    return copy;
+}
+
+LazyTemplMatch::Stats LazyTemplMatch::stats() const
+{
+    if (!m_cache) {
+        return Stats();
+    }
+    std::lock_guard<std::mutex> lock(m_cache->mutex);
+    Stats out = m_cache->stats;
+    out.residentBins = m_cache->residentCount();
+    out.totalBins = m_cache->bins.size();
+    return out;
+}
+
+void LazyTemplMatch::forEachResidentEngine(const std::function<void(const TIGER_BSVISION::ITemplMatch&, int)>& visit) const
+{
+    if (!m_cache) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_cache->mutex);
+    for (const Cache::Bin& bin : m_cache->bins) {
+        if (bin.master) {
+            visit(*bin.master, bin.templateCount);
+        }
+    }
+}
+
+bool LazyTemplMatch::create_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                        float _angle_start, float _angle_extent,
+                                        float _angle_step, float _scale_min, float _scale_max, float _scale_step,
+                                        float _weak_thresh, float _strong_thresh,
+                                        size_t _num_features,
+                                        TIGER_BSVISION::CPolarityType _type)
+{
+    clear();
+    if (_image.empty()) {
+        return false;
+    }
+    auto cache = std::make_shared<Cache>();
+    cache->image = _image.getMat().clone();
+    cache->mask = _mask.empty() ? cv::Mat() : _mask.getMat().clone();
+    cache->angleStep = _angle_step;
+    cache->scaleStep = _scale_step;
+    cache->weakThresh = _weak_thresh;
+    cache->strongThresh = _strong_thresh;
+    cache->numFeatures = _num_features;
+    cache->polarity = _type;
+    cache->capacity = static_cast<size_t>(m_cacheBins);
+
+    // 角度按 bin 宽度均分（与不分段时的离散角度集合一致）
+    const float coveredExtent = std::min(std::max(0.f, _angle_extent), 360.f);
+    const int angleParts = std::max(1, static_cast<int>(std::ceil(coveredExtent / m_angleBinDeg - 1e-4f)));
+    const std::vector<CompositeTemplMatch::AngleRange> angleRanges =
+        CompositeTemplMatch::splitAngleRange(_angle_start, _angle_extent, _angle_step, angleParts);
+    cache->angleBins = static_cast<int>(angleRanges.size());
+    cache->circular = _angle_extent >= 360.f - 1e-3f && cache->angleBins > 2;
+
+    // 缩放每 kScaleStepsPerBin 步一个 bin；上限多留半步避免浮点误差丢掉最后一个缩放
+    const float scaleLow = std::min(_scale_min, _scale_max);
+    const int scaleSteps = CompositeTemplMatch::scaleCount(_scale_min, _scale_max, _scale_step);
+    cache->scaleBins = std::max(1, (scaleSteps + kScaleStepsPerBin - 1) / kScaleStepsPerBin);
+    int offset = 0;
+    for (int a = 0; a < cache->angleBins; ++a) {
+        for (int s = 0; s < cache->scaleBins; ++s) {
+            Cache::Bin bin;
+            bin.angle = angleRanges[static_cast<size_t>(a)];
+            bin.angleIndex = a;
+            bin.scaleIndex = s;
+            if (scaleSteps <= 1) {
+                bin.scaleMin = _scale_min;
+                bin.scaleMax = _scale_max;
+            } else {
+                const int first = scaleSteps * s / cache->scaleBins;
+                const int last = scaleSteps * (s + 1) / cache->scaleBins;
+                bin.scaleMin = scaleLow + _scale_step * static_cast<float>(first);
+                bin.scaleMax = scaleLow + _scale_step * (static_cast<float>(last - first - 1) + 0.5f) + _scale_step * static_cast<float>(first);
+            }
+            const int binScales = scaleSteps <= 1 ? 1 : (scaleSteps * (s + 1) / cache->scaleBins - scaleSteps * s / cache->scaleBins);
+            bin.templateCount = bin.angle.angleCount * binScales;
+            bin.offset = offset;
+            offset += bin.templateCount;
+            cache->bins.push_back(bin);
+        }
+    }
+
+    // 初始扩展中心：学习姿态（0°、缩放 1）所在的 bin
+    int anchorAngle = 0;
+    for (int a = 0; a < cache->angleBins; ++a) {
+        const auto& range = angleRanges[static_cast<size_t>(a)];
+        float rel = std::fmod(-range.start, 360.f);
+        if (rel < 0.f) {
+            rel += 360.f;
+        }
+        if (rel <= range.extent) {
+            anchorAngle = a;
+            break;
+        }
+    }
+    int anchorScale = 0;
+    for (int s = 0; s < cache->scaleBins; ++s) {
+        const Cache::Bin& bin = cache->bins[static_cast<size_t>(s)];
+        if (1.f >= bin.scaleMin - 1e-6f && 1.f <= bin.scaleMax + 1e-6f) {
+            anchorScale = s;
+            break;
+        }
+    }
+    cache->anchor = static_cast<size_t>(anchorAngle * cache->scaleBins + anchorScale);
+    cache->rebuildOrder();
+    if (!cache->ensureBuilt(cache->anchor)) {
+        return false; // 学习姿态都生成失败，说明模板本身不可用
+    }
+    cache->bins[cache->anchor].lastUsed = ++cache->clock;
+    m_cache = std::move(cache);
+    return true;
+}
+
+bool LazyTemplMatch::create_one_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                            float _weak_thresh, float _strong_thresh,
+                                            size_t _num_features, TIGER_BSVISION::CPolarityType _type)
+{
+    return create_shape_model(_image, _mask, 0.f, 0.f, 0.f, 1.f, 1.f, 0.f,
+                              _weak_thresh, _strong_thresh, _num_features, _type);
+}
+
+TIGER_BSVISION::ITemplMatch* LazyTemplMatch::binEngine(size_t bin) const
+{
+    std::lock_guard<std::mutex> lock(m_cache->mutex);
+    if (!m_cache->ensureBuilt(bin)) {
+        return nullptr;
+    }
+    Cache::Bin& entry = m_cache->bins[bin];
+    entry.lastUsed = ++m_cache->clock;
+    LocalEngine& local = m_local[bin];
+    if (!local.engine || local.generation != entry.generation) {
+        local.engine.reset(TIGER_BSVISION::newTemplMatch(entry.master.get()));
+        local.generation = entry.generation;
+    }
+    return local.engine.get();
+}
+
+std::vector<TIGER_BSVISION::Match> LazyTemplMatch::find_shape_model(cv::InputArray _image, cv::InputArray _mask, float _threshold)
+{
+    std::vector<TIGER_BSVISION::Match> all;
+    if (isEmpty()) {
+        return all;
+    }
+    const cv::Mat image = _image.getMat();
+    const cv::Mat mask = _mask.getMat();
+    const size_t binCount = m_cache->bins.size();
+
+    uint64_t tick = 0;
+    std::vector<size_t> hot;
+    {
+        std::lock_guard<std::mutex> lock(m_cache->mutex);
+        tick = ++m_cache->tick;
+        ++m_cache->stats.searches;
+        // 已被淘汰或重建的 bin，本地副本一并释放
+        for (auto it = m_local.begin(); it != m_local.end();) {
+            const Cache::Bin& bin = m_cache->bins[it->first];
+            if (!bin.master || bin.generation != it->second.generation) {
+                it = m_local.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        for (size_t i = 0; i < binCount; ++i) {
+            const uint64_t lastMatch = m_cache->bins[i].lastMatch;
+            if (lastMatch > 0 && tick - lastMatch <= kHotSearches) {
+                hot.push_back(i);
+            }
+        }
+    }
+
+    std::vector<char> searched(binCount, 0);
+    std::vector<size_t> matchedBins;
+    size_t bestBin = binCount;
+    float bestScore = -1.f;
+    auto searchBin = [&](size_t bin) {
+        if (searched[bin]) {
+            return;
+        }
+        searched[bin] = 1;
+        TIGER_BSVISION::ITemplMatch* engine = binEngine(bin);
+        if (!engine) {
+            return;
+        }
+        std::vector<TIGER_BSVISION::Match> found = engine->find_shape_model(image, mask, _threshold);
+        if (found.empty()) {
+            return;
+        }
+        matchedBins.push_back(bin);
+        const int offset = m_cache->bins[bin].offset; // bin 划分在学习后不再变化，无需加锁
+        for (auto& match : found) {
+            if (match.similarity > bestScore) {
+                bestScore = match.similarity;
+                bestBin = bin;
+            }
+            match.template_id += offset;
+            all.push_back(std::move(match));
+        }
+    };
+
+    // 1. 热点 bin 及其相邻 bin（姿态缓慢漂移时跟随）
+    for (size_t bin : hot) {
+        searchBin(bin);
+    }
+    for (size_t bin : hot) {
+        for (size_t n : m_cache->neighbours(bin)) {
+            searchBin(n);
+        }
+    }
+
+    // 2. 从 anchor 由近及远扩展到其余 bin（hotFirst 时只在还没有结果时扩展，有结果即停）；
+    //    缓存有上限时本次最多新建上限个 bin
+    const auto keepExpanding = [&]() { return !m_hotFirst || all.empty(); };
+    if (keepExpanding()) {
+        size_t cursor = 0;
+        std::vector<size_t> order;
+        {
+            std::lock_guard<std::mutex> lock(m_cache->mutex);
+            cursor = m_cache->expandCursor;
+            order = m_cache->expandOrder;
+        }
+        const size_t buildBudget = m_cacheBins > 0 ? static_cast<size_t>(m_cacheBins) : order.size();
+        size_t builds = 0;
+        size_t i = cursor;
+        for (; i < order.size() && keepExpanding(); ++i) {
+            const size_t bin = order[i];
+            if (searched[bin]) {
+                continue;
+            }
+            bool resident = false;
+            {
+                std::lock_guard<std::mutex> lock(m_cache->mutex);
+                resident = static_cast<bool>(m_cache->bins[bin].master);
+            }
+            if (!resident) {
+                if (builds >= buildBudget) {
+                    break;
+                }
+                ++builds;
+            }
+            searchBin(bin);
+        }
+        std::lock_guard<std::mutex> lock(m_cache->mutex);
+        m_cache->expandCursor = (keepExpanding() && i < order.size()) ? i : 0;
+    }
+
+    // 3. 命中 bin 的相邻 bin：目标姿态可能更接近相邻区间的角度/缩放
+    const std::vector<size_t> hits = matchedBins;
+    for (size_t bin : hits) {
+        for (size_t n : m_cache->neighbours(bin)) {
+            searchBin(n);
+        }
+    }
+
+    if (!matchedBins.empty()) {
+        std::lock_guard<std::mutex> lock(m_cache->mutex);
+        for (size_t bin : matchedBins) {
+            m_cache->bins[bin].lastMatch = tick;
+        }
+        if (bestBin < binCount && bestBin != m_cache->anchor) {
+            m_cache->anchor = bestBin;
+            m_cache->rebuildOrder();
+        }
+    }
+    return CompositeTemplMatch::suppressDuplicates(std::move(all));
+}
+
+std::vector<TIGER_BSVISION::Match> LazyTemplMatch::find_pic_model(cv::InputArray _image, cv::InputArray _model, cv::InputArray _mask,
+                                                                  cv::InputArray _model_mask, float _threshold,
+                                                                  float _angle_start, float _angle_extent,
+                                                                  float _angle_step, float _scale_min,
+                                                                  float _scale_max, float _scale_step,
+                                                                  float _weak_thresh, size_t _num_features)
+{
+    LazyTemplMatch lazy(m_angleBinDeg, m_cacheBins);
+    if (!lazy.create_shape_model(_model, _model_mask, _angle_start, _angle_extent, _angle_step,
+                                 _scale_min, _scale_max, _scale_step, _weak_thresh, 60.0f, _num_features,
+                                 TIGER_BSVISION::cptIgnore)) {
+        return {};
+    }
+    return lazy.find_shape_model(_image, _mask, _threshold);
+}
+
+bool LazyTemplMatch::locate(int id, size_t& bin, int& localId) const
+{
+    if (isEmpty() || id < 0) {
+        return false;
+    }
+    for (size_t i = 0; i < m_cache->bins.size(); ++i) {
+        const Cache::Bin& entry = m_cache->bins[i];
+        if (id < entry.offset + entry.templateCount) {
+            bin = i;
+            localId = id - entry.offset;
+            return true;
+        }
+    }
+    return false;
+}
+
+TIGER_BSVISION::Template LazyTemplMatch::getTempl(int p_id) const
+{
+    size_t bin = 0;
+    int localId = 0;
+    TIGER_BSVISION::ITemplMatch* engine = locate(p_id, bin, localId) ? binEngine(bin) : nullptr;
+    return engine ? engine->getTempl(localId) : TIGER_BSVISION::Template();
+}
+
+float LazyTemplMatch::getAngle(int p_id) const
+{
+    size_t bin = 0;
+    int localId = 0;
+    TIGER_BSVISION::ITemplMatch* engine = locate(p_id, bin, localId) ? binEngine(bin) : nullptr;
+    return engine ? engine->getAngle(localId) : 0.f;
+}
+
+float LazyTemplMatch::getScale(int p_id) const
+{
+    size_t bin = 0;
+    int localId = 0;
+    TIGER_BSVISION::ITemplMatch* engine = locate(p_id, bin, localId) ? binEngine(bin) : nullptr;
+    return engine ? engine->getScale(localId) : 1.f;
+}
+
+bool LazyTemplMatch::write_shape_model(const cv::String) const
+{
+    return false;
+}
+
+bool LazyTemplMatch::read_shape_model(const cv::String)
+{
+    return false;
+}
+
+bool LazyTemplMatch::isEmpty() const
+{
+    return !m_cache || m_cache->bins.empty();
+}
+
+void LazyTemplMatch::clear()
+{
+    m_local.clear();
+    m_cache.reset();
+}
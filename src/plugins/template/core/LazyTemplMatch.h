@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <vector>
+#include <bscv/templmatch.h>
+
+// 按需生成旋转/缩放模板的 ITemplMatch：学习时只记录模板图像与参数并划分角度 × 缩放区间（bin），
+// 每个 bin 在第一次被搜索用到时才由引擎生成，常驻 bin 数超过上限时按最近使用淘汰。
+// 搜索顺序：最近命中过的 bin 及其相邻 bin → 从上次命中位置（初始为学习姿态）由近及远扩展到其余 bin。
+// 缓存不限时每次搜索覆盖全部 bin，结果与普通模型一致；缓存有上限时单次搜索最多新建上限个 bin，
+// 下一次从中断处继续，空图不会反复重建全部 bin。hotFirst 时在第一个有结果的 bin 处停止扩展，
+// 只适用于目标姿态集中在某一范围内的场景。
+// clone() 得到的副本共享同一缓存（加锁），各自持有 bin 引擎的副本，可在不同线程并行搜索。
+class LazyTemplMatch : public TIGER_BSVISION::ITemplMatch {
+public:
+    struct Stats {
+        uint64_t hits = 0;        // 需要的 bin 已在缓存中
+        uint64_t misses = 0;      // 需要的 bin 现场生成
+        uint64_t evictions = 0;
+        uint64_t searches = 0;
+        size_t   residentBins = 0;
+        size_t   totalBins = 0;
+        double   buildMs = 0.0;   // 累计生成耗时
+    };
+
+    // angleBinDeg：每个 bin 覆盖的角度宽度；cacheBins：常驻 bin 上限，<=0 表示不限；
+    // hotFirst：热点 bin 或扩展中任一 bin 有结果即停止搜索其余 bin
+    explicit LazyTemplMatch(float angleBinDeg = 10.f, int cacheBins = 0, bool hotFirst = false);
+    ~LazyTemplMatch() override;
+
+    LazyTemplMatch* clone() const;
+    Stats stats() const;
+    // 在缓存锁内依次访问已生成 bin 的主引擎及其模板数（内存统计用，不含各实例的本地副本）
+    void forEachResidentEngine(const std::function<void(const TIGER_BSVISION::ITemplMatch&, int)>& visit) const;
+
+    // 只划分 bin 并立即生成学习姿态所在的 bin（用于校验模板与提供 getTempl(0)）
+    bool create_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                            float _angle_start, float _angle_extent,
+                            float _angle_step, float _scale_min, float _scale_max, float _scale_step,
+                            float _weak_thresh, float _strong_thresh,
+                            size_t _num_features,
+                            TIGER_BSVISION::CPolarityType _type) override;
+    bool create_one_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                float _weak_thresh, float _strong_thresh,
+                                size_t _num_features, TIGER_BSVISION::CPolarityType _type) override;
+
+    std::vector<TIGER_BSVISION::Match> find_shape_model(cv::InputArray _image, cv::InputArray _mask, float _threshold) override;
+    std::vector<TIGER_BSVISION::Match> find_pic_model(cv::InputArray _image, cv::InputArray _model, cv::InputArray _mask,
+                                                      cv::InputArray _model_mask, float _threshold,
+                                                      float _angle_start, float _angle_extent,
+                                                      float _angle_step, float _scale_min,
+                                                      float _scale_max, float _scale_step,
+                                                      float _weak_thresh, size_t _num_features) override;
+
+    // 模板编号按 bin 顺序连续编排；访问未生成的 bin 会触发生成
+    TIGER_BSVISION::Template getTempl(int p_id) const override;
+    float getAngle(int p_id) const override;
+    float getScale(int p_id) const override;
+
+    // 按需模型不落盘（学习本身几乎不耗时），始终返回 false
+    bool write_shape_model(const cv::String _fileName) const override;
+    bool read_shape_model(const cv::String _fileName) override;
+
+    bool isEmpty() const override;
+    void clear() override;
+
+private:
+    struct Cache;
+    struct LocalEngine {
+        uint64_t generation = 0;
+        std::unique_ptr<TIGER_BSVISION::ITemplMatch> engine;
+    };
+
+    // 取本实例可用的 bin 引擎（必要时生成主引擎并复制一份），失败返回 nullptr
+    TIGER_BSVISION::ITemplMatch* binEngine(size_t bin) const;
+    bool locate(int id, size_t& bin, int& localId) const;
+
+    float m_angleBinDeg = 10.f;
+    int   m_cacheBins = 0;
+    bool  m_hotFirst = false;
+    std::shared_ptr<Cache> m_cache;
+    mutable std::map<size_t, LocalEngine> m_local;
+};
@@ -0,0 +1,118 @@
+#include "MatchSuppressor.h"
+#include <algorithm>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+
+MatchSuppressor::MatchSuppressor(double cellSize, double iouThreshold)
+    : m_cellSize(std::max(1.0, cellSize))
+    , m_iouThreshold(iouThreshold)
+{
+}
+
+cv::Point MatchSuppressor::cellOf(const cv::Point2f& point) const
+{
+    return cv::Point(static_cast<int>(std::floor(point.x / m_cellSize)),
+                     static_cast<int>(std::floor(point.y / m_cellSize)));
+}
+
+cv::RotatedRect MatchSuppressor::effectiveRect(const MatchResult& result)
+{
+    if (result.rotatedRect.size.width > 0.f && result.rotatedRect.size.height > 0.f) {
+        return result.rotatedRect;
+    }
+    const cv::Rect& box = result.Roiarea;
+    return cv::RotatedRect(cv::Point2f(static_cast<float>(box.x) + 0.5f * static_cast<float>(box.width),
+                                       static_cast<float>(box.y) + 0.5f * static_cast<float>(box.height)),
+                           cv::Size2f(static_cast<float>(box.width), static_cast<float>(box.height)), 0.f);
+}
+
+double MatchSuppressor::rotatedIoU(const cv::RotatedRect& lhs, const cv::RotatedRect& rhs)
+{
+    const double lhsArea = static_cast<double>(lhs.size.area());
+    const double rhsArea = static_cast<double>(rhs.size.area());
+    if (lhsArea <= 0.0 || rhsArea <= 0.0) {
+        return 0.0;
+    }
+    std::vector<cv::Point2f> intersection;
+    if (cv::rotatedRectangleIntersection(lhs, rhs, intersection) == cv::INTERSECT_NONE || intersection.size() < 3) {
+        return 0.0;
+    }
+    // 交点顺序不保证为凸多边形顺序，先求凸包再算面积
+    std::vector<cv::Point2f> hull;
+    cv::convexHull(intersection, hull);
+    const double inter = cv::contourArea(hull);
+    const double uni = lhsArea + rhsArea - inter;
+    return uni > 0.0 ? inter / uni : 0.0;
+}
+
+bool MatchSuppressor::isDuplicate(const MatchResult& candidate, double distanceThreshold) const
+{
+    if (m_centers.empty()) {
+        return false;
+    }
+    const bool useIoU = m_iouThreshold > 0.0;
+    cv::RotatedRect candidateRect;
+    double searchRadius = distanceThreshold;
+    if (useIoU) {
+        // 两个旋转框相交时中心距离不超过两者外接圆半径之和
+        candidateRect = effectiveRect(candidate);
+        searchRadius = 0.5 * std::hypot(candidateRect.size.width, candidateRect.size.height) + m_maxRadius;
+    }
+    const int reach = static_cast<int>(std::ceil(searchRadius / m_cellSize));
+    const cv::Point cell = cellOf(useIoU ? candidateRect.center : candidate.center);
+    const double thresholdSq = distanceThreshold * distanceThreshold;
+    for (int dy = -reach; dy <= reach; ++dy) {
+        for (int dx = -reach; dx <= reach; ++dx) {
+            const auto it = m_cells.find(cellKey(cell.x + dx, cell.y + dy));
+            if (it == m_cells.end()) {
+                continue;
+            }
+            for (size_t index : it->second) {
+                if (useIoU) {
+                    if (rotatedIoU(candidateRect, m_rects[index]) >= m_iouThreshold) {
+                        return true;
+                    }
+                    continue;
+                }
+                const cv::Point2f d = candidate.center - m_centers[index];
+                if (static_cast<double>(d.x) * d.x + static_cast<double>(d.y) * d.y <= thresholdSq) {
+                    return true;
+                }
+            }
+        }
+    }
+    return false;
+}
+
+void MatchSuppressor::accept(const MatchResult& result)
+{
+    const size_t index = m_centers.size();
+    m_centers.push_back(result.center);
+    cv::Point2f key = result.center;
+    if (m_iouThreshold > 0.0) {
+        // IoU 判据按旋转框中心入格（匹配中心可能设为模板基准点而非框中心）
+        const cv::RotatedRect rect = effectiveRect(result);
+        m_rects.push_back(rect);
+        m_maxRadius = std::max(m_maxRadius, 0.5 * std::hypot(rect.size.width, rect.size.height));
+        key = rect.center;
+    }
+    const cv::Point cell = cellOf(key);
+    m_cells[cellKey(cell.x, cell.y)].push_back(index);
+}
+
+bool MatchSuppressor::tryAccept(const MatchResult& candidate, double distanceThreshold)
+{
+    if (isDuplicate(candidate, distanceThreshold)) {
+        return false;
+    }
+    accept(candidate);
+    return true;
+}
+
+void MatchSuppressor::clear()
+{
+    m_centers.clear();
+    m_rects.clear();
+    m_cells.clear();
+    m_maxRadius = 0.0;
+}
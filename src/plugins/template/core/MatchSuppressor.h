@@ -0,0 +1,38 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "MatchParams.h"
+
+// 匹配结果去重（非极大值抑制）：已接受的结果按中心落入均匀网格，新候选只与相邻格子里的结果比较，
+// 代价近似与候选数成线性。调用方按分数降序逐个 tryAccept，语义与逐一比较全部已接受结果一致。
+// 两种判据：中心距离不超过阈值；或旋转框交并比（IoU）不低于阈值（密集排列、目标彼此贴近时更准确）。
+class MatchSuppressor {
+public:
+    // cellSize：网格边长，取典型的距离阈值即可；iouThreshold <= 0 时按中心距离判重
+    explicit MatchSuppressor(double cellSize, double iouThreshold = 0.0);
+
+    // 与已接受结果重复返回 false，否则接受并返回 true
+    bool tryAccept(const MatchResult& candidate, double distanceThreshold);
+    bool isDuplicate(const MatchResult& candidate, double distanceThreshold) const;
+    void accept(const MatchResult& result);
+
+    size_t size() const { return m_centers.size(); }
+    void clear();
+
+    // 参与 IoU 判据的旋转框：rotatedRect 尺寸为 0 时退化为轴对齐的 Roiarea
+    static cv::RotatedRect effectiveRect(const MatchResult& result);
+    static double rotatedIoU(const cv::RotatedRect& lhs, const cv::RotatedRect& rhs);
+
+private:
+    static uint64_t cellKey(int cx, int cy) { return (static_cast<uint64_t>(static_cast<uint32_t>(cx)) << 32) | static_cast<uint32_t>(cy); }
+    cv::Point cellOf(const cv::Point2f& point) const;
+
+    double m_cellSize = 10.0;
+    double m_iouThreshold = 0.0;
+    double m_maxRadius = 0.0; // 已接受结果外接圆半径的最大值，决定 IoU 判据的邻域范围
+    std::vector<cv::Point2f> m_centers;
+    std::vector<cv::RotatedRect> m_rects; // 只在 IoU 判据下记录
+    std::unordered_map<uint64_t, std::vector<size_t>> m_cells;
+};
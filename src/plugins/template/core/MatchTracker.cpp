@@ -0,0 +1,163 @@
+#include "MatchTracker.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 与 TemplateManager 的去重距离一致：中心距离小于模板对角线 0.3 倍视为同一目标
+float duplicateDistance(const MatchResult& result)
+{
+    return std::max(10.f, 0.3f * std::hypot(result.featureSize.width, result.featureSize.height));
+}
+} // namespace
+
+MatchTracker::MatchTracker(const TemplateManager& manager)
+    : m_manager(manager)
+{
+}
+
+void MatchTracker::reset()
+{
+    m_tracks.clear();
+    m_nextId = 1;
+    m_frame = 0;
+    m_lastFullSearchFrame = 0;
+    m_lastFullSearch = false;
+}
+
+void MatchTracker::confirm(Track& track, const MatchResult& result)
+{
+    if (!track.history.empty()) {
+        const float frames = static_cast<float>(std::max<uint64_t>(1, m_frame - track.history.back().frame));
+        const cv::Point2f step = (result.center - track.result.center) * (1.f / frames);
+        track.velocity = track.history.size() == 1 ? step : 0.5f * (track.velocity + step);
+    }
+    track.result = result;
+    track.result.trackId = track.id;
+    track.missedFrames = 0;
+
+    PoseSample sample;
+    sample.frame = m_frame;
+    sample.center = result.center;
+    sample.angle = result.angle;
+    sample.scale = result.scale;
+    sample.score = result.score;
+    track.history.push_back(sample);
+    while (track.history.size() > std::max<size_t>(1, m_params.historyLength)) {
+        track.history.pop_front();
+    }
+}
+
+void MatchTracker::associate(const std::vector<MatchResult>& detections, int maxTracks)
+{
+    for (const MatchResult& detection : detections) {
+        const float duplicate = duplicateDistance(detection);
+        Track* nearest = nullptr;
+        float nearestDistance = 0.f;
+        for (Track& track : m_tracks) {
+            const float missed = static_cast<float>(track.missedFrames);
+            const cv::Point2f predicted = track.result.center + track.velocity * missed;
+            const float distance = static_cast<float>(cv::norm(detection.center - predicted));
+            // 已确认的目标只判重；丢失的目标按丢失帧数放宽关联范围
+            const float gate = track.missedFrames == 0 ? duplicate : m_params.motionRadius * missed + duplicate;
+            if (distance <= gate && (!nearest || distance < nearestDistance)) {
+                nearest = &track;
+                nearestDistance = distance;
+            }
+        }
+        if (nearest) {
+            if (nearest->missedFrames > 0) {
+                confirm(*nearest, detection); // 找回丢失的目标
+            }
+            continue;
+        }
+        if (static_cast<int>(m_tracks.size()) >= maxTracks) {
+            continue;
+        }
+        Track track;
+        track.id = m_nextId++;
+        confirm(track, detection);
+        m_tracks.push_back(std::move(track));
+    }
+}
+
+const std::vector<MatchTracker::Track>& MatchTracker::update(const cv::Mat& frame, const FindMatchParams& params)
+{
+    ++m_frame;
+    m_lastFullSearch = false;
+    if (frame.empty() || !m_manager.hasTemplate()) {
+        return m_tracks;
+    }
+
+    // 1. 已有目标：只在预测位姿附近的窗口内搜索
+    if (!m_tracks.empty()) {
+        std::vector<TemplateManager::PosePrior> priors;
+        priors.reserve(m_tracks.size());
+        for (const Track& track : m_tracks) {
+            const float missed = static_cast<float>(track.missedFrames);
+            TemplateManager::PosePrior prior;
+            prior.center = track.result.center + track.velocity * (missed + 1.f);
+            prior.angle = track.result.angle;
+            prior.scale = track.result.scale;
+            prior.positionRadius = m_params.motionRadius * (missed + 1.f);
+            prior.angleBand = m_params.angleBand * (missed + 1.f);
+            prior.scaleBand = m_params.scaleBand;
+            priors.push_back(prior);
+        }
+        std::vector<char> found;
+        const std::vector<MatchResult> results = m_manager.matchAround(frame, priors, params, found);
+
+        // 两个目标收敛到同一物体时只保留分数高的一个，另一个按未确认处理
+        std::vector<size_t> order(m_tracks.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::stable_sort(order.begin(), order.end(), [&results](size_t lhs, size_t rhs) {
+            return results[lhs].score > results[rhs].score;
+        });
+        std::vector<char> confirmed(m_tracks.size(), 0);
+        for (size_t i : order) {
+            if (!found[i]) {
+                continue;
+            }
+            const bool duplicate = std::any_of(order.begin(), order.end(), [&](size_t j) {
+                return confirmed[j]
+                       && cv::norm(results[i].center - results[j].center) <= duplicateDistance(results[i]);
+            });
+            confirmed[i] = duplicate ? 0 : 1;
+        }
+        for (size_t i = 0; i < m_tracks.size(); ++i) {
+            if (confirmed[i]) {
+                confirm(m_tracks[i], results[i]);
+            } else {
+                ++m_tracks[i].missedFrames;
+            }
+        }
+    }
+
+    // 2. 没有目标、有目标丢失或到达周期时全图搜索
+    const bool anyLost = std::any_of(m_tracks.begin(), m_tracks.end(), [](const Track& track) { return track.missedFrames > 0; });
+    const bool periodic = m_params.fullSearchInterval > 0
+                          && m_frame - m_lastFullSearchFrame >= static_cast<uint64_t>(m_params.fullSearchInterval);
+    if (m_tracks.empty() || anyLost || periodic) {
+        associate(m_manager.matchTemplate(frame, params), std::max(1, params.maxCount));
+        m_lastFullSearchFrame = m_frame;
+        m_lastFullSearch = true;
+    }
+
+    m_tracks.erase(std::remove_if(m_tracks.begin(), m_tracks.end(), [this](const Track& track) {
+                       return track.missedFrames > m_params.maxMissedFrames;
+                   }),
+                   m_tracks.end());
+    return m_tracks;
+}
+
+std::vector<MatchResult> MatchTracker::confirmedResults() const
+{
+    std::vector<MatchResult> results;
+    for (const Track& track : m_tracks) {
+        if (track.missedFrames == 0) {
+            results.push_back(track.result);
+        }
+    }
+    return results;
+}
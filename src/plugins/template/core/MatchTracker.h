@@ -0,0 +1,66 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include "TemplateManager.h"
+#include "template/template_global.h"
+
+// 连续帧匹配的位姿跟踪：已跟踪的目标在下一帧只在预测位姿附近的窗口、窄角度/缩放带内搜索（TemplateManager::matchAround），
+// 只有目标丢失或到达周期时才做一次全图搜索，用于发现新目标与找回丢失目标。
+// 每个目标分配递增的跟踪编号并保留最近的位姿历史。
+// 非线程安全：同一时刻只能有一个线程调用 update（界面连续匹配模式下由单个后台任务驱动）。
+class TEMPLATE_EXPORT MatchTracker {
+public:
+    struct Params {
+        float  motionRadius = 40.f;    // 相邻两帧目标中心的最大位移（原图像素，在运动预测之外）
+        double angleBand = 10.0;       // 相邻两帧的最大转角（度）
+        double scaleBand = 0.05;
+        int    fullSearchInterval = 30; // 每隔多少帧强制全图搜索发现新目标，<=0 表示只在丢失时全图搜索
+        int    maxMissedFrames = 3;     // 连续多少帧未确认后删除目标
+        size_t historyLength = 64;      // 每个目标保留的位姿历史长度
+    };
+
+    struct PoseSample {
+        uint64_t    frame = 0;
+        cv::Point2f center{0.f, 0.f};
+        double      angle = 0.0;
+        double      scale = 1.0;
+        double      score = 0.0;
+    };
+
+    struct Track {
+        int         id = 0;
+        MatchResult result;              // 最近一次确认的匹配结果
+        cv::Point2f velocity{0.f, 0.f};  // 每帧位移（平滑后），用于预测下一帧位置
+        int         missedFrames = 0;    // 连续未确认帧数，0 表示本帧已确认
+        std::deque<PoseSample> history;  // 由旧到新
+    };
+
+    explicit MatchTracker(const TemplateManager& manager);
+
+    void setParams(const Params& params) { m_params = params; }
+    const Params& params() const { return m_params; }
+    // 清除全部目标（重新学习模板或切换图像源时调用）
+    void reset();
+
+    // 处理一帧，返回当前全部目标（含本帧未确认、尚未删除的目标）
+    const std::vector<Track>& update(const cv::Mat& frame, const FindMatchParams& params);
+    const std::vector<Track>& tracks() const { return m_tracks; }
+    // 本帧已确认目标的匹配结果，按跟踪编号排序
+    std::vector<MatchResult> confirmedResults() const;
+    bool lastFrameFullSearch() const { return m_lastFullSearch; }
+    uint64_t frameCount() const { return m_frame; }
+
+private:
+    void confirm(Track& track, const MatchResult& result);
+    // 全图搜索结果与目标关联：丢失的目标按最近距离找回，其余结果（不与已确认目标重复）建立新目标
+    void associate(const std::vector<MatchResult>& detections, int maxTracks);
+
+    const TemplateManager& m_manager;
+    Params   m_params;
+    std::vector<Track> m_tracks;
+    int      m_nextId = 1;
+    uint64_t m_frame = 0;
+    uint64_t m_lastFullSearchFrame = 0;
+    bool     m_lastFullSearch = false;
+};
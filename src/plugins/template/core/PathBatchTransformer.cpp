@@ -0,0 +1,87 @@
+#include "PathBatchTransformer.h"
+#include <QPainterPath>
+#include <QPolygonF>
+#include <QTransform>
+#include <cmath>
+
+namespace {
+constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+
+bool isAffine(const cv::Matx33d& m)
+{
+    return m(2, 0) == 0.0 && m(2, 1) == 0.0 && m(2, 2) == 1.0;
+}
+} // namespace
+
+PathBatchTransformer::PathBatchTransformer(const QPainterPath& path)
+{
+    const QList<QPolygonF> polygons = path.toSubpathPolygons();
+    for (const QPolygonF& polygon : polygons) {
+        if (polygon.size() < 2) {
+            continue;
+        }
+        m_starts.push_back(static_cast<int>(m_points.size()));
+        for (const QPointF& p : polygon) {
+            m_points.emplace_back(static_cast<float>(p.x()), static_cast<float>(p.y()));
+        }
+    }
+    m_starts.push_back(static_cast<int>(m_points.size()));
+}
+
+std::vector<cv::Point2f> PathBatchTransformer::transform(const std::vector<cv::Matx33d>& transforms) const
+{
+    const size_t count = m_points.size();
+    std::vector<cv::Point2f> out(count * transforms.size());
+    if (count == 0) {
+        return out;
+    }
+    // 输入只读共享，输出直接写入各实例的连续区间，不产生中间缓冲
+    const cv::Mat src(1, static_cast<int>(count), CV_32FC2, const_cast<cv::Point2f*>(m_points.data()));
+    for (size_t i = 0; i < transforms.size(); ++i) {
+        cv::Mat dst(1, static_cast<int>(count), CV_32FC2, out.data() + i * count);
+        const cv::Matx33d& m = transforms[i];
+        if (isAffine(m)) {
+            cv::transform(src, dst, cv::Matx23d(m(0, 0), m(0, 1), m(0, 2), m(1, 0), m(1, 1), m(1, 2)));
+        } else {
+            cv::perspectiveTransform(src, dst, m);
+        }
+    }
+    return out;
+}
+
+QPainterPath PathBatchTransformer::toPainterPath(const cv::Point2f* points) const
+{
+    QPainterPath path;
+    if (!points) {
+        return path;
+    }
+    for (size_t s = 0; s + 1 < m_starts.size(); ++s) {
+        const int first = m_starts[s];
+        const int last = m_starts[s + 1] - 1;
+        path.moveTo(points[first].x, points[first].y);
+        for (int i = first + 1; i <= last; ++i) {
+            path.lineTo(points[i].x, points[i].y);
+        }
+        if (m_points[static_cast<size_t>(first)] == m_points[static_cast<size_t>(last)]) {
+            path.closeSubpath();
+        }
+    }
+    return path;
+}
+
+cv::Matx33d PathBatchTransformer::rigid(const cv::Point2f& pivot, const cv::Point2f& offset, double angle)
+{
+    const double c = std::cos(angle * kDegToRad);
+    const double s = std::sin(angle * kDegToRad);
+    // p' = R (p - pivot) + pivot + offset
+    return cv::Matx33d(c, -s, pivot.x + offset.x - c * pivot.x + s * pivot.y,
+                       s, c, pivot.y + offset.y - s * pivot.x - c * pivot.y,
+                       0.0, 0.0, 1.0);
+}
+
+cv::Matx33d PathBatchTransformer::fromQTransform(const QTransform& transform)
+{
+    return cv::Matx33d(transform.m11(), transform.m21(), transform.m31(),
+                       transform.m12(), transform.m22(), transform.m32(),
+                       transform.m13(), transform.m23(), transform.m33());
+}
@@ -0,0 +1,38 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+#include "template/template_global.h"
+
+class QPainterPath;
+class QTransform;
+
+// 排版路径的批量变换：路径只展平一次为点缓冲（曲线按 Qt 细分为折线，子路径按起点下标划分），
+// 每个实例的刚体变换与后续坐标换算（图像 → 传感器 → 振镜单应）预先合成为一个 3×3 矩阵，
+// 对同一缓冲逐实例调用 cv::transform / cv::perspectiveTransform（内部 SIMD）写入连续输出。
+// 输出直接用于振镜坐标；QPainterPath 只在需要显示时由输出点构造。
+class TEMPLATE_EXPORT PathBatchTransformer {
+public:
+    PathBatchTransformer() = default;
+    explicit PathBatchTransformer(const QPainterPath& path);
+
+    bool isEmpty() const { return m_points.empty(); }
+    int  pointCount() const { return static_cast<int>(m_points.size()); }
+    const std::vector<cv::Point2f>& points() const { return m_points; }
+    // 各子路径在 points() 中的起点，末尾附总点数；闭合子路径的终点与起点重合
+    const std::vector<int>& subpathStarts() const { return m_starts; }
+
+    // 每个实例一个变换，输出按实例连续存放：实例 i 的点位于 [i * pointCount(), (i + 1) * pointCount())。
+    // 末行为 (0, 0, 1) 的仿射变换走 cv::transform，否则按射影变换处理
+    std::vector<cv::Point2f> transform(const std::vector<cv::Matx33d>& transforms) const;
+    // 由一个实例的输出点（pointCount() 个）按子路径组成显示用路径
+    QPainterPath toPainterPath(const cv::Point2f* points) const;
+
+    // 绕 pivot 旋转 angle（度，与 QTransform::rotate 同向：y 轴向下时顺时针）后平移 offset
+    static cv::Matx33d rigid(const cv::Point2f& pivot, const cv::Point2f& offset, double angle);
+    // QTransform（行向量约定）转为作用于列向量的 3×3 矩阵
+    static cv::Matx33d fromQTransform(const QTransform& transform);
+
+private:
+    std::vector<cv::Point2f> m_points;
+    std::vector<int> m_starts;
+};
@@ -0,0 +1,152 @@
+#include "PathTemplateGenerator.h"
+#include <QPainterPath>
+#include <QPolygonF>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+constexpr double kRadToDeg = 180.0 / 3.14159265358979323846;
+constexpr float kMinSegment = 1e-3f; // 细分后长度小于该值的线段视为重复点
+constexpr int kRenderShift = 4;      // 渲染时坐标的小数位数（1/16 像素）
+
+cv::Point2f unit(const cv::Point2f& v)
+{
+    const float length = std::hypot(v.x, v.y);
+    return length > 0.f ? v * (1.f / length) : cv::Point2f(0.f, 0.f);
+}
+
+std::vector<cv::Point> toFixedPoint(const std::vector<cv::Point2f>& points, double scale)
+{
+    std::vector<cv::Point> out;
+    out.reserve(points.size());
+    const double factor = scale * (1 << kRenderShift);
+    for (const cv::Point2f& p : points) {
+        out.emplace_back(cvRound(p.x * factor), cvRound(p.y * factor));
+    }
+    return out;
+}
+} // namespace
+
+PathTemplateGenerator::PathTemplateGenerator(const QPainterPath& path)
+{
+    build(path);
+}
+
+PathTemplateGenerator::PathTemplateGenerator(const QPainterPath& path, const Params& params)
+    : m_params(params)
+{
+    build(path);
+}
+
+void PathTemplateGenerator::build(const QPainterPath& path)
+{
+    const QRectF bounds = path.boundingRect();
+    if (path.isEmpty() || (bounds.width() <= 0.0 && bounds.height() <= 0.0)) {
+        return;
+    }
+    const int margin = std::max(0, m_params.margin);
+    const double left = std::floor(bounds.left());
+    const double top = std::floor(bounds.top());
+    m_origin = cv::Point2f(static_cast<float>(left - margin), static_cast<float>(top - margin));
+    m_size = cv::Size(static_cast<int>(std::ceil(bounds.right()) - left) + 2 * margin + 1,
+                      static_cast<int>(std::ceil(bounds.bottom()) - top) + 2 * margin + 1);
+
+    for (const QPolygonF& polygon : path.toSubpathPolygons()) {
+        Polyline polyline;
+        polyline.points.reserve(static_cast<size_t>(polygon.size()));
+        for (const QPointF& p : polygon) {
+            const cv::Point2f point(static_cast<float>(p.x()) - m_origin.x, static_cast<float>(p.y()) - m_origin.y);
+            if (polyline.points.empty() || cv::norm(point - polyline.points.back()) > kMinSegment) {
+                polyline.points.push_back(point);
+            }
+        }
+        // 闭合子路径的终点与起点重合，去掉终点并记为闭合
+        if (polyline.points.size() >= 3 && cv::norm(polyline.points.front() - polyline.points.back()) <= kMinSegment) {
+            polyline.points.pop_back();
+            polyline.closed = true;
+        }
+        if (polyline.points.size() >= 2) {
+            m_polylines.push_back(std::move(polyline));
+        }
+    }
+    if (m_polylines.empty()) {
+        m_size = cv::Size();
+    }
+}
+
+PathTemplateGenerator::Edges PathTemplateGenerator::sample(double scale) const
+{
+    Edges edges;
+    if (isEmpty() || scale <= 0.0) {
+        return edges;
+    }
+    const double step = std::max(0.1, m_params.spacing);
+    const double cornerCos = std::cos(m_params.cornerAngle / kRadToDeg);
+    for (const Polyline& polyline : m_polylines) {
+        const size_t count = polyline.points.size();
+        // 拐角：相邻线段方向夹角超过阈值；开放路径的两个端点同样视为拐角
+        std::vector<char> corner(count, 0);
+        for (size_t v = 0; v < count; ++v) {
+            if (!polyline.closed && (v == 0 || v + 1 == count)) {
+                corner[v] = 1;
+                continue;
+            }
+            const cv::Point2f& previous = polyline.points[(v + count - 1) % count];
+            const cv::Point2f& next = polyline.points[(v + 1) % count];
+            const cv::Point2f in = unit(polyline.points[v] - previous);
+            const cv::Point2f out = unit(next - polyline.points[v]);
+            corner[v] = in.dot(out) < cornerCos ? 1 : 0;
+        }
+
+        const size_t segments = polyline.closed ? count : count - 1;
+        double carry = 0.0; // 下一个采样点距当前线段起点的弧长，采样间距跨线段连续
+        for (size_t i = 0; i < segments; ++i) {
+            const size_t j = (i + 1) % count;
+            const cv::Point2f a = polyline.points[i] * static_cast<float>(scale);
+            const cv::Point2f b = polyline.points[j] * static_cast<float>(scale);
+            const double length = cv::norm(b - a);
+            if (length <= 0.0) {
+                continue;
+            }
+            const cv::Point2f direction = (b - a) * static_cast<float>(1.0 / length);
+            double angle = std::atan2(direction.x, -direction.y) * kRadToDeg; // 法向 (-dy, dx)
+            if (angle < 0.0) {
+                angle += 360.0;
+            }
+            const double low = corner[i] ? m_params.cornerMargin : 0.0;
+            const double high = length - (corner[j] ? m_params.cornerMargin : 0.0);
+            double t = carry;
+            for (; t <= length; t += step) {
+                if (t >= low && t <= high) {
+                    edges.points.push_back(a + direction * static_cast<float>(t));
+                    edges.angles.push_back(static_cast<float>(angle));
+                }
+            }
+            carry = t - length;
+        }
+    }
+    return edges;
+}
+
+cv::Mat PathTemplateGenerator::render(double scale) const
+{
+    if (isEmpty() || scale <= 0.0) {
+        return cv::Mat();
+    }
+    const cv::Size size(std::max(1, static_cast<int>(std::lround(m_size.width * scale))),
+                        std::max(1, static_cast<int>(std::lround(m_size.height * scale))));
+    cv::Mat image(size, CV_8UC1, cv::Scalar(0));
+    std::vector<std::vector<cv::Point>> closed;
+    std::vector<std::vector<cv::Point>> open;
+    for (const Polyline& polyline : m_polylines) {
+        (polyline.closed ? closed : open).push_back(toFixedPoint(polyline.points, scale));
+    }
+    if (!closed.empty()) {
+        cv::fillPoly(image, closed, cv::Scalar(255), cv::LINE_AA, kRenderShift); // 多个轮廓按奇偶规则填充，内孔保持为空
+    }
+    if (!open.empty()) {
+        cv::polylines(image, open, false, cv::Scalar(255), 1, cv::LINE_AA, kRenderShift);
+    }
+    return image;
+}
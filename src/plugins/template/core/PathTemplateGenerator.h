@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <opencv2/core.hpp>
+#include "template/template_global.h"
+
+class QPainterPath;
+
+// 由矢量路径（激光加工路径，图像像素坐标）直接生成形状模板的边缘点：曲线按 Qt 的细分转成折线后，
+// 沿弧长等间距采样轮廓点，法向由线段方向解析得到，不需要渲染整幅图像、画掩膜与提取梯度，结果只由路径决定。
+// 拐角与开放路径端点处的法向不确定，其两侧 cornerMargin 内不采样。路径不含明暗信息，生成的模型只能忽略极性。
+class TEMPLATE_EXPORT PathTemplateGenerator {
+public:
+    struct Params {
+        double spacing = 1.0;      // 采样间距（像素，按采样尺度计）
+        double cornerAngle = 30.0; // 相邻线段转角超过该值（度）视为拐角
+        double cornerMargin = 1.5; // 拐角两侧不采样的距离（像素，按采样尺度计）
+        int    margin = 8;         // 模板坐标系在路径外接框外留的边距（第 0 层像素）
+    };
+    struct Edges {
+        std::vector<cv::Point2f> points; // 模板坐标（第 0 层坐标乘以 scale），按轮廓顺序
+        std::vector<float> angles;       // 法向（度，0~360，图像坐标 y 向下）
+    };
+
+    explicit PathTemplateGenerator(const QPainterPath& path);
+    PathTemplateGenerator(const QPainterPath& path, const Params& params);
+
+    bool isEmpty() const { return m_polylines.empty(); }
+    // 模板坐标系原点在图像中的位置，以及第 0 层模板尺寸
+    cv::Point2f origin() const { return m_origin; }
+    cv::Size templateSize() const { return m_size; }
+
+    // 按 scale（第 L 层为 1/2^L）缩放后采样
+    Edges sample(double scale = 1.0) const;
+    // 渲染模板图像（8 位单通道，闭合子路径填充为 255，开放子路径画线）：
+    // 用于模板预览/模型包保存，以及没有边缘点接口的引擎（预编译 BSCV）
+    cv::Mat render(double scale = 1.0) const;
+
+private:
+    struct Polyline {
+        std::vector<cv::Point2f> points; // 模板坐标（第 0 层），闭合时首尾不重复
+        bool closed = false;
+    };
+    void build(const QPainterPath& path);
+
+    Params m_params;
+    std::vector<Polyline> m_polylines;
+    cv::Point2f m_origin{0.f, 0.f};
+    cv::Size m_size;
+};
@@ -0,0 +1,208 @@
+#include "PoseRefiner.h"
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+constexpr double kRadToDeg = 180.0 / 3.14159265358979323846;
+
+// 双线性采样，越界返回 false
+bool sampleBilinear(const cv::Mat& image, float x, float y, float& value)
+{
+    if (x < 0.f || y < 0.f || x > static_cast<float>(image.cols - 2) || y > static_cast<float>(image.rows - 2)) {
+        return false;
+    }
+    const int x0 = static_cast<int>(x);
+    const int y0 = static_cast<int>(y);
+    const float fx = x - static_cast<float>(x0);
+    const float fy = y - static_cast<float>(y0);
+    const float* row0 = image.ptr<float>(y0) + x0;
+    const float* row1 = image.ptr<float>(y0 + 1) + x0;
+    value = (row0[0] * (1.f - fx) + row0[1] * fx) * (1.f - fy) + (row1[0] * (1.f - fx) + row1[1] * fx) * fy;
+    return true;
+}
+
+// 相似变换 m 作用在 2x3 仿射 a 之后：m ∘ a
+cv::Matx23f compose(const cv::Matx23f& m, const cv::Matx23f& a)
+{
+    return cv::Matx23f(m(0, 0) * a(0, 0) + m(0, 1) * a(1, 0), m(0, 0) * a(0, 1) + m(0, 1) * a(1, 1),
+                       m(0, 0) * a(0, 2) + m(0, 1) * a(1, 2) + m(0, 2),
+                       m(1, 0) * a(0, 0) + m(1, 1) * a(1, 0), m(1, 0) * a(0, 1) + m(1, 1) * a(1, 1),
+                       m(1, 0) * a(0, 2) + m(1, 1) * a(1, 2) + m(1, 2));
+}
+
+cv::Point2f apply(const cv::Matx23f& m, const cv::Point2f& p)
+{
+    return cv::Point2f(m(0, 0) * p.x + m(0, 1) * p.y + m(0, 2), m(1, 0) * p.x + m(1, 1) * p.y + m(1, 2));
+}
+} // namespace
+
+bool PoseRefiner::refine(const cv::Mat& gray, MatchResult& result, Stats* stats) const
+{
+    if (stats) {
+        *stats = Stats();
+    }
+    if (gray.empty() || gray.type() != CV_8UC1 || !result.featureModel || result.featureModel->size() < 8) {
+        return false;
+    }
+    const std::vector<cv::Point2f>& model = *result.featureModel;
+
+    // 只在特征点外接框外扩搜索半径的范围内求梯度
+    std::vector<cv::Point2f> points;
+    cv::transform(model, points, result.featureTransform);
+    const int margin = static_cast<int>(std::ceil(m_params.searchRadius)) + 4;
+    const cv::Rect roi = (cv::boundingRect(points) + cv::Size(2 * margin, 2 * margin) - cv::Point(margin, margin))
+                         & cv::Rect(0, 0, gray.cols, gray.rows);
+    if (roi.width < 4 || roi.height < 4) {
+        return false;
+    }
+    cv::Mat gradX;
+    cv::Mat gradY;
+    cv::Sobel(gray(roi), gradX, CV_32F, 1, 0, 3);
+    cv::Sobel(gray(roi), gradY, CV_32F, 0, 1, 3);
+    const cv::Point2f roiOrigin(static_cast<float>(roi.x), static_cast<float>(roi.y));
+
+    const float step = 0.5f;
+    const int steps = std::max(1, static_cast<int>(std::ceil(m_params.searchRadius / step)));
+    const int unknowns = m_params.refineScale ? 4 : 3;
+    const size_t minInliers = std::max<size_t>(8, model.size() / 5);
+
+    cv::Matx23f transform = result.featureTransform;
+    cv::Matx23f total(1.f, 0.f, 0.f, 0.f, 1.f, 0.f); // 累计修正（原图坐标）
+    Stats local;
+    std::vector<float> profile(static_cast<size_t>(2 * steps + 1));
+    for (int iteration = 0; iteration < m_params.maxIterations; ++iteration) {
+        cv::transform(model, points, transform);
+        cv::Point2f centroid(0.f, 0.f);
+        for (const cv::Point2f& p : points) {
+            centroid += p;
+        }
+        centroid *= 1.f / static_cast<float>(points.size());
+
+        // 每个特征点沿图像梯度方向搜索方向导数最大的位置（抛物线插值到亚像素），以点到该处切线的距离为残差
+        cv::Matx44d normal = cv::Matx44d::zeros();
+        cv::Vec4d rhs(0.0, 0.0, 0.0, 0.0);
+        double squaredError = 0.0;
+        size_t inliers = 0;
+        for (const cv::Point2f& p : points) {
+            const cv::Point2f origin = p - roiOrigin;
+            float gx = 0.f;
+            float gy = 0.f;
+            if (!sampleBilinear(gradX, origin.x, origin.y, gx) || !sampleBilinear(gradY, origin.x, origin.y, gy)) {
+                continue;
+            }
+            const float magnitude = std::hypot(gx, gy);
+            if (magnitude < m_params.minGradient) {
+                continue;
+            }
+            const cv::Point2f n(gx / magnitude, gy / magnitude);
+            int best = -1;
+            for (int k = -steps; k <= steps; ++k) {
+                const cv::Point2f q = origin + n * (static_cast<float>(k) * step);
+                float qx = 0.f;
+                float qy = 0.f;
+                float& value = profile[static_cast<size_t>(k + steps)];
+                value = 0.f;
+                if (sampleBilinear(gradX, q.x, q.y, qx) && sampleBilinear(gradY, q.x, q.y, qy)) {
+                    value = std::abs(qx * n.x + qy * n.y);
+                }
+                if (best < 0 || value > profile[static_cast<size_t>(best)]) {
+                    best = k + steps;
+                }
+            }
+            if (best <= 0 || best >= 2 * steps || profile[static_cast<size_t>(best)] < m_params.minGradient) {
+                continue; // 边缘不在搜索范围内（极值落在端点）
+            }
+            const float left = profile[static_cast<size_t>(best - 1)];
+            const float center = profile[static_cast<size_t>(best)];
+            const float right = profile[static_cast<size_t>(best + 1)];
+            const float denominator = left - 2.f * center + right;
+            const float subStep = std::abs(denominator) > 1e-6f ? 0.5f * (left - right) / denominator : 0.f;
+            const double distance = (static_cast<float>(best - steps) + subStep) * step;
+
+            const double u = p.x - centroid.x;
+            const double v = p.y - centroid.y;
+            const cv::Vec4d jacobian(n.x, n.y, -n.x * v + n.y * u, n.x * u + n.y * v);
+            const double weight = std::abs(distance) <= m_params.huberDelta ? 1.0 : m_params.huberDelta / std::abs(distance);
+            for (int r = 0; r < unknowns; ++r) {
+                for (int c = 0; c < unknowns; ++c) {
+                    normal(r, c) += weight * jacobian[r] * jacobian[c];
+                }
+                rhs[r] += weight * jacobian[r] * distance;
+            }
+            squaredError += distance * distance;
+            ++inliers;
+        }
+        local.inliers = static_cast<int>(inliers);
+        local.iterations = iteration + 1;
+        local.rmsError = inliers > 0 ? static_cast<float>(std::sqrt(squaredError / static_cast<double>(inliers))) : 0.f;
+        if (inliers < minInliers) {
+            if (stats) {
+                *stats = local;
+            }
+            return false;
+        }
+
+        cv::Mat a(unknowns, unknowns, CV_64F);
+        cv::Mat b(unknowns, 1, CV_64F);
+        for (int r = 0; r < unknowns; ++r) {
+            for (int c = 0; c < unknowns; ++c) {
+                a.at<double>(r, c) = normal(r, c);
+            }
+            b.at<double>(r) = rhs[r];
+        }
+        cv::Mat delta;
+        if (!cv::solve(a, b, delta, cv::DECOMP_CHOLESKY)) {
+            break;
+        }
+        const double dx = delta.at<double>(0);
+        const double dy = delta.at<double>(1);
+        const double dTheta = delta.at<double>(2);
+        const double dScale = unknowns > 3 ? delta.at<double>(3) : 0.0;
+
+        // 绕当前特征点重心旋转/缩放，再平移
+        const float s = static_cast<float>(1.0 + dScale);
+        const float cosA = s * static_cast<float>(std::cos(dTheta));
+        const float sinA = s * static_cast<float>(std::sin(dTheta));
+        const cv::Matx23f update(cosA, -sinA, centroid.x - cosA * centroid.x + sinA * centroid.y + static_cast<float>(dx),
+                                 sinA, cosA, centroid.y - sinA * centroid.x - cosA * centroid.y + static_cast<float>(dy));
+        transform = compose(update, transform);
+        total = compose(update, total);
+
+        float radius = 0.f;
+        for (const cv::Point2f& p : points) {
+            radius = std::max(radius, static_cast<float>(cv::norm(p - centroid)));
+        }
+        const double movement = std::hypot(dx, dy) + (std::abs(dTheta) + std::abs(dScale)) * radius;
+        if (movement < m_params.convergence) {
+            local.converged = true;
+            break;
+        }
+    }
+    if (stats) {
+        *stats = local;
+    }
+    // 残差超过搜索半径说明对齐到了错误的边缘，保留原结果
+    const double shift = std::hypot(total(0, 2), total(1, 2));
+    if (local.rmsError > m_params.searchRadius || !std::isfinite(shift)) {
+        return false;
+    }
+
+    // 累计修正作用到结果：angle 与 getRotationMatrix2D 一致以逆时针为正，图像坐标（y 向下）的旋转角取反
+    const double rotation = std::atan2(total(1, 0), total(0, 0)) * kRadToDeg;
+    const double scale = std::hypot(total(0, 0), total(1, 0));
+    result.featureTransform = transform;
+    result.center = apply(total, result.center);
+    result.angle -= rotation;
+    result.scale *= scale;
+    result.rotatedRect = cv::RotatedRect(apply(total, result.rotatedRect.center),
+                                         result.rotatedRect.size * static_cast<float>(scale),
+                                         result.rotatedRect.angle + static_cast<float>(rotation));
+    result.featureSize = result.rotatedRect.size;
+    result.Roiarea = result.rotatedRect.boundingRect() & cv::Rect(0, 0, gray.cols, gray.rows);
+    if (!result.transformedFeaturePoints.empty()) {
+        cv::transform(model, result.transformedFeaturePoints, transform);
+    }
+    return true;
+}
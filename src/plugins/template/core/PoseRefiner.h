@@ -0,0 +1,38 @@
+#pragma once
+#include <opencv2/core.hpp>
+#include "MatchParams.h"
+#include "template/template_global.h"
+
+// 亚像素位姿精修：在粗匹配位姿附近，把模板特征点沿图像梯度方向对齐到最近的边缘，
+// 以点到切线距离为残差做 Gauss-Newton（Huber 加权）迭代，求平移、旋转（可选缩放）的修正量。
+// 匹配精度因此不再受 angle_step/scale_step 限制：2~4° 的粗步长加精修即可得到亚步长角度与亚像素位置，
+// 模板数、模型内存与搜索时间按步长比例下降，每个结果的精修只需读取外接框附近的梯度（通常远小于一次层搜索）。
+// 精修失败（有效边缘点过少或残差发散）时保持原结果不变。
+class TEMPLATE_EXPORT PoseRefiner {
+public:
+    struct Params {
+        int   maxIterations = 10;
+        float searchRadius = 2.f;  // 沿法向搜索边缘的半径（像素），应覆盖粗位姿在模板边缘处的最大偏差
+        float minGradient = 20.f;  // 边缘点的最小方向导数（Sobel 3x3）
+        float huberDelta = 0.5f;   // Huber 权重的拐点（像素）
+        float convergence = 0.01f; // 各特征点位移的最大更新量（像素）小于该值时停止
+        bool  refineScale = false; // 学习时缩放范围为单一值时不精修缩放
+    };
+
+    struct Stats {
+        int   inliers = 0;
+        int   iterations = 0;
+        float rmsError = 0.f; // 最终有效边缘点的点到切线距离均方根（像素）
+        bool  converged = false;
+    };
+
+    PoseRefiner() = default;
+    explicit PoseRefiner(const Params& params) : m_params(params) {}
+
+    // gray 为 8 位单通道图像，与 result 同坐标系；result 须带 featureModel/featureTransform。
+    // 成功时更新 center/angle/scale/featureTransform/rotatedRect/Roiarea 并返回 true
+    bool refine(const cv::Mat& gray, MatchResult& result, Stats* stats = nullptr) const;
+
+private:
+    Params m_params;
+};
@@ -0,0 +1,907 @@
+#include "SyntheticBenchmark.h"
+#include <QDebug>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <opencv2/imgproc.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <map>
+#include <memory>
+#include "BatchMatcher.h"
+
+namespace {
+constexpr int    kTemplateMargin = 12;     // 模板图像在形状外接框外留的边距
+constexpr int    kRenderShift = 4;         // 渲染坐标的小数位数（1/16 像素）
+constexpr int    kPlacementGap = 4;        // 实例之间、实例与图像边界的最小间隙（像素）
+constexpr int    kPlacementAttempts = 200; // 每个实例随机摆放的最多尝试次数
+constexpr double kTemplateBackground = 50.0;
+constexpr double kTemplateForeground = 200.0;
+
+const SyntheticBenchmark::Condition kConditions[SyntheticBenchmark::kConditionCount] = {
+    SyntheticBenchmark::Condition::Rotation, SyntheticBenchmark::Condition::Scale, SyntheticBenchmark::Condition::Noise,
+    SyntheticBenchmark::Condition::Occlusion, SyntheticBenchmark::Condition::Clutter};
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 角度差归一到 [-180, 180)
+double wrapAngle(double angle)
+{
+    angle = std::fmod(angle + 180.0, 360.0);
+    return (angle < 0.0 ? angle + 360.0 : angle) - 180.0;
+}
+
+std::vector<cv::Point2f> circlePoints(const cv::Point2f& center, float radius)
+{
+    constexpr int kSegments = 96;
+    std::vector<cv::Point2f> points;
+    points.reserve(kSegments);
+    for (int i = 0; i < kSegments; ++i) {
+        const double theta = 2.0 * CV_PI * i / kSegments;
+        points.emplace_back(center.x + radius * static_cast<float>(std::cos(theta)),
+                            center.y + radius * static_cast<float>(std::sin(theta)));
+    }
+    return points;
+}
+
+std::vector<cv::Point> toFixedPoint(const std::vector<cv::Point2f>& points)
+{
+    std::vector<cv::Point> out;
+    out.reserve(points.size());
+    for (const cv::Point2f& p : points) {
+        out.emplace_back(cvRound(p.x * (1 << kRenderShift)), cvRound(p.y * (1 << kRenderShift)));
+    }
+    return out;
+}
+
+// 多个轮廓按奇偶规则填充（内孔保持原值），坐标带 1/16 像素小数，保证渲染位置与真值一致
+void fillContours(cv::Mat& image, const std::vector<std::vector<cv::Point2f>>& contours, double value)
+{
+    std::vector<std::vector<cv::Point>> fixed;
+    fixed.reserve(contours.size());
+    for (const std::vector<cv::Point2f>& contour : contours) {
+        fixed.push_back(toFixedPoint(contour));
+    }
+    cv::fillPoly(image, fixed, cv::Scalar(value), cv::LINE_AA, kRenderShift);
+}
+
+// 轮廓整体平移到外接框左上角为 (kTemplateMargin, kTemplateMargin)，并渲染模板图像
+SyntheticBenchmark::Shape makeShape(const QString& name, std::vector<std::vector<cv::Point2f>> contours)
+{
+    float minX = std::numeric_limits<float>::max();
+    float minY = std::numeric_limits<float>::max();
+    float maxX = std::numeric_limits<float>::lowest();
+    float maxY = std::numeric_limits<float>::lowest();
+    for (const std::vector<cv::Point2f>& contour : contours) {
+        for (const cv::Point2f& p : contour) {
+            minX = std::min(minX, p.x);
+            minY = std::min(minY, p.y);
+            maxX = std::max(maxX, p.x);
+            maxY = std::max(maxY, p.y);
+        }
+    }
+    const cv::Point2f shift(kTemplateMargin - minX, kTemplateMargin - minY);
+    for (std::vector<cv::Point2f>& contour : contours) {
+        for (cv::Point2f& p : contour) {
+            p += shift;
+        }
+    }
+    SyntheticBenchmark::Shape shape;
+    shape.name = name;
+    shape.contours = std::move(contours);
+    const cv::Size size(static_cast<int>(std::ceil(maxX - minX)) + 2 * kTemplateMargin + 1,
+                        static_cast<int>(std::ceil(maxY - minY)) + 2 * kTemplateMargin + 1);
+    shape.templateImage = cv::Mat(size, CV_8UC1, cv::Scalar(kTemplateBackground));
+    fillContours(shape.templateImage, shape.contours, kTemplateForeground);
+    return shape;
+}
+
+// 原始统计量：场景级别生成后逐级合并到形状/条件/总体
+struct Accumulator {
+    int scenes = 0;
+    int truths = 0;
+    int detections = 0;
+    int truePositives = 0;
+    std::vector<double> positionErrors;
+    std::vector<double> angleErrors;
+    std::vector<double> scaleErrors;
+    std::vector<double> matchMs;
+    TemplateManager::MatchTiming stageSum;
+
+    void merge(const Accumulator& other)
+    {
+        scenes += other.scenes;
+        truths += other.truths;
+        detections += other.detections;
+        truePositives += other.truePositives;
+        positionErrors.insert(positionErrors.end(), other.positionErrors.begin(), other.positionErrors.end());
+        angleErrors.insert(angleErrors.end(), other.angleErrors.begin(), other.angleErrors.end());
+        scaleErrors.insert(scaleErrors.end(), other.scaleErrors.begin(), other.scaleErrors.end());
+        matchMs.insert(matchMs.end(), other.matchMs.begin(), other.matchMs.end());
+        stageSum.prepareMs += other.stageSum.prepareMs;
+        stageSum.pyramidMs += other.stageSum.pyramidMs;
+        stageSum.searchMs += other.stageSum.searchMs;
+        stageSum.refineMs += other.stageSum.refineMs;
+        stageSum.finalizeMs += other.stageSum.finalizeMs;
+    }
+};
+
+double mean(const std::vector<double>& values)
+{
+    double total = 0.0;
+    for (double value : values) {
+        total += value;
+    }
+    return values.empty() ? 0.0 : total / static_cast<double>(values.size());
+}
+
+double maximum(const std::vector<double>& values)
+{
+    return values.empty() ? 0.0 : *std::max_element(values.begin(), values.end());
+}
+
+SyntheticBenchmark::Metrics finalize(const Accumulator& acc)
+{
+    SyntheticBenchmark::Metrics metrics;
+    metrics.scenes = acc.scenes;
+    metrics.truths = acc.truths;
+    metrics.detections = acc.detections;
+    metrics.truePositives = acc.truePositives;
+    metrics.recall = acc.truths > 0 ? static_cast<double>(acc.truePositives) / acc.truths : 0.0;
+    metrics.precision = acc.detections > 0 ? static_cast<double>(acc.truePositives) / acc.detections : 1.0;
+    metrics.meanPositionError = mean(acc.positionErrors);
+    metrics.p90PositionError = BatchMatcher::percentile(acc.positionErrors, 90.0);
+    metrics.maxPositionError = maximum(acc.positionErrors);
+    metrics.meanAngleError = mean(acc.angleErrors);
+    metrics.p90AngleError = BatchMatcher::percentile(acc.angleErrors, 90.0);
+    metrics.maxAngleError = maximum(acc.angleErrors);
+    metrics.meanScaleError = mean(acc.scaleErrors);
+    metrics.maxScaleError = maximum(acc.scaleErrors);
+    metrics.meanMatchMs = mean(acc.matchMs);
+    metrics.p50MatchMs = BatchMatcher::percentile(acc.matchMs, 50.0);
+    metrics.p90MatchMs = BatchMatcher::percentile(acc.matchMs, 90.0);
+    metrics.maxMatchMs = maximum(acc.matchMs);
+    if (acc.scenes > 0) {
+        metrics.meanStages.prepareMs = acc.stageSum.prepareMs / acc.scenes;
+        metrics.meanStages.pyramidMs = acc.stageSum.pyramidMs / acc.scenes;
+        metrics.meanStages.searchMs = acc.stageSum.searchMs / acc.scenes;
+        metrics.meanStages.refineMs = acc.stageSum.refineMs / acc.scenes;
+        metrics.meanStages.finalizeMs = acc.stageSum.finalizeMs / acc.scenes;
+    }
+    return metrics;
+}
+
+// 结果按分数从高到低依次与中心最近、角度在容差内的未占用真值配对，配上的计为命中
+Accumulator evaluateScene(const SyntheticBenchmark::Scene& scene, const cv::Point2f& trainCenter,
+                          const TemplateManager::MatchJobResult& job, const SyntheticBenchmark::Options& options)
+{
+    Accumulator acc;
+    acc.scenes = 1;
+    acc.truths = static_cast<int>(scene.truth.size());
+    acc.detections = static_cast<int>(job.results.size());
+    acc.matchMs.push_back(job.elapsedMs);
+    acc.stageSum = job.timing;
+
+    std::vector<cv::Point2f> centers;
+    centers.reserve(scene.truth.size());
+    for (const SyntheticBenchmark::Instance& instance : scene.truth) {
+        centers.push_back(SyntheticBenchmark::truthCenter(instance, trainCenter));
+    }
+    std::vector<const MatchResult*> ordered;
+    for (const MatchResult& result : job.results) {
+        ordered.push_back(&result);
+    }
+    std::stable_sort(ordered.begin(), ordered.end(), [](const MatchResult* lhs, const MatchResult* rhs) {
+        return lhs->score > rhs->score;
+    });
+    std::vector<char> used(scene.truth.size(), 0);
+    for (const MatchResult* result : ordered) {
+        int best = -1;
+        double bestDistance = options.positionTolerance;
+        for (size_t t = 0; t < scene.truth.size(); ++t) {
+            const double distance = cv::norm(result->center - centers[t]);
+            if (used[t] || distance > bestDistance
+                || std::abs(wrapAngle(result->angle - scene.truth[t].angle)) > options.angleTolerance) {
+                continue;
+            }
+            best = static_cast<int>(t);
+            bestDistance = distance;
+        }
+        if (best < 0) {
+            continue;
+        }
+        used[static_cast<size_t>(best)] = 1;
+        ++acc.truePositives;
+        acc.positionErrors.push_back(bestDistance);
+        acc.angleErrors.push_back(std::abs(wrapAngle(result->angle - scene.truth[static_cast<size_t>(best)].angle)));
+        acc.scaleErrors.push_back(std::abs(result->scale - scene.truth[static_cast<size_t>(best)].scale));
+    }
+    return acc;
+}
+
+QJsonObject timingToJson(const TemplateManager::MatchTiming& timing)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("prepare"), timing.prepareMs);
+    object.insert(QStringLiteral("pyramid"), timing.pyramidMs);
+    object.insert(QStringLiteral("search"), timing.searchMs);
+    object.insert(QStringLiteral("refine"), timing.refineMs);
+    object.insert(QStringLiteral("finalize"), timing.finalizeMs);
+    return object;
+}
+
+QJsonObject conditionsToJson(const std::array<SyntheticBenchmark::Metrics, SyntheticBenchmark::kConditionCount>& conditions)
+{
+    QJsonObject object;
+    for (int c = 0; c < SyntheticBenchmark::kConditionCount; ++c) {
+        object.insert(SyntheticBenchmark::conditionKey(kConditions[c]), SyntheticBenchmark::toJsonObject(conditions[static_cast<size_t>(c)]));
+    }
+    return object;
+}
+
+QJsonObject optionsToJson(const SyntheticBenchmark::Options& options)
+{
+    QJsonObject learn;
+    learn.insert(QStringLiteral("angleRange"), options.learn.angleRange);
+    learn.insert(QStringLiteral("angleStep"), options.learn.angle_step);
+    learn.insert(QStringLiteral("featurePointNum"), static_cast<double>(options.learn.FeaturePointNum));
+    learn.insert(QStringLiteral("weakThreshold"), options.learn.weakThreshold);
+    learn.insert(QStringLiteral("strongThreshold"), options.learn.strongThreshold);
+    learn.insert(QStringLiteral("ignorePolarity"), options.learn.ignorePolarity);
+    learn.insert(QStringLiteral("scaleMin"), options.learn.scale_min);
+    learn.insert(QStringLiteral("scaleMax"), options.learn.scale_max);
+    learn.insert(QStringLiteral("scaleStep"), options.learn.scale_step);
+    learn.insert(QStringLiteral("lazyModel"), options.learn.lazyModel);
+    QJsonObject find;
+    find.insert(QStringLiteral("scoreThreshold"), options.find.scoreThreshold);
+    find.insert(QStringLiteral("maxCount"), options.find.maxCount);
+    find.insert(QStringLiteral("coarseToFine"), options.find.coarseToFine);
+    find.insert(QStringLiteral("nmsIouThreshold"), options.find.nmsIouThreshold);
+    find.insert(QStringLiteral("timeoutMs"), options.find.timeoutMs);
+    find.insert(QStringLiteral("refinePose"), options.find.refinePose);
+    QJsonObject object;
+    object.insert(QStringLiteral("seed"), QString::number(static_cast<qulonglong>(options.seed)));
+    object.insert(QStringLiteral("scenesPerCondition"), options.scenesPerCondition);
+    object.insert(QStringLiteral("instancesPerScene"), options.instancesPerScene);
+    object.insert(QStringLiteral("sceneWidth"), options.sceneSize.width);
+    object.insert(QStringLiteral("sceneHeight"), options.sceneSize.height);
+    object.insert(QStringLiteral("positionTolerance"), options.positionTolerance);
+    object.insert(QStringLiteral("angleTolerance"), options.angleTolerance);
+    object.insert(QStringLiteral("baseNoiseSigma"), options.baseNoiseSigma);
+    object.insert(QStringLiteral("noiseSigma"), options.noiseSigma);
+    object.insert(QStringLiteral("occlusionRatio"), options.occlusionRatio);
+    object.insert(QStringLiteral("clutterCount"), options.clutterCount);
+    object.insert(QStringLiteral("matchThreads"), TemplateManager::maxMatchThreads());
+    object.insert(QStringLiteral("learn"), learn);
+    object.insert(QStringLiteral("find"), find);
+    return object;
+}
+
+// 两组结果的差异：按分数降序逐个对应，数量不同或任一位姿/分数偏差超出容差即视为该场景不一致
+struct ResultDiff {
+    explicit ResultDiff(const SyntheticBenchmark::Tolerance& tolerance)
+        : tolerance(tolerance)
+    {
+    }
+
+    SyntheticBenchmark::Tolerance tolerance;
+    int    scenes = 0;
+    int    mismatchedScenes = 0;
+    int    results = 0;
+    int    otherResults = 0;
+    double maxPosition = 0.0;
+    double maxAngle = 0.0;
+    double maxScale = 0.0;
+    double maxScore = 0.0;
+
+    void add(std::vector<MatchResult> lhs, std::vector<MatchResult> rhs)
+    {
+        const auto byScore = [](const MatchResult& a, const MatchResult& b) {
+            if (a.score != b.score) {
+                return a.score > b.score;
+            }
+            return a.center.x != b.center.x ? a.center.x < b.center.x : a.center.y < b.center.y;
+        };
+        std::sort(lhs.begin(), lhs.end(), byScore);
+        std::sort(rhs.begin(), rhs.end(), byScore);
+        ++scenes;
+        results += static_cast<int>(lhs.size());
+        otherResults += static_cast<int>(rhs.size());
+        bool same = lhs.size() == rhs.size();
+        for (size_t i = 0; i < std::min(lhs.size(), rhs.size()); ++i) {
+            const double position = cv::norm(lhs[i].center - rhs[i].center);
+            const double angle = std::abs(wrapAngle(lhs[i].angle - rhs[i].angle));
+            const double scale = std::abs(lhs[i].scale - rhs[i].scale);
+            const double score = std::abs(lhs[i].score - rhs[i].score);
+            maxPosition = std::max(maxPosition, position);
+            maxAngle = std::max(maxAngle, angle);
+            maxScale = std::max(maxScale, scale);
+            maxScore = std::max(maxScore, score);
+            same = same && position <= tolerance.position && angle <= tolerance.angle && scale <= tolerance.scale
+                   && score <= tolerance.score;
+        }
+        mismatchedScenes += same ? 0 : 1;
+    }
+    bool identical() const { return mismatchedScenes == 0; }
+
+    QJsonObject toJson() const
+    {
+        QJsonObject object;
+        object.insert(QStringLiteral("scenes"), scenes);
+        object.insert(QStringLiteral("mismatchedScenes"), mismatchedScenes);
+        object.insert(QStringLiteral("results"), results);
+        object.insert(QStringLiteral("otherResults"), otherResults);
+        object.insert(QStringLiteral("maxPositionDelta"), maxPosition);
+        object.insert(QStringLiteral("maxAngleDelta"), maxAngle);
+        object.insert(QStringLiteral("maxScaleDelta"), maxScale);
+        object.insert(QStringLiteral("maxScoreDelta"), maxScore);
+        return object;
+    }
+};
+} // namespace
+
+SyntheticBenchmark::SyntheticBenchmark(const Options& options)
+    : m_options(options)
+{
+}
+
+std::vector<SyntheticBenchmark::Shape> SyntheticBenchmark::builtinShapes()
+{
+    // 均无旋转对称性，角度真值唯一
+    std::vector<Shape> shapes;
+    shapes.push_back(makeShape(QStringLiteral("l_bracket"),
+                               {{{0.f, 0.f}, {72.f, 0.f}, {72.f, 22.f}, {24.f, 22.f}, {24.f, 64.f}, {0.f, 64.f}}}));
+    shapes.push_back(makeShape(QStringLiteral("arrow"),
+                               {{{0.f, 16.f}, {46.f, 16.f}, {46.f, 0.f}, {78.f, 32.f}, {46.f, 64.f}, {46.f, 48.f}, {0.f, 48.f}}}));
+    shapes.push_back(makeShape(QStringLiteral("eccentric_ring"),
+                               {circlePoints(cv::Point2f(36.f, 36.f), 36.f), circlePoints(cv::Point2f(47.f, 30.f), 14.f)}));
+    shapes.push_back(makeShape(QStringLiteral("t_slot"),
+                               {{{0.f, 0.f}, {64.f, 0.f}, {64.f, 18.f}, {41.f, 18.f}, {41.f, 60.f}, {23.f, 60.f}, {23.f, 18.f}, {0.f, 18.f}},
+                                {{27.f, 32.f}, {37.f, 32.f}, {37.f, 44.f}, {27.f, 44.f}}}));
+    return shapes;
+}
+
+QString SyntheticBenchmark::conditionKey(Condition condition)
+{
+    switch (condition) {
+    case Condition::Scale:
+        return QStringLiteral("scale");
+    case Condition::Noise:
+        return QStringLiteral("noise");
+    case Condition::Occlusion:
+        return QStringLiteral("occlusion");
+    case Condition::Clutter:
+        return QStringLiteral("clutter");
+    default:
+        return QStringLiteral("rotation");
+    }
+}
+
+cv::Point2f SyntheticBenchmark::truthCenter(const Instance& instance, const cv::Point2f& trainCenter)
+{
+    const cv::Vec2d p = instance.transform * cv::Vec3d(trainCenter.x, trainCenter.y, 1.0);
+    return cv::Point2f(static_cast<float>(p[0]), static_cast<float>(p[1]));
+}
+
+SyntheticBenchmark::Scene SyntheticBenchmark::generateScene(const Shape& shape, int shapeIndex, Condition condition, int index) const
+{
+    Scene scene;
+    scene.shape = shapeIndex;
+    scene.condition = condition;
+    scene.index = index;
+    const uint64_t sceneKey = (static_cast<uint64_t>(shapeIndex) << 40) ^ (static_cast<uint64_t>(condition) << 32)
+                              ^ static_cast<uint64_t>(static_cast<uint32_t>(index));
+    cv::RNG rng(m_options.seed ^ (sceneKey * 0x9E3779B97F4A7C15ull));
+    const cv::Size size = m_options.sceneSize;
+
+    // 背景：随机底色加任意方向的线性亮度渐变
+    const double base = rng.uniform(40.0, 80.0);
+    const double gradient = rng.uniform(0.0, 30.0);
+    const double direction = rng.uniform(0.0, 2.0 * CV_PI);
+    const double gx = gradient * std::cos(direction) / std::max(1, size.width);
+    const double gy = gradient * std::sin(direction) / std::max(1, size.height);
+    cv::Mat background(size, CV_32FC1);
+    for (int y = 0; y < size.height; ++y) {
+        float* row = background.ptr<float>(y);
+        for (int x = 0; x < size.width; ++x) {
+            row[x] = static_cast<float>(base + gx * x + gy * y);
+        }
+    }
+    background.convertTo(scene.image, CV_8UC1);
+
+    // 干扰图形先画，实例覆盖其上，实例本身的轮廓保持完整
+    const int clutter = condition == Condition::Clutter ? std::max(0, m_options.clutterCount) : 0;
+    for (int i = 0; i < clutter; ++i) {
+        const cv::Point2f center(rng.uniform(0.f, static_cast<float>(size.width)), rng.uniform(0.f, static_cast<float>(size.height)));
+        const cv::Scalar value(rng.uniform(90.0, 230.0));
+        switch (rng.uniform(0, 3)) {
+        case 0:
+            cv::circle(scene.image, center, rng.uniform(4, 24), value, cv::FILLED, cv::LINE_AA);
+            break;
+        case 1: {
+            const cv::RotatedRect box(center, cv::Size2f(rng.uniform(6.f, 50.f), rng.uniform(4.f, 30.f)), rng.uniform(0.f, 180.f));
+            cv::Point2f corners[4];
+            box.points(corners);
+            fillContours(scene.image, {std::vector<cv::Point2f>(corners, corners + 4)}, value[0]);
+            break;
+        }
+        default: {
+            const cv::Point end(cvRound(center.x + rng.uniform(-60.f, 60.f)), cvRound(center.y + rng.uniform(-60.f, 60.f)));
+            cv::line(scene.image, center, end, value, rng.uniform(1, 4), cv::LINE_AA);
+            break;
+        }
+        }
+    }
+
+    // 实例：角度在学习角度范围内，缩放只在 Scale 条件下随机；外接圆互不重叠且完整落在图像内
+    const cv::Size templateSize = shape.templateImage.size();
+    const cv::Point2f templateCenter(0.5f * templateSize.width, 0.5f * templateSize.height);
+    const double shapeRadius = 0.5 * std::hypot(templateSize.width - 2 * kTemplateMargin, templateSize.height - 2 * kTemplateMargin);
+    const double shapeArea = static_cast<double>(templateSize.width - 2 * kTemplateMargin) * (templateSize.height - 2 * kTemplateMargin);
+    const double angleRange = std::min(std::max(m_options.learn.angleRange, 0.0), 360.0);
+    const double scaleMin = std::min(m_options.learn.scale_min, m_options.learn.scale_max);
+    const double scaleMax = std::max(m_options.learn.scale_min, m_options.learn.scale_max);
+    std::vector<cv::Point2f> placed;
+    std::vector<double> placedRadii;
+    for (int i = 0; i < m_options.instancesPerScene; ++i) {
+        Instance instance;
+        instance.angle = angleRange > 0.0 ? rng.uniform(0.0, angleRange) : 0.0;
+        instance.scale = condition == Condition::Scale ? rng.uniform(scaleMin, scaleMax) : std::min(std::max(1.0, scaleMin), scaleMax);
+        const double radius = shapeRadius * instance.scale + kPlacementGap;
+        if (2.0 * radius >= std::min(size.width, size.height)) {
+            continue;
+        }
+        bool found = false;
+        cv::Point2f center;
+        for (int attempt = 0; attempt < kPlacementAttempts && !found; ++attempt) {
+            center = cv::Point2f(static_cast<float>(rng.uniform(radius, size.width - radius)),
+                                 static_cast<float>(rng.uniform(radius, size.height - radius)));
+            found = true;
+            for (size_t j = 0; j < placed.size() && found; ++j) {
+                found = cv::norm(center - placed[j]) >= radius + placedRadii[j];
+            }
+        }
+        if (!found) {
+            continue;
+        }
+        placed.push_back(center);
+        placedRadii.push_back(radius);
+
+        instance.transform = cv::getRotationMatrix2D(templateCenter, instance.angle, instance.scale);
+        instance.transform(0, 2) += center.x - templateCenter.x;
+        instance.transform(1, 2) += center.y - templateCenter.y;
+        std::vector<std::vector<cv::Point2f>> contours(shape.contours.size());
+        for (size_t c = 0; c < shape.contours.size(); ++c) {
+            cv::transform(shape.contours[c], contours[c], instance.transform);
+        }
+        fillContours(scene.image, contours, rng.uniform(170.0, 220.0));
+
+        if (condition == Condition::Occlusion && m_options.occlusionRatio > 0.0) {
+            // 遮挡块中心放在随机一个轮廓顶点上，保证确实遮住一段轮廓
+            const std::vector<cv::Point2f>& contour = contours[static_cast<size_t>(rng.uniform(0, static_cast<int>(contours.size())))];
+            const cv::Point2f anchor = contour[static_cast<size_t>(rng.uniform(0, static_cast<int>(contour.size())))];
+            const double area = m_options.occlusionRatio * shapeArea * instance.scale * instance.scale;
+            const double aspect = rng.uniform(0.5, 2.0);
+            const float width = static_cast<float>(std::sqrt(area * aspect));
+            const float height = static_cast<float>(area / std::max(1e-6, static_cast<double>(width)));
+            const cv::RotatedRect box(anchor, cv::Size2f(width, height), rng.uniform(0.f, 180.f));
+            cv::Point2f corners[4];
+            box.points(corners);
+            fillContours(scene.image, {std::vector<cv::Point2f>(corners, corners + 4)}, base + rng.uniform(-5.0, 5.0));
+        }
+        scene.truth.push_back(instance);
+    }
+
+    // 成像：轻微模糊后叠加高斯噪声
+    cv::GaussianBlur(scene.image, scene.image, cv::Size(3, 3), 0.8);
+    const double sigma = condition == Condition::Noise ? m_options.noiseSigma : m_options.baseNoiseSigma;
+    if (sigma > 0.0) {
+        cv::Mat noise(size, CV_16SC1);
+        rng.fill(noise, cv::RNG::NORMAL, cv::Scalar(0.0), cv::Scalar(sigma));
+        cv::Mat noisy;
+        scene.image.convertTo(noisy, CV_16SC1);
+        noisy += noise;
+        noisy.convertTo(scene.image, CV_8UC1);
+    }
+    return scene;
+}
+
+SyntheticBenchmark::Report SyntheticBenchmark::run(const SceneCallback& onScene) const
+{
+    Report report;
+    report.options = m_options;
+    const auto startTime = std::chrono::steady_clock::now();
+    const std::vector<Shape> shapes = builtinShapes();
+    Accumulator overall;
+    std::array<Accumulator, kConditionCount> conditions;
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        const Shape& shape = shapes[s];
+        const int shapeIndex = static_cast<int>(s);
+        ShapeReport shapeReport;
+        shapeReport.name = shape.name;
+        TemplateManager manager;
+        shapeReport.learned = manager.learnTemplate(shape.templateImage, shape.templateImage, m_options.learn);
+        if (!shapeReport.learned) {
+            qWarning().noquote() << QStringLiteral("合成回归：形状 %1 学习失败").arg(shape.name);
+            report.shapes.push_back(shapeReport);
+            continue;
+        }
+        shapeReport.learnMs = manager.learnMs();
+        shapeReport.modelBytes = manager.memoryReport().totalBytes;
+        const cv::Point2f trainCenter = manager.trainCenter();
+        if (m_options.warmUp) {
+            manager.matchTemplate(generateScene(shape, shapeIndex, Condition::Rotation, -1).image, m_options.find);
+        }
+
+        Accumulator shapeOverall;
+        std::array<Accumulator, kConditionCount> shapeConditions;
+        for (int c = 0; c < kConditionCount; ++c) {
+            for (int i = 0; i < m_options.scenesPerCondition; ++i) {
+                const Scene scene = generateScene(shape, shapeIndex, kConditions[c], i);
+                const TemplateManager::MatchJobResult job = manager.runMatchJob(TemplateManager::makeMatchJob(scene.image, m_options.find));
+                const Accumulator sceneStats = evaluateScene(scene, trainCenter, job, m_options);
+                shapeOverall.merge(sceneStats);
+                shapeConditions[static_cast<size_t>(c)].merge(sceneStats);
+                overall.merge(sceneStats);
+                conditions[static_cast<size_t>(c)].merge(sceneStats);
+                if (onScene) {
+                    onScene(scene, shape, trainCenter, job);
+                }
+            }
+        }
+        shapeReport.overall = finalize(shapeOverall);
+        for (int c = 0; c < kConditionCount; ++c) {
+            shapeReport.conditions[static_cast<size_t>(c)] = finalize(shapeConditions[static_cast<size_t>(c)]);
+        }
+        qInfo().noquote() << QStringLiteral("合成回归 %1：学习 %2 ms，召回率 %3，精确率 %4，中心误差均值 %5 px，角度误差均值 %6°，匹配均值 %7 ms")
+                              .arg(shape.name)
+                              .arg(shapeReport.learnMs, 0, 'f', 1)
+                              .arg(shapeReport.overall.recall, 0, 'f', 3)
+                              .arg(shapeReport.overall.precision, 0, 'f', 3)
+                              .arg(shapeReport.overall.meanPositionError, 0, 'f', 3)
+                              .arg(shapeReport.overall.meanAngleError, 0, 'f', 3)
+                              .arg(shapeReport.overall.meanMatchMs, 0, 'f', 2);
+        report.shapes.push_back(shapeReport);
+    }
+    report.overall = finalize(overall);
+    for (int c = 0; c < kConditionCount; ++c) {
+        report.conditions[static_cast<size_t>(c)] = finalize(conditions[static_cast<size_t>(c)]);
+    }
+    report.wallMs = millisecondsSince(startTime);
+    qInfo().noquote() << QStringLiteral("合成回归共 %1 个场景、%2 个实例：召回率 %3，精确率 %4，匹配 P50 %5 ms / P90 %6 ms，总耗时 %7 ms")
+                          .arg(report.overall.scenes)
+                          .arg(report.overall.truths)
+                          .arg(report.overall.recall, 0, 'f', 3)
+                          .arg(report.overall.precision, 0, 'f', 3)
+                          .arg(report.overall.p50MatchMs, 0, 'f', 2)
+                          .arg(report.overall.p90MatchMs, 0, 'f', 2)
+                          .arg(report.wallMs, 0, 'f', 1);
+    return report;
+}
+
+bool SyntheticBenchmark::hitsTruth(const MatchResult& result, const cv::Point2f& center, const Instance& instance) const
+{
+    return cv::norm(result.center - center) <= m_options.positionTolerance
+           && std::abs(wrapAngle(result.angle - instance.angle)) <= m_options.angleTolerance;
+}
+
+std::vector<SyntheticBenchmark::Scene> SyntheticBenchmark::generateScenes(const Shape& shape, int shapeIndex) const
+{
+    std::vector<Scene> scenes;
+    scenes.reserve(static_cast<size_t>(kConditionCount * std::max(0, m_options.scenesPerCondition)));
+    for (int c = 0; c < kConditionCount; ++c) {
+        for (int i = 0; i < m_options.scenesPerCondition; ++i) {
+            scenes.push_back(generateScene(shape, shapeIndex, kConditions[c], i));
+        }
+    }
+    return scenes;
+}
+
+bool SyntheticBenchmark::learn(const Shape& shape, const MatchParams& params, TemplateManager& manager) const
+{
+    if (manager.learnTemplate(shape.templateImage, shape.templateImage, params)) {
+        return true;
+    }
+    qWarning().noquote() << QStringLiteral("合成回归：形状 %1 学习失败").arg(shape.name);
+    return false;
+}
+
+SyntheticBenchmark::Comparison SyntheticBenchmark::comparePaths(const MatchParams& learnParams, const MatchPath& lhs,
+                                                                const MatchPath& rhs, const Tolerance& tolerance) const
+{
+    Comparison comparison;
+    ResultDiff diff(tolerance);
+    Accumulator lhsStats;
+    Accumulator rhsStats;
+    const std::vector<Shape> shapes = builtinShapes();
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        const int shapeIndex = static_cast<int>(s);
+        TemplateManager manager;
+        if (!learn(shapes[s], learnParams, manager)) {
+            comparison.learned = false;
+            continue;
+        }
+        const cv::Point2f trainCenter = manager.trainCenter();
+        if (m_options.warmUp) {
+            const Scene warmUp = generateScene(shapes[s], shapeIndex, Condition::Rotation, -1);
+            lhs(manager, shapeIndex, warmUp);
+            rhs(manager, shapeIndex, warmUp);
+        }
+        for (const Scene& scene : generateScenes(shapes[s], shapeIndex)) {
+            const TemplateManager::MatchJobResult lhsJob = lhs(manager, shapeIndex, scene);
+            const TemplateManager::MatchJobResult rhsJob = rhs(manager, shapeIndex, scene);
+            lhsStats.merge(evaluateScene(scene, trainCenter, lhsJob, m_options));
+            rhsStats.merge(evaluateScene(scene, trainCenter, rhsJob, m_options));
+            diff.add(lhsJob.results, rhsJob.results);
+        }
+    }
+    comparison.identical = diff.identical();
+    comparison.lhs = finalize(lhsStats);
+    comparison.rhs = finalize(rhsStats);
+    comparison.diff = diff.toJson();
+    return comparison;
+}
+
+SyntheticBenchmark::MatchPath SyntheticBenchmark::findPath(const FindMatchParams& params)
+{
+    return [params](const TemplateManager& manager, int, const Scene& scene) {
+        return manager.runMatchJob(TemplateManager::makeMatchJob(scene.image, params));
+    };
+}
+
+SyntheticBenchmark::Study SyntheticBenchmark::measure(const QString& name, const std::vector<Variant>& variants) const
+{
+    Study study;
+    study.name = name;
+    if (variants.empty()) {
+        return study;
+    }
+    const int previousThreads = TemplateManager::maxMatchThreads();
+    std::vector<Accumulator> stats(variants.size());
+    study.variants.resize(variants.size());
+    const std::vector<Shape> shapes = builtinShapes();
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        const int shapeIndex = static_cast<int>(s);
+        const std::vector<Scene> scenes = generateScenes(shapes[s], shapeIndex);
+        // 学习参数相同（模型哈希一致）的配置共用一个模型
+        std::map<QString, std::unique_ptr<TemplateManager>> models;
+        for (size_t v = 0; v < variants.size(); ++v) {
+            const Variant& variant = variants[v];
+            const QString key = TemplateManager::modelHash(shapes[s].templateImage, variant.learn)
+                                + (variant.learn.lazyModel ? QStringLiteral("-lazy") : QString());
+            std::unique_ptr<TemplateManager>& manager = models[key];
+            if (!manager) {
+                manager = std::make_unique<TemplateManager>();
+                if (!learn(shapes[s], variant.learn, *manager)) {
+                    continue;
+                }
+            } else if (!manager->hasTemplate()) {
+                continue;
+            }
+            VariantResult& result = study.variants[v];
+            result.learnMs += manager->learnMs();
+            result.modelBytes += manager->memoryReport().totalBytes;
+            TemplateManager::setMaxMatchThreads(variant.matchThreads);
+            if (m_options.warmUp) {
+                manager->matchTemplate(generateScene(shapes[s], shapeIndex, Condition::Rotation, -1).image, variant.find);
+            }
+            const cv::Point2f trainCenter = manager->trainCenter();
+            for (const Scene& scene : scenes) {
+                const TemplateManager::MatchJobResult job = manager->runMatchJob(TemplateManager::makeMatchJob(scene.image, variant.find));
+                stats[v].merge(evaluateScene(scene, trainCenter, job, m_options));
+            }
+        }
+    }
+    TemplateManager::setMaxMatchThreads(previousThreads);
+
+    for (size_t v = 0; v < variants.size(); ++v) {
+        VariantResult& result = study.variants[v];
+        result.name = variants[v].name;
+        result.matchThreads = variants[v].matchThreads;
+        result.metrics = finalize(stats[v]);
+        const double referenceMs = study.variants.front().metrics.meanMatchMs;
+        result.speedup = result.metrics.meanMatchMs > 0.0 ? referenceMs / result.metrics.meanMatchMs : 0.0;
+        qInfo().noquote() << QStringLiteral("配置对比 %1 / %2：召回率 %3，中心误差均值 %4 px，角度误差均值 %5°，学习 %6 ms，"
+                                            "匹配均值 %7 ms（P90 %8 ms），加速比 %9")
+                              .arg(study.name, result.name)
+                              .arg(result.metrics.recall, 0, 'f', 3)
+                              .arg(result.metrics.meanPositionError, 0, 'f', 3)
+                              .arg(result.metrics.meanAngleError, 0, 'f', 3)
+                              .arg(result.learnMs, 0, 'f', 1)
+                              .arg(result.metrics.meanMatchMs, 0, 'f', 2)
+                              .arg(result.metrics.p90MatchMs, 0, 'f', 2)
+                              .arg(result.speedup, 0, 'f', 2);
+    }
+    return study;
+}
+
+SyntheticBenchmark::Study SyntheticBenchmark::measureMatchThreads(const std::vector<int>& threads) const
+{
+    std::vector<Variant> variants;
+    for (int count : threads) {
+        Variant variant;
+        variant.name = QStringLiteral("threads%1").arg(count);
+        variant.learn = m_options.learn;
+        variant.find = m_options.find;
+        variant.matchThreads = count;
+        variants.push_back(variant);
+    }
+    return measure(QStringLiteral("matchThreads"), variants);
+}
+
+SyntheticBenchmark::Study SyntheticBenchmark::measureCoarseToFine() const
+{
+    Variant exhaustive;
+    exhaustive.name = QStringLiteral("exhaustive");
+    exhaustive.learn = m_options.learn;
+    exhaustive.find = m_options.find;
+    exhaustive.find.coarseToFine = false;
+    exhaustive.matchThreads = TemplateManager::maxMatchThreads();
+    Variant hierarchical = exhaustive;
+    hierarchical.name = QStringLiteral("coarseToFine");
+    hierarchical.find.coarseToFine = true;
+    return measure(QStringLiteral("coarseToFine"), {exhaustive, hierarchical});
+}
+
+SyntheticBenchmark::Study SyntheticBenchmark::measurePoseRefinement(const std::vector<float>& angleSteps) const
+{
+    std::vector<Variant> variants;
+    for (float angleStep : angleSteps) {
+        Variant plain;
+        plain.name = QStringLiteral("step%1").arg(static_cast<double>(angleStep));
+        plain.learn = m_options.learn;
+        plain.learn.angle_step = angleStep;
+        plain.find = m_options.find;
+        plain.find.refinePose = false;
+        plain.matchThreads = TemplateManager::maxMatchThreads();
+        Variant refined = plain;
+        refined.name += QStringLiteral("-refined");
+        refined.find.refinePose = true;
+        variants.push_back(plain);
+        variants.push_back(refined);
+    }
+    return measure(QStringLiteral("poseRefinement"), variants);
+}
+
+QJsonObject SyntheticBenchmark::toJsonObject(const Metrics& metrics)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("scenes"), metrics.scenes);
+    object.insert(QStringLiteral("truths"), metrics.truths);
+    object.insert(QStringLiteral("detections"), metrics.detections);
+    object.insert(QStringLiteral("truePositives"), metrics.truePositives);
+    object.insert(QStringLiteral("recall"), metrics.recall);
+    object.insert(QStringLiteral("precision"), metrics.precision);
+    object.insert(QStringLiteral("positionError"), QJsonObject{{QStringLiteral("mean"), metrics.meanPositionError},
+                                                               {QStringLiteral("p90"), metrics.p90PositionError},
+                                                               {QStringLiteral("max"), metrics.maxPositionError}});
+    object.insert(QStringLiteral("angleError"), QJsonObject{{QStringLiteral("mean"), metrics.meanAngleError},
+                                                            {QStringLiteral("p90"), metrics.p90AngleError},
+                                                            {QStringLiteral("max"), metrics.maxAngleError}});
+    object.insert(QStringLiteral("scaleError"), QJsonObject{{QStringLiteral("mean"), metrics.meanScaleError},
+                                                            {QStringLiteral("max"), metrics.maxScaleError}});
+    object.insert(QStringLiteral("matchMs"), QJsonObject{{QStringLiteral("mean"), metrics.meanMatchMs},
+                                                         {QStringLiteral("p50"), metrics.p50MatchMs},
+                                                         {QStringLiteral("p90"), metrics.p90MatchMs},
+                                                         {QStringLiteral("max"), metrics.maxMatchMs}});
+    object.insert(QStringLiteral("stagesMs"), timingToJson(metrics.meanStages));
+    return object;
+}
+
+QJsonObject SyntheticBenchmark::toJsonObject(const Comparison& comparison, const QString& lhsName, const QString& rhsName)
+{
+    QJsonObject object;
+    object.insert(QStringLiteral("diff"), comparison.diff);
+    object.insert(lhsName, toJsonObject(comparison.lhs));
+    object.insert(rhsName, toJsonObject(comparison.rhs));
+    object.insert(QStringLiteral("speedup"),
+                  comparison.rhs.meanMatchMs > 0.0 ? comparison.lhs.meanMatchMs / comparison.rhs.meanMatchMs : 0.0);
+    return object;
+}
+
+QByteArray SyntheticBenchmark::toJson(const Report& report)
+{
+    QJsonArray shapes;
+    for (const ShapeReport& shape : report.shapes) {
+        QJsonObject object;
+        object.insert(QStringLiteral("name"), shape.name);
+        object.insert(QStringLiteral("learned"), shape.learned);
+        object.insert(QStringLiteral("learnMs"), shape.learnMs);
+        object.insert(QStringLiteral("modelBytes"), static_cast<double>(shape.modelBytes));
+        object.insert(QStringLiteral("overall"), toJsonObject(shape.overall));
+        object.insert(QStringLiteral("conditions"), conditionsToJson(shape.conditions));
+        shapes.append(object);
+    }
+    QJsonObject root;
+    root.insert(QStringLiteral("formatVersion"), 1);
+    root.insert(QStringLiteral("options"), optionsToJson(report.options));
+    root.insert(QStringLiteral("overall"), toJsonObject(report.overall));
+    root.insert(QStringLiteral("conditions"), conditionsToJson(report.conditions));
+    root.insert(QStringLiteral("shapes"), shapes);
+    if (!report.studies.empty()) {
+        QJsonArray studies;
+        for (const Study& study : report.studies) {
+            QJsonArray variants;
+            for (const VariantResult& variant : study.variants) {
+                QJsonObject object;
+                object.insert(QStringLiteral("name"), variant.name);
+                object.insert(QStringLiteral("matchThreads"), variant.matchThreads);
+                object.insert(QStringLiteral("learnMs"), variant.learnMs);
+                object.insert(QStringLiteral("modelBytes"), static_cast<double>(variant.modelBytes));
+                object.insert(QStringLiteral("speedup"), variant.speedup);
+                object.insert(QStringLiteral("metrics"), toJsonObject(variant.metrics));
+                variants.append(object);
+            }
+            studies.append(QJsonObject{{QStringLiteral("name"), study.name}, {QStringLiteral("variants"), variants}});
+        }
+        root.insert(QStringLiteral("studies"), studies);
+    }
+    root.insert(QStringLiteral("wallMs"), report.wallMs);
+    return QJsonDocument(root).toJson(QJsonDocument::Indented);
+}
+
+QByteArray SyntheticBenchmark::sceneToJsonLine(const Scene& scene, const QString& shapeName, const cv::Point2f& trainCenter,
+                                               const TemplateManager::MatchJobResult& job)
+{
+    QJsonArray truth;
+    for (const Instance& instance : scene.truth) {
+        const cv::Point2f center = truthCenter(instance, trainCenter);
+        truth.append(QJsonObject{{QStringLiteral("x"), center.x},
+                                 {QStringLiteral("y"), center.y},
+                                 {QStringLiteral("angle"), instance.angle},
+                                 {QStringLiteral("scale"), instance.scale}});
+    }
+    QJsonArray results;
+    for (const MatchResult& item : job.results) {
+        results.append(QJsonObject{{QStringLiteral("score"), item.score},
+                                   {QStringLiteral("x"), item.center.x},
+                                   {QStringLiteral("y"), item.center.y},
+                                   {QStringLiteral("angle"), item.angle},
+                                   {QStringLiteral("scale"), item.scale}});
+    }
+    QJsonObject line;
+    line.insert(QStringLiteral("shape"), shapeName);
+    line.insert(QStringLiteral("condition"), conditionKey(scene.condition));
+    line.insert(QStringLiteral("index"), scene.index);
+    line.insert(QStringLiteral("timedOut"), job.status == TemplateManager::MatchStatus::TimedOut);
+    line.insert(QStringLiteral("matchMs"), job.elapsedMs);
+    line.insert(QStringLiteral("stagesMs"), timingToJson(job.timing));
+    line.insert(QStringLiteral("truth"), truth);
+    line.insert(QStringLiteral("results"), results);
+    return QJsonDocument(line).toJson(QJsonDocument::Compact) + '\n';
+}
+
+QStringList SyntheticBenchmark::compare(const QJsonObject& baseline, const Report& report, double maxRecallDrop, double maxSlowdown)
+{
+    QStringList regressions;
+    // 数据集由选项决定，选项不同时指标没有可比性
+    const QJsonObject baseOptions = baseline.value(QStringLiteral("options")).toObject();
+    const QJsonObject options = optionsToJson(report.options);
+    for (const QString& key : {QStringLiteral("seed"), QStringLiteral("scenesPerCondition"), QStringLiteral("instancesPerScene"),
+                               QStringLiteral("sceneWidth"), QStringLiteral("sceneHeight")}) {
+        if (baseOptions.value(key) != options.value(key)) {
+            regressions.append(QStringLiteral("基线数据集选项 %1 不同，无法比较").arg(key));
+        }
+    }
+    if (!regressions.isEmpty()) {
+        return regressions;
+    }
+    const QJsonObject base = baseline.value(QStringLiteral("overall")).toObject();
+    const double baseRecall = base.value(QStringLiteral("recall")).toDouble();
+    const double basePrecision = base.value(QStringLiteral("precision")).toDouble();
+    const double baseMatchMs = base.value(QStringLiteral("matchMs")).toObject().value(QStringLiteral("mean")).toDouble();
+    if (report.overall.recall < baseRecall - maxRecallDrop) {
+        regressions.append(QStringLiteral("召回率 %1 → %2").arg(baseRecall, 0, 'f', 3).arg(report.overall.recall, 0, 'f', 3));
+    }
+    if (report.overall.precision < basePrecision - maxRecallDrop) {
+        regressions.append(QStringLiteral("精确率 %1 → %2").arg(basePrecision, 0, 'f', 3).arg(report.overall.precision, 0, 'f', 3));
+    }
+    if (baseMatchMs > 0.0 && report.overall.meanMatchMs > baseMatchMs * (1.0 + maxSlowdown)) {
+        regressions.append(QStringLiteral("平均匹配耗时 %1 ms → %2 ms").arg(baseMatchMs, 0, 'f', 2).arg(report.overall.meanMatchMs, 0, 'f', 2));
+    }
+    return regressions;
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <array>
+#include <functional>
+#include <vector>
+#include <QByteArray>
+#include <QJsonObject>
+#include <QString>
+#include <QStringList>
+#include "TemplateManager.h"
+#include "template/template_global.h"
+
+// 合成数据集精度/速度回归：按固定随机种子生成若干无旋转对称的形状模板，以及各种条件（旋转、缩放、噪声、遮挡、杂乱背景）下
+// 真值位姿精确已知的场景，用固定的 MatchParams / FindMatchParams 学习并匹配，统计召回率、精确率、位姿误差与各阶段耗时，
+// 输出 JSON 供不同版本（参数调整、匹配库升级）之间对比。场景只由种子与选项决定，同一选项在任何版本下生成的数据完全相同。
+class TEMPLATE_EXPORT SyntheticBenchmark {
+public:
+    enum class Condition {
+        Rotation,  // 任意角度，缩放为 1，轻微噪声
+        Scale,     // 任意角度，缩放在学习范围内随机
+        Noise,     // 强高斯噪声
+        Occlusion, // 每个实例被背景色块遮挡一部分轮廓
+        Clutter    // 背景中加入大量干扰图形
+    };
+    static constexpr int kConditionCount = 5;
+
+    struct Options {
+        MatchParams learn;
+        FindMatchParams find;
+        int      scenesPerCondition = 10; // 每个形状、每种条件的场景数
+        int      instancesPerScene = 3;
+        cv::Size sceneSize{640, 480};
+        uint64_t seed = 20240601;
+        double   positionTolerance = 4.0;  // 判为命中：中心偏差上限（像素）
+        double   angleTolerance = 5.0;     // 判为命中：角度偏差上限（度）
+        double   baseNoiseSigma = 2.0;     // 所有场景的高斯噪声标准差
+        double   noiseSigma = 15.0;        // Noise 条件的高斯噪声标准差
+        double   occlusionRatio = 0.2;     // Occlusion 条件下遮挡块面积与模板面积之比
+        int      clutterCount = 40;        // Clutter 条件的干扰图形数
+        bool     warmUp = true;            // 每个形状先匹配一次不计入统计（缓冲池分配、引擎副本复制）
+    };
+
+    // 形状：模板坐标下的轮廓（闭合多边形，多个轮廓按奇偶规则填充，内孔为背景）与渲染好的模板图像
+    struct Shape {
+        QString name;
+        std::vector<std::vector<cv::Point2f>> contours;
+        cv::Mat templateImage;
+    };
+    // 真值实例：模板坐标 → 场景坐标的相似变换，角度/缩放与匹配引擎约定一致（cv::getRotationMatrix2D）
+    struct Instance {
+        cv::Matx23d transform;
+        double angle = 0.0;
+        double scale = 1.0;
+    };
+    struct Scene {
+        int       shape = 0;
+        Condition condition = Condition::Rotation;
+        int       index = 0;
+        cv::Mat   image;
+        std::vector<Instance> truth;
+    };
+
+    struct Metrics {
+        int    scenes = 0;
+        int    truths = 0;
+        int    detections = 0;
+        int    truePositives = 0;
+        double recall = 0.0;
+        double precision = 0.0; // 没有检测结果时记为 1
+        // 位姿误差只统计命中的结果：中心（像素）、角度（度）、缩放（绝对差）
+        double meanPositionError = 0.0;
+        double p90PositionError = 0.0;
+        double maxPositionError = 0.0;
+        double meanAngleError = 0.0;
+        double p90AngleError = 0.0;
+        double maxAngleError = 0.0;
+        double meanScaleError = 0.0;
+        double maxScaleError = 0.0;
+        // 单张场景匹配耗时与各阶段平均耗时（毫秒）
+        double meanMatchMs = 0.0;
+        double p50MatchMs = 0.0;
+        double p90MatchMs = 0.0;
+        double maxMatchMs = 0.0;
+        TemplateManager::MatchTiming meanStages;
+    };
+    struct ShapeReport {
+        QString name;
+        bool    learned = false;
+        double  learnMs = 0.0;
+        size_t  modelBytes = 0;
+        Metrics overall;
+        std::array<Metrics, kConditionCount> conditions;
+    };
+    // 两组结果视为一致的容差（缺省只允许浮点舍入）
+    struct Tolerance {
+        double position = 1e-3; // 像素
+        double angle = 1e-3;    // 度
+        double scale = 1e-4;
+        double score = 1e-4;
+    };
+    // 一条匹配路径：用学好的模型匹配场景，返回完整的作业结果（含耗时）
+    using MatchPath = std::function<TemplateManager::MatchJobResult(const TemplateManager& manager, int shapeIndex,
+                                                                    const Scene& scene)>;
+    // 两条路径在同一批场景上的对比：各自的真值指标与逐场景结果差异
+    struct Comparison {
+        bool        learned = true; // 全部形状学习成功
+        bool        identical = false;
+        Metrics     lhs;
+        Metrics     rhs;
+        QJsonObject diff;
+    };
+    // 配置对比（性能取舍）：同一批场景上逐个配置学习并匹配，第一个配置为参照
+    struct Variant {
+        QString         name;
+        MatchParams     learn;
+        FindMatchParams find;
+        int             matchThreads = 1; // 单次匹配内部的线程数（TemplateManager::setMaxMatchThreads）
+    };
+    struct VariantResult {
+        QString name;
+        int     matchThreads = 1;
+        Metrics metrics;
+        double  learnMs = 0.0;  // 各形状学习耗时之和
+        size_t  modelBytes = 0; // 各形状模型内存之和
+        double  speedup = 1.0;  // 参照配置平均匹配耗时 / 本配置
+    };
+    struct Study {
+        QString name;
+        std::vector<VariantResult> variants;
+    };
+    struct Report {
+        Options options;
+        std::vector<ShapeReport> shapes;
+        Metrics overall;
+        std::array<Metrics, kConditionCount> conditions;
+        std::vector<Study> studies; // 按需运行的配置对比，未运行时为空
+        double wallMs = 0.0;
+    };
+    // 每个场景匹配后调用（trainCenter 为该形状模型的训练中心），用于导出数据集或逐场景排查
+    using SceneCallback = std::function<void(const Scene& scene, const Shape& shape, const cv::Point2f& trainCenter,
+                                             const TemplateManager::MatchJobResult& job)>;
+
+    explicit SyntheticBenchmark(const Options& options);
+
+    static std::vector<Shape> builtinShapes();
+    static QString conditionKey(Condition condition);
+    // 生成一个场景：随机数只由种子、形状、条件与序号决定，与生成顺序无关
+    Scene generateScene(const Shape& shape, int shapeIndex, Condition condition, int index) const;
+    // 实例中心的真值：模板训练中心（TemplateManager::trainCenter，模板图像坐标）经真值变换后的位置
+    static cv::Point2f truthCenter(const Instance& instance, const cv::Point2f& trainCenter);
+    // 某个形状在当前选项下的全部场景（各条件依次排列）
+    std::vector<Scene> generateScenes(const Shape& shape, int shapeIndex) const;
+    // 结果与真值实例（中心为 center）的位姿偏差在命中容差内
+    bool hitsTruth(const MatchResult& result, const cv::Point2f& center, const Instance& instance) const;
+
+    Report run(const SceneCallback& onScene = SceneCallback()) const;
+    bool learn(const Shape& shape, const MatchParams& params, TemplateManager& manager) const;
+    // 每个形状按 learnParams 学习一次，全部场景依次交给两条路径匹配（先各预热一次）；一致性测试与性能对比共用
+    Comparison comparePaths(const MatchParams& learnParams, const MatchPath& lhs, const MatchPath& rhs,
+                            const Tolerance& tolerance) const;
+    // 按 params 调用 runMatchJob 的匹配路径
+    static MatchPath findPath(const FindMatchParams& params);
+    // 对比结果：结果差异、两条路径的真值指标（分别以 lhsName/rhsName 为键），以及平均匹配耗时之比（lhs / rhs）
+    static QJsonObject toJsonObject(const Comparison& comparison, const QString& lhsName, const QString& rhsName);
+    // 依次测量各配置（学习参数相同的配置共用一个模型），结束后恢复原来的匹配线程数
+    Study measure(const QString& name, const std::vector<Variant>& variants) const;
+    // 单次匹配内部各线程数（如 1/2/4/8）的匹配耗时与相对单线程的加速比
+    Study measureMatchThreads(const std::vector<int>& threads) const;
+    // 逐层全图搜索（参照）与金字塔由粗到精搜索的匹配耗时与精度
+    Study measureCoarseToFine() const;
+    // 各学习角度步长下不精修/精修的精度、匹配耗时、学习耗时与模型内存；参照为第一个步长不精修
+    Study measurePoseRefinement(const std::vector<float>& angleSteps) const;
+
+    static QByteArray toJson(const Report& report);
+    static QJsonObject toJsonObject(const Metrics& metrics);
+    static QByteArray sceneToJsonLine(const Scene& scene, const QString& shapeName, const cv::Point2f& trainCenter,
+                                      const TemplateManager::MatchJobResult& job);
+    // 与基线报告（toJson 的输出）比较总体指标：召回率/精确率下降超过 maxRecallDrop，或平均匹配耗时
+    // 增加超过 maxSlowdown（比例）时返回对应的说明，空列表表示没有回退
+    static QStringList compare(const QJsonObject& baseline, const Report& report, double maxRecallDrop, double maxSlowdown);
+
+private:
+    Options m_options;
+};
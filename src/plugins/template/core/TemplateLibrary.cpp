@@ -0,0 +1,191 @@
+#include "TemplateLibrary.h"
+#include "MatchSuppressor.h"
+#include <QDebug>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// 与 TemplateManager 的去重距离一致：中心距离小于模板对角线 0.3 倍视为同一目标
+double duplicateDistance(const MatchResult& result)
+{
+    return std::max(10.0, 0.3 * std::hypot(static_cast<double>(result.featureSize.width),
+                                           static_cast<double>(result.featureSize.height)));
+}
+} // namespace
+
+TemplateLibrary::TemplateLibrary() = default;
+
+TemplateLibrary::~TemplateLibrary() = default;
+
+int TemplateLibrary::addTemplate(const QString& name, const cv::Mat& src, const cv::Mat& templateMat,
+                                 const MatchParams& params, const FindMatchParams& findParams)
+{
+    auto manager = std::make_unique<TemplateManager>();
+    if (!manager->learnTemplate(src, templateMat, params)) {
+        qWarning().noquote() << QStringLiteral("模板库学习失败：%1").arg(name);
+        return -1;
+    }
+    return addTemplate(name, std::move(manager), findParams);
+}
+
+int TemplateLibrary::addTemplate(const QString& name, std::unique_ptr<TemplateManager> manager,
+                                 const FindMatchParams& findParams)
+{
+    if (!manager || !manager->hasTemplate()) {
+        return -1;
+    }
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    for (Entry& entry : m_entries) {
+        if (entry.name == name) {
+            entry.manager = std::move(manager);
+            entry.findParams = findParams;
+            return entry.id;
+        }
+    }
+    Entry entry;
+    entry.id = m_nextId++;
+    entry.name = name;
+    entry.findParams = findParams;
+    entry.manager = std::move(manager);
+    m_entries.push_back(std::move(entry));
+    return m_entries.back().id;
+}
+
+bool TemplateLibrary::removeTemplate(int id)
+{
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    const auto it = std::find_if(m_entries.begin(), m_entries.end(), [id](const Entry& entry) { return entry.id == id; });
+    if (it == m_entries.end()) {
+        return false;
+    }
+    m_entries.erase(it);
+    return true;
+}
+
+void TemplateLibrary::clear()
+{
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    m_entries.clear();
+}
+
+bool TemplateLibrary::setFindParams(int id, const FindMatchParams& findParams)
+{
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    for (Entry& entry : m_entries) {
+        if (entry.id == id) {
+            entry.findParams = findParams;
+            return true;
+        }
+    }
+    return false;
+}
+
+QStringList TemplateLibrary::names() const
+{
+    QStringList result;
+    for (const Entry& entry : m_entries) {
+        result.append(entry.name);
+    }
+    return result;
+}
+
+int TemplateLibrary::idOf(const QString& name) const
+{
+    for (const Entry& entry : m_entries) {
+        if (entry.name == name) {
+            return entry.id;
+        }
+    }
+    return -1;
+}
+
+QString TemplateLibrary::nameOf(int id) const
+{
+    const Entry* entry = find(id);
+    return entry ? entry->name : QString();
+}
+
+const TemplateManager* TemplateLibrary::manager(int id) const
+{
+    const Entry* entry = find(id);
+    return entry ? entry->manager.get() : nullptr;
+}
+
+const TemplateLibrary::Entry* TemplateLibrary::find(int id) const
+{
+    for (const Entry& entry : m_entries) {
+        if (entry.id == id) {
+            return &entry;
+        }
+    }
+    return nullptr;
+}
+
+std::vector<MatchResult> TemplateLibrary::matchAll(const cv::Mat& src, const cv::Mat& mask, bool useRoi,
+                                                   bool suppressAcrossTemplates) const
+{
+    std::vector<MatchResult> results;
+    std::lock_guard<std::mutex> lock(m_matchMutex);
+    if (src.empty() || m_entries.empty()) {
+        return results;
+    }
+    const auto startTime = std::chrono::steady_clock::now();
+
+    // 裁剪范围取各模板外扩量的最大值、原点按最深扫描层对齐，保证每个模板看到的搜索区域不小于单独匹配时
+    int margin = 0;
+    int scanUpperLevel = 0;
+    for (const Entry& entry : m_entries) {
+        margin = std::max(margin, entry.manager->searchMargin());
+        scanUpperLevel = std::max(scanUpperLevel, entry.manager->scanUpperLevelLimit());
+    }
+    cv::Mat searchSrc;
+    cv::Mat searchMask;
+    cv::Rect region;
+    if (!TemplateManager::prepareSearchInput(src, mask, margin, 1 << scanUpperLevel, searchSrc, searchMask, region)) {
+        return results;
+    }
+    m_pyramid.reset(searchSrc, searchMask);
+    if (m_pyramid.empty()) {
+        m_pyramid.release();
+        return results;
+    }
+
+    // 各模板依次在共享金字塔上搜索：金字塔各层在首次用到时生成，之后的模板直接复用
+    for (const Entry& entry : m_entries) {
+        FindMatchParams params = entry.findParams;
+        params.useRoi = useRoi;
+        std::vector<MatchResult> found = entry.manager->matchPyramid(m_pyramid, params);
+        for (MatchResult& item : found) {
+            item.libraryId = entry.id;
+        }
+        TemplateManager::finalizeResults(found, params, region.tl());
+        results.insert(results.end(), std::make_move_iterator(found.begin()), std::make_move_iterator(found.end()));
+    }
+    m_pyramid.release();
+
+    std::stable_sort(results.begin(), results.end(), [](const MatchResult& lhs, const MatchResult& rhs) {
+        return lhs.score > rhs.score;
+    });
+    if (suppressAcrossTemplates && m_entries.size() > 1) {
+        double cellSize = 0.0;
+        for (const MatchResult& item : results) {
+            cellSize = std::max(cellSize, duplicateDistance(item));
+        }
+        MatchSuppressor suppressor(cellSize);
+        std::vector<MatchResult> kept;
+        kept.reserve(results.size());
+        for (MatchResult& item : results) {
+            if (suppressor.tryAccept(item, duplicateDistance(item))) {
+                kept.push_back(std::move(item));
+            }
+        }
+        results.swap(kept);
+    }
+
+    const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    qInfo().noquote() << QStringLiteral("模板库匹配 %1 个模板，输出结果数: %2，耗时 %3 ms")
+                          .arg(static_cast<int>(m_entries.size()))
+                          .arg(static_cast<int>(results.size()))
+                          .arg(elapsedMs, 0, 'f', 2);
+    return results;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <QString>
+#include <QStringList>
+#include "TemplateManager.h"
+#include "template/template_global.h"
+
+// 模板库：按名称保存多个已学习的模板（各自的 MatchParams 与匹配参数），一次调用在同一帧上匹配全部模板。
+// 灰度转换、掩膜裁剪与各层降采样对整帧只做一次，所有模板共享同一个搜索图金字塔；
+// 各模板依次在共享金字塔上搜索（每个模板内部仍按层/候选并行），结果的 libraryId 标明命中的模板。
+// 梯度方向量化在匹配引擎内部按模板完成，无法跨模板共享。
+// addTemplate/removeTemplate 与 matchAll 不可并发调用；matchAll 之间串行执行（共享同一个金字塔缓冲）。
+class TEMPLATE_EXPORT TemplateLibrary {
+public:
+    struct Entry {
+        int     id = -1;
+        QString name;
+        FindMatchParams findParams; // 该模板的分数阈值、最大结果数等（Mask/useRoi 由 matchAll 统一给出）
+        std::unique_ptr<TemplateManager> manager;
+    };
+
+    TemplateLibrary();
+    ~TemplateLibrary();
+
+    // 学习并加入一个模板，返回模板编号；同名模板被替换（沿用原编号），学习失败返回 -1
+    int addTemplate(const QString& name, const cv::Mat& src, const cv::Mat& templateMat,
+                    const MatchParams& params, const FindMatchParams& findParams = FindMatchParams());
+    // 加入已学习（或已加载模型包）的模板，返回模板编号；未学习的模板返回 -1
+    int addTemplate(const QString& name, std::unique_ptr<TemplateManager> manager,
+                    const FindMatchParams& findParams = FindMatchParams());
+    bool removeTemplate(int id);
+    void clear();
+    bool setFindParams(int id, const FindMatchParams& findParams);
+
+    int size() const { return static_cast<int>(m_entries.size()); }
+    bool isEmpty() const { return m_entries.empty(); }
+    QStringList names() const;
+    int idOf(const QString& name) const; // 不存在返回 -1
+    QString nameOf(int id) const;
+    const TemplateManager* manager(int id) const;
+
+    // 在 src 上匹配库内全部模板：mask/useRoi 对所有模板生效；suppressAcrossTemplates 时不同模板在同一位置的结果只保留最高分，
+    // 返回按分数降序的结果（各模板最多 findParams.maxCount 个）
+    std::vector<MatchResult> matchAll(const cv::Mat& src, const cv::Mat& mask = cv::Mat(), bool useRoi = false,
+                                      bool suppressAcrossTemplates = true) const;
+
+private:
+    const Entry* find(int id) const;
+
+    std::vector<Entry> m_entries;
+    int m_nextId = 0;
+    mutable std::mutex m_matchMutex;
+    mutable ImagePyramid m_pyramid; // 跨帧复用的共享金字塔，由 m_matchMutex 保护
+};
@@ -1,8 +1,14 @@
 #include "TemplateManager.h"
+#include "CompositeTemplMatch.h"
+#include "LazyTemplMatch.h"
+#include "MatchSuppressor.h"
+#include "PathTemplateGenerator.h"
+#include "PoseRefiner.h"
 #include <algorithm>
 #include <cmath>
 #include <cstdint> // 提供 int64_t/uint32_t 等定长整数类型，用于稳定打包哈希键
 #include <limits>
+#include <map>
 #include <set>
 #include <unordered_map> // 用于构建二维网格直方图（确定性选峰），替代 rand 随机抽样
 #include <exception>
@@ -10,9 +16,250 @@
 #include <bscv/templMatchTypes.h>
 #include <QDebug> // 用于输出掩膜尺寸异常日志
 #include <QString>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <opencv2/imgcodecs.hpp>
+#ifdef BSCV_BUILTIN_MATCHER
+#include <shapematch/shapeMatch.h>
+#endif
 
 namespace { // 工具函数
 constexpr int kMaxPyramidScanLevel = 3;
+constexpr float kCoarseScoreRatio = 0.8f; // 分层搜索中间层候选阈值 = 最终阈值 * 该比例
+constexpr int kMinHypotheses = 8;         // 最粗层至少保留的候选数
+constexpr size_t kMaxPooledPyramids = 2;  // 搜索图金字塔缓冲池上限（界面 + 后台各一）
+constexpr size_t kMaxPooledEngineSets = 8; // 引擎副本池上限
+constexpr int kDefaultMatchThreads = 4;    // 自动模式下单次匹配的并行上限（层数上限即为 4）
+
+std::atomic<int> g_maxMatchThreads{0};
+
+// 模型包：清单 + 模板图像/掩膜 + 每个槽位一个引擎模型文件
+constexpr int kModelBundleVersion = 1;
+const char* const kModelBundleFormat = "TemplateModelBundle";
+const char* const kManifestFile = "manifest.yml";
+const char* const kTemplateImageFile = "template.png";
+const char* const kTemplateMaskFile = "mask.png";
+#ifdef BSCV_BUILTIN_MATCHER
+const char* const kMatchEngineTag = "builtin-shapematch"; // 不同引擎的模型文件互不兼容，引擎标识参与哈希
+#else
+const char* const kMatchEngineTag = "bscv";
+#endif
+
+// 分段/按需模型不是引擎库自己的类型，复制/读取时需要单独处理
+TIGER_BSVISION::ITemplMatch* cloneEngine(TIGER_BSVISION::ITemplMatch* engine)
+{
+    if (const auto* composite = dynamic_cast<const CompositeTemplMatch*>(engine)) {
+        return composite->clone();
+    }
+    if (const auto* lazy = dynamic_cast<const LazyTemplMatch*>(engine)) {
+        return lazy->clone();
+    }
+    return TIGER_BSVISION::newTemplMatch(engine);
+}
+
+// 统计一个引擎（含分段/按需模型的各组成引擎）的变体数、特征数与字节数。
+// expectedVariants 为该引擎的模板数，只在内部存储不透明、需要按 getTempl 展开估算时使用
+void measureEngine(const TIGER_BSVISION::ITemplMatch& engine, int expectedVariants, bool perVariant,
+                   TemplateManager::MemoryReport::Slot& slot)
+{
+    if (const auto* composite = dynamic_cast<const CompositeTemplMatch*>(&engine)) {
+        for (size_t i = 0; i < composite->partCount(); ++i) {
+            if (const TIGER_BSVISION::ITemplMatch* part = composite->part(i)) {
+                measureEngine(*part, composite->templateCount(i), perVariant, slot);
+            }
+        }
+        return;
+    }
+    if (const auto* lazy = dynamic_cast<const LazyTemplMatch*>(&engine)) {
+        lazy->forEachResidentEngine([perVariant, &slot](const TIGER_BSVISION::ITemplMatch& bin, int templateCount) {
+            measureEngine(bin, templateCount, perVariant, slot);
+        });
+        return;
+    }
+#ifdef BSCV_BUILTIN_MATCHER
+    if (const auto* builtin = dynamic_cast<const TIGER_BSVISION::ShapeMatchEngine*>(&engine)) {
+        const TIGER_BSVISION::ShapeMatchEngine::MemoryUsage usage = builtin->memoryUsage();
+        slot.variants += usage.templates;
+        slot.features += usage.features;
+        slot.bytes += usage.totalBytes();
+        for (size_t i = 0; perVariant && i < usage.templates; ++i) {
+            slot.variantBytes.push_back(builtin->templateBytes(static_cast<int>(i)));
+        }
+        return;
+    }
+#endif
+    // 预编译引擎：按展开后的 Template 大小估算（实际存储格式未知），不逐个展开时取首/中/尾三个模板的平均
+    if (expectedVariants <= 0 || engine.isEmpty()) {
+        return;
+    }
+    const auto templateSize = [&engine](int id, size_t& features) {
+        features = engine.getTempl(id).features.size();
+        return sizeof(TIGER_BSVISION::Template) + features * sizeof(TIGER_BSVISION::Feature);
+    };
+    size_t features = 0;
+    size_t bytes = 0;
+    if (perVariant) {
+        for (int id = 0; id < expectedVariants; ++id) {
+            size_t count = 0;
+            const size_t size = templateSize(id, count);
+            slot.variantBytes.push_back(size);
+            features += count;
+            bytes += size;
+        }
+    } else {
+        const std::set<int> samples{0, expectedVariants / 2, expectedVariants - 1};
+        for (int id : samples) {
+            size_t count = 0;
+            bytes += templateSize(id, count);
+            features += count;
+        }
+        features = features * static_cast<size_t>(expectedVariants) / samples.size();
+        bytes = bytes * static_cast<size_t>(expectedVariants) / samples.size();
+    }
+    slot.variants += static_cast<size_t>(expectedVariants);
+    slot.features += features;
+    slot.bytes += bytes;
+    slot.estimated = true;
+}
+
+void logMemoryReport(const TemplateManager::MemoryReport& report)
+{
+    for (const TemplateManager::MemoryReport::Slot& slot : report.engineSlots) {
+        qDebug().noquote() << QStringLiteral("槽位 %1（第 %2 层）：%3 个变体，%4 个特征，%5 KB（每变体 %6 B%7）")
+                              .arg(slot.slot)
+                              .arg(slot.level)
+                              .arg(slot.variants)
+                              .arg(slot.features)
+                              .arg(static_cast<double>(slot.bytes) / 1024.0, 0, 'f', 1)
+                              .arg(slot.bytesPerVariant(), 0, 'f', 0)
+                              .arg(slot.estimated ? QStringLiteral("，估算") : QString());
+    }
+}
+
+std::unique_ptr<TIGER_BSVISION::ITemplMatch> readEngineFile(const std::string& path)
+{
+    std::unique_ptr<TIGER_BSVISION::ITemplMatch> engine;
+    if (CompositeTemplMatch::isCompositeModelFile(path)) {
+        engine = std::make_unique<CompositeTemplMatch>();
+    } else {
+        engine.reset(TIGER_BSVISION::newTemplMatch());
+    }
+    if (!engine || !engine->read_shape_model(path) || engine->isEmpty()) {
+        return nullptr;
+    }
+    return engine;
+}
+
+QString engineModelFile(size_t slot)
+{
+    return QStringLiteral("engine_%1.yml").arg(slot);
+}
+
+// 64 位 FNV-1a，只用于缓存键，不要求抗碰撞
+uint64_t fnv1a(uint64_t hash, const void* data, size_t size)
+{
+    const auto* bytes = static_cast<const unsigned char*>(data);
+    for (size_t i = 0; i < size; ++i) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+template <typename T>
+uint64_t fnv1aValue(uint64_t hash, const T& value)
+{
+    return fnv1a(hash, &value, sizeof(T));
+}
+
+// 图像经 QFile 读写，避免 cv::imwrite/imread 在 Windows 上不支持中文路径
+bool writeImageFile(const QString& path, const cv::Mat& image)
+{
+    std::vector<uchar> buffer;
+    if (image.empty() || !cv::imencode(".png", image, buffer)) {
+        return false;
+    }
+    QSaveFile file(path);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<qint64>(buffer.size()));
+    return file.commit();
+}
+
+cv::Mat readImageFile(const QString& path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return cv::Mat();
+    }
+    const QByteArray data = file.readAll();
+    if (data.isEmpty()) {
+        return cv::Mat();
+    }
+    const cv::Mat raw(1, data.size(), CV_8UC1, const_cast<char*>(data.constData()));
+    return cv::imdecode(raw, cv::IMREAD_UNCHANGED);
+}
+
+void writeMatchParams(cv::FileStorage& fs, const MatchParams& params)
+{
+    fs << "params" << "{"
+       << "angleRange" << params.angleRange
+       << "angle_step" << params.angle_step
+       << "FeaturePointNum" << static_cast<int>(params.FeaturePointNum)
+       << "compressionLevel" << params.compressionLevel
+       << "weakThreshold" << params.weakThreshold
+       << "strongThreshold" << params.strongThreshold
+       << "ignorePolarity" << static_cast<int>(params.ignorePolarity)
+       << "scale_min" << params.scale_min
+       << "scale_max" << params.scale_max
+       << "scale_step" << params.scale_step
+       << "borderPadding" << params.borderPadding
+       << "learnAngleSplits" << params.learnAngleSplits
+       << "}";
+}
+
+MatchParams readMatchParams(const cv::FileNode& node)
+{
+    MatchParams params;
+    node["angleRange"] >> params.angleRange;
+    node["angle_step"] >> params.angle_step;
+    params.FeaturePointNum = static_cast<size_t>(std::max(0, static_cast<int>(node["FeaturePointNum"])));
+    node["compressionLevel"] >> params.compressionLevel;
+    node["weakThreshold"] >> params.weakThreshold;
+    node["strongThreshold"] >> params.strongThreshold;
+    params.ignorePolarity = static_cast<int>(node["ignorePolarity"]) != 0;
+    node["scale_min"] >> params.scale_min;
+    node["scale_max"] >> params.scale_max;
+    node["scale_step"] >> params.scale_step;
+    node["borderPadding"] >> params.borderPadding;
+    node["learnAngleSplits"] >> params.learnAngleSplits;
+    return params;
+}
+
+// 匹配专用线程池：与界面使用的全局线程池分开，避免在全局池任务里等待全局池造成饥饿
+QThreadPool& matchThreadPool()
+{
+    static QThreadPool pool;
+    return pool;
+}
+
+int resolveMatchThreads()
+{
+    int threads = g_maxMatchThreads.load();
+    if (threads <= 0) {
+        // 工作线程内 OpenCV 的 parallel_for 会退化为串行，线程数不超过 OpenCV 线程数即不会过度订阅
+        threads = std::min(kDefaultMatchThreads, std::max(1, cv::getNumThreads()));
+    }
+    return std::max(1, threads);
+}
 
 int calcValidPyramidLevel(const cv::Size& size, int requestedLevel)
 {
@@ -97,17 +344,69 @@ double normalizeScore(double similarity)
 {
     return std::clamp(similarity / 100.0, 0.0, 1.0);
 } 
-// 根据中心距离抑制重复的匹配结果，避免同一位置被反复标记
-bool isDuplicateMatch(const MatchResult& candidate, const std::vector<MatchResult>& accepted, double distanceThreshold)
+// FindMatchParams::scoreThreshold 与引擎相似度同为 0~100（界面分数框直接给出），MatchResult::score 为 0~1。
+// 阈值只在这里换算：传给引擎用 engineThreshold，与结果分数比较用 resultThreshold
+float engineThreshold(const FindMatchParams& params)
 {
-    for (const auto& existing : accepted) {
-        const double dist = cv::norm(candidate.center - existing.center);
-        const double angleDelta = std::abs(candidate.angle - existing.angle);
-        if (dist <= distanceThreshold) {
-            return true;
-        }
+    return static_cast<float>(std::clamp(params.scoreThreshold, 0.0, 100.0));
+}
+double resultThreshold(const FindMatchParams& params)
+{
+    return normalizeScore(engineThreshold(params));
+}
+// 补齐完整结果：按需变换特征点，外接框与旋转框按特征点重新计算（与逐点输出时一致）
+void materializeFeaturePoints(MatchResult& item)
+{
+    item.transformedFeaturePoints = item.featurePoints();
+    if (item.transformedFeaturePoints.empty()) {
+        return;
+    }
+    item.Roiarea = cv::boundingRect(item.transformedFeaturePoints);
+    item.rotatedRect = cv::minAreaRect(item.transformedFeaturePoints);
+    item.featureSize = item.rotatedRect.size;
+}
+
+// 掩膜有效像素（与 ImagePyramid 的规整一致：>1 视为有效）的外接矩形，没有有效像素时为空
+cv::Rect maskBoundingRect(const cv::Mat& mask)
+{
+    cv::Mat gray;
+    if (mask.type() == CV_8UC1) {
+        gray = mask;
+    } else if (mask.channels() > 1) {
+        cv::cvtColor(mask, gray, cv::COLOR_BGR2GRAY);
+    } else {
+        mask.convertTo(gray, CV_8U);
+    }
+    return cv::boundingRect(gray > 1);
+}
+
+// 整图坐标平移：裁剪搜索得到的结果换算回整图
+void offsetResult(MatchResult& item, const cv::Point& offset)
+{
+    const cv::Point2f shift(static_cast<float>(offset.x), static_cast<float>(offset.y));
+    item.center += shift;
+    item.rotatedRect.center += shift;
+    item.Roiarea += offset;
+    for (auto& pt : item.transformedFeaturePoints) {
+        pt += shift;
+    }
+    item.featureTransform(0, 2) += shift.x;
+    item.featureTransform(1, 2) += shift.y;
+}
+
+size_t featurePointBytes(const std::vector<MatchResult>& results)
+{
+    size_t bytes = 0;
+    for (const MatchResult& item : results) {
+        bytes += item.transformedFeaturePoints.capacity() * sizeof(cv::Point2f);
     }
-    return false;
+    return bytes;
+}
+
+// 中心距离小于该值的结果视为同一目标，避免同一位置被反复标记
+double duplicateDistance(const cv::Size2f& featureSize)
+{
+    return std::max(10.0, std::hypot(static_cast<double>(featureSize.width), static_cast<double>(featureSize.height)) * 0.3);
 }
 
 }// namespace
@@ -130,6 +429,7 @@ bool TemplateManager::learnTemplate(const cv::Mat& src, const cv::Mat& templateM
     {
         return false;
     }
+    const auto learnStart = std::chrono::steady_clock::now();
 
     cv::Mat roiMat = templateMat.clone();
     cv::Mat grayTemplate = toGrayMat(roiMat);
@@ -137,15 +437,7 @@ bool TemplateManager::learnTemplate(const cv::Mat& src, const cv::Mat& templateM
     {
         return false;
     }
-    for (auto& engine : m_matchEngines) {
-        if (engine) {
-            engine->clear();
-            engine.reset();
-        }
-    }
-    m_effectiveLevels.fill(0);
-    m_engineTrainCenters.fill(cv::Point2f(0.f, 0.f));
-    m_valid = false;
+    resetModel();
     float angleStart = 0.0f;
     // 根据参数构造模板学习掩膜：屏蔽距离边界较近的像素，避免把 ROI 边框当作特征
     cv::Mat templateMask; 
@@ -186,45 +478,252 @@ bool TemplateManager::learnTemplate(const cv::Mat& src, const cv::Mat& templateM
     const int scanUpperLevel = std::min(m_pyramidLevel, kMaxPyramidScanLevel);
     m_featurePoints.clear();
     m_template = roiMat; // 保存原始 ROI 图像供其它模块显示
+    m_templateMask = templateMask;
+    m_modelHash.clear();
 
     m_learnParams = params; // 缓存学习时使用的参数
+
+    // 先并行生成每个有效层（及其角度分段）的引擎，再按原串行顺序合并：调用参数与串行完全一致，结果相同
+    std::vector<int> levelsToBuild;
+    for (int requestLevel = 0; requestLevel <= scanUpperLevel; ++requestLevel) {
+        const int effectiveLevel = calcValidPyramidLevel(grayTemplate.size(), requestLevel);
+        if (std::find(levelsToBuild.begin(), levelsToBuild.end(), effectiveLevel) == levelsToBuild.end()) {
+            levelsToBuild.push_back(effectiveLevel);
+        }
+    }
+    const float angleStep = params.angle_step / 2.0f;
+    const std::vector<CompositeTemplMatch::AngleRange> angleRanges =
+        CompositeTemplMatch::splitAngleRange(angleStart, static_cast<float>(params.angleRange), angleStep,
+                                             params.lazyModel ? 1 : params.learnAngleSplits);
+    std::vector<cv::Mat> levelTemplates(levelsToBuild.size());
+    std::vector<cv::Mat> levelMasks(levelsToBuild.size());
+    for (size_t i = 0; i < levelsToBuild.size(); ++i) {
+        levelTemplates[i] = pyramidDown(grayTemplate, levelsToBuild[i]);
+        if (!templateMask.empty()) {
+            levelMasks[i] = pyramidDown(templateMask, levelsToBuild[i]);
+            cv::threshold(levelMasks[i], levelMasks[i], 1, 255, cv::THRESH_BINARY);
+        }
+    }
+    const int scales = CompositeTemplMatch::scaleCount(params.scale_min, params.scale_max, params.scale_step);
+    std::vector<int> templateCounts;
+    for (const CompositeTemplMatch::AngleRange& range : angleRanges) {
+        templateCounts.push_back(range.angleCount * scales);
+    }
+    std::map<int, std::unique_ptr<TIGER_BSVISION::ITemplMatch>> builtEngines;
+    const int learnWorkers = buildLevelEngines(levelsToBuild, templateCounts, [&](size_t levelIndex, size_t part) {
+        const CompositeTemplMatch::AngleRange& range = angleRanges[part];
+        std::unique_ptr<TIGER_BSVISION::ITemplMatch> engine;
+        if (params.lazyModel) {
+            engine = std::make_unique<LazyTemplMatch>(params.lazyAngleBin, params.lazyCacheBins, params.lazyHotFirst);
+        } else {
+            engine.reset(TIGER_BSVISION::newTemplMatch());
+        }
+        const bool ok = engine && engine->create_shape_model(levelTemplates[levelIndex],
+                                                             levelMasks[levelIndex],
+                                                             range.start,
+                                                             range.extent,
+                                                             angleStep,
+                                                             params.scale_min,
+                                                             params.scale_max,
+                                                             params.scale_step,
+                                                             params.weakThreshold,
+                                                             params.strongThreshold,
+                                                             params.FeaturePointNum,
+                                                             _type);
+        return ok ? std::move(engine) : nullptr;
+    }, builtEngines);
+
+    if (!installEngines(builtEngines, grayTemplate.size(), scanUpperLevel)) {
+        return false;
+    }
+    m_modelHash = modelHash(templateMat, params);
+    m_learnMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - learnStart).count();
+    qDebug().noquote() << QStringLiteral("模板学习完成：%1 层 × %2 段，%3 线程，%4 ms")
+                          .arg(levelsToBuild.size())
+                          .arg(angleRanges.size())
+                          .arg(learnWorkers)
+                          .arg(m_learnMs, 0, 'f', 1);
+    logMemoryReport(memoryReport());
+    return true;
+}
+
+int TemplateManager::buildLevelEngines(const std::vector<int>& levels, const std::vector<int>& partTemplateCounts,
+                                       const std::function<std::unique_ptr<TIGER_BSVISION::ITemplMatch>(size_t, size_t)>& build,
+                                       std::map<int, std::unique_ptr<TIGER_BSVISION::ITemplMatch>>& builtEngines) const
+{
+    const size_t partCount = partTemplateCounts.size();
+    std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>> parts(levels.size() * partCount);
+    std::atomic<size_t> nextTask{0};
+    const int workers = static_cast<int>(std::min<size_t>(parts.size(), static_cast<size_t>(resolveMatchThreads())));
+    runParallel(workers, [&](int, const EngineSet*) {
+        for (size_t task = nextTask++; task < parts.size(); task = nextTask++) {
+            parts[task] = build(task / partCount, task % partCount);
+        }
+    }, nullptr, false);
+
+    // 每个有效层：所有分段都成功才可用；只有一段时直接使用该引擎
+    for (size_t i = 0; i < levels.size(); ++i) {
+        auto first = parts.begin() + static_cast<std::ptrdiff_t>(i * partCount);
+        auto last = first + static_cast<std::ptrdiff_t>(partCount);
+        if (std::any_of(first, last, [](const std::unique_ptr<TIGER_BSVISION::ITemplMatch>& part) { return !part; })) {
+            continue;
+        }
+        if (partCount == 1) {
+            builtEngines[levels[i]] = std::move(*first);
+            continue;
+        }
+        std::vector<std::unique_ptr<TIGER_BSVISION::ITemplMatch>> levelParts(std::make_move_iterator(first), std::make_move_iterator(last));
+        if (!CompositeTemplMatch::templateCountsMatch(levelParts, partTemplateCounts)) {
+            qWarning().noquote() << QStringLiteral("金字塔层 %1 分段模型的模板数与角度分段不一致，跳过该层").arg(levels[i]);
+            continue;
+        }
+        builtEngines[levels[i]] = std::make_unique<CompositeTemplMatch>(std::move(levelParts), partTemplateCounts);
+    }
+    return workers;
+}
+
+bool TemplateManager::learnTemplateFromPath(const QPainterPath& path, const MatchParams& params)
+{
+    const auto learnStart = std::chrono::steady_clock::now();
+    const PathTemplateGenerator generator(path);
+    if (generator.isEmpty()) {
+        return false;
+    }
+    const cv::Size templateSize = generator.templateSize();
+    resetModel();
+
+    MatchParams pathParams = params;
+    if (!params.ignorePolarity) {
+        qInfo().noquote() << QStringLiteral("路径模板不含明暗信息，按忽略极性学习");
+        pathParams.ignorePolarity = true;
+    }
+    m_pyramidLevel = calcValidPyramidLevel(templateSize, params.compressionLevel);
+    m_pyramidScale = static_cast<float>(1 << m_pyramidLevel);
+    const int scanUpperLevel = std::min(m_pyramidLevel, kMaxPyramidScanLevel);
+    m_featurePoints.clear();
+    m_template = generator.render(); // 只用于显示与模型包保存
+    m_templateMask = cv::Mat();
+    m_modelHash.clear();
+    m_learnParams = pathParams;
+
+    // 每个有效层直接按 1/2^L 缩放路径采样，与图像学习的降采样坐标一致；角度离散与分段与 learnTemplate 相同
+    std::vector<int> levelsToBuild;
+    for (int requestLevel = 0; requestLevel <= scanUpperLevel; ++requestLevel) {
+        const int level = calcValidPyramidLevel(templateSize, requestLevel);
+        if (std::find(levelsToBuild.begin(), levelsToBuild.end(), level) == levelsToBuild.end()) {
+            levelsToBuild.push_back(level);
+        }
+    }
+#ifdef BSCV_BUILTIN_MATCHER
+    // 按需模型的 bin 由图像生成，边缘点建模无法按需，整体生成
+    const bool lazyModel = false;
+    if (params.lazyModel) {
+        qWarning().noquote() << QStringLiteral("路径模板由边缘点直接建模，不支持按需模型，改为完整生成");
+    }
+#else
+    const bool lazyModel = params.lazyModel;
+#endif
+    const float angleStep = params.angle_step / 2.0f;
+    const std::vector<CompositeTemplMatch::AngleRange> angleRanges =
+        CompositeTemplMatch::splitAngleRange(0.f, static_cast<float>(params.angleRange), angleStep,
+                                             lazyModel ? 1 : params.learnAngleSplits);
+    const int scales = CompositeTemplMatch::scaleCount(params.scale_min, params.scale_max, params.scale_step);
+    std::vector<int> templateCounts;
+    for (const CompositeTemplMatch::AngleRange& range : angleRanges) {
+        templateCounts.push_back(range.angleCount * scales);
+    }
+    // 各层的采样（或渲染）只做一次，供该层所有分段共用
+#ifdef BSCV_BUILTIN_MATCHER
+    std::vector<PathTemplateGenerator::Edges> levelEdges;
+    for (int level : levelsToBuild) {
+        levelEdges.push_back(generator.sample(1.0 / static_cast<double>(1 << level)));
+    }
+#else
+    std::vector<cv::Mat> levelImages;
+    for (int level : levelsToBuild) {
+        // 预编译引擎没有边缘点接口，只能从图像学习：渲染该层模板大小的图像（不是整幅相机图像）
+        levelImages.push_back(generator.render(1.0 / static_cast<double>(1 << level)));
+    }
+#endif
+    std::map<int, std::unique_ptr<TIGER_BSVISION::ITemplMatch>> builtEngines;
+    const int learnWorkers = buildLevelEngines(levelsToBuild, templateCounts, [&](size_t levelIndex, size_t part) {
+        const CompositeTemplMatch::AngleRange& range = angleRanges[part];
+#ifdef BSCV_BUILTIN_MATCHER
+        const PathTemplateGenerator::Edges& edges = levelEdges[levelIndex];
+        auto engine = std::make_unique<TIGER_BSVISION::ShapeMatchEngine>();
+        const bool ok = engine->createShapeModelFromEdges(edges.points, edges.angles,
+                                                          range.start, range.extent, angleStep,
+                                                          params.scale_min, params.scale_max, params.scale_step,
+                                                          params.weakThreshold, params.FeaturePointNum,
+                                                          TIGER_BSVISION::cptIgnore);
+#else
+        std::unique_ptr<TIGER_BSVISION::ITemplMatch> engine;
+        if (lazyModel) {
+            engine = std::make_unique<LazyTemplMatch>(params.lazyAngleBin, params.lazyCacheBins, params.lazyHotFirst);
+        } else {
+            engine.reset(TIGER_BSVISION::newTemplMatch());
+        }
+        const bool ok = engine && engine->create_shape_model(levelImages[levelIndex], cv::Mat(),
+                                                             range.start, range.extent, angleStep,
+                                                             params.scale_min, params.scale_max, params.scale_step,
+                                                             params.weakThreshold, params.strongThreshold,
+                                                             params.FeaturePointNum, TIGER_BSVISION::cptIgnore);
+#endif
+        return ok ? std::unique_ptr<TIGER_BSVISION::ITemplMatch>(std::move(engine)) : nullptr;
+    }, builtEngines);
+
+    if (!installEngines(builtEngines, templateSize, scanUpperLevel)) {
+        qWarning().noquote() << QStringLiteral("路径模板生成失败：路径过短或采样点不足");
+        return false;
+    }
+    m_modelHash = modelHash(m_template, pathParams);
+    m_learnMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - learnStart).count();
+    qDebug().noquote() << QStringLiteral("路径模板生成完成：%1 层 × %2 段，%3 线程，模板 %4×%5，%6 ms")
+                          .arg(levelsToBuild.size())
+                          .arg(angleRanges.size())
+                          .arg(learnWorkers)
+                          .arg(templateSize.width)
+                          .arg(templateSize.height)
+                          .arg(m_learnMs, 0, 'f', 1);
+    logMemoryReport(memoryReport());
+    return true;
+}
+
+void TemplateManager::resetModel()
+{
+    for (auto& engine : m_matchEngines) {
+        if (engine) {
+            engine->clear();
+            engine.reset();
+        }
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_enginePoolMutex);
+        m_enginePool.clear(); // 副本由旧模型复制而来，随之作废
+    }
+    m_effectiveLevels.fill(0);
+    m_engineTrainCenters.fill(cv::Point2f(0.f, 0.f));
+    m_engineGeometry.fill(EngineGeometry());
+    m_valid = false;
+}
+
+bool TemplateManager::installEngines(std::map<int, std::unique_ptr<TIGER_BSVISION::ITemplMatch>>& builtEngines,
+                                     const cv::Size& templateSize, int scanUpperLevel)
+{
     std::set<int> builtLevels;
     bool level0Captured = false;
     for (int requestLevel = 0; requestLevel <= scanUpperLevel; ++requestLevel) {
-        const int effectiveLevel = calcValidPyramidLevel(grayTemplate.size(), requestLevel);
+        const int effectiveLevel = calcValidPyramidLevel(templateSize, requestLevel);
         m_effectiveLevels[requestLevel] = effectiveLevel;
         if (builtLevels.find(effectiveLevel) != builtLevels.end()) {
             continue;
         }
 
-        std::unique_ptr<TIGER_BSVISION::ITemplMatch> engine(TIGER_BSVISION::newTemplMatch());
+        std::unique_ptr<TIGER_BSVISION::ITemplMatch> engine = std::move(builtEngines[effectiveLevel]);
         if (!engine) {
             continue;
         }
 
-        cv::Mat engineTemplate = pyramidDown(grayTemplate, effectiveLevel);
-        cv::Mat engineMask;
-        if (!templateMask.empty()) {
-            engineMask = pyramidDown(templateMask, effectiveLevel);
-            cv::threshold(engineMask, engineMask, 1, 255, cv::THRESH_BINARY);
-        }
-
-        const bool ok = engine->create_shape_model(engineTemplate,
-                                                   engineMask,
-                                                   angleStart,
-                                                   params.angleRange,
-                                                   params.angle_step / 2.0f,
-                                                   params.scale_min,
-                                                   params.scale_max,
-                                                   params.scale_step,
-                                                   params.weakThreshold,
-                                                   params.strongThreshold,
-                                                   params.FeaturePointNum,
-                                                   _type);
-        if (!ok) {
-            continue;
-        }
-
         const std::vector<cv::Point2f> engineFeaturePoints = collectFeaturePoints(engine->getTempl(0));
         cv::RotatedRect rr = cv::minAreaRect(engineFeaturePoints.empty() ? std::vector<cv::Point2f>{cv::Point2f(0.f, 0.f)} : engineFeaturePoints);
         const cv::Point2f engineCenter = rr.center;
@@ -278,170 +777,1118 @@ bool TemplateManager::learnTemplate(const cv::Mat& src, const cv::Mat& templateM
     if (level0Captured) {
         m_featurePoints = scalePointsUp(m_featurePoints, 1.0f);
     }
+    updateEngineGeometry();
 
     m_featureBounds = computeFeatureBounds(m_featurePoints);
     if (m_featureBounds.width <= 0.f || m_featureBounds.height <= 0.f) {
         m_featureBounds = cv::Rect2f(0.f, 0.f,
-                                     static_cast<float>(roiMat.cols),
-                                     static_cast<float>(roiMat.rows));
+                                     static_cast<float>(templateSize.width),
+                                     static_cast<float>(templateSize.height));
+    }
+    return true;
+}
+
+QString TemplateManager::modelHash(const cv::Mat& templateMat, const MatchParams& params)
+{
+    uint64_t hash = 1469598103934665603ull;
+    hash = fnv1a(hash, kMatchEngineTag, std::strlen(kMatchEngineTag));
+    hash = fnv1aValue(hash, kModelBundleVersion);
+    hash = fnv1aValue(hash, templateMat.rows);
+    hash = fnv1aValue(hash, templateMat.cols);
+    hash = fnv1aValue(hash, templateMat.type());
+    const size_t rowBytes = static_cast<size_t>(templateMat.cols) * templateMat.elemSize();
+    for (int r = 0; r < templateMat.rows; ++r) {
+        hash = fnv1a(hash, templateMat.ptr(r), rowBytes); // 逐行哈希，ROI 视图与连续拷贝结果一致
+    }
+    hash = fnv1aValue(hash, params.angleRange);
+    hash = fnv1aValue(hash, params.angle_step);
+    hash = fnv1aValue(hash, static_cast<uint64_t>(params.FeaturePointNum));
+    hash = fnv1aValue(hash, params.compressionLevel);
+    hash = fnv1aValue(hash, params.weakThreshold);
+    hash = fnv1aValue(hash, params.strongThreshold);
+    hash = fnv1aValue(hash, static_cast<uint8_t>(params.ignorePolarity));
+    hash = fnv1aValue(hash, params.scale_min);
+    hash = fnv1aValue(hash, params.scale_max);
+    hash = fnv1aValue(hash, params.scale_step);
+    hash = fnv1aValue(hash, params.borderPadding);
+    hash = fnv1aValue(hash, params.learnAngleSplits); // 分段数改变模型文件结构
+    return QStringLiteral("%1").arg(static_cast<qulonglong>(hash), 16, 16, QLatin1Char('0'));
+}
+
+bool TemplateManager::saveModel(const QString& directory) const
+{
+    if (!m_valid || m_template.empty()) {
+        return false;
+    }
+    if (m_learnParams.lazyModel) {
+        qWarning().noquote() << QStringLiteral("按需生成的模型不保存模型包：%1").arg(directory);
+        return false;
+    }
+    const QDir dir(directory);
+    if (!QDir().mkpath(directory)) {
+        qWarning().noquote() << QStringLiteral("无法创建模型目录：%1").arg(directory);
+        return false;
+    }
+    if (!writeImageFile(dir.filePath(QString::fromLatin1(kTemplateImageFile)), m_template)) {
+        return false;
+    }
+    const QString maskPath = dir.filePath(QString::fromLatin1(kTemplateMaskFile));
+    if (!m_templateMask.empty()) {
+        if (!writeImageFile(maskPath, m_templateMask)) {
+            return false;
+        }
+    } else {
+        QFile::remove(maskPath); // 同目录下旧模型残留的掩膜不能被误读
+    }
+
+    std::vector<int> engineSlots(m_matchEngines.size(), 0);
+    for (size_t slot = 0; slot < m_matchEngines.size(); ++slot) {
+        if (!m_matchEngines[slot]) {
+            continue;
+        }
+        const std::string path = QFile::encodeName(dir.filePath(engineModelFile(slot))).toStdString();
+        if (!m_matchEngines[slot]->write_shape_model(path)) {
+            qWarning().noquote() << QStringLiteral("槽位 %1 的引擎模型保存失败").arg(slot);
+            return false;
+        }
+        engineSlots[slot] = 1;
+    }
+
+    // 清单最后写入：清单存在即表示模型包完整
+    cv::FileStorage fs(".yml", cv::FileStorage::WRITE | cv::FileStorage::MEMORY);
+    fs << "format" << kModelBundleFormat;
+    fs << "version" << kModelBundleVersion;
+    fs << "engine" << kMatchEngineTag;
+    fs << "hash" << m_modelHash.toStdString();
+    fs << "learn_ms" << m_learnMs;
+    writeMatchParams(fs, m_learnParams);
+    fs << "pyramid_level" << m_pyramidLevel;
+    fs << "effective_levels" << std::vector<int>(m_effectiveLevels.begin(), m_effectiveLevels.end());
+    fs << "engine_slots" << engineSlots;
+    fs << "engine_train_centers" << std::vector<cv::Point2f>(m_engineTrainCenters.begin(), m_engineTrainCenters.end());
+    fs << "train_center" << m_trainCenter;
+    fs << "engine_train_center" << m_engineTrainCenter;
+    fs << "feature_bounds" << m_featureBounds;
+    fs << "feature_points" << m_featurePoints;
+    const std::string manifest = fs.releaseAndGetString();
+
+    QSaveFile file(dir.filePath(QString::fromLatin1(kManifestFile)));
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+    file.write(manifest.data(), static_cast<qint64>(manifest.size()));
+    return file.commit();
+}
+
+bool TemplateManager::loadModel(const QString& directory)
+{
+    const auto loadStart = std::chrono::steady_clock::now();
+    const QDir dir(directory);
+    QFile manifestFile(dir.filePath(QString::fromLatin1(kManifestFile)));
+    if (!manifestFile.open(QIODevice::ReadOnly)) {
+        return false;
+    }
+    const QByteArray manifest = manifestFile.readAll();
+
+    // 先全部读入临时变量，任何一步失败都不影响当前已加载的模型
+    MatchParams params;
+    int pyramidLevel = 0;
+    std::vector<int> effectiveLevels;
+    std::vector<int> engineSlots;
+    std::vector<cv::Point2f> engineTrainCenters;
+    cv::Point2f trainCenter;
+    cv::Point2f engineTrainCenter;
+    cv::Rect2f featureBounds;
+    std::vector<cv::Point2f> featurePoints;
+    std::string hash;
+    double learnMs = 0.0;
+    try {
+        cv::FileStorage fs(manifest.toStdString(), cv::FileStorage::READ | cv::FileStorage::MEMORY);
+        if (!fs.isOpened()
+            || static_cast<std::string>(fs["format"]) != kModelBundleFormat
+            || static_cast<int>(fs["version"]) != kModelBundleVersion) {
+            qWarning().noquote() << QStringLiteral("模型包格式不兼容：%1").arg(directory);
+            return false;
+        }
+        if (static_cast<std::string>(fs["engine"]) != kMatchEngineTag) {
+            qWarning().noquote() << QStringLiteral("模型包由其它匹配引擎生成（%1），无法加载")
+                                    .arg(QString::fromStdString(static_cast<std::string>(fs["engine"])));
+            return false;
+        }
+        fs["hash"] >> hash;
+        fs["learn_ms"] >> learnMs;
+        params = readMatchParams(fs["params"]);
+        fs["pyramid_level"] >> pyramidLevel;
+        fs["effective_levels"] >> effectiveLevels;
+        fs["engine_slots"] >> engineSlots;
+        fs["engine_train_centers"] >> engineTrainCenters;
+        fs["train_center"] >> trainCenter;
+        fs["engine_train_center"] >> engineTrainCenter;
+        fs["feature_bounds"] >> featureBounds;
+        fs["feature_points"] >> featurePoints;
+    } catch (const cv::Exception& e) {
+        qWarning().noquote() << QStringLiteral("模型清单解析失败：%1").arg(QString::fromLocal8Bit(e.what()));
+        return false;
+    }
+    if (effectiveLevels.size() != m_effectiveLevels.size() || engineSlots.size() != m_matchEngines.size()
+        || engineTrainCenters.size() != m_engineTrainCenters.size()) {
+        return false;
+    }
+
+    const cv::Mat templateImage = readImageFile(dir.filePath(QString::fromLatin1(kTemplateImageFile)));
+    if (templateImage.empty()) {
+        return false;
+    }
+    const cv::Mat templateMask = readImageFile(dir.filePath(QString::fromLatin1(kTemplateMaskFile)));
+
+    EngineSet engines;
+    bool anyEngine = false;
+    for (size_t slot = 0; slot < engines.size(); ++slot) {
+        if (!engineSlots[slot]) {
+            continue;
+        }
+        const std::string path = QFile::encodeName(dir.filePath(engineModelFile(slot))).toStdString();
+        std::unique_ptr<TIGER_BSVISION::ITemplMatch> engine = readEngineFile(path);
+        if (!engine) {
+            qWarning().noquote() << QStringLiteral("槽位 %1 的引擎模型读取失败").arg(slot);
+            return false;
+        }
+        engines[slot] = std::move(engine);
+        anyEngine = true;
     }
+    if (!anyEngine) {
+        return false;
+    }
+
+    for (auto& engine : m_matchEngines) {
+        if (engine) {
+            engine->clear();
+        }
+    }
+    m_matchEngines = std::move(engines);
+    {
+        std::lock_guard<std::mutex> lock(m_enginePoolMutex);
+        m_enginePool.clear();
+    }
+    m_template = templateImage;
+    m_templateMask = templateMask;
+    m_learnParams = params;
+    m_pyramidLevel = pyramidLevel;
+    m_pyramidScale = static_cast<float>(1 << pyramidLevel);
+    std::copy(effectiveLevels.begin(), effectiveLevels.end(), m_effectiveLevels.begin());
+    std::copy(engineTrainCenters.begin(), engineTrainCenters.end(), m_engineTrainCenters.begin());
+    m_trainCenter = trainCenter;
+    m_engineTrainCenter = engineTrainCenter;
+    m_featureBounds = featureBounds;
+    m_featurePoints = std::move(featurePoints);
+    m_modelHash = QString::fromStdString(hash);
+    m_learnMs = learnMs;
+    updateEngineGeometry();
+    m_valid = true;
+
+    const double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - loadStart).count();
+    qDebug().noquote() << QStringLiteral("模型包加载完成：%1 ms（原学习耗时 %2 ms）")
+                          .arg(loadMs, 0, 'f', 1)
+                          .arg(learnMs, 0, 'f', 1);
     return true;
 }
 
-std::vector<MatchResult> TemplateManager::matchTemplate(const cv::Mat& src, const FindMatchParams& params) const 
+bool TemplateManager::learnTemplateCached(const cv::Mat& src, const cv::Mat& templateMat, const MatchParams& params,
+                                          const QString& cacheRoot)
+{
+    if (templateMat.empty()) {
+        return false;
+    }
+    if (params.lazyModel) {
+        return learnTemplate(src, templateMat, params); // 按需模型学习本身几乎不耗时，不走缓存
+    }
+    const QString hash = modelHash(templateMat, params);
+    const QString bundleDir = QDir(cacheRoot).filePath(hash);
+    if (QFileInfo::exists(QDir(bundleDir).filePath(QString::fromLatin1(kManifestFile)))) {
+        if (loadModel(bundleDir) && m_modelHash == hash) {
+            return true;
+        }
+        qWarning().noquote() << QStringLiteral("缓存模型包不可用，重新学习：%1").arg(bundleDir);
+    }
+    if (!learnTemplate(src, templateMat, params)) {
+        return false;
+    }
+    if (!saveModel(bundleDir)) {
+        qWarning().noquote() << QStringLiteral("模型包保存失败：%1").arg(bundleDir);
+    }
+    return true;
+}
+
+struct TemplateManager::MatchControl {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    const CancelToken* cancelToken = nullptr;
+    uint64_t frameSequence = 0;
+    const std::atomic<uint64_t>* latestFrameSequence = nullptr;
+    MatchTiming* timing = nullptr; // 非空时记录各阶段耗时
+    const EngineSet* engines = nullptr; // 调用线程独占的引擎副本，为空时使用主引擎
+    mutable std::atomic<int> status{static_cast<int>(MatchStatus::Completed)};
+
+    // 各检查点调用；一旦返回 true 之后始终返回 true
+    bool shouldStop() const
+    {
+        if (status.load(std::memory_order_relaxed) != static_cast<int>(MatchStatus::Completed)) {
+            return true;
+        }
+        MatchStatus reason = MatchStatus::Completed;
+        if (cancelToken && cancelToken->isCancelled()) {
+            reason = MatchStatus::Cancelled;
+        } else if (frameSequence > 0 && latestFrameSequence && latestFrameSequence->load() > frameSequence) {
+            reason = MatchStatus::Stale;
+        } else if (std::chrono::steady_clock::now() >= deadline) {
+            reason = MatchStatus::TimedOut;
+        }
+        if (reason == MatchStatus::Completed) {
+            return false;
+        }
+        int expected = static_cast<int>(MatchStatus::Completed);
+        status.compare_exchange_strong(expected, static_cast<int>(reason));
+        return true;
+    }
+    MatchStatus result() const { return static_cast<MatchStatus>(status.load()); }
+};
+
+namespace {
+std::chrono::steady_clock::time_point deadlineFor(const FindMatchParams& params)
+{
+    return params.timeoutMs > 0 ? std::chrono::steady_clock::now() + std::chrono::milliseconds(params.timeoutMs)
+                                : std::chrono::steady_clock::time_point::max();
+}
+
+double millisecondsSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+QString matchStatusText(TemplateManager::MatchStatus status)
+{
+    switch (status) {
+    case TemplateManager::MatchStatus::TimedOut:
+        return QStringLiteral("超时");
+    case TemplateManager::MatchStatus::Cancelled:
+        return QStringLiteral("已取消");
+    case TemplateManager::MatchStatus::Stale:
+        return QStringLiteral("已过期");
+    default:
+        return QStringLiteral("完成");
+    }
+}
+} // namespace
+
+TemplateManager::MatchJob TemplateManager::makeMatchJob(const cv::Mat& frame, const FindMatchParams& params, uint64_t frameSequence)
+{
+    MatchJob job;
+    job.frame = frame;
+    job.params = params;
+    job.frameSequence = frameSequence;
+    job.cancelToken = std::make_shared<CancelToken>();
+    job.deadline = deadlineFor(params);
+    return job;
+}
+
+void TemplateManager::publishFrameSequence(uint64_t frameSequence) const
+{
+    uint64_t current = m_latestFrameSequence.load();
+    while (current < frameSequence && !m_latestFrameSequence.compare_exchange_weak(current, frameSequence)) {
+    }
+}
+
+TemplateManager::MatchJobResult TemplateManager::runMatchJob(const MatchJob& job) const
+{
+    const auto start = std::chrono::steady_clock::now();
+    MatchControl control;
+    control.deadline = job.deadline;
+    control.cancelToken = job.cancelToken.get();
+    control.frameSequence = job.frameSequence;
+    control.latestFrameSequence = &m_latestFrameSequence;
+    control.engines = job.engines;
+
+    MatchJobResult out;
+    out.frameSequence = job.frameSequence;
+    control.timing = &out.timing;
+    if (!control.shouldStop()) { // 排队期间可能已被取消或过期
+        out.results = matchWithControl(job.frame, job.params, control);
+    }
+    out.status = control.result();
+    if (out.status == MatchStatus::Cancelled || out.status == MatchStatus::Stale) {
+        out.results.clear();
+    }
+    out.elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    if (out.status != MatchStatus::Completed) {
+        qInfo().noquote() << QStringLiteral("匹配任务%1：帧 %2，耗时 %3 ms，输出 %4 个结果")
+                              .arg(matchStatusText(out.status))
+                              .arg(static_cast<qulonglong>(job.frameSequence))
+                              .arg(out.elapsedMs, 0, 'f', 1)
+                              .arg(static_cast<int>(out.results.size()));
+    }
+    return out;
+}
+
+std::vector<MatchResult> TemplateManager::matchTemplate(const cv::Mat& src, const FindMatchParams& params) const
+{
+    MatchControl control;
+    control.deadline = deadlineFor(params);
+    return matchWithControl(src, params, control);
+}
+
+std::vector<MatchResult> TemplateManager::matchWithControl(const cv::Mat& src, const FindMatchParams& params,
+                                                           const MatchControl& control) const
 {
     std::vector<MatchResult> results; // 结果集合
     if (!m_valid || src.empty()) 
     {
         return results;
     }
-    cv::Size imageSize(src.cols, src.rows); // 记录整图尺寸以便裁剪
-    cv::Rect region(0, 0, imageSize.width, imageSize.height);
-    if (region.width <= 0 || region.height <= 0) 
-    {
+    const auto startTime = std::chrono::steady_clock::now();
+    const int scanUpperLevel = scanUpperLevelLimit();
+    cv::Mat searchSrc;
+    cv::Mat searchMask;
+    cv::Rect region;
+    const bool prepared = prepareSearchInput(src, params.Mask, searchMargin(), 1 << scanUpperLevel, searchSrc, searchMask, region);
+    if (control.timing) {
+        control.timing->prepareMs = millisecondsSince(startTime);
+    }
+    if (!prepared) {
         return results;
     }
 
-    cv::Mat graySearch = toGrayMat(src); // 将源图像转为灰度图用于匹配
-    if (graySearch.empty()) 
-    {
-        return results;
+    // 灰度转换、掩膜规整与各层降采样都在金字塔内只做一次，后续层由上一层增量生成
+    std::unique_ptr<ImagePyramid> pyramid = acquirePyramid();
+    const auto pyramidStart = std::chrono::steady_clock::now();
+    pyramid->reset(searchSrc, searchMask);
+    if (control.timing) {
+        control.timing->pyramidMs += millisecondsSince(pyramidStart); // 各层降采样在 matchPyramid 内累加
+    }
+    if (!pyramid->empty()) {
+        results = matchPyramid(*pyramid, params, control);
+    }
+    releasePyramid(std::move(pyramid));
+    const auto finalizeStart = std::chrono::steady_clock::now();
+    finalizeResults(results, params, region.tl());
+    if (control.timing) {
+        control.timing->finalizeMs = millisecondsSince(finalizeStart);
     }
 
-    cv::Mat maskParam = params.Mask; // 从参数中获取掩膜
-    // 修改：如果掩膜非空，确保其为单通道格式
-    if (!maskParam.empty() && maskParam.type() != CV_8UC1) {
-        if (maskParam.channels() > 1) {
-            cv::cvtColor(maskParam, maskParam, cv::COLOR_BGR2GRAY); // 多通道掩膜转为灰度
-        } else {
-            maskParam.convertTo(maskParam, CV_8U); // 确保数据类型为 8 位无符号整型
+    if (!results.empty()) {
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        qInfo().noquote() << QStringLiteral("0~%1 金字塔轮询后输出结果数: %2，耗时 %3 ms（%4 线程）")
+                              .arg(scanUpperLevel)
+                              .arg(static_cast<int>(results.size()))
+                              .arg(elapsedMs, 0, 'f', 2)
+                              .arg(resolveMatchThreads());
+        qDebug().noquote() << QStringLiteral("结果特征点占用 %1 字节（%2）")
+                              .arg(static_cast<qulonglong>(featurePointBytes(results)))
+                              .arg(params.compactResults ? QStringLiteral("紧凑结果，按需计算") : QStringLiteral("完整结果"));
+    }
+    if (m_learnParams.lazyModel) {
+        const LazyTemplMatch::Stats stats = lazyModelStats();
+        qDebug().noquote() << QStringLiteral("按需模型缓存：命中 %1，生成 %2（累计 %3 ms），淘汰 %4，常驻 %5/%6 区间")
+                              .arg(static_cast<qulonglong>(stats.hits))
+                              .arg(static_cast<qulonglong>(stats.misses))
+                              .arg(stats.buildMs, 0, 'f', 1)
+                              .arg(static_cast<qulonglong>(stats.evictions))
+                              .arg(static_cast<qulonglong>(stats.residentBins))
+                              .arg(static_cast<qulonglong>(stats.totalBins));
+    }
+    return results;
+}
+
+std::vector<MatchResult> TemplateManager::matchPyramid(ImagePyramid& pyramid, const FindMatchParams& params) const
+{
+    const MatchControl control;
+    return matchPyramid(pyramid, params, control);
+}
+
+int TemplateManager::scanUpperLevelLimit() const
+{
+    return std::min(m_pyramidLevel, kMaxPyramidScanLevel);
+}
+
+int TemplateManager::searchMargin() const
+{
+    return static_cast<int>(std::ceil(0.5f * std::max(1.f, m_learnParams.scale_max)
+                                      * std::hypot(m_featureBounds.width, m_featureBounds.height)));
+}
+
+bool TemplateManager::prepareSearchInput(const cv::Mat& src, const cv::Mat& mask, int margin, int align,
+                                         cv::Mat& searchSrc, cv::Mat& searchMask, cv::Rect& region)
+{
+    searchSrc = src;
+    searchMask = mask;
+    region = cv::Rect(0, 0, src.cols, src.rows);
+    if (src.empty()) {
+        return false;
+    }
+    if (!searchMask.empty() && searchMask.size() != src.size()) {
+        qWarning().noquote() << QStringLiteral("匹配掩膜尺寸与输入图像不一致，已忽略掩膜：mask=%1x%2 image=%3x%4")
+                                .arg(searchMask.cols)
+                                .arg(searchMask.rows)
+                                .arg(src.cols)
+                                .arg(src.rows);
+        searchMask.release(); // 丢弃失配的掩膜，避免后续 Mat ROI 断言（中文提示）
+    }
+    if (searchMask.empty()) {
+        return true;
+    }
+
+    // 有掩膜时只在掩膜有效区域外扩一个模板外接圆半径的范围内搜索：金字塔、各层引擎与去重都在裁剪后的图像上进行，
+    // 结果再平移回整图坐标。裁剪原点按最粗扫描层对齐，各层降采样网格与整图一致
+    const cv::Rect maskRegion = maskBoundingRect(searchMask);
+    if (maskRegion.empty()) {
+        return false; // 掩膜内没有有效像素，整图搜索同样不会有结果
+    }
+    align = std::max(1, align);
+    const int x0 = std::max(0, (maskRegion.x - margin) / align * align);
+    const int y0 = std::max(0, (maskRegion.y - margin) / align * align);
+    const int x1 = std::min(src.cols, maskRegion.x + maskRegion.width + margin);
+    const int y1 = std::min(src.rows, maskRegion.y + maskRegion.height + margin);
+    region = cv::Rect(x0, y0, x1 - x0, y1 - y0);
+    if (region.size() != src.size()) {
+        // 匹配库按连续内存读取整幅输入，裁剪视图拷贝出来（只拷贝搜索区域）
+        searchSrc = src(region).clone();
+        searchMask = searchMask(region).clone();
+        qDebug().noquote() << QStringLiteral("按掩膜裁剪搜索区域：(%1, %2) %3x%4，占整图 %5%")
+                              .arg(region.x)
+                              .arg(region.y)
+                              .arg(region.width)
+                              .arg(region.height)
+                              .arg(100.0 * region.area() / (static_cast<double>(src.cols) * src.rows), 0, 'f', 1);
+    }
+    return true;
+}
+
+void TemplateManager::finalizeResults(std::vector<MatchResult>& results, const FindMatchParams& params, const cv::Point& offset)
+{
+    if (offset != cv::Point()) {
+        for (MatchResult& item : results) {
+            offsetResult(item, offset);
         }
     }
-    if (!maskParam.empty()) {
-        const bool sizeMismatch = maskParam.cols != graySearch.cols || maskParam.rows != graySearch.rows;
-        if (sizeMismatch) {
-            qWarning().noquote() << QStringLiteral("匹配掩膜尺寸与输入图像不一致，已忽略掩膜：mask=%1x%2 image=%3x%4")
-                                    .arg(maskParam.cols)
-                                    .arg(maskParam.rows)
-                                    .arg(graySearch.cols)
-                                    .arg(graySearch.rows);
-            maskParam.release(); // 丢弃失配的掩膜，避免后续 Mat ROI 断言（中文提示）
+    if (!params.compactResults) {
+        for (MatchResult& item : results) {
+            materializeFeaturePoints(item);
         }
     }
+}
 
-    std::set<int> executedLevels;
+std::vector<MatchResult> TemplateManager::matchPyramid(ImagePyramid& pyramid, const FindMatchParams& params,
+                                                       const MatchControl& control) const
+{
+    std::vector<MatchResult> results;
+    if (!m_valid || pyramid.empty()) {
+        return results;
+    }
     int maxCount = std::max(1, params.maxCount); //至少返回一个结果
-    const int scanUpperLevel = std::min(m_pyramidLevel, kMaxPyramidScanLevel);
+    const auto levelsStart = std::chrono::steady_clock::now();
+    std::vector<LevelSearch> levels = collectLevels(pyramid, params.useRoi);
+    const auto searchStart = std::chrono::steady_clock::now();
+    if (control.timing) {
+        control.timing->pyramidMs += millisecondsSince(levelsStart);
+    }
+
+    if (params.coarseToFine && levels.size() > 1) {
+        results = matchCoarseToFine(levels, params, control);
+    } else {
+        // 各层独立全图搜索：各层引擎互不相关，分给匹配线程池并行执行；
+        // 合并仍按槽位顺序（细层优先）去重，输出与串行一致
+        std::vector<std::vector<MatchResult>> perLevel(levels.size());
+        const int workers = std::min(resolveMatchThreads(), static_cast<int>(levels.size()));
+        runParallel(workers, [&](int worker, const EngineSet* engines) {
+            for (size_t i = static_cast<size_t>(worker); i < levels.size(); i += static_cast<size_t>(workers)) {
+                if (control.shouldStop()) {
+                    break; // 已完成的层照常合并，作为部分结果
+                }
+                const LevelSearch& search = levels[i];
+                perLevel[i] = searchLevel(search, cv::Rect(0, 0, search.image.cols, search.image.rows),
+                                          engineThreshold(params), engines);
+            }
+        }, control.engines, false);
+        MatchSuppressor suppressor(duplicateDistance(m_featureBounds.size()), params.nmsIouThreshold);
+        for (size_t i = 0; i < levels.size(); ++i) {
+            for (const MatchResult& item : perLevel[i]) {
+                if (suppressor.tryAccept(item, duplicateDistance(item.featureSize))) {
+                    results.push_back(item);
+                }
+            }
+            qInfo().noquote() << QStringLiteral("金字塔层 %1 匹配候选数: %2").arg(levels[i].level).arg(static_cast<int>(perLevel[i].size()));
+        }
+    }
+
+    levels.clear(); // 归还前释放对金字塔各层缓冲的引用
+
+    std::sort(results.begin(), results.end(), [](const MatchResult& lhs, const MatchResult& rhs) {
+        return lhs.score > rhs.score;
+    });
+    if (static_cast<int>(results.size()) > maxCount) {
+        results.resize(maxCount);
+    }
+    if (control.timing) {
+        control.timing->searchMs = millisecondsSince(searchStart);
+    }
+    if (params.refinePose && !control.shouldStop()) {
+        const auto refineStart = std::chrono::steady_clock::now();
+        refinePoses(pyramid.image(0), results);
+        if (control.timing) {
+            control.timing->refineMs = millisecondsSince(refineStart);
+        }
+    }
+    return results;
+}
+
+PoseRefiner::Params TemplateManager::poseRefineParams() const
+{
+    constexpr double kDegToRad = 3.14159265358979323846 / 180.0;
+    const float templateRadius = 0.5f * std::max(1.f, m_learnParams.scale_max)
+                                 * std::hypot(m_featureBounds.width, m_featureBounds.height);
+    // 引擎按 angle_step / 2 离散角度（见 learnTemplate），最大角度误差为其一半
+    const double angleError = 0.25 * m_learnParams.angle_step * kDegToRad;
+    const double scaleError = m_learnParams.scale_max > m_learnParams.scale_min ? 0.5 * m_learnParams.scale_step : 0.0;
+    PoseRefiner::Params refine;
+    refine.searchRadius = static_cast<float>(1.5 + templateRadius * (std::sin(angleError) + scaleError));
+    refine.refineScale = scaleError > 0.0;
+    return refine;
+}
 
-    cv::Point offset(0, 0); // 坐标偏移量为零,直接在全图上匹配
+void TemplateManager::refinePoses(const cv::Mat& gray, std::vector<MatchResult>& results, const std::vector<char>* found) const
+{
+    const auto startTime = std::chrono::steady_clock::now();
+    const PoseRefiner refiner(poseRefineParams());
+    int refined = 0;
+    int attempted = 0;
+    double rmsSum = 0.0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (found && !(*found)[i]) {
+            continue;
+        }
+        ++attempted;
+        PoseRefiner::Stats stats;
+        if (refiner.refine(gray, results[i], &stats)) {
+            ++refined;
+            rmsSum += stats.rmsError;
+        }
+    }
+    if (attempted > 0) {
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        qDebug().noquote() << QStringLiteral("位姿精修 %1/%2 个结果，平均边缘残差 %3 px，耗时 %4 ms")
+                              .arg(refined)
+                              .arg(attempted)
+                              .arg(refined > 0 ? rmsSum / refined : 0.0, 0, 'f', 3)
+                              .arg(elapsedMs, 0, 'f', 2);
+    }
+}
+
+LazyTemplMatch::Stats TemplateManager::lazyModelStats() const
+{
+    LazyTemplMatch::Stats total;
+    for (const auto& engine : m_matchEngines) {
+        const auto* lazy = dynamic_cast<const LazyTemplMatch*>(engine.get());
+        if (!lazy) {
+            continue;
+        }
+        const LazyTemplMatch::Stats stats = lazy->stats(); // 引擎副本共享同一缓存，已包含并行搜索的统计
+        total.hits += stats.hits;
+        total.misses += stats.misses;
+        total.evictions += stats.evictions;
+        total.searches += stats.searches;
+        total.residentBins += stats.residentBins;
+        total.totalBins += stats.totalBins;
+        total.buildMs += stats.buildMs;
+    }
+    return total;
+} 
+
+TemplateManager::MemoryReport TemplateManager::memoryReport(bool perVariant) const
+{
+    MemoryReport report;
+    // 不分段时单个引擎的模板数（分段/按需模型自带各段模板数），与 learnTemplate 的离散方式一致
+    const std::vector<CompositeTemplMatch::AngleRange> angles =
+        CompositeTemplMatch::splitAngleRange(0.f, static_cast<float>(m_learnParams.angleRange), m_learnParams.angle_step / 2.0f, 1);
+    const int expectedVariants = (angles.empty() ? 0 : angles.front().angleCount)
+                                 * CompositeTemplMatch::scaleCount(m_learnParams.scale_min, m_learnParams.scale_max,
+                                                                   m_learnParams.scale_step);
     for (size_t slot = 0; slot < m_matchEngines.size(); ++slot) {
         if (!m_matchEngines[slot]) {
             continue;
         }
-        if (m_effectiveLevels[slot] > scanUpperLevel) {
-            continue;
+        MemoryReport::Slot item;
+        item.slot = static_cast<int>(slot);
+        item.level = m_effectiveLevels[slot];
+        measureEngine(*m_matchEngines[slot], expectedVariants, perVariant, item);
+        report.totalBytes += item.bytes;
+        report.engineSlots.push_back(std::move(item));
+
+        const EngineGeometry& geometry = m_engineGeometry[slot];
+        if (geometry.points) {
+            report.geometryBytes += geometry.points->capacity() * sizeof(cv::Point2f);
+        }
+    }
+    report.geometryBytes += m_featurePoints.capacity() * sizeof(cv::Point2f);
+    {
+        std::lock_guard<std::mutex> lock(m_pyramidMutex);
+        for (const auto& pyramid : m_pyramidPool) {
+            report.pyramidPoolBytes += pyramid->bufferBytes();
         }
+    }
+    report.totalBytes += report.geometryBytes + report.pyramidPoolBytes;
+    return report;
+}
 
-        const int level = calcValidPyramidLevel(graySearch.size(), m_effectiveLevels[slot]);
-        if (!executedLevels.insert(level).second) {
-            continue; // 有效层级重复时只跑一次
+void TemplateManager::setMaxMatchThreads(int threads)
+{
+    g_maxMatchThreads.store(threads);
+}
+
+int TemplateManager::maxMatchThreads()
+{
+    return resolveMatchThreads();
+}
+
+std::unique_ptr<TemplateManager::EngineSet> TemplateManager::acquireEngineSet() const
+{
+    {
+        std::lock_guard<std::mutex> lock(m_enginePoolMutex);
+        if (!m_enginePool.empty()) {
+            std::unique_ptr<EngineSet> engines = std::move(m_enginePool.back());
+            m_enginePool.pop_back();
+            return engines;
         }
+    }
+    auto engines = std::make_unique<EngineSet>();
+    for (size_t slot = 0; slot < m_matchEngines.size(); ++slot) {
+        if (m_matchEngines[slot]) {
+            (*engines)[slot].reset(cloneEngine(m_matchEngines[slot].get()));
+        }
+    }
+    return engines;
+}
 
-        const float scaleToOriginal = static_cast<float>(1 << level);
-        cv::Mat searchForEngine = pyramidDown(graySearch, level);
-        cv::Mat levelMask = maskParam;
-        if (!levelMask.empty()) {
-            levelMask = pyramidDown(levelMask, level);
-            cv::threshold(levelMask, levelMask, 1, 255, cv::THRESH_BINARY);
+void TemplateManager::releaseEngineSet(std::unique_ptr<EngineSet> engines) const
+{
+    std::lock_guard<std::mutex> lock(m_enginePoolMutex);
+    if (m_enginePool.size() < kMaxPooledEngineSets) {
+        m_enginePool.push_back(std::move(engines));
+    }
+}
+
+void TemplateManager::runParallel(int workers, const std::function<void(int, const EngineSet*)>& task,
+                                  const EngineSet* callerEngines, bool needReplicas) const
+{
+    workers = std::max(1, workers);
+    if (workers == 1) {
+        task(0, callerEngines);
+        return;
+    }
+    QThreadPool& pool = matchThreadPool();
+    if (pool.maxThreadCount() < workers - 1) {
+        pool.setMaxThreadCount(workers - 1);
+    }
+    std::vector<std::unique_ptr<EngineSet>> replicas(static_cast<size_t>(workers));
+    if (needReplicas) {
+        for (int worker = 1; worker < workers; ++worker) {
+            replicas[static_cast<size_t>(worker)] = acquireEngineSet();
+        }
+    }
+    QVector<QFuture<void>> futures;
+    futures.reserve(workers - 1);
+    for (int worker = 1; worker < workers; ++worker) {
+        const EngineSet* engines = needReplicas ? replicas[static_cast<size_t>(worker)].get() : callerEngines;
+        futures.append(QtConcurrent::run(&pool, [&task, worker, engines]() { task(worker, engines); }));
+    }
+    task(0, callerEngines); // 调用线程也参与计算，使用调用方的引擎
+    for (QFuture<void>& future : futures) {
+        future.waitForFinished();
+    }
+    for (auto& engines : replicas) {
+        if (engines) {
+            releaseEngineSet(std::move(engines));
         }
+    }
+}
+
+std::unique_ptr<ImagePyramid> TemplateManager::acquirePyramid() const
+{
+    std::lock_guard<std::mutex> lock(m_pyramidMutex);
+    if (m_pyramidPool.empty()) {
+        return std::make_unique<ImagePyramid>();
+    }
+    std::unique_ptr<ImagePyramid> pyramid = std::move(m_pyramidPool.back());
+    m_pyramidPool.pop_back();
+    return pyramid;
+}
+
+void TemplateManager::releasePyramid(std::unique_ptr<ImagePyramid> pyramid) const
+{
+    pyramid->release();
+    std::lock_guard<std::mutex> lock(m_pyramidMutex);
+    if (m_pyramidPool.size() < kMaxPooledPyramids) { // 池大小有上限，并发峰值过后多余的直接释放
+        m_pyramidPool.push_back(std::move(pyramid));
+    }
+}
+
+std::vector<MatchResult> TemplateManager::searchLevel(const LevelSearch& search, const cv::Rect& window, float threshold,
+                                                      const EngineSet* engines) const
+{
+    std::vector<MatchResult> results;
+    const cv::Rect bounded = window & cv::Rect(0, 0, search.image.cols, search.image.rows);
+    if (bounded.width <= 0 || bounded.height <= 0) {
+        return results;
+    }
+    const bool fullImage = bounded.size() == search.image.size();
+    // 整幅搜索直接使用金字塔缓冲（匹配库只读输入）；窗口搜索拷贝出连续内存交给匹配库
+    cv::Mat MatchImg = fullImage ? search.image : search.image(bounded).clone();
+    cv::Mat levelMask;
+    if (!search.mask.empty()) {
+        levelMask = fullImage ? search.mask : search.mask(bounded).clone();
+    }
+
+    std::vector<TIGER_BSVISION::Match> matches;
+    try {
+        TIGER_BSVISION::ITemplMatch* engine = engines ? (*engines)[search.slot].get() : m_matchEngines[search.slot].get();
+        matches = engine->find_shape_model(MatchImg, levelMask, threshold);
+    } catch (const cv::Exception& e) {
+        qWarning().noquote() << QStringLiteral("find_shape_model 在金字塔层 %1 抛出 OpenCV 异常：%2")
+                                .arg(search.level)
+                                .arg(QString::fromUtf8(e.what()));
+        return results;
+    } catch (const std::exception& e) {
+        qWarning().noquote() << QStringLiteral("find_shape_model 在金字塔层 %1 抛出异常：%2")
+                                .arg(search.level)
+                                .arg(QString::fromUtf8(e.what()));
+        return results;
+    } catch (...) {
+        qWarning().noquote() << QStringLiteral("find_shape_model 在金字塔层 %1 出现未知异常").arg(search.level);
+        return results;
+    }
+
+    std::sort(matches.begin(), matches.end(), [](const TIGER_BSVISION::Match& lhs,
+              const TIGER_BSVISION::Match& rhs) { return lhs.similarity > rhs.similarity; });
 
-        cv::Mat MatchImg;
-        if (params.useRoi && !levelMask.empty()) {
-            cv::bitwise_and(searchForEngine, searchForEngine, MatchImg, levelMask); // 使用掩码提取目标区域
-            levelMask.release(); // 第三方匹配库在启用掩膜时会做额外 ROI 处理，这里直接清空掩膜避免越界
+    const float scaleToOriginal = static_cast<float>(1 << search.level);
+    const cv::Size& imageSize = search.originalSize;
+    const cv::Point offset = bounded.tl();
+    const cv::Point2f matchCenter = m_engineTrainCenters[search.slot];
+    const EngineGeometry& geometry = m_engineGeometry[search.slot];
+    const bool hasGeometry = geometry.points && !geometry.points->empty();
+    cv::Point2f trainCorners[4];
+    geometry.bounds.points(trainCorners);
+    results.reserve(matches.size());
+    for (const auto& match : matches) {
+        cv::Rect rect = buildResultRect(match, offset, search.image.size());
+        rect = scaleRectUp(rect, scaleToOriginal, imageSize);
+        if (rect.width <= 0 || rect.height <= 0) {
+            continue;
+        }
+
+        // 不拷贝 match.pts：记录训练坐标 → 原图坐标的仿射变换，特征点由共享的训练特征点按需计算
+        MatchResult item;
+        item.score = normalizeScore(match.similarity);
+        item.angle = match.angle;
+        item.scale = match.scale;
+        item.templateId = match.template_id;
+        const cv::Point2f origin = match.transPt(cv::Point2f(0.f, 0.f));
+        const cv::Point2f axisX = match.transPt(cv::Point2f(1.f, 0.f)) - origin;
+        const cv::Point2f axisY = match.transPt(cv::Point2f(0.f, 1.f)) - origin;
+        item.featureTransform = cv::Matx23f(axisX.x * scaleToOriginal, axisY.x * scaleToOriginal, (origin.x + offset.x) * scaleToOriginal,
+                                            axisX.y * scaleToOriginal, axisY.y * scaleToOriginal, (origin.y + offset.y) * scaleToOriginal);
+        item.featureModel = geometry.points;
+
+        item.center = match.transPt(matchCenter);
+        item.center.x = (item.center.x + offset.x) * scaleToOriginal;
+        item.center.y = (item.center.y + offset.y) * scaleToOriginal;
+
+        if (hasGeometry) {
+            // 相似变换保持最小外接矩形：只变换训练特征外接框的 4 个角点
+            std::vector<cv::Point2f> corners(4);
+            for (int i = 0; i < 4; ++i) {
+                const cv::Vec3f p(trainCorners[i].x, trainCorners[i].y, 1.f);
+                const cv::Vec2f q = item.featureTransform * p;
+                corners[static_cast<size_t>(i)] = cv::Point2f(q[0], q[1]);
+            }
+            item.rotatedRect = cv::minAreaRect(corners);
+            item.featureSize = item.rotatedRect.size;
+            item.Roiarea = cv::boundingRect(corners);
         } else {
-            MatchImg = searchForEngine.clone();
+            item.Roiarea = rect;
+            item.featureSize = cv::Size2f(static_cast<float>(rect.width), static_cast<float>(rect.height));
+            item.rotatedRect = cv::RotatedRect(
+                cv::Point2f(rect.x + rect.width * 0.5f, rect.y + rect.height * 0.5f),
+                item.featureSize,
+                static_cast<float>(match.angle));
         }
+        results.push_back(std::move(item));
+    }
+    return results;
+}
 
-        std::vector<TIGER_BSVISION::Match> matches;
-        try {
-            matches = m_matchEngines[slot]->find_shape_model(MatchImg, levelMask, static_cast<float>(params.scoreThreshold));
-        } catch (const cv::Exception& e) {
-            qWarning().noquote() << QStringLiteral("find_shape_model 在金字塔层 %1 抛出 OpenCV 异常：%2")
-                                    .arg(level)
-                                    .arg(QString::fromUtf8(e.what()));
-            continue;
-        } catch (const std::exception& e) {
-            qWarning().noquote() << QStringLiteral("find_shape_model 在金字塔层 %1 抛出异常：%2")
-                                    .arg(level)
-                                    .arg(QString::fromUtf8(e.what()));
+std::vector<TemplateManager::LevelSearch> TemplateManager::collectLevels(ImagePyramid& pyramid, bool useRoi) const
+{
+    const int scanUpperLevel = std::min(m_pyramidLevel, kMaxPyramidScanLevel);
+    std::set<int> executedLevels;
+    std::vector<LevelSearch> levels;
+    for (size_t slot = 0; slot < m_matchEngines.size(); ++slot) {
+        if (!m_matchEngines[slot]) {
             continue;
-        } catch (...) {
-            qWarning().noquote() << QStringLiteral("find_shape_model 在金字塔层 %1 出现未知异常").arg(level);
+        }
+        if (m_effectiveLevels[slot] > scanUpperLevel) {
             continue;
         }
 
-        std::sort(matches.begin(), matches.end(), [](const TIGER_BSVISION::Match& lhs,
-                  const TIGER_BSVISION::Match& rhs) { return lhs.similarity > rhs.similarity; });
+        const int level = calcValidPyramidLevel(pyramid.size(), m_effectiveLevels[slot]);
+        if (!executedLevels.insert(level).second) {
+            continue; // 有效层级重复时只跑一次
+        }
 
-        const cv::Point2f matchCenter = m_engineTrainCenters[slot];
-        for (const auto& match : matches) {
-            cv::Rect rect = buildResultRect(match, offset, MatchImg.size());
-            rect = scaleRectUp(rect, scaleToOriginal, imageSize);
-            if (rect.width <= 0 || rect.height <= 0) {
-                continue;
-            }
+        LevelSearch search;
+        search.slot = slot;
+        search.level = level;
+        search.originalSize = pyramid.size();
+        if (useRoi && pyramid.hasMask()) {
+            search.image = pyramid.maskedImage(level); // 使用掩码提取目标区域
+            // 第三方匹配库在启用掩膜时会做额外 ROI 处理，这里不再传掩膜避免越界
+        } else {
+            search.image = pyramid.image(level);
+            search.mask = pyramid.mask(level);
+        }
+        levels.push_back(std::move(search));
+    }
+    return levels;
+}
 
-            MatchResult item;
-            item.transformedFeaturePoints = scalePointsUp(match.pts, scaleToOriginal);
-            item.score = normalizeScore(match.similarity);
-            item.angle = match.angle;
-            item.scale = match.scale;
-
-            item.center = match.transPt(matchCenter);
-            item.center.x *= scaleToOriginal;
-            item.center.y *= scaleToOriginal;
-            item.Roiarea = rect = boundingRect(item.transformedFeaturePoints);;
-
-            if (!item.transformedFeaturePoints.empty()) {
-                cv::RotatedRect rr = cv::minAreaRect(item.transformedFeaturePoints);
-                item.featureSize = rr.size;
-                item.rotatedRect = rr;
-            } else {
-                item.featureSize = cv::Size2f(static_cast<float>(rect.width), static_cast<float>(rect.height));
-                item.rotatedRect = cv::RotatedRect(
-                    cv::Point2f(rect.x + rect.width * 0.5f, rect.y + rect.height * 0.5f),
-                    item.featureSize,
-                    static_cast<float>(match.angle));
-            }
+std::vector<MatchResult> TemplateManager::matchAround(const cv::Mat& src, const std::vector<PosePrior>& priors,
+                                                      const FindMatchParams& params, std::vector<char>& found) const
+{
+    std::vector<MatchResult> results(priors.size());
+    found.assign(priors.size(), 0);
+    if (!m_valid || src.empty() || priors.empty()) {
+        return results;
+    }
+    cv::Mat maskParam = params.Mask;
+    if (!maskParam.empty() && maskParam.size() != src.size()) {
+        maskParam.release(); // 与 matchTemplate 一致：尺寸不符的掩膜忽略
+    }
 
-            const double diag = std::hypot(static_cast<double>(item.featureSize.width),
-                                           static_cast<double>(item.featureSize.height));
-            const double distanceThreshold = std::max(10.0, diag * 0.3);
-            if (isDuplicateMatch(item, results, distanceThreshold)) {
-                continue;
+    std::unique_ptr<ImagePyramid> pyramid = acquirePyramid();
+    pyramid->reset(src, maskParam); // 只有窗口覆盖到的区域会被各层引擎读取，降采样仍按整幅进行
+    std::vector<LevelSearch> levels;
+    if (!pyramid->empty()) {
+        levels = collectLevels(*pyramid, params.useRoi);
+    }
+    std::vector<const LevelSearch*> ordered; // 由粗到细
+    for (const LevelSearch& search : levels) {
+        ordered.push_back(&search);
+    }
+    std::sort(ordered.begin(), ordered.end(), [](const LevelSearch* lhs, const LevelSearch* rhs) {
+        return lhs->level > rhs->level;
+    });
+
+    MatchControl control;
+    control.deadline = deadlineFor(params);
+    if (!ordered.empty()) {
+        const float finalThreshold = engineThreshold(params);
+        const float templateRadius = 0.5f * m_learnParams.scale_max
+                                     * std::hypot(std::max(1.f, m_featureBounds.width), std::max(1.f, m_featureBounds.height));
+        const LevelSearch& coarse = *ordered.front();
+        const float coarseScale = static_cast<float>(1 << coarse.level);
+        const float coarseThreshold = ordered.size() > 1 ? finalThreshold * kCoarseScoreRatio : finalThreshold;
+        // 最粗层角度/缩放离散更粗，带宽在先验带宽之外再放宽一个量化误差
+        const double angleSlack = std::max(3.0, 2.0 * m_learnParams.angle_step * (1 << coarse.level));
+        const double scaleSlack = std::max(0.02, 2.0 * m_learnParams.scale_step * (1 << coarse.level));
+
+        // 各先验互不依赖，与分层细化一样分给匹配线程池并行处理
+        const int workers = std::min(resolveMatchThreads(), static_cast<int>(priors.size()));
+        runParallel(workers, [&](int worker, const EngineSet* engines) {
+            for (size_t i = static_cast<size_t>(worker); i < priors.size(); i += static_cast<size_t>(workers)) {
+                if (control.shouldStop()) {
+                    break;
+                }
+                const PosePrior& prior = priors[i];
+                const float half = templateRadius + prior.positionRadius;
+                const cv::Rect window(cv::Point(static_cast<int>(std::floor((prior.center.x - half) / coarseScale)),
+                                                static_cast<int>(std::floor((prior.center.y - half) / coarseScale))),
+                                      cv::Point(static_cast<int>(std::ceil((prior.center.x + half) / coarseScale)) + 1,
+                                                static_cast<int>(std::ceil((prior.center.y + half) / coarseScale)) + 1));
+                const std::vector<MatchResult> candidates = searchLevel(coarse, window, coarseThreshold, engines);
+
+                const MatchResult* best = nullptr;
+                for (const MatchResult& candidate : candidates) {
+                    double angleDelta = std::fmod(std::abs(candidate.angle - prior.angle), 360.0);
+                    angleDelta = std::min(angleDelta, 360.0 - angleDelta);
+                    if (cv::norm(candidate.center - prior.center) > prior.positionRadius + 2.f * coarseScale
+                        || angleDelta > prior.angleBand + angleSlack
+                        || std::abs(candidate.scale - prior.scale) > prior.scaleBand + scaleSlack) {
+                        continue;
+                    }
+                    if (!best || candidate.score > best->score) {
+                        best = &candidate;
+                    }
+                }
+                if (best) {
+                    found[i] = refineHypothesis(ordered, 0, *best, params, templateRadius, engines, control, results[i]) ? 1 : 0;
+                }
             }
+        }, nullptr);
+    }
 
-            results.push_back(item);
+    levels.clear();
+    if (params.refinePose && !pyramid->empty()) {
+        refinePoses(pyramid->image(0), results, &found);
+    }
+    releasePyramid(std::move(pyramid));
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (found[i] && !params.compactResults) {
+            materializeFeaturePoints(results[i]);
         }
-        qInfo().noquote() << QStringLiteral("金字塔层 %1 匹配候选数: %2").arg(level).arg(static_cast<int>(matches.size()));
     }
+    return results;
+}
 
-    std::sort(results.begin(), results.end(), [](const MatchResult& lhs, const MatchResult& rhs) {
-        return lhs.score > rhs.score;
-    });
-    if (static_cast<int>(results.size()) > maxCount) {
-        results.resize(maxCount);
+std::vector<MatchResult> TemplateManager::matchCoarseToFine(const std::vector<LevelSearch>& levels,
+                                                             const FindMatchParams& params,
+                                                             const MatchControl& control) const
+{
+    std::vector<MatchResult> results;
+    std::vector<const LevelSearch*> ordered; // 由粗到细
+    for (const LevelSearch& search : levels) {
+        ordered.push_back(&search);
     }
+    std::sort(ordered.begin(), ordered.end(), [](const LevelSearch* lhs, const LevelSearch* rhs) {
+        return lhs->level > rhs->level;
+    });
 
-    if (!results.empty()) {
-        qInfo().noquote() << QStringLiteral("0~%1 金字塔轮询后输出结果数: %2")
-                              .arg(scanUpperLevel)
-                              .arg(static_cast<int>(results.size()));
+    const float finalThreshold = engineThreshold(params);
+    // 粗层特征少、得分偏低，候选阈值适当放宽，避免细层本可命中的目标在粗层被提前淘汰
+    const float coarseThreshold = finalThreshold * kCoarseScoreRatio;
+    const int maxHypotheses = std::max(kMinHypotheses, std::max(1, params.maxCount) * 4);
+
+    // 1. 最粗层全图搜索；模板在粗层过小找不到时逐层回退，保证与逐层全图搜索结论一致
+    size_t start = 0;
+    std::vector<MatchResult> hypotheses;
+    for (; start < ordered.size(); ++start) {
+        if (control.shouldStop()) {
+            return results;
+        }
+        const LevelSearch& search = *ordered[start];
+        const bool finest = start + 1 == ordered.size();
+        const std::vector<MatchResult> candidates =
+            searchLevel(search, cv::Rect(0, 0, search.image.cols, search.image.rows),
+                        finest ? finalThreshold : coarseThreshold, control.engines);
+        MatchSuppressor suppressor(duplicateDistance(m_featureBounds.size()), params.nmsIouThreshold);
+        for (const MatchResult& item : candidates) {
+            if (!suppressor.tryAccept(item, duplicateDistance(item.featureSize))) {
+                continue;
+            }
+            hypotheses.push_back(item);
+            if (static_cast<int>(hypotheses.size()) >= maxHypotheses) {
+                break;
+            }
+        }
+        qInfo().noquote() << QStringLiteral("金字塔层 %1 全图搜索候选数: %2").arg(search.level).arg(static_cast<int>(hypotheses.size()));
+        if (!hypotheses.empty()) {
+            break;
+        }
+    }
+    if (hypotheses.empty()) {
+        return results;
     }
 
+    // 模板外接圆半径（原图像素，按最大缩放），决定细化窗口大小
+    const float templateRadius = 0.5f * m_learnParams.scale_max
+                                 * std::hypot(std::max(1.f, m_featureBounds.width), std::max(1.f, m_featureBounds.height));
+
+    // 2. 逐层细化：窗口 = 模板外接圆 + 上一层定位误差；角度/缩放只接受上一层结果附近的候选。
+    //    各候选互不依赖，分给匹配线程池并行细化（每个工作线程使用独立的引擎副本），
+    //    结果按候选下标存放，合并顺序与串行一致
+    std::vector<MatchResult> refined(hypotheses.size());
+    std::vector<char> accepted(hypotheses.size(), 0);
+    const int workers = std::min(resolveMatchThreads(), static_cast<int>(hypotheses.size()));
+    runParallel(workers, [&](int worker, const EngineSet* engines) {
+        for (size_t i = static_cast<size_t>(worker); i < hypotheses.size(); i += static_cast<size_t>(workers)) {
+            // 停止后不再搜索，候选保持当前层精度，达到最终阈值的仍作为部分结果输出
+            accepted[i] = refineHypothesis(ordered, start, hypotheses[i], params, templateRadius, engines, control, refined[i]) ? 1 : 0;
+        }
+    }, control.engines);
+
+    MatchSuppressor suppressor(duplicateDistance(m_featureBounds.size()), params.nmsIouThreshold);
+    for (size_t i = 0; i < refined.size(); ++i) {
+        if (!accepted[i]) {
+            continue;
+        }
+        MatchResult& current = refined[i];
+        if (suppressor.tryAccept(current, duplicateDistance(current.featureSize))) {
+            results.push_back(std::move(current));
+        }
+    }
     return results;
-} 
+}
+
+bool TemplateManager::refineHypothesis(const std::vector<const LevelSearch*>& ordered, size_t start,
+                                       const MatchResult& hypothesis, const FindMatchParams& params,
+                                       float templateRadius, const EngineSet* engines, const MatchControl& control,
+                                       MatchResult& current) const
+{
+    const float finalThreshold = engineThreshold(params);
+    const float coarseThreshold = finalThreshold * kCoarseScoreRatio;
+    current = hypothesis;
+    int previousLevel = ordered[start]->level;
+    for (size_t index = start + 1; index < ordered.size(); ++index) {
+        if (control.shouldStop()) {
+            break;
+        }
+        const LevelSearch& search = *ordered[index];
+        const bool finest = index + 1 == ordered.size();
+        const float levelScale = static_cast<float>(1 << search.level);
+        const float positionTolerance = 4.f * static_cast<float>(1 << previousLevel);
+        const double angleTolerance = std::max(3.0, 2.0 * m_learnParams.angle_step * (1 << previousLevel));
+        const double scaleTolerance = std::max(0.02, 2.0 * m_learnParams.scale_step * (1 << previousLevel));
+
+        const float half = templateRadius + positionTolerance;
+        const cv::Rect window(cv::Point(static_cast<int>(std::floor((current.center.x - half) / levelScale)),
+                                        static_cast<int>(std::floor((current.center.y - half) / levelScale))),
+                              cv::Point(static_cast<int>(std::ceil((current.center.x + half) / levelScale)) + 1,
+                                        static_cast<int>(std::ceil((current.center.y + half) / levelScale)) + 1));
+        const std::vector<MatchResult> candidates =
+            searchLevel(search, window, finest ? finalThreshold : coarseThreshold, engines);
+
+        const MatchResult* best = nullptr;
+        for (const MatchResult& candidate : candidates) {
+            double angleDelta = std::fmod(std::abs(candidate.angle - current.angle), 360.0);
+            angleDelta = std::min(angleDelta, 360.0 - angleDelta);
+            if (cv::norm(candidate.center - current.center) > positionTolerance
+                || angleDelta > angleTolerance
+                || std::abs(candidate.scale - current.scale) > scaleTolerance) {
+                continue;
+            }
+            if (!best || candidate.score > best->score) {
+                best = &candidate;
+            }
+        }
+        if (!best) {
+            break; // 该层未能确认，保留上一层结果（逐层全图搜索时同样会输出该层结果）
+        }
+        current = *best;
+        previousLevel = search.level;
+    }
+    return current.score >= resultThreshold(params); // 只在放宽阈值的粗层得到确认的候选不输出
+}
+
+void TemplateManager::updateEngineGeometry()
+{
+    for (size_t slot = 0; slot < m_matchEngines.size(); ++slot) {
+        m_engineGeometry[slot] = EngineGeometry();
+        if (!m_matchEngines[slot]) {
+            continue;
+        }
+        auto points = std::make_shared<const std::vector<cv::Point2f>>(collectFeaturePoints(m_matchEngines[slot]->getTempl(0)));
+        if (!points->empty()) {
+            m_engineGeometry[slot].bounds = cv::minAreaRect(*points);
+        }
+        m_engineGeometry[slot].points = std::move(points);
+    }
+}
 
 std::vector<cv::Point2f> TemplateManager::collectFeaturePoints(const TIGER_BSVISION::Template& templ)
 {
@@ -1,27 +1,207 @@
 #pragma once
 #include <memory>
 #include <array>
+#include <map>
 #include <vector>
 #include "MatchParams.h"
 #include <bscv/templmatch.h>
 #include <fstream>
 #include <algorithm>
+#include <functional>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include "ImagePyramid.h"
+#include "LazyTemplMatch.h"
+#include "PoseRefiner.h"
 #include "template/template_global.h"
 #include <opencv2/imgproc.hpp>
+#include <QString>
+
+class QPainterPath;
 
 class TEMPLATE_EXPORT TemplateManager {
+    friend class TemplateLibrary; // 模板库共享同一帧的金字塔，直接调用 matchPyramid
 public:
+    enum class MatchStatus {
+        Completed,
+        TimedOut,  // 到达截止时间，results 为已确认的部分结果
+        Cancelled, // 调用方取消，results 为空
+        Stale      // 已有更新的帧（publishFrameSequence），results 为空
+    };
+    // 取消令牌：任意线程调用 cancel()，运行中的任务在下一个检查点结束
+    class CancelToken {
+    public:
+        void cancel() { m_cancelled.store(true); }
+        bool isCancelled() const { return m_cancelled.load(); }
+    private:
+        std::atomic<bool> m_cancelled{false};
+    };
+    // 各槽位（金字塔层 0~3）一组匹配引擎
+    using EngineSet = std::array<std::unique_ptr<TIGER_BSVISION::ITemplMatch>, 4>;
+    // 一次匹配任务：frame 为只读快照（共享图像数据，调用方保证之后不再原地修改）
+    struct MatchJob {
+        cv::Mat frame;
+        FindMatchParams params;
+        uint64_t frameSequence = 0; // 帧序号，0 表示不做过期检查
+        std::shared_ptr<CancelToken> cancelToken;
+        std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+        // 非空时调用线程使用这组独占引擎副本（acquireEngineSet）代替主引擎；
+        // 同一模板上并发执行的任务中，除一个之外都必须各自持有副本
+        const EngineSet* engines = nullptr;
+    };
+    // 单次匹配各阶段耗时（毫秒），用于性能回归对比；提前停止时未执行的阶段为 0
+    struct MatchTiming {
+        double prepareMs = 0.0;  // 校验掩膜并裁剪搜索区域
+        double pyramidMs = 0.0;  // 灰度转换与各搜索层降采样
+        double searchMs = 0.0;   // 各层引擎搜索、由粗到精细化与去重
+        double refineMs = 0.0;   // 亚像素位姿精修（refinePose）
+        double finalizeMs = 0.0; // 坐标换算回整图、补齐特征点
+    };
+    struct MatchJobResult {
+        MatchStatus status = MatchStatus::Completed;
+        std::vector<MatchResult> results;
+        uint64_t frameSequence = 0;
+        double   elapsedMs = 0.0;
+        MatchTiming timing;
+    };
+
     TemplateManager();
     ~TemplateManager();
     //获取模板   src: 输入图像   templateMat: 模板图像   params: 模板参数
     bool learnTemplate(const cv::Mat& src, const cv::Mat& templateMat, const MatchParams& params);
+    //由矢量路径（图像像素坐标，如激光加工路径）直接生成模型，不渲染图像、不提取梯度（PathTemplateGenerator）。
+    //模板坐标系原点为路径外接框左上角外扩边距处；路径不含明暗信息，按忽略极性学习。
+    //各层与角度分段（learnAngleSplits）与 learnTemplate 一样并行生成；按需模型只能由图像生成 bin，
+    //内置引擎由边缘点建模时忽略 lazyModel 并给出警告，预编译引擎由渲染图像建模时照常按需生成
+    bool learnTemplateFromPath(const QPainterPath& path, const MatchParams& params);
     //匹配模板，返回所有匹配结果   src: 输入图像    params: 匹配参数
     std::vector<MatchResult> matchTemplate(const cv::Mat& src, const FindMatchParams& params) const;
     bool hasTemplate() const { return m_valid; }
     //返回当前模板的特征点坐标
     std::vector<cv::Point2f> currentFeaturePoints() const{ return m_featurePoints;}
     cv::Point2f trainCenter() const { return m_trainCenter; }
+    //返回学习时保存的模板图像与参数（服务端匹配模式下上传给推流服务器）
+    cv::Mat templateImage() const { return m_template; }
+    const MatchParams& learnParams() const { return m_learnParams; }
+    //最近一次学习耗时（毫秒）；加载模型包时为模型包记录的学习耗时
+    double learnMs() const { return m_learnMs; }
+    //模型包持久化：directory 下保存清单（参数/层级/中心/特征点/内容哈希）、模板图像与掩膜、各槽位引擎模型
+    bool saveModel(const QString& directory) const;
+    bool loadModel(const QString& directory);
+    //带缓存的学习：cacheRoot/<哈希> 下已有相同模板与参数的模型包时直接加载，否则学习后写入缓存
+    bool learnTemplateCached(const cv::Mat& src, const cv::Mat& templateMat, const MatchParams& params,
+                             const QString& cacheRoot);
+    //模板图像 + 学习参数 + 匹配引擎的内容哈希（16 位十六进制），作为模型包的缓存键
+    static QString modelHash(const cv::Mat& templateMat, const MatchParams& params);
+    //按需生成模型（MatchParams::lazyModel）各层区间缓存的命中/生成/淘汰统计之和，普通模型返回全 0
+    LazyTemplMatch::Stats lazyModelStats() const;
+    //模型内存统计：每个槽位（金字塔层）的变体（旋转/缩放模板）数、特征数与字节数
+    struct MemoryReport {
+        struct Slot {
+            int    slot = 0;
+            int    level = 0;       // 有效金字塔层
+            size_t variants = 0;    // 已生成的变体数（按需模型只计常驻 bin）
+            size_t features = 0;
+            size_t bytes = 0;
+            bool   estimated = false; // 引擎内部存储不透明（预编译 BSCV）时按 getTempl 展开大小估算
+            std::vector<size_t> variantBytes; // perVariant 时按模板编号给出每个变体的字节数
+            double bytesPerVariant() const { return variants > 0 ? static_cast<double>(bytes) / static_cast<double>(variants) : 0.0; }
+        };
+        std::vector<Slot> engineSlots;
+        size_t geometryBytes = 0;    // 各槽位共享特征点与学习特征点
+        size_t pyramidPoolBytes = 0; // 搜索图金字塔缓冲池
+        size_t totalBytes = 0;       // 以上全部 + 各槽位模型
+    };
+    //perVariant 为 true 时逐个变体统计（预编译 BSCV 需要展开每个模板，较慢）
+    MemoryReport memoryReport(bool perVariant = false) const;
+    //创建匹配任务：截止时间从现在起按 params.timeoutMs 计算（排队等待也计入），附带新的取消令牌
+    static MatchJob makeMatchJob(const cv::Mat& frame, const FindMatchParams& params, uint64_t frameSequence = 0);
+    //执行匹配任务：在金字塔层、引擎调用与候选细化之间检查取消/过期/截止时间
+    MatchJobResult runMatchJob(const MatchJob& job) const;
+    //通知已有更新的帧：帧序号更小、尚未完成的任务在下一个检查点以 Stale 结束
+    void publishFrameSequence(uint64_t frameSequence) const;
+    //跟踪先验：上一帧（或按运动预测的）位姿，以及本帧允许偏离的范围
+    struct PosePrior {
+        cv::Point2f center{0.f, 0.f};
+        double angle = 0.0;
+        double scale = 1.0;
+        float  positionRadius = 40.f; // 原图像素
+        double angleBand = 10.0;      // 度
+        double scaleBand = 0.05;
+    };
+    //只在各先验位姿附近的窗口内由粗到精搜索（不做全图搜索），返回与 priors 一一对应的结果，
+    //found[i] 为 0 表示第 i 个先验在带宽内没有达到分数阈值的匹配
+    std::vector<MatchResult> matchAround(const cv::Mat& src, const std::vector<PosePrior>& priors,
+                                         const FindMatchParams& params, std::vector<char>& found) const;
+    //单次匹配内部并行使用的最大线程数（含调用线程），<=0 表示自动：不超过 OpenCV 线程数与金字塔层数
+    static void setMaxMatchThreads(int threads);
+    static int maxMatchThreads();
+    //借出/归还一组由主引擎复制的引擎副本（池内复用，重新学习模板时清空）。
+    //复制会读取主引擎，须在并发匹配开始之前借出，不能与使用主引擎的搜索同时进行
+    std::unique_ptr<EngineSet> acquireEngineSet() const;
+    void releaseEngineSet(std::unique_ptr<EngineSet> engines) const;
 private:
+    // 学习前清空引擎、引擎副本池与各槽位状态
+    void resetModel();
+    // 按有效层把已生成的引擎分配到槽位，并计算训练中心/特征点/外接框；没有可用引擎时返回 false
+    bool installEngines(std::map<int, std::unique_ptr<TIGER_BSVISION::ITemplMatch>>& builtEngines,
+                        const cv::Size& templateSize, int scanUpperLevel);
+    // 并行生成各层各角度分段的引擎（build(层序号, 段序号)），每层所有分段都成功才可用，多段时合并为分段模型
+    // （各段模板数须与 partTemplateCounts 一致），结果按有效层写入 builtEngines；返回实际使用的线程数
+    int buildLevelEngines(const std::vector<int>& levels, const std::vector<int>& partTemplateCounts,
+                          const std::function<std::unique_ptr<TIGER_BSVISION::ITemplMatch>(size_t, size_t)>& build,
+                          std::map<int, std::unique_ptr<TIGER_BSVISION::ITemplMatch>>& builtEngines) const;
+    // 单次匹配的停止条件（取消令牌/帧序号/截止时间），首次触发的原因记为最终状态
+    struct MatchControl;
+
+    std::vector<MatchResult> matchWithControl(const cv::Mat& src, const FindMatchParams& params, const MatchControl& control) const;
+    // 在已构建的搜索图金字塔上匹配，返回按分数降序的前 maxCount 个结果（金字塔第 0 层坐标，未补齐特征点）
+    std::vector<MatchResult> matchPyramid(ImagePyramid& pyramid, const FindMatchParams& params, const MatchControl& control) const;
+    std::vector<MatchResult> matchPyramid(ImagePyramid& pyramid, const FindMatchParams& params) const; // 不设停止条件
+    // 校验掩膜并按掩膜有效区域外扩 margin 裁剪输入（原点按 align 对齐）；region 为裁剪区域在整图中的位置，
+    // 掩膜内没有有效像素时返回 false
+    static bool prepareSearchInput(const cv::Mat& src, const cv::Mat& mask, int margin, int align,
+                                   cv::Mat& searchSrc, cv::Mat& searchMask, cv::Rect& region);
+    // 裁剪坐标平移回整图，非紧凑模式下补齐特征点
+    static void finalizeResults(std::vector<MatchResult>& results, const FindMatchParams& params, const cv::Point& offset);
+    int scanUpperLevelLimit() const;
+    // 按学习步长确定精修的边缘搜索半径：覆盖半个角度/缩放步长在模板边缘处造成的偏差
+    PoseRefiner::Params poseRefineParams() const;
+    // gray 为与 results 同坐标系的第 0 层灰度图；精修失败的结果保持不变
+    void refinePoses(const cv::Mat& gray, std::vector<MatchResult>& results, const std::vector<char>* found = nullptr) const;
+    int searchMargin() const; // 模板外接圆半径（原图像素，按最大缩放），裁剪搜索区域的外扩量
+
+    // 单个金字塔层的搜索输入（整幅图像已降采样到该层）
+    struct LevelSearch {
+        size_t  slot = 0;
+        int     level = 0;
+        cv::Mat image;
+        cv::Mat mask;
+        cv::Size originalSize; // 原图尺寸，用于裁剪换算回原图的结果
+    };
+    // 在该层 window（层坐标）内运行匹配，结果换算到原图坐标并按分数降序
+    // engines 为空时使用主引擎，否则使用工作线程独占的引擎副本
+    std::vector<MatchResult> searchLevel(const LevelSearch& search, const cv::Rect& window, float threshold,
+                                         const EngineSet* engines = nullptr) const;
+    // 按槽位收集要搜索的金字塔层（有效层级重复的只保留一个）；useRoi 且有掩膜时搜索掩膜外清零的图像
+    std::vector<LevelSearch> collectLevels(ImagePyramid& pyramid, bool useRoi) const;
+    // 由粗到精：最粗层全图搜索得到候选，逐层在候选附近窗口内细化
+    std::vector<MatchResult> matchCoarseToFine(const std::vector<LevelSearch>& levels, const FindMatchParams& params,
+                                               const MatchControl& control) const;
+    // 把一个粗层候选逐层细化到最细层，返回是否达到最终分数阈值
+    bool refineHypothesis(const std::vector<const LevelSearch*>& ordered, size_t start, const MatchResult& hypothesis,
+                          const FindMatchParams& params, float templateRadius, const EngineSet* engines,
+                          const MatchControl& control, MatchResult& refined) const;
+    // 在匹配线程池上并行执行 workers 个任务（调用线程执行第 0 个，使用 callerEngines，为空时即主引擎）；
+    // needReplicas 时第 1 个起的任务拿到独占引擎副本，否则所有任务都使用 callerEngines（各任务须访问不同槽位）
+    void runParallel(int workers, const std::function<void(int, const EngineSet*)>& task, const EngineSet* callerEngines,
+                     bool needReplicas = true) const;
+    // 搜索图金字塔缓冲池：借出/归还，连续同尺寸帧复用内存
+    std::unique_ptr<ImagePyramid> acquirePyramid() const;
+    void releasePyramid(std::unique_ptr<ImagePyramid> pyramid) const;
+    // 由各槽位引擎的 getTempl(0) 重新计算共享特征点与外接旋转框（学习/加载模型后调用）
+    void updateEngineGeometry();
     //设置当前模板的特征点坐标
     static std::vector<cv::Point2f> collectFeaturePoints(const TIGER_BSVISION::Template& templ);
     //计算最小外接矩形
@@ -29,6 +209,9 @@ private:
 
 private:
     cv::Mat      m_template;
+    cv::Mat      m_templateMask; // 学习时实际使用的掩膜（Alpha/边界屏蔽），随模型包保存
+    QString      m_modelHash;    // 当前模型的内容哈希，学习/加载后更新
+    double       m_learnMs = 0.0; // 最近一次实际学习耗时，写入模型包供加载时对比
     MatchParams  m_learnParams;
     cv::Point2f  m_trainCenter{0.f, 0.f};
     cv::Point2f  m_engineTrainCenter{0.f, 0.f};
@@ -37,8 +220,22 @@ private:
     int          m_pyramidLevel = 0;
     float        m_pyramidScale = 1.0f;
     // 轮询金字塔 0~3：每个槽位对应一个请求层级（0/1/2/3），effectiveLevel 可能因图像过小被截断。
-    std::array<std::unique_ptr<TIGER_BSVISION::ITemplMatch>, 4> m_matchEngines;
+    EngineSet m_matchEngines;
     std::array<cv::Point2f, 4> m_engineTrainCenters{{cv::Point2f(0.f, 0.f), cv::Point2f(0.f, 0.f), cv::Point2f(0.f, 0.f), cv::Point2f(0.f, 0.f)}};
     std::array<int, 4> m_effectiveLevels{{0, 0, 0, 0}};
+    // 各槽位引擎训练坐标下的特征点（所有匹配结果共享，按需变换到全图）及其最小外接旋转框
+    struct EngineGeometry {
+        std::shared_ptr<const std::vector<cv::Point2f>> points;
+        cv::RotatedRect bounds;
+    };
+    std::array<EngineGeometry, 4> m_engineGeometry;
     bool         m_valid = false;
+    // 金字塔池可被多个匹配线程同时借用（每个金字塔同一时刻只借给一次匹配）；主引擎则不加锁，
+    // runParallel 的第 0 个任务总在调用方引擎上运行，并发匹配须按 MatchJob::engines 各自持有副本
+    mutable std::mutex m_pyramidMutex;
+    mutable std::vector<std::unique_ptr<ImagePyramid>> m_pyramidPool;
+    // 并行细化用的引擎副本池（由主引擎复制，重新学习模板时清空）
+    mutable std::mutex m_enginePoolMutex;
+    mutable std::vector<std::unique_ptr<EngineSet>> m_enginePool;
+    mutable std::atomic<uint64_t> m_latestFrameSequence{0};
 };
\ No newline at end of file
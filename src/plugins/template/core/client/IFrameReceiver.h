@@ -0,0 +1,41 @@
+#pragma once
+#include <QObject>
+#include <QString>
+#include <opencv2/core.hpp>
+#include "StreamProtocol.h"
+
+Q_DECLARE_METATYPE(cv::Mat)
+Q_DECLARE_METATYPE(StreamProtocol::FrameGeometry)
+
+// 帧接收器公共接口：UDP 推流与同机共享内存两种传输对使用方表现一致
+class IFrameReceiver : public QObject {
+    Q_OBJECT
+
+public:
+    explicit IFrameReceiver(QObject* parent = nullptr) : QObject(parent) {}
+    ~IFrameReceiver() override = default;
+
+    static void registerMetaTypes()
+    {
+        qRegisterMetaType<cv::Mat>("cv::Mat");
+        qRegisterMetaType<StreamProtocol::FrameGeometry>("StreamProtocol::FrameGeometry");
+    }
+
+    // 最近一帧的传输图像 -> 传感器整幅坐标映射
+    StreamProtocol::FrameGeometry lastGeometry() const { return geometry; }
+    // 把在最近一帧上得到的匹配结果换算到传感器整幅坐标
+    void mapToSensor(MatchResult& result) const { geometry.mapToSensor(result); }
+
+public slots:
+    // address/port 的含义由具体传输决定：UDP 为服务器地址与端口，共享内存为映射名与流编号
+    virtual bool start(const QString& address, quint16 port) = 0;
+    virtual void stop() = 0;
+
+signals:
+    void frameReady(cv::Mat frame);
+    void frameReadyWithGeometry(cv::Mat frame, StreamProtocol::FrameGeometry geometry); // 附带坐标映射
+    void statusText(QString text);
+
+protected:
+    StreamProtocol::FrameGeometry geometry; // 最近一帧的坐标映射
+};
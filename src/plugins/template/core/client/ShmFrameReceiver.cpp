@@ -0,0 +1,100 @@
+#include "ShmFrameReceiver.h"
+#include <algorithm>
+
+ShmFrameReceiver::ShmFrameReceiver(QObject* parent)
+    : IFrameReceiver(parent) {
+    pollTimer.setTimerType(Qt::PreciseTimer);
+    pollTimer.setInterval(1); // 同机传输延迟主要取决于轮询间隔
+    connect(&pollTimer, &QTimer::timeout, this, &ShmFrameReceiver::poll);
+}
+
+ShmFrameReceiver::~ShmFrameReceiver() {
+    stop();
+}
+
+bool ShmFrameReceiver::start(const QString& address, quint16) {
+    stop();
+    ringName = address.toStdString();
+    std::string error;
+    if (!reader.attach(ringName, error)) {
+        // 写端可能尚未启动，保持轮询等待其创建
+        emit statusText(QStringLiteral("共享内存暂不可用，等待写端：%1").arg(QString::fromStdString(error)));
+    } else {
+        emit statusText(QStringLiteral("已连接共享内存 %1").arg(address));
+    }
+    lastStatus = reader.isAttached() ? ShmFrameRing::Reader::Status::NoFrame : ShmFrameRing::Reader::Status::Detached;
+    frames = 0;
+    latencyUs = 0;
+    maxLatencyUs = 0;
+    pollTimer.start();
+    return true;
+}
+
+void ShmFrameReceiver::stop() {
+    pollTimer.stop();
+    reader.detach();
+    frame.release();
+}
+
+void ShmFrameReceiver::poll() {
+    using Status = ShmFrameRing::Reader::Status;
+    if (!reader.isAttached()) {
+        if (reattachCountdown-- > 0) {
+            return;
+        }
+        reattachCountdown = 200; // 约 200ms 重试一次
+        std::string error;
+        if (!reader.attach(ringName, error)) {
+            return;
+        }
+        emit statusText(QStringLiteral("共享内存写端已就绪"));
+    }
+
+    // 一次轮询把积压的新帧读完，只发出最新一帧
+    bool gotFrame = false;
+    StreamProtocol::FrameGeometry frameGeometry;
+    uint64_t captureTimeUs = 0;
+    Status status = Status::NoFrame;
+    for (int i = 0; i < 4; ++i) {
+        if (frame.u && frame.u->refcount > 1) {
+            frame.release(); // 上一帧仍被使用方持有，不能原地覆盖
+        }
+        status = reader.poll(frame, frameGeometry, captureTimeUs);
+        if (status != Status::NewFrame) {
+            break;
+        }
+        gotFrame = true;
+    }
+
+    if (status != lastStatus && (status == Status::WriterLost || status == Status::Detached)) {
+        emit statusText(status == Status::WriterLost ? QStringLiteral("共享内存写端心跳超时，等待写端重启")
+                                                     : QStringLiteral("共享内存已失效，尝试重新连接"));
+    } else if (lastStatus == Status::WriterLost && (status == Status::NewFrame || gotFrame)) {
+        emit statusText(QStringLiteral("共享内存写端已恢复"));
+    }
+    lastStatus = gotFrame ? Status::NewFrame : status;
+
+    if (!gotFrame) {
+        return;
+    }
+    const quint64 latency = ShmFrameRing::nowUs() - captureTimeUs;
+    frames++;
+    latencyUs += latency;
+    maxLatencyUs = std::max(maxLatencyUs, latency);
+    geometry = frameGeometry;
+    emit frameReady(frame);
+    emit frameReadyWithGeometry(frame, frameGeometry);
+    if (frames % 100 == 0) {
+        reportLatency();
+    }
+}
+
+void ShmFrameReceiver::reportLatency() {
+    emit statusText(QStringLiteral("共享内存：%1 帧，平均延迟 %2 ms，最大 %3 ms，丢帧 %4，撕裂重读 %5")
+                        .arg(frames)
+                        .arg(latencyUs / 1000.0 / frames, 0, 'f', 3)
+                        .arg(maxLatencyUs / 1000.0, 0, 'f', 3)
+                        .arg(reader.droppedFrames())
+                        .arg(reader.tornReads()));
+    maxLatencyUs = 0;
+}
@@ -0,0 +1,39 @@
+#pragma once
+#include <QTimer>
+#include <QString>
+#include <string>
+#include <opencv2/core.hpp>
+#include "IFrameReceiver.h"
+#include "ShmFrameRing.h"
+
+// 同机共享内存帧接收器：与 UDPMatReceiver 同一接口，使用方无需区分传输方式
+class ShmFrameReceiver : public IFrameReceiver {
+    Q_OBJECT
+
+public:
+    explicit ShmFrameReceiver(QObject* parent = nullptr);
+    ~ShmFrameReceiver() override;
+
+public slots:
+    // address: 共享内存名称；port: 未使用（保留与 UDP 接口一致）
+    bool start(const QString& address = QStringLiteral("heightVisionFrames"), quint16 port = 0) override;
+    void stop() override;
+
+private slots:
+    void poll();
+
+private:
+    void reportLatency();
+
+private:
+    QTimer pollTimer;
+    ShmFrameRing::Reader reader;
+    std::string ringName;
+    cv::Mat frame; // 未被使用方持有时复用
+    ShmFrameRing::Reader::Status lastStatus = ShmFrameRing::Reader::Status::Detached;
+    int reattachCountdown = 0; // 未连接时降低重试频率
+
+    quint64 frames = 0;
+    quint64 latencyUs = 0;    // 写端发布到本端发出信号
+    quint64 maxLatencyUs = 0;
+};
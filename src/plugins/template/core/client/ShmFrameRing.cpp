@@ -0,0 +1,364 @@
+#include "ShmFrameRing.h"
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#  ifndef NOMINMAX
+#    define NOMINMAX
+#  endif
+#  include <windows.h>
+#else
+#  include <fcntl.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+namespace ShmFrameRing {
+
+namespace {
+
+constexpr size_t kAlign = 64;
+
+size_t alignUp(size_t v)
+{
+    return (v + kAlign - 1) / kAlign * kAlign;
+}
+
+size_t slotStride(uint32_t slotBytes)
+{
+    return sizeof(SlotHeader) + alignUp(slotBytes);
+}
+
+std::string platformName(const std::string& name)
+{
+#ifdef _WIN32
+    return "Local\\" + name;
+#else
+    return name.empty() || name[0] != '/' ? "/" + name : name; // shm_open 要求以 / 开头
+#endif
+}
+
+} // namespace
+
+uint64_t nowUs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+size_t mappingSize(uint32_t slotCount, uint32_t slotBytes)
+{
+    return alignUp(sizeof(RingHeader)) + static_cast<size_t>(slotCount) * slotStride(slotBytes);
+}
+
+// ---------------------------------------------------------------- Mapping
+
+bool Mapping::open(const std::string& name, size_t size, bool create, std::string& error)
+{
+    close();
+    const std::string osName = platformName(name);
+#ifdef _WIN32
+    HANDLE handle = nullptr;
+    if (create) {
+        const unsigned long long wanted = size;
+        handle = CreateFileMappingA(INVALID_HANDLE_VALUE, nullptr, PAGE_READWRITE,
+                                    static_cast<DWORD>(wanted >> 32), static_cast<DWORD>(wanted & 0xFFFFFFFFu),
+                                    osName.c_str());
+    } else {
+        handle = OpenFileMappingA(FILE_MAP_READ, FALSE, osName.c_str());
+    }
+    if (!handle) {
+        error = "无法打开共享内存 " + osName + "，错误码 " + std::to_string(GetLastError());
+        return false;
+    }
+    void* view = MapViewOfFile(handle, create ? FILE_MAP_ALL_ACCESS : FILE_MAP_READ, 0, 0, 0);
+    if (!view) {
+        error = "共享内存映射失败，错误码 " + std::to_string(GetLastError());
+        CloseHandle(handle);
+        return false;
+    }
+    MEMORY_BASIC_INFORMATION info{};
+    VirtualQuery(view, &info, sizeof(info));
+    if (create && info.RegionSize < size) {
+        // Windows 命名映射创建后大小固定：已有旧映射且容量不足时无法扩容
+        error = "已存在的共享内存容量不足，请先关闭所有读端";
+        UnmapViewOfFile(view);
+        CloseHandle(handle);
+        return false;
+    }
+    m_handle = handle;
+    m_data = static_cast<uint8_t*>(view);
+    m_size = info.RegionSize;
+    return true;
+#else
+    const int fd = shm_open(osName.c_str(), create ? (O_CREAT | O_RDWR) : O_RDONLY, 0666);
+    if (fd < 0) {
+        error = "无法打开共享内存 " + osName + "：" + std::strerror(errno);
+        return false;
+    }
+    struct stat st {};
+    if (fstat(fd, &st) != 0) {
+        error = std::string("fstat 失败：") + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    size_t mapSize = static_cast<size_t>(st.st_size);
+    if (create && mapSize < size) {
+        // 只增不减：读端可能仍映射着旧长度，缩小文件会让其访问越界（SIGBUS）
+        if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+            error = std::string("ftruncate 失败：") + std::strerror(errno);
+            ::close(fd);
+            return false;
+        }
+        mapSize = size;
+    }
+    if (mapSize < sizeof(RingHeader)) {
+        error = "共享内存尚未初始化";
+        ::close(fd);
+        return false;
+    }
+    void* addr = mmap(nullptr, mapSize, create ? (PROT_READ | PROT_WRITE) : PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd); // 映射建立后描述符即可关闭
+    if (addr == MAP_FAILED) {
+        error = std::string("mmap 失败：") + std::strerror(errno);
+        return false;
+    }
+    m_data = static_cast<uint8_t*>(addr);
+    m_size = mapSize;
+    return true;
+#endif
+}
+
+void Mapping::close()
+{
+    if (!m_data) {
+        return;
+    }
+#ifdef _WIN32
+    UnmapViewOfFile(m_data);
+    CloseHandle(static_cast<HANDLE>(m_handle));
+    m_handle = nullptr;
+#else
+    munmap(m_data, m_size);
+#endif
+    m_data = nullptr;
+    m_size = 0;
+}
+
+// ---------------------------------------------------------------- Writer
+
+SlotHeader* Writer::slot(uint32_t index) const
+{
+    const RingHeader* h = header();
+    return reinterpret_cast<SlotHeader*>(m_mapping.data() + alignUp(sizeof(RingHeader))
+                                         + static_cast<size_t>(index) * slotStride(h->slotBytes));
+}
+
+bool Writer::open(const std::string& name, uint32_t slotCount, uint32_t slotBytes, std::string& error)
+{
+    if (slotCount < 2 || slotBytes == 0) {
+        error = "共享内存环至少需要 2 个槽位";
+        return false;
+    }
+    const size_t wanted = mappingSize(slotCount, slotBytes);
+    if (!m_mapping.open(name, wanted, true, error)) {
+        return false;
+    }
+
+    RingHeader* h = header();
+    const bool compatible = h->magic == kMagic && h->version == kVersion
+                            && h->slotCount == slotCount && h->slotBytes == slotBytes;
+    if (compatible) {
+        // 写端崩溃后重启：沿用已发布序号，读端无需感知
+        m_nextSeq = h->publishedSeq.load(std::memory_order_acquire) + 1;
+    } else {
+        // 首次创建或布局变化：先让读端看到无效魔数，再重建布局
+        h->magic = 0;
+        std::atomic_thread_fence(std::memory_order_release);
+        h->version = kVersion;
+        h->slotCount = slotCount;
+        h->slotBytes = slotBytes;
+        h->publishedSeq.store(0, std::memory_order_relaxed);
+        for (uint32_t i = 0; i < slotCount; ++i) {
+            slot(i)->seq.store(0, std::memory_order_relaxed);
+        }
+        m_nextSeq = 1;
+        std::atomic_thread_fence(std::memory_order_release);
+        h->magic = kMagic;
+    }
+    h->generation.fetch_add(1, std::memory_order_acq_rel);
+    heartbeat();
+    return true;
+}
+
+void Writer::heartbeat()
+{
+    if (m_mapping.isOpen()) {
+        header()->heartbeatUs.store(nowUs(), std::memory_order_release);
+    }
+}
+
+bool Writer::publish(const cv::Mat& frame, uint64_t captureTimeUs, const StreamProtocol::FrameGeometry& geometry)
+{
+    if (!m_mapping.isOpen() || frame.empty() || frame.depth() != CV_8U) {
+        return false;
+    }
+    RingHeader* h = header();
+    const size_t rowBytes = frame.cols * frame.elemSize();
+    const size_t bytes = rowBytes * frame.rows;
+    if (bytes > h->slotBytes) {
+        return false;
+    }
+
+    const uint64_t seq = m_nextSeq++;
+    SlotHeader* s = slot(static_cast<uint32_t>(seq % h->slotCount));
+    s->seq.store(2 * seq - 1, std::memory_order_relaxed); // 奇数：写入中
+    std::atomic_thread_fence(std::memory_order_release);
+
+    s->width = static_cast<uint32_t>(frame.cols);
+    s->height = static_cast<uint32_t>(frame.rows);
+    s->type = frame.type();
+    s->payloadLen = static_cast<uint32_t>(bytes);
+    s->captureTimeUs = captureTimeUs;
+    const cv::Size sensor = geometry.sensorSize.empty() ? frame.size() : geometry.sensorSize;
+    const cv::Rect crop = geometry.crop.empty() ? cv::Rect(0, 0, frame.cols, frame.rows) : geometry.crop;
+    s->sensorWidth = sensor.width;
+    s->sensorHeight = sensor.height;
+    s->cropX = crop.x;
+    s->cropY = crop.y;
+    s->cropW = crop.width;
+    s->cropH = crop.height;
+    s->scale = geometry.scale;
+
+    uint8_t* dst = reinterpret_cast<uint8_t*>(s) + sizeof(SlotHeader);
+    if (frame.isContinuous()) {
+        std::memcpy(dst, frame.data, bytes);
+    } else {
+        for (int y = 0; y < frame.rows; ++y) {
+            std::memcpy(dst + y * rowBytes, frame.ptr(y), rowBytes);
+        }
+    }
+
+    s->seq.store(2 * seq, std::memory_order_release); // 偶数：已发布
+    h->publishedSeq.store(seq, std::memory_order_release);
+    h->heartbeatUs.store(nowUs(), std::memory_order_release);
+    return true;
+}
+
+// ---------------------------------------------------------------- Reader
+
+const SlotHeader* Reader::slot(uint32_t index) const
+{
+    const RingHeader* h = header();
+    return reinterpret_cast<const SlotHeader*>(m_mapping.data() + alignUp(sizeof(RingHeader))
+                                               + static_cast<size_t>(index) * slotStride(h->slotBytes));
+}
+
+bool Reader::layoutValid() const
+{
+    const RingHeader* h = header();
+    if (h->magic != kMagic || h->version != kVersion || h->slotCount < 2) {
+        return false;
+    }
+    return mappingSize(h->slotCount, h->slotBytes) <= m_mapping.size();
+}
+
+bool Reader::attach(const std::string& name, std::string& error)
+{
+    m_name = name;
+    if (!m_mapping.open(name, 0, false, error)) {
+        return false;
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (!layoutValid()) {
+        error = "共享内存布局无效或写端尚未初始化";
+        m_mapping.close();
+        return false;
+    }
+    m_generation = header()->generation.load(std::memory_order_acquire);
+    m_lastSeq = 0;
+    return true;
+}
+
+void Reader::detach()
+{
+    m_mapping.close();
+    m_generation = 0;
+    m_lastSeq = 0;
+}
+
+Reader::Status Reader::poll(cv::Mat& frame, StreamProtocol::FrameGeometry& geometry, uint64_t& captureTimeUs)
+{
+    std::string error;
+    if (!m_mapping.isOpen() && (m_name.empty() || !attach(m_name, error))) {
+        return Status::Detached;
+    }
+    if (!layoutValid()) {
+        // 写端重建了布局（容量可能变大），重新映射
+        m_mapping.close();
+        if (!attach(m_name, error)) {
+            return Status::Detached;
+        }
+    }
+
+    const RingHeader* h = header();
+    const uint64_t generation = h->generation.load(std::memory_order_acquire);
+    const uint64_t published = h->publishedSeq.load(std::memory_order_acquire);
+    if (generation != m_generation) {
+        m_generation = generation;
+        if (published < m_lastSeq) {
+            m_lastSeq = 0; // 写端重建布局后序号从头开始
+        }
+    }
+    if (nowUs() - h->heartbeatUs.load(std::memory_order_acquire) > kWriterTimeoutUs) {
+        return Status::WriterLost;
+    }
+    if (published == 0 || published == m_lastSeq) {
+        return Status::NoFrame;
+    }
+    if (published < m_lastSeq) {
+        m_lastSeq = 0;
+    }
+
+    const SlotHeader* s = slot(static_cast<uint32_t>(published % h->slotCount));
+    const uint64_t before = s->seq.load(std::memory_order_acquire);
+    if (before != 2 * published) {
+        ++m_torn; // 槽位已被更新的帧覆盖或写端在写入中崩溃，下次轮询读取最新帧
+        return Status::NoFrame;
+    }
+
+    const int width = static_cast<int>(s->width);
+    const int height = static_cast<int>(s->height);
+    const int type = s->type;
+    const uint32_t payloadLen = s->payloadLen;
+    if (width <= 0 || height <= 0 || CV_MAT_DEPTH(type) != CV_8U || payloadLen > h->slotBytes
+        || static_cast<size_t>(width) * height * CV_ELEM_SIZE(type) != payloadLen) {
+        ++m_torn;
+        return Status::NoFrame;
+    }
+    StreamProtocol::FrameGeometry g;
+    g.sensorSize = cv::Size(s->sensorWidth, s->sensorHeight);
+    g.crop = cv::Rect(s->cropX, s->cropY, s->cropW, s->cropH);
+    g.scale = s->scale > 0.f ? s->scale : 1.0f;
+    const uint64_t capture = s->captureTimeUs;
+
+    frame.create(height, width, type); // 尺寸/类型不变时复用已有内存
+    std::memcpy(frame.data, reinterpret_cast<const uint8_t*>(s) + sizeof(SlotHeader), payloadLen);
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (s->seq.load(std::memory_order_relaxed) != before) {
+        ++m_torn; // 拷贝期间被覆盖
+        return Status::NoFrame;
+    }
+
+    if (m_lastSeq != 0 && published > m_lastSeq + 1) {
+        m_dropped += published - m_lastSeq - 1;
+    }
+    m_lastSeq = published;
+    geometry = g;
+    captureTimeUs = capture;
+    return Status::NewFrame;
+}
+
+} // namespace ShmFrameRing
@@ -0,0 +1,121 @@
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <opencv2/core.hpp>
+#include "StreamProtocol.h"
+
+// 同机共享内存帧环：采集进程与界面进程在同一台机器时替代 JPEG + UDP 回环。
+// 布局：RingHeader + slotCount 个固定大小槽位；单写多读，按序号无锁发布：
+//   写端先把槽位序号置为奇数（写入中），拷贝像素后写入 2*frameSeq（偶数，已发布），再更新 publishedSeq；
+//   读端拷贝前后各读一次槽位序号，不一致或为奇数说明被覆盖/写端中途崩溃，丢弃后读取最新帧。
+// 崩溃恢复：读端不在共享内存中留下任何状态；写端每次（重新）打开都递增 generation 并持续刷新心跳，
+// 读端据此判断写端掉线、重启以及布局变化后重新映射。
+namespace ShmFrameRing {
+
+constexpr uint32_t kMagic = 0x48565348; // "HVSH"
+constexpr uint32_t kVersion = 1;
+
+struct alignas(64) RingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slotCount;
+    uint32_t slotBytes;                       // 每个槽位可容纳的最大像素字节数
+    std::atomic<uint64_t> generation;         // 写端每次重启 +1
+    std::atomic<uint64_t> heartbeatUs;        // 写端心跳（steady_clock 微秒）
+    std::atomic<uint64_t> publishedSeq;       // 最近发布的帧序号，0 表示尚无帧
+};
+
+struct alignas(64) SlotHeader {
+    std::atomic<uint64_t> seq;    // 奇数：写入中；偶数：2*frameSeq
+    uint32_t width;
+    uint32_t height;
+    int32_t  type;                // OpenCV 类型（CV_8UC1/3/4）
+    uint32_t payloadLen;
+    uint64_t captureTimeUs;
+    int32_t  sensorWidth;
+    int32_t  sensorHeight;
+    int32_t  cropX, cropY, cropW, cropH;
+    float    scale;
+};
+
+uint64_t nowUs();
+size_t mappingSize(uint32_t slotCount, uint32_t slotBytes);
+
+// 平台相关的命名共享内存映射（POSIX shm_open / Windows 文件映射）
+class Mapping {
+public:
+    Mapping() = default;
+    ~Mapping() { close(); }
+    Mapping(const Mapping&) = delete;
+    Mapping& operator=(const Mapping&) = delete;
+
+    // create=true 时不存在则创建并调整到 size；否则只打开已存在的映射，size 为 0 时按实际大小映射
+    bool open(const std::string& name, size_t size, bool create, std::string& error);
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    uint8_t* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    uint8_t* m_data = nullptr;
+    size_t   m_size = 0;
+#ifdef _WIN32
+    void*    m_handle = nullptr;
+#endif
+};
+
+// 写端（采集进程）：只允许一个实例写同一个环
+class Writer {
+public:
+    // 打开或创建环；已存在且布局兼容时沿用已发布序号继续写，布局不兼容时重新初始化
+    bool open(const std::string& name, uint32_t slotCount, uint32_t slotBytes, std::string& error);
+    void close() { m_mapping.close(); }
+    // 发布一帧（拷贝一次到槽位）；frame 超过槽位容量时返回 false
+    bool publish(const cv::Mat& frame, uint64_t captureTimeUs,
+                 const StreamProtocol::FrameGeometry& geometry = StreamProtocol::FrameGeometry());
+    // 无新帧时也应定期调用，避免读端误判写端掉线
+    void heartbeat();
+
+private:
+    RingHeader* header() const { return reinterpret_cast<RingHeader*>(m_mapping.data()); }
+    SlotHeader* slot(uint32_t index) const;
+
+    Mapping  m_mapping;
+    uint64_t m_nextSeq = 1;
+};
+
+// 读端（界面进程）
+class Reader {
+public:
+    enum class Status {
+        NewFrame,     // 读到新帧
+        NoFrame,      // 暂无新帧
+        WriterLost,   // 心跳超时（写端可能崩溃）
+        Detached,     // 共享内存不存在或布局无效
+    };
+
+    bool attach(const std::string& name, std::string& error);
+    void detach();
+    bool isAttached() const { return m_mapping.isOpen(); }
+    // 读取最新一帧到 frame（frame 尺寸不变时复用内存）；期间写端重启/布局变化会自动重新映射
+    Status poll(cv::Mat& frame, StreamProtocol::FrameGeometry& geometry, uint64_t& captureTimeUs);
+    uint64_t droppedFrames() const { return m_dropped; }
+    uint64_t tornReads() const { return m_torn; }
+
+    static constexpr uint64_t kWriterTimeoutUs = 2000000; // 2 秒无心跳视为写端掉线
+
+private:
+    const RingHeader* header() const { return reinterpret_cast<const RingHeader*>(m_mapping.data()); }
+    const SlotHeader* slot(uint32_t index) const;
+    bool layoutValid() const;
+
+    Mapping     m_mapping;
+    std::string m_name;
+    uint64_t    m_generation = 0;
+    uint64_t    m_lastSeq = 0;
+    uint64_t    m_dropped = 0;
+    uint64_t    m_torn = 0;
+};
+
+} // namespace ShmFrameRing
@@ -0,0 +1,611 @@
+#include "StreamProtocol.h"
+#include <algorithm>
+#include <cstring>
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+namespace StreamProtocol {
+
+namespace { // 大端读写工具
+
+class ByteWriter {
+public:
+    explicit ByteWriter(std::vector<uint8_t>& out) : m_out(out) {}
+
+    void u8(uint8_t v) { m_out.push_back(v); }
+    void u16(uint16_t v) { u8(static_cast<uint8_t>(v >> 8)); u8(static_cast<uint8_t>(v)); }
+    void u32(uint32_t v) { u16(static_cast<uint16_t>(v >> 16)); u16(static_cast<uint16_t>(v)); }
+    void u64(uint64_t v) { u32(static_cast<uint32_t>(v >> 32)); u32(static_cast<uint32_t>(v)); }
+    void f32(float v)
+    {
+        uint32_t bits = 0;
+        std::memcpy(&bits, &v, sizeof(bits));
+        u32(bits);
+    }
+    void bytes(const std::vector<uint8_t>& data)
+    {
+        u32(static_cast<uint32_t>(data.size()));
+        m_out.insert(m_out.end(), data.begin(), data.end());
+    }
+
+private:
+    std::vector<uint8_t>& m_out;
+};
+
+class ByteReader {
+public:
+    ByteReader(const uint8_t* data, size_t size) : m_data(data), m_size(size) {}
+
+    bool ok() const { return m_ok; }
+    uint8_t u8()
+    {
+        if (!require(1)) {
+            return 0;
+        }
+        return m_data[m_pos++];
+    }
+    uint16_t u16() { const uint16_t hi = u8(); return static_cast<uint16_t>((hi << 8) | u8()); }
+    uint32_t u32() { const uint32_t hi = u16(); return (hi << 16) | u16(); }
+    uint64_t u64() { const uint64_t hi = u32(); return (hi << 32) | u32(); }
+    float f32()
+    {
+        const uint32_t bits = u32();
+        float v = 0.f;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    std::vector<uint8_t> bytes()
+    {
+        const uint32_t len = u32();
+        if (!require(len)) {
+            return {};
+        }
+        std::vector<uint8_t> out(m_data + m_pos, m_data + m_pos + len);
+        m_pos += len;
+        return out;
+    }
+
+private:
+    bool require(size_t n)
+    {
+        if (!m_ok || m_pos + n > m_size) {
+            m_ok = false;
+            return false;
+        }
+        return true;
+    }
+
+    const uint8_t* m_data;
+    size_t m_size;
+    size_t m_pos = 0;
+    bool m_ok = true;
+};
+
+void writeRotatedRect(ByteWriter& w, const cv::RotatedRect& rr)
+{
+    w.f32(rr.center.x);
+    w.f32(rr.center.y);
+    w.f32(rr.size.width);
+    w.f32(rr.size.height);
+    w.f32(rr.angle);
+}
+
+cv::RotatedRect readRotatedRect(ByteReader& r)
+{
+    cv::RotatedRect rr;
+    rr.center.x = r.f32();
+    rr.center.y = r.f32();
+    rr.size.width = r.f32();
+    rr.size.height = r.f32();
+    rr.angle = r.f32();
+    return rr;
+}
+
+void writeRect(ByteWriter& w, const cv::Rect& rect)
+{
+    w.u32(static_cast<uint32_t>(rect.x));
+    w.u32(static_cast<uint32_t>(rect.y));
+    w.u32(static_cast<uint32_t>(rect.width));
+    w.u32(static_cast<uint32_t>(rect.height));
+}
+
+cv::Rect readRect(ByteReader& r)
+{
+    cv::Rect rect;
+    rect.x = static_cast<int>(r.u32());
+    rect.y = static_cast<int>(r.u32());
+    rect.width = static_cast<int>(r.u32());
+    rect.height = static_cast<int>(r.u32());
+    return rect;
+}
+
+bool validFormat(uint8_t format)
+{
+    return format <= static_cast<uint8_t>(PixelFormat::Bgr8);
+}
+
+} // namespace
+
+bool isProtocolPacket(const uint8_t* data, size_t size)
+{
+    PacketHeader header;
+    return readHeader(data, size, header);
+}
+
+bool readHeader(const uint8_t* data, size_t size, PacketHeader& header)
+{
+    if (!data || size < kHeaderSize) {
+        return false;
+    }
+    ByteReader r(data, size);
+    if (r.u32() != kMagic) {
+        return false;
+    }
+    header.version = r.u8();
+    const uint8_t type = r.u8();
+    header.streamId = r.u16();
+    header.transferId = r.u32();
+    header.chunkIndex = r.u16();
+    header.chunkCount = r.u16();
+    header.totalLen = r.u32();
+    if (header.version != kVersion || type < static_cast<uint8_t>(PacketType::ModelUpload)
+        || type > static_cast<uint8_t>(PacketType::FrameData)) {
+        return false;
+    }
+    if (header.chunkCount == 0 || header.chunkIndex >= header.chunkCount) {
+        return false;
+    }
+    header.type = static_cast<PacketType>(type);
+    return r.ok();
+}
+
+std::vector<std::vector<uint8_t>> packetize(PacketType type, uint32_t transferId, const std::vector<uint8_t>& payload,
+                                            uint16_t streamId)
+{
+    std::vector<std::vector<uint8_t>> packets;
+    const size_t chunkCount = std::max<size_t>(1, (payload.size() + kMaxChunkPayload - 1) / kMaxChunkPayload);
+    if (chunkCount > 0xFFFF) {
+        return packets; // 超过 4GB 级别的负载不支持
+    }
+    packets.reserve(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i) {
+        const size_t begin = i * kMaxChunkPayload;
+        const size_t end = std::min(payload.size(), begin + kMaxChunkPayload);
+        std::vector<uint8_t> packet;
+        packet.reserve(kHeaderSize + (end - begin));
+        ByteWriter w(packet);
+        w.u32(kMagic);
+        w.u8(kVersion);
+        w.u8(static_cast<uint8_t>(type));
+        w.u16(streamId);
+        w.u32(transferId);
+        w.u16(static_cast<uint16_t>(i));
+        w.u16(static_cast<uint16_t>(chunkCount));
+        w.u32(static_cast<uint32_t>(payload.size()));
+        packet.insert(packet.end(), payload.begin() + begin, payload.begin() + end);
+        packets.push_back(std::move(packet));
+    }
+    return packets;
+}
+
+std::vector<std::vector<uint8_t>> packetizeFrame(const FrameDescriptor& desc, uint32_t transferId,
+                                                 const std::vector<uint8_t>& payload)
+{
+    std::vector<std::vector<uint8_t>> packets = packetize(PacketType::FrameHeader, transferId,
+                                                          encodeFrameDescriptor(desc), desc.streamId);
+    for (auto& packet : packetize(PacketType::FrameData, transferId, payload, desc.streamId)) {
+        packets.push_back(std::move(packet));
+    }
+    return packets;
+}
+
+std::vector<uint8_t> encodeModelUpload(const ModelUpload& upload)
+{
+    std::vector<uint8_t> payload;
+    ByteWriter w(payload);
+
+    std::vector<uint8_t> png;
+    if (!upload.templateImage.empty()) {
+        cv::imencode(".png", upload.templateImage, png); // PNG 无损且保留 Alpha 掩膜
+    }
+    w.bytes(png);
+
+    const MatchParams& lp = upload.learnParams;
+    w.f32(static_cast<float>(lp.angleRange));
+    w.f32(lp.angle_step);
+    w.u32(static_cast<uint32_t>(lp.FeaturePointNum));
+    w.u32(static_cast<uint32_t>(lp.compressionLevel));
+    w.f32(lp.weakThreshold);
+    w.f32(lp.strongThreshold);
+    w.u8(lp.ignorePolarity ? 1 : 0);
+    w.f32(lp.scale_min);
+    w.f32(lp.scale_max);
+    w.f32(lp.scale_step);
+    w.u32(static_cast<uint32_t>(lp.borderPadding));
+
+    const FindMatchParams& fp = upload.findParams;
+    w.u32(static_cast<uint32_t>(fp.maxCount));
+    w.u8(fp.useSubPx ? 1 : 0);
+    w.u8(fp.centerType == MatchCenterType::TrainCenter ? 1 : 0);
+    w.f32(static_cast<float>(fp.scoreThreshold));
+
+    w.u16(upload.thumbnailInterval);
+    w.f32(upload.thumbnailScale);
+    return payload;
+}
+
+bool decodeModelUpload(const std::vector<uint8_t>& payload, ModelUpload& upload)
+{
+    ByteReader r(payload.data(), payload.size());
+    const std::vector<uint8_t> png = r.bytes();
+
+    MatchParams lp;
+    lp.angleRange = r.f32();
+    lp.angle_step = r.f32();
+    lp.FeaturePointNum = r.u32();
+    lp.compressionLevel = static_cast<int>(r.u32());
+    lp.weakThreshold = r.f32();
+    lp.strongThreshold = r.f32();
+    lp.ignorePolarity = r.u8() != 0;
+    lp.scale_min = r.f32();
+    lp.scale_max = r.f32();
+    lp.scale_step = r.f32();
+    lp.borderPadding = static_cast<int>(r.u32());
+
+    FindMatchParams fp;
+    fp.maxCount = static_cast<int>(r.u32());
+    fp.useSubPx = r.u8() != 0;
+    fp.centerType = r.u8() != 0 ? MatchCenterType::TrainCenter : MatchCenterType::SceneCenter;
+    fp.scoreThreshold = r.f32();
+
+    const uint16_t thumbnailInterval = r.u16();
+    const float thumbnailScale = r.f32();
+    if (!r.ok() || png.empty()) {
+        return false;
+    }
+
+    cv::Mat templ = cv::imdecode(png, cv::IMREAD_UNCHANGED);
+    if (templ.empty()) {
+        return false;
+    }
+    upload.templateImage = templ;
+    upload.learnParams = lp;
+    upload.findParams = fp;
+    upload.thumbnailInterval = thumbnailInterval;
+    upload.thumbnailScale = std::clamp(thumbnailScale, 0.05f, 1.0f);
+    return true;
+}
+
+std::vector<uint8_t> encodeResultFrame(const ResultFrame& frame)
+{
+    std::vector<uint8_t> payload;
+    payload.reserve(24 + frame.results.size() * 40);
+    ByteWriter w(payload);
+    w.u32(frame.frameId);
+    w.u64(frame.captureTimeUs);
+    w.u32(frame.serverLatencyUs);
+    w.u32(frame.frameBytes);
+    const uint16_t count = static_cast<uint16_t>(std::min<size_t>(frame.results.size(), 0xFFFF));
+    w.u16(count);
+    for (uint16_t i = 0; i < count; ++i) {
+        const MatchResult& res = frame.results[i];
+        w.f32(res.center.x);
+        w.f32(res.center.y);
+        w.f32(static_cast<float>(res.angle));
+        w.f32(static_cast<float>(res.scale));
+        w.f32(static_cast<float>(res.score));
+        writeRotatedRect(w, res.rotatedRect);
+    }
+    return payload;
+}
+
+bool decodeResultFrame(const std::vector<uint8_t>& payload, ResultFrame& frame)
+{
+    ByteReader r(payload.data(), payload.size());
+    ResultFrame out;
+    out.frameId = r.u32();
+    out.captureTimeUs = r.u64();
+    out.serverLatencyUs = r.u32();
+    out.frameBytes = r.u32();
+    const uint16_t count = r.u16();
+    if (!r.ok()) {
+        return false;
+    }
+    out.results.reserve(count);
+    for (uint16_t i = 0; i < count; ++i) {
+        MatchResult res;
+        res.center.x = r.f32();
+        res.center.y = r.f32();
+        res.angle = r.f32();
+        res.scale = r.f32();
+        res.score = r.f32();
+        res.rotatedRect = readRotatedRect(r);
+        res.featureSize = res.rotatedRect.size;
+        res.Roiarea = res.rotatedRect.boundingRect();
+        out.results.push_back(res);
+    }
+    if (!r.ok()) {
+        return false;
+    }
+    frame = std::move(out);
+    return true;
+}
+
+std::vector<uint8_t> encodeThumbnail(uint32_t frameId, const cv::Mat& image, float scale)
+{
+    std::vector<uint8_t> payload;
+    if (image.empty()) {
+        return payload;
+    }
+    cv::Mat small;
+    cv::resize(image, small, cv::Size(), scale, scale, cv::INTER_AREA);
+    std::vector<uint8_t> jpeg;
+    cv::imencode(".jpg", small, jpeg, {cv::IMWRITE_JPEG_QUALITY, 70});
+    ByteWriter w(payload);
+    w.u32(frameId);
+    w.bytes(jpeg);
+    return payload;
+}
+
+bool decodeThumbnail(const std::vector<uint8_t>& payload, uint32_t& frameId, cv::Mat& image)
+{
+    ByteReader r(payload.data(), payload.size());
+    frameId = r.u32();
+    const std::vector<uint8_t> jpeg = r.bytes();
+    if (!r.ok() || jpeg.empty()) {
+        return false;
+    }
+    image = cv::imdecode(jpeg, cv::IMREAD_COLOR);
+    return !image.empty();
+}
+
+void FrameGeometry::mapToSensor(MatchResult& result) const
+{
+    if (isIdentity()) {
+        return;
+    }
+    result.center = toSensor(result.center);
+    result.rotatedRect.center = toSensor(result.rotatedRect.center);
+    result.rotatedRect.size.width *= scale;
+    result.rotatedRect.size.height *= scale;
+    result.featureSize.width *= scale;
+    result.featureSize.height *= scale;
+    for (auto& pt : result.transformedFeaturePoints) {
+        pt = toSensor(pt);
+    }
+    for (int r = 0; r < 2; ++r) {
+        result.featureTransform(r, 0) *= scale;
+        result.featureTransform(r, 1) *= scale;
+        result.featureTransform(r, 2) = result.featureTransform(r, 2) * scale + static_cast<float>(r == 0 ? crop.x : crop.y);
+    }
+    const cv::Point2f tl = toSensor(cv::Point2f(static_cast<float>(result.Roiarea.x), static_cast<float>(result.Roiarea.y)));
+    result.Roiarea = cv::Rect(cvRound(tl.x), cvRound(tl.y),
+                              cvRound(result.Roiarea.width * scale), cvRound(result.Roiarea.height * scale));
+}
+
+std::vector<uint8_t> encodeStreamRequest(const StreamRequest& request)
+{
+    std::vector<uint8_t> payload;
+    ByteWriter w(payload);
+    w.u16(request.streamId);
+    writeRect(w, request.crop);
+    w.f32(request.downscale);
+    w.u8(static_cast<uint8_t>(request.format));
+    w.f32(request.maxFps);
+    w.u8(request.singleShot ? 1 : 0);
+    return payload;
+}
+
+bool decodeStreamRequest(const std::vector<uint8_t>& payload, StreamRequest& request)
+{
+    ByteReader r(payload.data(), payload.size());
+    StreamRequest out;
+    out.streamId = r.u16();
+    out.crop = readRect(r);
+    out.downscale = r.f32();
+    const uint8_t format = r.u8();
+    out.maxFps = r.f32();
+    out.singleShot = r.u8() != 0;
+    if (!r.ok() || !validFormat(format) || !(out.downscale >= 1.0f) || out.maxFps < 0.f) {
+        return false;
+    }
+    out.format = static_cast<PixelFormat>(format);
+    request = out;
+    return true;
+}
+
+std::vector<uint8_t> encodeFrameDescriptor(const FrameDescriptor& desc)
+{
+    std::vector<uint8_t> payload;
+    ByteWriter w(payload);
+    w.u32(desc.frameId);
+    w.u16(desc.streamId);
+    w.u8(static_cast<uint8_t>(desc.format));
+    w.u32(desc.payloadLen);
+    w.u16(desc.width);
+    w.u16(desc.height);
+    w.u64(desc.captureTimeUs);
+    w.u32(static_cast<uint32_t>(desc.geometry.sensorSize.width));
+    w.u32(static_cast<uint32_t>(desc.geometry.sensorSize.height));
+    writeRect(w, desc.geometry.crop);
+    w.f32(desc.geometry.scale);
+    return payload;
+}
+
+bool decodeFrameDescriptor(const std::vector<uint8_t>& payload, FrameDescriptor& desc)
+{
+    ByteReader r(payload.data(), payload.size());
+    FrameDescriptor out;
+    out.frameId = r.u32();
+    out.streamId = r.u16();
+    const uint8_t format = r.u8();
+    out.payloadLen = r.u32();
+    out.width = r.u16();
+    out.height = r.u16();
+    out.captureTimeUs = r.u64();
+    out.geometry.sensorSize.width = static_cast<int>(r.u32());
+    out.geometry.sensorSize.height = static_cast<int>(r.u32());
+    out.geometry.crop = readRect(r);
+    out.geometry.scale = r.f32();
+    if (!r.ok() || !validFormat(format) || !(out.geometry.scale > 0.f) || out.payloadLen == 0
+        || out.payloadLen >= 50u * 1024 * 1024) { // 与旧协议帧长的合理性上限一致
+        return false;
+    }
+    out.format = static_cast<PixelFormat>(format);
+    desc = out;
+    return true;
+}
+
+bool encodeFramePayload(const cv::Mat& sensorFrame, const StreamRequest& request,
+                        FrameDescriptor& desc, std::vector<uint8_t>& payload)
+{
+    if (sensorFrame.empty()) {
+        return false;
+    }
+    const cv::Rect full(0, 0, sensorFrame.cols, sensorFrame.rows);
+    cv::Rect crop = request.crop.empty() ? full : (request.crop & full);
+    if (crop.empty()) {
+        crop = full; // 请求区域落在图像外时退回整幅，避免客户端一直收不到图
+    }
+
+    cv::Mat view = sensorFrame(crop);
+    const float downscale = std::max(1.0f, request.downscale);
+    cv::Mat scaled;
+    if (downscale > 1.0f) {
+        const cv::Size dst(std::max(1, cvRound(crop.width / downscale)), std::max(1, cvRound(crop.height / downscale)));
+        cv::resize(view, scaled, dst, 0, 0, cv::INTER_AREA);
+    } else {
+        scaled = view;
+    }
+
+    cv::Mat converted;
+    switch (request.format) {
+    case PixelFormat::Gray8:
+        if (scaled.channels() == 1) {
+            converted = scaled;
+        } else {
+            cv::cvtColor(scaled, converted, scaled.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY);
+        }
+        break;
+    case PixelFormat::Bgr8:
+        if (scaled.channels() == 3) {
+            converted = scaled;
+        } else {
+            cv::cvtColor(scaled, converted, scaled.channels() == 4 ? cv::COLOR_BGRA2BGR : cv::COLOR_GRAY2BGR);
+        }
+        break;
+    case PixelFormat::Jpeg:
+    default:
+        converted = scaled;
+        break;
+    }
+    if (converted.cols > 0xFFFF || converted.rows > 0xFFFF) {
+        return false;
+    }
+
+    payload.clear();
+    if (request.format == PixelFormat::Jpeg) {
+        cv::imencode(".jpg", converted, payload);
+    } else {
+        const size_t rowBytes = converted.cols * converted.elemSize();
+        payload.resize(rowBytes * converted.rows);
+        for (int y = 0; y < converted.rows; ++y) {
+            std::memcpy(payload.data() + y * rowBytes, converted.ptr(y), rowBytes); // 裁剪视图不连续，逐行拷贝
+        }
+    }
+    if (payload.empty()) {
+        return false;
+    }
+
+    desc.format = request.format;
+    desc.streamId = request.streamId;
+    desc.payloadLen = static_cast<uint32_t>(payload.size());
+    desc.width = static_cast<uint16_t>(converted.cols);
+    desc.height = static_cast<uint16_t>(converted.rows);
+    desc.geometry.sensorSize = sensorFrame.size();
+    desc.geometry.crop = crop;
+    desc.geometry.scale = static_cast<float>(crop.width) / static_cast<float>(converted.cols);
+    return true;
+}
+
+int jpegDecodeFlags(int reduction)
+{
+    switch (reduction) {
+    case 2: return cv::IMREAD_REDUCED_COLOR_2;
+    case 4: return cv::IMREAD_REDUCED_COLOR_4;
+    case 8: return cv::IMREAD_REDUCED_COLOR_8;
+    default: return cv::IMREAD_COLOR;
+    }
+}
+
+bool decodeFramePayload(const FrameDescriptor& desc, const uint8_t* data, size_t size,
+                        cv::Mat& dst, int jpegReduction)
+{
+    if (!data || size < desc.payloadLen) {
+        return false;
+    }
+    switch (desc.format) {
+    case PixelFormat::Gray8:
+        if (static_cast<size_t>(desc.width) * desc.height != desc.payloadLen) {
+            return false;
+        }
+        cv::Mat(desc.height, desc.width, CV_8UC1, const_cast<uint8_t*>(data)).copyTo(dst);
+        return true;
+    case PixelFormat::Bgr8:
+        if (static_cast<size_t>(desc.width) * desc.height * 3 != desc.payloadLen) {
+            return false;
+        }
+        cv::Mat(desc.height, desc.width, CV_8UC3, const_cast<uint8_t*>(data)).copyTo(dst);
+        return true;
+    case PixelFormat::Jpeg:
+    default:
+        // 直接包装重组缓冲区，imdecode 内部 create() 在尺寸一致时不会重新分配 dst
+        cv::imdecode(cv::Mat(1, static_cast<int>(desc.payloadLen), CV_8UC1, const_cast<uint8_t*>(data)),
+                     jpegDecodeFlags(jpegReduction), &dst);
+        return !dst.empty();
+    }
+}
+
+bool ChunkAssembler::push(const PacketHeader& header, const uint8_t* chunk, size_t size, std::vector<uint8_t>& payload)
+{
+    if (header.chunkCount == 1) {
+        if (size != header.totalLen) {
+            return false;
+        }
+        payload.assign(chunk, chunk + size);
+        return true;
+    }
+
+    auto it = m_pending.find(header.transferId);
+    if (it == m_pending.end()) {
+        if (m_pending.size() >= kMaxPending) {
+            m_pending.erase(m_pending.begin()); // transferId 单调递增，最早的一组最可能已经丢包
+        }
+        Pending pending;
+        pending.type = header.type;
+        pending.totalLen = header.totalLen;
+        pending.data.resize(header.totalLen);
+        pending.got.assign(header.chunkCount, false);
+        it = m_pending.emplace(header.transferId, std::move(pending)).first;
+    }
+
+    Pending& pending = it->second;
+    if (pending.totalLen != header.totalLen || pending.got.size() != header.chunkCount || pending.type != header.type) {
+        m_pending.erase(it);
+        return false;
+    }
+    const size_t offset = static_cast<size_t>(header.chunkIndex) * kMaxChunkPayload;
+    if (offset + size > pending.data.size() || pending.got[header.chunkIndex]) {
+        return false;
+    }
+    std::memcpy(pending.data.data() + offset, chunk, size);
+    pending.got[header.chunkIndex] = true;
+    if (++pending.received < header.chunkCount) {
+        return false;
+    }
+    payload = std::move(pending.data);
+    m_pending.erase(it);
+    return true;
+}
+
+} // namespace StreamProtocol
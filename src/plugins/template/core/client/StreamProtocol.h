@@ -0,0 +1,162 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "../MatchParams.h"
+
+// 推流服务端 <-> 客户端之间的扩展协议（旧协议：4 字节大端长度包 + 若干 JPEG 分片）。
+// 扩展包统一以 kMagic 开头，旧协议中长度包固定 4 字节，JPEG 分片恰好以魔数+合法版本/类型开头的概率可以忽略。
+// 编解码只依赖 OpenCV 与 MatchParams 定义，不涉及 Qt 网络模块，服务端（matchserver）可直接复用。
+namespace StreamProtocol {
+
+constexpr uint32_t kMagic = 0x48565350; // "HVSP"
+constexpr uint8_t  kVersion = 1;
+constexpr size_t   kHeaderSize = 20;
+constexpr size_t   kMaxChunkPayload = 60000; // 留出 UDP/IP 头余量，单包不超过 64KB
+
+enum class PacketType : uint8_t {
+    ModelUpload   = 1, // 客户端 -> 服务端：模板图像 + 学习参数 + 匹配参数
+    ModelAck      = 2, // 服务端 -> 客户端：模型加载结果
+    MatchResults  = 3, // 服务端 -> 客户端：单帧紧凑匹配结果
+    Thumbnail     = 4, // 服务端 -> 客户端：低频缩略图（JPEG）
+    StopMatchMode = 5, // 客户端 -> 服务端：退出服务端匹配，恢复整帧推流
+    StreamRequest = 6, // 客户端 -> 服务端：协商裁剪区域/降采样/像素格式/帧率
+    FrameHeader   = 7, // 服务端 -> 客户端：协商模式下替代 4 字节长度包，描述随后数据分片的几何信息
+    FrameData     = 8, // 服务端 -> 客户端：协商模式下的帧数据分片，transferId 与所属 FrameHeader 相同
+};
+
+enum class PixelFormat : uint8_t {
+    Jpeg  = 0,
+    Gray8 = 1, // 原始 8 位灰度，行紧密排列
+    Bgr8  = 2, // 原始 BGR，行紧密排列
+};
+
+// 每个扩展包的固定头（大端）：magic | version | type | streamId | transferId | chunkIndex | chunkCount | totalLen
+// streamId 原为保留字段（恒为 0），多路流共用一个端口时按它区分各路的重组状态
+struct PacketHeader {
+    uint8_t    version = kVersion;
+    PacketType type = PacketType::MatchResults;
+    uint16_t   streamId = 0;
+    uint32_t   transferId = 0;
+    uint16_t   chunkIndex = 0;
+    uint16_t   chunkCount = 1;
+    uint32_t   totalLen = 0;
+};
+
+// 服务端匹配模式下的模型上传内容
+struct ModelUpload {
+    cv::Mat         templateImage;      // 已学习模板的 ROI 图像（4 通道时 Alpha 为掩膜）
+    MatchParams     learnParams;
+    FindMatchParams findParams;         // Mask 不参与传输
+    uint16_t        thumbnailInterval = 0; // 每 N 帧附带一张缩略图，0 表示不发送
+    float           thumbnailScale = 0.25f;
+};
+
+// 单帧匹配结果：每条记录 40 字节（中心/角度/缩放/分数/旋转矩形）
+struct ResultFrame {
+    uint32_t frameId = 0;
+    uint64_t captureTimeUs = 0;  // 服务端采集时间戳（服务端时钟）
+    uint32_t serverLatencyUs = 0; // 采集到发送的服务端耗时（含匹配）
+    uint32_t frameBytes = 0;      // 若按整帧 JPEG 推流该帧所需字节数，用于带宽对比
+    std::vector<MatchResult> results;
+};
+
+// 客户端对某一路流的请求，运行时可随时重新下发
+struct StreamRequest {
+    uint16_t    streamId = 0;
+    cv::Rect    crop;               // 传感器坐标下的裁剪区域，空矩形表示整幅
+    float       downscale = 1.0f;   // >= 1，传输图像边长 = 裁剪边长 / downscale
+    PixelFormat format = PixelFormat::Jpeg;
+    float       maxFps = 0.f;       // 0 表示不限帧率
+    bool        singleShot = false; // 只按该请求发送一帧，随后恢复上一次的持续请求（如操作员临时要整帧）
+};
+
+// 传输图像与传感器整幅图像之间的映射：sensor = crop.tl + payload * scale
+struct FrameGeometry {
+    cv::Size sensorSize;
+    cv::Rect crop;       // 传感器坐标下的实际裁剪区域
+    float    scale = 1.0f; // 每个传输像素对应的传感器像素数
+
+    bool isIdentity() const { return scale == 1.0f && crop.x == 0 && crop.y == 0
+                                     && (crop.empty() || crop.size() == sensorSize); }
+    cv::Point2f toSensor(const cv::Point2f& pt) const
+    {
+        return cv::Point2f(crop.x + pt.x * scale, crop.y + pt.y * scale);
+    }
+    cv::Point2f fromSensor(const cv::Point2f& pt) const
+    {
+        return cv::Point2f((pt.x - crop.x) / scale, (pt.y - crop.y) / scale);
+    }
+    // 把在传输图像上得到的匹配结果换算到传感器整幅坐标
+    void mapToSensor(MatchResult& result) const;
+};
+
+// 协商模式下每帧的描述头，随后是同一 transferId 的 FrameData 分片（早期服务端按旧协议发无包头分片，客户端两者都接受）
+struct FrameDescriptor {
+    uint32_t      frameId = 0;
+    uint16_t      streamId = 0;
+    PixelFormat   format = PixelFormat::Jpeg;
+    uint32_t      payloadLen = 0;
+    uint16_t      width = 0;   // 传输图像尺寸（原始格式解包必需）
+    uint16_t      height = 0;
+    uint64_t      captureTimeUs = 0;
+    FrameGeometry geometry;
+};
+
+bool isProtocolPacket(const uint8_t* data, size_t size);
+bool readHeader(const uint8_t* data, size_t size, PacketHeader& header);
+
+// 按 kMaxChunkPayload 切片并加上包头，返回可直接发送的数据报列表
+std::vector<std::vector<uint8_t>> packetize(PacketType type, uint32_t transferId, const std::vector<uint8_t>& payload,
+                                            uint16_t streamId = 0);
+// 协商模式的一帧：FrameHeader 包 + FrameData 分片，包头都带 desc.streamId，可与其他流在同一端口交错发送
+std::vector<std::vector<uint8_t>> packetizeFrame(const FrameDescriptor& desc, uint32_t transferId,
+                                                 const std::vector<uint8_t>& payload);
+
+std::vector<uint8_t> encodeModelUpload(const ModelUpload& upload);
+bool decodeModelUpload(const std::vector<uint8_t>& payload, ModelUpload& upload);
+
+std::vector<uint8_t> encodeResultFrame(const ResultFrame& frame);
+bool decodeResultFrame(const std::vector<uint8_t>& payload, ResultFrame& frame);
+
+std::vector<uint8_t> encodeThumbnail(uint32_t frameId, const cv::Mat& image, float scale);
+bool decodeThumbnail(const std::vector<uint8_t>& payload, uint32_t& frameId, cv::Mat& image);
+
+std::vector<uint8_t> encodeStreamRequest(const StreamRequest& request);
+bool decodeStreamRequest(const std::vector<uint8_t>& payload, StreamRequest& request);
+
+std::vector<uint8_t> encodeFrameDescriptor(const FrameDescriptor& desc);
+bool decodeFrameDescriptor(const std::vector<uint8_t>& payload, FrameDescriptor& desc);
+
+// 按请求把传感器整帧裁剪/降采样/编码为传输负载，并填充描述头（服务端使用）
+bool encodeFramePayload(const cv::Mat& sensorFrame, const StreamRequest& request,
+                        FrameDescriptor& desc, std::vector<uint8_t>& payload);
+// 按描述头把收齐的负载还原为图像（客户端使用）；data 指向 payloadLen 字节。
+// 解码直接写入 dst，dst 尺寸/类型与本帧一致时复用其内存（调用方需保证 dst 未被他处持有）；
+// jpegReduction 为 2/4/8 时 JPEG 在 DCT 域按 1/n 缩小解码（libjpeg scale_denom），原始像素格式忽略该参数
+bool decodeFramePayload(const FrameDescriptor& desc, const uint8_t* data, size_t size,
+                        cv::Mat& dst, int jpegReduction = 1);
+// 1/2/4/8 缩小解码对应的 imdecode 标志，其他值按原尺寸
+int jpegDecodeFlags(int reduction);
+
+// 多分片重组：同一 transferId 收齐全部分片后返回完整负载
+class ChunkAssembler {
+public:
+    // 返回 true 表示该 transferId 已收齐，payload 输出完整内容
+    bool push(const PacketHeader& header, const uint8_t* chunk, size_t size, std::vector<uint8_t>& payload);
+    void clear() { m_pending.clear(); }
+
+private:
+    struct Pending {
+        PacketType type = PacketType::ModelUpload;
+        uint32_t totalLen = 0;
+        uint16_t received = 0;
+        std::vector<uint8_t> data;
+        std::vector<bool> got;
+    };
+    std::map<uint32_t, Pending> m_pending;
+    static constexpr size_t kMaxPending = 8; // 丢包导致的残缺传输最多保留 8 组
+};
+
+} // namespace StreamProtocol
@@ -0,0 +1,70 @@
+#include "StreamStats.h"
+#include <algorithm>
+
+void StreamStatsTracker::reset()
+{
+    const uint16_t streamId = m_snapshot.streamId;
+    *this = StreamStatsTracker(streamId);
+}
+
+void StreamStatsTracker::rollWindow(uint64_t nowUs)
+{
+    if (m_windowStartUs == 0) {
+        m_windowStartUs = nowUs;
+        return;
+    }
+    const uint64_t elapsed = nowUs - m_windowStartUs;
+    if (elapsed < kWindowUs) {
+        return;
+    }
+    // 窗口结束时才更新帧率/码率，数值稳定，便于界面显示
+    const double seconds = static_cast<double>(elapsed) / 1e6;
+    m_snapshot.fps = static_cast<double>(m_windowFrames) / seconds;
+    m_snapshot.bitrateKbps = static_cast<double>(m_windowBytes) * 8.0 / 1000.0 / seconds;
+    m_windowStartUs = nowUs;
+    m_windowFrames = 0;
+    m_windowBytes = 0;
+}
+
+void StreamStatsTracker::onBytes(uint64_t bytes, uint64_t nowUs)
+{
+    rollWindow(nowUs);
+    m_snapshot.bytes += bytes;
+    m_windowBytes += bytes;
+    m_lastActivityUs = nowUs;
+}
+
+void StreamStatsTracker::onDecoded(uint64_t decodeUs, bool ok, uint64_t nowUs)
+{
+    rollWindow(nowUs);
+    ++m_decodeCount;
+    m_decodeUsTotal += decodeUs;
+    m_snapshot.avgDecodeMs = static_cast<double>(m_decodeUsTotal) / 1000.0 / static_cast<double>(m_decodeCount);
+    m_snapshot.maxDecodeMs = std::max(m_snapshot.maxDecodeMs, static_cast<double>(decodeUs) / 1000.0);
+    if (ok) {
+        ++m_snapshot.frames;
+        ++m_windowFrames;
+    } else {
+        ++m_snapshot.decodeErrors;
+    }
+    m_lastActivityUs = nowUs;
+}
+
+void StreamStatsTracker::setQueueDepth(uint32_t depth)
+{
+    m_snapshot.queueDepth = depth;
+    m_snapshot.maxQueueDepth = std::max(m_snapshot.maxQueueDepth, depth);
+}
+
+StreamStatsSnapshot StreamStatsTracker::snapshot(uint64_t nowUs) const
+{
+    StreamStatsSnapshot out = m_snapshot;
+    const uint64_t missed = out.lostFrames + out.droppedFrames;
+    const uint64_t total = m_decodeCount + missed;
+    out.lossRate = total > 0 ? static_cast<double>(missed) / static_cast<double>(total) : 0.0;
+    if (m_lastActivityUs == 0 || nowUs > m_lastActivityUs + 2 * kWindowUs) {
+        out.fps = 0.0; // 流已停止，避免一直显示最后一个窗口的数值
+        out.bitrateKbps = 0.0;
+    }
+    return out;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <cstdint>
+
+// 单路流的运行统计，不依赖 Qt，接收端/服务端/离线工具都可复用
+struct StreamStatsSnapshot {
+    uint16_t streamId = 0;
+    uint64_t frames = 0;          // 已解码成功的帧数
+    uint64_t bytes = 0;           // 累计接收字节（含包头）
+    uint64_t lostFrames = 0;      // 分片未收齐即被下一帧覆盖的帧数
+    uint64_t droppedFrames = 0;   // 解码队列已满被丢弃的帧数
+    uint64_t decodeErrors = 0;    // 收齐但解码失败的帧数
+    double   fps = 0.0;           // 最近统计窗口内的解码帧率
+    double   bitrateKbps = 0.0;   // 最近统计窗口内的接收码率
+    double   lossRate = 0.0;      // (lost + dropped) / 已收齐或丢失的总帧数
+    double   avgDecodeMs = 0.0;
+    double   maxDecodeMs = 0.0;
+    uint32_t queueDepth = 0;      // 当前待解码帧数（含正在解码的一帧）
+    uint32_t maxQueueDepth = 0;
+};
+
+class StreamStatsTracker {
+public:
+    explicit StreamStatsTracker(uint16_t streamId = 0) { m_snapshot.streamId = streamId; }
+
+    void reset();
+    void onBytes(uint64_t bytes, uint64_t nowUs);
+    void onFrameLost() { ++m_snapshot.lostFrames; }
+    void onFrameDropped() { ++m_snapshot.droppedFrames; }
+    void onDecoded(uint64_t decodeUs, bool ok, uint64_t nowUs);
+    void setQueueDepth(uint32_t depth);
+
+    // 取当前统计；窗口内没有新数据超过一个窗口长度时帧率/码率按 0 计
+    StreamStatsSnapshot snapshot(uint64_t nowUs) const;
+
+    static constexpr uint64_t kWindowUs = 1000000; // 帧率/码率统计窗口 1 秒
+
+private:
+    void rollWindow(uint64_t nowUs);
+
+    StreamStatsSnapshot m_snapshot;
+    uint64_t m_decodeUsTotal = 0;
+    uint64_t m_decodeCount = 0;   // 含解码失败
+    uint64_t m_windowStartUs = 0;
+    uint64_t m_windowFrames = 0;
+    uint64_t m_windowBytes = 0;
+    uint64_t m_lastActivityUs = 0;
+};
@@ -1,17 +1,22 @@
 ﻿#include "UDPMatReceiver.h"
 #include <QDebug>
+#include <QtConcurrent/QtConcurrent>
+#include <algorithm>
+#include <chrono>
+
+namespace {
+
+uint64_t steadyNowUs() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
 
 UDPMatReceiver::UDPMatReceiver(QObject* parent)
-    : QObject(parent) {
+    : IFrameReceiver(parent) {
     reconnectTimer.setInterval(1000);
     reconnectTimer.setSingleShot(false);
-
-    connect(&sock, &QUdpSocket::readyRead, this, &UDPMatReceiver::onReadyRead);
-
-    connect(&sock,
-            QOverload<QAbstractSocket::SocketError>::of(&QUdpSocket::error),
-            this,
-            &UDPMatReceiver::onError);
     connect(&reconnectTimer, &QTimer::timeout, this, &UDPMatReceiver::tryConnect);
 }
 
@@ -20,17 +25,14 @@ UDPMatReceiver::~UDPMatReceiver() {
 }
 
 void UDPMatReceiver::registerMetaTypes() {
-    qRegisterMetaType<cv::Mat>("cv::Mat");
+    IFrameReceiver::registerMetaTypes();
+    qRegisterMetaType<MatchResults>("MatchResults");
 }
 
 bool UDPMatReceiver::start(const QString& host, quint16 port) {
     stop(); // 先清理旧状态
-    targetHost = host;
-    targetPort = port;
-    waitingFirstFrame = true;
-    expectedFrameLen = 0;
-    buffer.clear();
-    lastFrameTimer.invalidate();
+    traffic = TrafficStats();
+    addSource(host, port, 0);
     tryConnect();
     if (!reconnectTimer.isActive()) {
         reconnectTimer.start();
@@ -39,115 +41,606 @@ bool UDPMatReceiver::start(const QString& host, quint16 port) {
     return false;
 }
 
+int UDPMatReceiver::addSource(const QString& host, quint16 port, quint16 legacyStreamId) {
+    const int index = static_cast<int>(sources.size());
+    auto source = std::make_unique<Source>();
+    source->sock = std::make_unique<QUdpSocket>();
+    source->host = host;
+    source->port = port;
+    source->legacyStreamId = legacyStreamId;
+    QUdpSocket* sock = source->sock.get();
+    connect(sock, &QUdpSocket::readyRead, this, [this, index]() { onReadyRead(index); });
+    connect(sock, QOverload<QAbstractSocket::SocketError>::of(&QUdpSocket::error), this,
+            [this, index](QAbstractSocket::SocketError) { onError(index); });
+    sources.push_back(std::move(source));
+    stream(legacyStreamId, index);
+    if (reconnectTimer.isActive()) {
+        tryConnect(); // start() 之后追加的数据源立即握手
+    }
+    return index;
+}
+
 void UDPMatReceiver::stop() {
     reconnectTimer.stop();
-    sock.close();
-    buffer.clear();
-    expectedFrameLen = 0;
-    waitingFirstFrame = true;
-    lastFrameTimer.invalidate();
+    for (auto& source : sources) {
+        source->sock->close();
+    }
+    sources.clear();
+    streams.clear();
+    ++epoch;
+    pendingResultBytes = 0;
+    if (serverMatchActive) {
+        serverMatchActive = false;
+        emit serverMatchModeChanged(false);
+    }
 }
 
-void UDPMatReceiver::tryConnect() {
-    // UDP 端不需要真正“连接”，但需要先绑定本地端口并主动发送握手包让服务器记录地址
-    if (sock.state() != QAbstractSocket::BoundState) {
-        // 增大接收缓冲区到 20MB (默认可能只有 64KB)，解决高清图传输丢包导致的卡顿/花屏
-        sock.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 20 * 1024 * 1024);
+UDPMatReceiver::StreamState& UDPMatReceiver::stream(quint16 streamId, int sourceIndex) {
+    auto it = streams.find(streamId);
+    if (it == streams.end()) {
+        it = streams.emplace(streamId, StreamState()).first;
+        it->second.id = streamId;
+        it->second.stats = StreamStatsTracker(streamId);
+        auto reduction = decodeReductions.find(streamId);
+        it->second.jpegReduction = reduction != decodeReductions.end() ? reduction->second : 1;
+    }
+    it->second.sourceIndex = sourceIndex;
+    return it->second;
+}
 
-        if (!sock.bind(QHostAddress::AnyIPv4, 0, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
-            emit statusText(QStringLiteral("udp bind 失败: %1").arg(sock.errorString()));
-            return;
-        }
+void UDPMatReceiver::setStreamDecodeReduction(quint16 streamId, int reduction) {
+    const int valid = (reduction == 2 || reduction == 4 || reduction == 8) ? reduction : 1;
+    decodeReductions[streamId] = valid;
+    auto it = streams.find(streamId);
+    if (it != streams.end()) {
+        it->second.jpegReduction = valid;
     }
+}
 
-    // 仅在还未收到第一帧，或长时间未收帧时重发握手，避免频繁打扰服务器
-    bool shouldHandshake = waitingFirstFrame;
-    if (!waitingFirstFrame && (!lastFrameTimer.isValid() || lastFrameTimer.elapsed() > 2000)) {
-        shouldHandshake = true;
+std::vector<StreamStatsSnapshot> UDPMatReceiver::streamStats() const {
+    std::vector<StreamStatsSnapshot> out;
+    out.reserve(streams.size());
+    const uint64_t now = steadyNowUs();
+    for (const auto& kv : streams) {
+        out.push_back(kv.second.stats.snapshot(now));
     }
+    return out;
+}
 
-    if (!shouldHandshake) {
-        return;
+bool UDPMatReceiver::streamStats(quint16 streamId, StreamStatsSnapshot& stats) const {
+    auto it = streams.find(streamId);
+    if (it == streams.end()) {
+        return false;
     }
+    stats = it->second.stats.snapshot(steadyNowUs());
+    return true;
+}
+
+void UDPMatReceiver::tryConnect() {
+    for (int index = 0; index < static_cast<int>(sources.size()); ++index) {
+        Source& source = *sources[static_cast<size_t>(index)];
+        QUdpSocket& sock = *source.sock;
+        // UDP 端不需要真正“连接”，但需要先绑定本地端口并主动发送握手包让服务器记录地址
+        if (sock.state() != QAbstractSocket::BoundState) {
+            // 增大接收缓冲区到 20MB (默认可能只有 64KB)，解决高清图传输丢包导致的卡顿/花屏
+            sock.setSocketOption(QAbstractSocket::ReceiveBufferSizeSocketOption, 20 * 1024 * 1024);
+
+            if (!sock.bind(QHostAddress::AnyIPv4, 0, QUdpSocket::ShareAddress | QUdpSocket::ReuseAddressHint)) {
+                emit statusText(QStringLiteral("udp bind 失败: %1").arg(sock.errorString()));
+                continue;
+            }
+        }
 
-    QByteArray hello(1, '\0'); // 任意内容，服务器只需知道客户端地址/端口
-    qint64 sent = sock.writeDatagram(hello, QHostAddress(targetHost), targetPort);
-    if (sent < 0) {
-        emit statusText(QStringLiteral("握手包发送失败: %1").arg(sock.errorString()));
-    } else {
-        emit statusText(QStringLiteral("已发送 UDP 连接到 %1:%2").arg(targetHost).arg(targetPort));
+        // 仅在还未收到第一帧，或长时间未收帧时重发握手，避免频繁打扰服务器
+        bool shouldHandshake = source.waitingFirstFrame;
+        if (!source.waitingFirstFrame && (!source.lastFrameTimer.isValid() || source.lastFrameTimer.elapsed() > 2000)) {
+            shouldHandshake = true;
+        }
+
+        if (!shouldHandshake) {
+            continue;
+        }
+
+        QByteArray hello(1, '\0'); // 任意内容，服务器只需知道客户端地址/端口
+        qint64 sent = sock.writeDatagram(hello, QHostAddress(source.host), source.port);
+        if (sent < 0) {
+            emit statusText(QStringLiteral("握手包发送失败: %1").arg(sock.errorString()));
+            continue;
+        }
+        emit statusText(QStringLiteral("已发送 UDP 连接到 %1:%2").arg(source.host).arg(source.port));
+        // 服务端可能已重启并丢失协商状态，握手后重发该数据源上各路流的当前请求
+        for (const auto& kv : streamRequests) {
+            if (kv.second.sourceIndex == index) {
+                sendPayload(StreamProtocol::PacketType::StreamRequest,
+                            StreamProtocol::encodeStreamRequest(kv.second.request), index);
+            }
+        }
     }
 }
 
-void UDPMatReceiver::onError(QAbstractSocket::SocketError) {
-    emit statusText(QStringLiteral("socket error: %1").arg(sock.errorString()));
+void UDPMatReceiver::onError(int sourceIndex) {
+    if (sourceIndex < static_cast<int>(sources.size())) {
+        emit statusText(QStringLiteral("socket error: %1").arg(sources[static_cast<size_t>(sourceIndex)]->sock->errorString()));
+    }
 }
 
-void UDPMatReceiver::onReadyRead() {
+void UDPMatReceiver::onReadyRead(int sourceIndex) {
+    if (sourceIndex >= static_cast<int>(sources.size())) {
+        return;
+    }
+    Source& source = *sources[static_cast<size_t>(sourceIndex)];
+    QUdpSocket& sock = *source.sock;
     while (sock.hasPendingDatagrams()) {
-        QByteArray datagram;
-        datagram.resize(static_cast<int>(sock.pendingDatagramSize()));
-        QHostAddress sender;
-        quint16 senderPort = 0;
-        qint64 read = sock.readDatagram(datagram.data(), datagram.size(), &sender, &senderPort);
+        const qint64 pendingSize = std::max<qint64>(0, sock.pendingDatagramSize());
+
+        // 正在按顺序拼接无包头分片时直接读入重组缓冲区尾部，省去中间缓冲及其拷贝；
+        // 读入的若是扩展包则 filled 不前移，等同于未写入
+        StreamState* rawTarget = nullptr;
+        if (source.rawStreamId >= 0) {
+            auto it = streams.find(static_cast<quint16>(source.rawStreamId));
+            if (it != streams.end() && it->second.assembling) {
+                rawTarget = &it->second;
+            } else {
+                source.rawStreamId = -1;
+            }
+        }
+        const bool direct = rawTarget && pendingSize > 4
+                            && rawTarget->filled + static_cast<size_t>(pendingSize) <= rawTarget->expectedLen;
+        char* target = nullptr;
+        if (direct) {
+            target = reinterpret_cast<char*>(rawTarget->data->data() + rawTarget->filled);
+        } else {
+            if (scratch.size() < pendingSize) {
+                scratch.resize(static_cast<int>(pendingSize)); // 只增不减，避免每个数据报重新分配
+            }
+            target = scratch.data();
+        }
+        qint64 read = sock.readDatagram(target, pendingSize);
         
         if (read <= 0) continue;
+        const auto* bytes = reinterpret_cast<const uint8_t*>(target);
+
+        // 0. 扩展协议包（服务端匹配结果/缩略图/应答/协商帧分片）以魔数开头，单独处理
+        if (read >= static_cast<qint64>(StreamProtocol::kHeaderSize)
+            && StreamProtocol::isProtocolPacket(bytes, static_cast<size_t>(read))) {
+            source.lastFrameTimer.restart();
+            handleProtocolPacket(sourceIndex, bytes, static_cast<size_t>(read));
+            continue;
+        }
 
         // 1. 尝试识别帧头（长度包）
         // 服务器发送的长度包固定为 4 字节
-        bool isHeader = false;
         if (read == 4) {
             quint32 beLen = 0;
-            memcpy(&beLen, datagram.constData(), 4);
+            memcpy(&beLen, bytes, 4);
             quint32 len = qFromBigEndian(beLen);
 
             // 简单的合理性校验 (例如 1KB ~ 50MB)
             // 这是一个启发式判断：如果收到的 4 字节解析出来像是一个合理的帧长度，
             // 我们就认为它是新的一帧的开始。
             if (len > 1024 && len < 50 * 1024 * 1024) {
-                isHeader = true;
+                // 开始新的一帧（旧协议整帧归属该数据源的默认流）
+                StreamState& state = stream(source.legacyStreamId, sourceIndex);
+                beginFrame(state, len, false);
+                state.frameBytes += 4;
+                state.stats.onBytes(4, steadyNowUs());
+                source.rawStreamId = state.id;
                 
-                // 开始新的一帧
-                expectedFrameLen = len;
-                buffer.clear();
-                buffer.reserve(static_cast<int>(len));
-                
-                if (waitingFirstFrame) {
-                    waitingFirstFrame = false;
+                if (source.waitingFirstFrame) {
+                    source.waitingFirstFrame = false;
                     emit statusText(QStringLiteral("收到首帧，长度: %1").arg(len));
                 }
-                lastFrameTimer.restart();
+                source.lastFrameTimer.restart();
+                continue;
             }
         }
 
-        // 2. 如果不是帧头，且我们正在等待数据，则追加
-        if (!isHeader && expectedFrameLen > 0) {
-            buffer.append(datagram);
+        // 2. 如果不是帧头，且我们正在等待数据，则按顺序追加到当前流
+        if (!rawTarget) {
+            continue;
+        }
+        StreamState& state = *rawTarget;
+        state.frameBytes += static_cast<quint64>(read);
+        state.stats.onBytes(static_cast<uint64_t>(read), steadyNowUs());
+        if (direct) {
+            state.filled += static_cast<size_t>(read);
+            traffic.directReadBytes += static_cast<quint64>(read);
+        } else {
+            // 注意：UDP 乱序或逻辑重叠时数据可能超过帧长，超出部分丢弃，解码只读取需要的部分
+            const size_t copy = std::min(static_cast<size_t>(read), state.expectedLen - state.filled);
+            memcpy(state.data->data() + state.filled, bytes, copy);
+            state.filled += copy;
+        }
 
-            // 3. 检查是否收满
-            if (buffer.size() >= static_cast<int>(expectedFrameLen)) {
-                // 尝试解码
-                // 注意：buffer 可能比 expectedFrameLen 大（如果 UDP 乱序或逻辑重叠），
-                // 但 imdecode 只会读取它需要的部分。
-                
-                cv::Mat frame = cv::imdecode(
-                    std::vector<uchar>(buffer.begin(), buffer.begin() + expectedFrameLen), 
-                    cv::IMREAD_COLOR
-                );
-
-                if (!frame.empty()) {
-                    emit frameReady(frame);
-                    lastFrameTimer.restart();
-                } 
-                
-                // 重置，等待下一帧头
-                expectedFrameLen = 0;
-                buffer.clear();
+        // 3. 检查是否收满
+        if (state.filled >= state.expectedLen) {
+            source.rawStreamId = -1;
+            completeFrame(state);
+        }
+    }
+}
+
+void UDPMatReceiver::beginFrame(StreamState& state, quint32 length, bool negotiated) {
+    if (state.assembling) {
+        state.stats.onFrameLost(); // 上一帧分片未收齐就来了新帧头
+    }
+    if (!state.data) {
+        if (!state.freeBuffers.empty()) {
+            state.data = std::move(state.freeBuffers.back());
+            state.freeBuffers.pop_back();
+        } else {
+            state.data = std::make_shared<std::vector<uint8_t>>();
+        }
+    }
+    if (state.data->size() < length) {
+        state.data->resize(length); // 只增不减，帧长稳定后不再分配
+    }
+    state.assembling = true;
+    state.negotiated = negotiated;
+    state.expectedLen = length;
+    state.filled = 0;
+    state.frameBytes = 0;
+    const size_t chunkCount = (length + StreamProtocol::kMaxChunkPayload - 1) / StreamProtocol::kMaxChunkPayload;
+    state.gotChunk.assign(chunkCount, false);
+    state.frameStartTimer.restart();
+}
+
+void UDPMatReceiver::recycleBuffer(StreamState& state, Buffer buffer) {
+    if (buffer && state.freeBuffers.size() <= kMaxDecodeQueue) {
+        state.freeBuffers.push_back(std::move(buffer));
+    }
+}
+
+void UDPMatReceiver::completeFrame(StreamState& state) {
+    state.assembling = false;
+    if (state.queue.size() >= kMaxDecodeQueue) {
+        // 解码跟不上接收时丢弃最旧的帧，保证显示的是最新画面
+        recycleBuffer(state, std::move(state.queue.front().data));
+        state.queue.pop_front();
+        state.stats.onFrameDropped();
+    }
+    StreamState::Pending pending;
+    pending.negotiated = state.negotiated;
+    pending.desc = state.desc;
+    pending.data = std::move(state.data); // 缓冲区随帧移交解码任务，下一帧从空闲缓冲中取
+    pending.length = state.expectedLen;
+    pending.receiveUs = static_cast<quint64>(state.frameStartTimer.nsecsElapsed() / 1000);
+    pending.bytes = state.frameBytes;
+    state.queue.push_back(std::move(pending));
+    state.stats.setQueueDepth(static_cast<uint32_t>(state.queue.size() + (state.decoding ? 1 : 0)));
+    if (!state.decoding) {
+        startDecode(state);
+    }
+}
+
+void UDPMatReceiver::startDecode(StreamState& state) {
+    if (state.queue.empty()) {
+        return;
+    }
+    // 每路流同时只有一帧在线程池中解码，保证同一路流的出帧顺序；各路流之间并行
+    auto pending = std::make_shared<StreamState::Pending>(std::move(state.queue.front()));
+    state.queue.pop_front();
+    state.decoding = true;
+    state.stats.setQueueDepth(static_cast<uint32_t>(state.queue.size() + 1));
+
+    // 选一块使用方已不再持有的输出图像，解码直接覆盖其内存（尺寸一致时无堆分配）
+    int poolIndex = -1;
+    for (size_t i = 0; i < state.outputPool.size(); ++i) {
+        const cv::Mat& candidate = state.outputPool[i];
+        if (!candidate.u || candidate.u->refcount == 1) {
+            poolIndex = static_cast<int>(i);
+            break;
+        }
+    }
+    if (poolIndex < 0 && state.outputPool.size() < kOutputPoolSize) {
+        state.outputPool.emplace_back();
+        poolIndex = static_cast<int>(state.outputPool.size()) - 1;
+    }
+    cv::Mat output = poolIndex >= 0 ? state.outputPool[static_cast<size_t>(poolIndex)] : cv::Mat();
+    const int reduction = state.jpegReduction;
+
+    auto* watcher = new QFutureWatcher<DecodedFrame>(this);
+    const quint16 streamId = state.id;
+    const quint32 currentEpoch = epoch;
+    connect(watcher, &QFutureWatcher<DecodedFrame>::finished, this, [this, streamId, currentEpoch, watcher]() {
+        onFrameDecoded(streamId, currentEpoch, watcher);
+    });
+    // 任务只持有帧数据与输出图像的引用，不访问接收器成员，接收器先于任务析构也安全
+    watcher->setFuture(QtConcurrent::run([pending, output, poolIndex, reduction]() mutable {
+        DecodedFrame out;
+        QElapsedTimer decodeTimer;
+        decodeTimer.start();
+        const uchar* previous = output.data;
+        const uint8_t* data = pending->data->data();
+        if (pending->negotiated) {
+            StreamProtocol::decodeFramePayload(pending->desc, data, pending->length, output, reduction);
+            out.geometry = pending->desc.geometry;
+            if (pending->desc.format == StreamProtocol::PixelFormat::Jpeg && reduction > 1
+                && !output.empty() && pending->desc.width > 0) {
+                // DCT 域缩小后每个像素对应更多传感器像素
+                out.geometry.scale *= static_cast<float>(pending->desc.width) / static_cast<float>(output.cols);
             }
+        } else {
+            cv::imdecode(cv::Mat(1, static_cast<int>(pending->length), CV_8UC1, const_cast<uint8_t*>(data)),
+                         StreamProtocol::jpegDecodeFlags(reduction), &output);
+            out.geometry.sensorSize = cv::Size(output.cols * reduction, output.rows * reduction);
+            out.geometry.crop = cv::Rect(cv::Point(0, 0), out.geometry.sensorSize);
+            out.geometry.scale = static_cast<float>(reduction);
         }
+        out.decodeUs = static_cast<quint64>(decodeTimer.nsecsElapsed() / 1000);
+        out.reused = previous && output.data == previous;
+        out.frame = output;
+        out.receiveUs = pending->receiveUs;
+        out.bytes = pending->bytes;
+        out.buffer = std::move(pending->data);
+        out.poolIndex = poolIndex;
+        return out;
+    }));
+}
+
+void UDPMatReceiver::onFrameDecoded(quint16 streamId, quint32 decodeEpoch, QFutureWatcher<DecodedFrame>* watcher) {
+    DecodedFrame decoded = watcher->result();
+    watcher->deleteLater();
+    auto it = streams.find(streamId);
+    if (decodeEpoch != epoch || it == streams.end()) {
+        return; // 停止/重启前发起的解码
     }
+    StreamState& state = it->second;
+    state.decoding = false;
+    recycleBuffer(state, std::move(decoded.buffer));
+    if (decoded.poolIndex >= 0 && decoded.poolIndex < static_cast<int>(state.outputPool.size())) {
+        state.outputPool[static_cast<size_t>(decoded.poolIndex)] = decoded.frame; // 尺寸变化重新分配时更新池
+    }
+    const bool ok = !decoded.frame.empty();
+    state.stats.onDecoded(decoded.decodeUs, ok, steadyNowUs());
+    state.stats.setQueueDepth(static_cast<uint32_t>(state.queue.size()));
+
+    if (ok) {
+        traffic.frames++;
+        traffic.frameBytes += decoded.bytes;
+        traffic.frameDecodeUs += decoded.decodeUs;
+        traffic.frameReceiveUs += decoded.receiveUs;
+        traffic.reusedOutputs += decoded.reused ? 1 : 0;
+        emit streamFrameReady(streamId, decoded.frame, decoded.geometry);
+        if (streamId == primaryStreamId) {
+            geometry = decoded.geometry;
+            emit frameReady(decoded.frame);
+            emit frameReadyWithGeometry(decoded.frame, decoded.geometry);
+        }
+        if (traffic.frames % 100 == 0) {
+            reportTraffic();
+        }
+    }
+    decoded.frame.release();
+    startDecode(state);
 }
 
-bool UDPMatReceiver::processBuffer() {
-    return false; 
+bool UDPMatReceiver::sendPayload(StreamProtocol::PacketType type, const std::vector<uint8_t>& payload, int sourceIndex) {
+    if (sourceIndex < 0 || sourceIndex >= static_cast<int>(sources.size())
+        || sources[static_cast<size_t>(sourceIndex)]->sock->state() != QAbstractSocket::BoundState) {
+        emit statusText(QStringLiteral("扩展协议发送失败：socket 未绑定"));
+        return false;
+    }
+    Source& source = *sources[static_cast<size_t>(sourceIndex)];
+    const auto packets = StreamProtocol::packetize(type, nextTransferId++, payload);
+    if (packets.empty()) {
+        return false;
+    }
+    for (const auto& packet : packets) {
+        const qint64 sent = source.sock->writeDatagram(reinterpret_cast<const char*>(packet.data()),
+                                                       static_cast<qint64>(packet.size()),
+                                                       QHostAddress(source.host), source.port);
+        if (sent < 0) {
+            emit statusText(QStringLiteral("扩展协议发送失败: %1").arg(source.sock->errorString()));
+            return false;
+        }
+    }
+    return true;
+}
+
+bool UDPMatReceiver::uploadMatchModel(const cv::Mat& templateImage, const MatchParams& learnParams,
+                                      const FindMatchParams& findParams, quint16 thumbnailInterval,
+                                      float thumbnailScale) {
+    if (templateImage.empty()) {
+        emit statusText(QStringLiteral("模板为空，无法启用服务端匹配"));
+        return false;
+    }
+    StreamProtocol::ModelUpload upload;
+    upload.templateImage = templateImage;
+    upload.learnParams = learnParams;
+    upload.findParams = findParams;
+    upload.findParams.Mask.release(); // 掩膜与整帧尺寸绑定，不随模型上传
+    upload.thumbnailInterval = thumbnailInterval;
+    upload.thumbnailScale = thumbnailScale;
+    const std::vector<uint8_t> payload = StreamProtocol::encodeModelUpload(upload);
+    if (!sendPayload(StreamProtocol::PacketType::ModelUpload, payload)) {
+        return false;
+    }
+    emit statusText(QStringLiteral("已上传匹配模型 %1 字节，等待服务端确认").arg(payload.size()));
+    return true;
+}
+
+void UDPMatReceiver::stopServerMatching() {
+    sendPayload(StreamProtocol::PacketType::StopMatchMode, std::vector<uint8_t>{0});
+    if (serverMatchActive) {
+        serverMatchActive = false;
+        emit serverMatchModeChanged(false);
+    }
+}
+
+bool UDPMatReceiver::requestStream(const StreamProtocol::StreamRequest& request, int sourceIndex) {
+    StreamProtocol::StreamRequest sanitized = request;
+    sanitized.downscale = std::max(1.0f, request.downscale);
+    sanitized.maxFps = std::max(0.f, request.maxFps);
+    if (sourceIndex < 0) {
+        auto known = streams.find(request.streamId);
+        auto persisted = streamRequests.find(request.streamId);
+        sourceIndex = known != streams.end() ? known->second.sourceIndex
+                    : persisted != streamRequests.end() ? persisted->second.sourceIndex : 0;
+    }
+    if (!sanitized.singleShot) {
+        streamRequests[sanitized.streamId] = PersistentRequest{sourceIndex, sanitized};
+    }
+    if (!sendPayload(StreamProtocol::PacketType::StreamRequest, StreamProtocol::encodeStreamRequest(sanitized),
+                     sourceIndex)) {
+        return false;
+    }
+    emit statusText(QStringLiteral("已请求流 %1：裁剪 %2,%3 %4x%5，降采样 1/%6，格式 %7，帧率 %8%9")
+                        .arg(sanitized.streamId)
+                        .arg(sanitized.crop.x).arg(sanitized.crop.y)
+                        .arg(sanitized.crop.width).arg(sanitized.crop.height)
+                        .arg(sanitized.downscale, 0, 'f', 2)
+                        .arg(static_cast<int>(sanitized.format))
+                        .arg(sanitized.maxFps, 0, 'f', 1)
+                        .arg(sanitized.singleShot ? QStringLiteral("（单帧）") : QString()));
+    return true;
+}
+
+bool UDPMatReceiver::requestFullFrame(int streamId) {
+    StreamProtocol::StreamRequest request;
+    request.streamId = streamId < 0 ? primaryStreamId : static_cast<quint16>(streamId);
+    request.singleShot = true;
+    return requestStream(request);
+}
+
+void UDPMatReceiver::handleProtocolPacket(int sourceIndex, const uint8_t* data, size_t size) {
+    Source& source = *sources[static_cast<size_t>(sourceIndex)];
+    StreamProtocol::PacketHeader header;
+    if (!StreamProtocol::readHeader(data, size, header)) {
+        return;
+    }
+    if (header.type == StreamProtocol::PacketType::MatchResults) {
+        pendingResultBytes += size;
+    }
+    if (header.type == StreamProtocol::PacketType::FrameHeader) {
+        // 协商模式的帧头：随后是同一 transferId 的 FrameData 分片（早期服务端为无包头分片，按顺序拼接）
+        std::vector<uint8_t> payload(data + StreamProtocol::kHeaderSize, data + size);
+        StreamProtocol::FrameDescriptor desc;
+        if (!StreamProtocol::decodeFrameDescriptor(payload, desc)) {
+            return;
+        }
+        StreamState& state = stream(desc.streamId, sourceIndex);
+        beginFrame(state, desc.payloadLen, true);
+        state.desc = desc;
+        state.transferId = header.transferId;
+        state.frameBytes += size;
+        state.stats.onBytes(size, steadyNowUs());
+        source.rawStreamId = state.id;
+        if (source.waitingFirstFrame) {
+            source.waitingFirstFrame = false;
+            emit statusText(QStringLiteral("收到首帧（协商模式，流 %1），长度: %2").arg(desc.streamId).arg(desc.payloadLen));
+        }
+        return;
+    }
+    if (header.type == StreamProtocol::PacketType::FrameData) {
+        auto it = streams.find(header.streamId);
+        if (it == streams.end() || !it->second.assembling || it->second.transferId != header.transferId
+            || !it->second.negotiated) {
+            return; // 帧头丢失或属于已被覆盖的旧帧
+        }
+        StreamState& state = it->second;
+        const size_t chunkSize = size - StreamProtocol::kHeaderSize;
+        const size_t offset = static_cast<size_t>(header.chunkIndex) * StreamProtocol::kMaxChunkPayload;
+        if (header.chunkIndex >= state.gotChunk.size() || offset + chunkSize > state.expectedLen
+            || state.gotChunk[header.chunkIndex]) {
+            return;
+        }
+        source.rawStreamId = -1; // 新服务端的分片都带包头
+        // 数据报可能是直接读进本缓冲区尾部的，源与目标可能重叠
+        memmove(state.data->data() + offset, data + StreamProtocol::kHeaderSize, chunkSize);
+        state.gotChunk[header.chunkIndex] = true;
+        state.filled += chunkSize;
+        state.frameBytes += size;
+        state.stats.onBytes(size, steadyNowUs());
+        if (state.filled >= state.expectedLen) {
+            completeFrame(state);
+        }
+        return;
+    }
+
+    std::vector<uint8_t> payload;
+    if (!source.assembler.push(header, data + StreamProtocol::kHeaderSize, size - StreamProtocol::kHeaderSize, payload)) {
+        return; // 分片未收齐
+    }
+
+    switch (header.type) {
+    case StreamProtocol::PacketType::ModelAck: {
+        const bool ok = !payload.empty() && payload[0] != 0;
+        if (ok != serverMatchActive) {
+            serverMatchActive = ok;
+            emit serverMatchModeChanged(ok);
+        }
+        emit statusText(ok ? QStringLiteral("服务端匹配模式已启用")
+                           : QStringLiteral("服务端模型加载失败，继续整帧推流"));
+        break;
+    }
+    case StreamProtocol::PacketType::MatchResults: {
+        StreamProtocol::ResultFrame frame;
+        const quint64 bytes = pendingResultBytes;
+        pendingResultBytes = 0;
+        if (!StreamProtocol::decodeResultFrame(payload, frame)) {
+            break;
+        }
+        traffic.resultFrames++;
+        traffic.resultBytes += bytes;
+        traffic.serverLatencyUs += frame.serverLatencyUs;
+        traffic.equivalentFrameBytes += frame.frameBytes;
+
+        MatchResults results;
+        results.results.reserve(static_cast<int>(frame.results.size()));
+        for (const auto& res : frame.results) {
+            results.results.append(res);
+        }
+        emit matchResultsReady(results, frame.frameId);
+        if (traffic.resultFrames % 100 == 0) {
+            reportTraffic();
+        }
+        break;
+    }
+    case StreamProtocol::PacketType::Thumbnail: {
+        uint32_t frameId = 0;
+        cv::Mat thumbnail;
+        if (StreamProtocol::decodeThumbnail(payload, frameId, thumbnail)) {
+            emit thumbnailReady(thumbnail, frameId);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void UDPMatReceiver::reportTraffic() {
+    if (traffic.frames > 0) {
+        emit statusText(QStringLiteral("整帧推流：%1 帧，平均 %2 KB/帧，接收+解码 %3 ms（解码 %4 ms）")
+                            .arg(traffic.frames)
+                            .arg(traffic.frameBytes / 1024.0 / traffic.frames, 0, 'f', 1)
+                            .arg(traffic.frameReceiveUs / 1000.0 / traffic.frames, 0, 'f', 2)
+                            .arg(traffic.frameDecodeUs / 1000.0 / traffic.frames, 0, 'f', 2));
+        // 零拷贝路径的收益：免去的中间拷贝字节与免去堆分配的帧占比
+        emit statusText(QStringLiteral("整帧推流：直接读入重组缓冲 %1 KB/帧，输出复用 %2%")
+                            .arg(traffic.directReadBytes / 1024.0 / traffic.frames, 0, 'f', 1)
+                            .arg(100.0 * traffic.reusedOutputs / traffic.frames, 0, 'f', 1));
+    }
+    if (traffic.resultFrames > 0) {
+        emit statusText(QStringLiteral("服务端匹配：%1 帧，平均 %2 B/帧（等效整帧 %3 KB），服务端采集到发送 %4 ms")
+                            .arg(traffic.resultFrames)
+                            .arg(static_cast<double>(traffic.resultBytes) / traffic.resultFrames, 0, 'f', 0)
+                            .arg(traffic.equivalentFrameBytes / 1024.0 / traffic.resultFrames, 0, 'f', 1)
+                            .arg(traffic.serverLatencyUs / 1000.0 / traffic.resultFrames, 0, 'f', 2));
+    }
+    if (streams.size() > 1) {
+        for (const StreamStatsSnapshot& st : streamStats()) {
+            emit statusText(QStringLiteral("流 %1：%2 fps，%3 kbps，丢帧 %4%（未收齐 %5 / 队列溢出 %6），解码 %7 ms，队列 %8/%9")
+                                .arg(st.streamId)
+                                .arg(st.fps, 0, 'f', 1)
+                                .arg(st.bitrateKbps, 0, 'f', 0)
+                                .arg(st.lossRate * 100.0, 0, 'f', 1)
+                                .arg(st.lostFrames)
+                                .arg(st.droppedFrames)
+                                .arg(st.avgDecodeMs, 0, 'f', 2)
+                                .arg(st.queueDepth)
+                                .arg(st.maxQueueDepth));
+        }
+    }
 }
@@ -7,12 +7,20 @@
 #include <QString>
 #include <QElapsedTimer>
 #include <QHostAddress>
+#include <QFutureWatcher>
 #include <opencv2/opencv.hpp>
+#include <deque>
+#include <map>
+#include <memory>
 #include <vector>
+#include "StreamProtocol.h"
+#include "StreamStats.h"
+#include "IFrameReceiver.h"
 
-Q_DECLARE_METATYPE(cv::Mat)
-
-class UDPMatReceiver : public QObject {
+// 支持多路并发流：每个服务端地址/端口为一个数据源（各自一个 socket），
+// 同一数据源上的多路流按扩展协议包头中的 streamId 区分；旧协议整帧推流按数据源的默认流编号归类。
+// 每路流有独立的分片重组状态、解码队列与统计，frameReady/frameReadyWithGeometry 只对主流发出。
+class UDPMatReceiver : public IFrameReceiver {
     Q_OBJECT
 
 public:
@@ -21,32 +29,151 @@ public:
 
     static void registerMetaTypes();
 
+    // 追加一个数据源，返回数据源序号；legacyStreamId 为该数据源旧协议整帧归属的流编号。
+    // start() 会清空数据源并以 (host, port, 流 0) 作为第 0 个数据源，追加数据源需在 start() 之后调用。
+    int addSource(const QString& host, quint16 port, quint16 legacyStreamId);
+    // 主流：frameReady/frameReadyWithGeometry 与 lastGeometry() 对应的流，默认 0
+    void setPrimaryStream(quint16 streamId) { primaryStreamId = streamId; }
+    quint16 primaryStream() const { return primaryStreamId; }
+
+    // 预览流的 JPEG 缩小解码（1/2/4/8，DCT 域缩放），坐标映射随之调整；1 表示原尺寸
+    void setStreamDecodeReduction(quint16 streamId, int reduction);
+
+    // 各路流的统计（Qt 无关类型，可直接交给日志/诊断工具）
+    std::vector<StreamStatsSnapshot> streamStats() const;
+    bool streamStats(quint16 streamId, StreamStatsSnapshot& stats) const;
+
+    static constexpr size_t kMaxDecodeQueue = 2; // 每路流最多积压的待解码帧，超出时丢弃最旧一帧
+    static constexpr size_t kOutputPoolSize = 3; // 每路流循环使用的输出图像数（使用方仍持有的不会被覆盖）
+
 public slots:
-    bool start(const QString& host = QStringLiteral("0.0.0.0"), quint16 port = 9000);
+    bool start(const QString& host = QStringLiteral("0.0.0.0"), quint16 port = 9000) override;
+
+    void stop() override;
 
-    void stop();
+    // 服务端匹配模式：上传已学习的模板与匹配参数，服务端在相机侧匹配后只回传结果记录
+    // thumbnailInterval: 每 N 帧附带一张缩略图（0 表示不要缩略图）
+    bool uploadMatchModel(const cv::Mat& templateImage, const MatchParams& learnParams,
+                          const FindMatchParams& findParams, quint16 thumbnailInterval = 0,
+                          float thumbnailScale = 0.25f);
+    // 退出服务端匹配，恢复整帧推流
+    void stopServerMatching();
+
+    // 协商裁剪区域/降采样/像素格式/帧率，运行时可反复调用；非 singleShot 请求会在重新握手后自动重发
+    // sourceIndex < 0 时发往已知承载该流的数据源（未知时为第 0 个）
+    bool requestStream(const StreamProtocol::StreamRequest& request, int sourceIndex = -1);
+    // 临时请求一帧全分辨率整幅 JPEG，之后服务端恢复当前的持续请求；streamId < 0 表示主流
+    bool requestFullFrame(int streamId = -1);
 
 signals:
-    void frameReady(cv::Mat frame);
-    void statusText(QString text);
+    void streamFrameReady(quint16 streamId, cv::Mat frame, StreamProtocol::FrameGeometry geometry); // 任意一路流的新帧
+    void matchResultsReady(MatchResults results, quint32 frameId); // 服务端匹配结果（全图坐标）
+    void thumbnailReady(cv::Mat thumbnail, quint32 frameId);       // 服务端匹配模式下的低频缩略图
+    void serverMatchModeChanged(bool active);
 
 private slots:
     void tryConnect();
-    void onReadyRead();
-    void onError(QAbstractSocket::SocketError err);
 
 private:
-    bool processBuffer(); // 返回是否解出至少一帧
+    struct Source;
+    struct StreamState;
+    using Buffer = std::shared_ptr<std::vector<uint8_t>>; // 重组缓冲区，解码完成后回收复用
+    struct DecodedFrame {
+        cv::Mat frame;
+        StreamProtocol::FrameGeometry geometry;
+        quint64 decodeUs = 0;
+        quint64 receiveUs = 0; // 帧头到收齐耗时
+        quint64 bytes = 0;
+        Buffer buffer;         // 归还给该路流的重组缓冲区
+        int poolIndex = -1;    // 输出图像所在的池位置，-1 表示池已满临时分配
+        bool reused = false;   // 是否解码进了已有内存（未重新分配）
+    };
+
+    void onReadyRead(int sourceIndex);
+    void onError(int sourceIndex);
+    // 处理扩展协议包（结果/缩略图/应答/帧分片）
+    void handleProtocolPacket(int sourceIndex, const uint8_t* data, size_t size);
+    bool sendPayload(StreamProtocol::PacketType type, const std::vector<uint8_t>& payload, int sourceIndex = 0);
+    StreamState& stream(quint16 streamId, int sourceIndex);
+    void beginFrame(StreamState& state, quint32 length, bool negotiated);
+    void completeFrame(StreamState& state);
+    void startDecode(StreamState& state);
+    void recycleBuffer(StreamState& state, Buffer buffer);
+    void onFrameDecoded(quint16 streamId, quint32 epoch, QFutureWatcher<DecodedFrame>* watcher);
+    void reportTraffic();
 
 private:
-    QUdpSocket sock; // UDP socket（客户端主动发一个握手包即可收到推流）
+    struct Source {
+        std::unique_ptr<QUdpSocket> sock; // UDP socket（客户端主动发一个握手包即可收到推流）
+        QString host;
+        quint16 port = 0;
+        quint16 legacyStreamId = 0;       // 旧协议整帧归属的流
+        bool waitingFirstFrame = true;    // 还未收到第一帧时保持握手
+        QElapsedTimer lastFrameTimer;     // 记录上次收到帧的时间，用于决定何时重发握手
+        StreamProtocol::ChunkAssembler assembler; // 扩展协议多分片重组（transferId 只在数据源内唯一）
+        int rawStreamId = -1;             // 无包头数据分片当前归属的流（旧协议/早期协商模式），-1 表示无
+    };
+
+    struct StreamState {
+        quint16 id = 0;
+        int sourceIndex = 0;
+        // 分片重组
+        bool assembling = false;
+        bool negotiated = false;                 // 当前帧是否由 FrameHeader 开始
+        StreamProtocol::FrameDescriptor desc;    // 协商模式下正在接收的帧描述
+        quint32 transferId = 0;
+        Buffer data;                             // 当前帧重组缓冲区（容量按历史最大帧保留）
+        std::vector<bool> gotChunk;
+        size_t filled = 0;
+        quint32 expectedLen = 0;
+        quint64 frameBytes = 0;                  // 当前帧累计接收字节（含包头）
+        QElapsedTimer frameStartTimer;           // 当前帧帧头到达时刻
+        // 解码队列
+        struct Pending {
+            bool negotiated = false;
+            StreamProtocol::FrameDescriptor desc;
+            Buffer data;
+            size_t length = 0;
+            quint64 receiveUs = 0;
+            quint64 bytes = 0;
+        };
+        std::deque<Pending> queue;
+        bool decoding = false;
+        std::vector<Buffer> freeBuffers;         // 已解码完可复用的重组缓冲区
+        std::vector<cv::Mat> outputPool;         // 循环使用的解码输出
+        int jpegReduction = 1;
+        StreamStatsTracker stats;
+    };
+
+    std::vector<std::unique_ptr<Source>> sources;
+    std::map<quint16, StreamState> streams;
+    quint16 primaryStreamId = 0;
+    quint32 epoch = 0; // stop() 递增，丢弃停止前发起的解码结果
     QTimer reconnectTimer; // 定时尝试重发握手/保活
-    QElapsedTimer lastFrameTimer; // 记录上次收到帧的时间，用于决定何时重发握手
 
-    QByteArray buffer; // 接收缓冲区（UDP 分片重新组包）
-    quint32 expectedFrameLen = 0; // 当前待收完整帧的长度
+    quint32 nextTransferId = 1;
+    bool serverMatchActive = false;
+
+    struct PersistentRequest {
+        int sourceIndex = 0;
+        StreamProtocol::StreamRequest request;
+    };
+    std::map<quint16, PersistentRequest> streamRequests; // 各路流当前持续请求（重新握手后重发）
+    std::map<quint16, int> decodeReductions;             // 各路流的 JPEG 缩小解码倍数
+    QByteArray scratch; // 无法直接读入重组缓冲区的数据报（扩展包/帧头/首个分片）的复用读缓冲
 
-    QString targetHost = QStringLiteral("0.0.0.0");
-    quint16 targetPort = 9000;
-    bool waitingFirstFrame = true; // 还未收到第一帧时保持握手
+    // 整帧推流与服务端匹配两条路径的流量/时延统计，定期通过 statusText 输出对比
+    struct TrafficStats {
+        quint64 frames = 0;            // 整帧模式：已解码帧数（所有流）
+        quint64 frameBytes = 0;        // 整帧模式：累计接收字节
+        quint64 frameReceiveUs = 0;    // 整帧模式：帧头到收齐耗时
+        quint64 frameDecodeUs = 0;     // 整帧模式：解码耗时
+        quint64 resultFrames = 0;      // 匹配模式：已收结果帧数
+        quint64 resultBytes = 0;       // 匹配模式：累计接收字节
+        quint64 serverLatencyUs = 0;   // 匹配模式：服务端采集到发送耗时（含匹配）
+        quint64 equivalentFrameBytes = 0; // 匹配模式：服务端报告的等效整帧字节数
+        quint64 reusedOutputs = 0;     // 整帧模式：解码进已有输出内存（无堆分配）的帧数
+        quint64 directReadBytes = 0;   // 整帧模式：直接从 socket 读入重组缓冲区、省去中间拷贝的字节数
+    } traffic;
+    quint64 pendingResultBytes = 0; // 结果包分片的累计字节（重组完成后计入统计）
 };
@@ -0,0 +1,147 @@
+#include "MatchStreamSession.h"
+#include <algorithm>
+#include <chrono>
+#include <QDebug>
+#include <QString>
+
+uint64_t MatchStreamSession::nowUs()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+bool MatchStreamSession::handleClientDatagram(const uint8_t* data, size_t size, std::vector<std::vector<uint8_t>>& replies)
+{
+    StreamProtocol::PacketHeader header;
+    if (!StreamProtocol::readHeader(data, size, header)) {
+        return false;
+    }
+
+    switch (header.type) {
+    case StreamProtocol::PacketType::ModelUpload: {
+        std::vector<uint8_t> payload;
+        if (!m_assembler.push(header, data + StreamProtocol::kHeaderSize, size - StreamProtocol::kHeaderSize, payload)) {
+            return true; // 等待剩余分片
+        }
+        StreamProtocol::ModelUpload upload;
+        const bool ok = StreamProtocol::decodeModelUpload(payload, upload) && loadModel(upload);
+        const std::vector<uint8_t> ack{static_cast<uint8_t>(ok ? 1 : 0)};
+        for (auto& packet : StreamProtocol::packetize(StreamProtocol::PacketType::ModelAck, header.transferId, ack)) {
+            replies.push_back(std::move(packet));
+        }
+        return true;
+    }
+    case StreamProtocol::PacketType::StreamRequest: {
+        std::vector<uint8_t> payload;
+        StreamProtocol::StreamRequest request;
+        if (!m_assembler.push(header, data + StreamProtocol::kHeaderSize, size - StreamProtocol::kHeaderSize, payload)
+            || !StreamProtocol::decodeStreamRequest(payload, request)) {
+            return true;
+        }
+        StreamState& state = m_streams[request.streamId];
+        if (request.singleShot) {
+            state.singleShot = request;
+            state.hasSingleShot = true;
+        } else {
+            state.request = request;
+        }
+        return true;
+    }
+    case StreamProtocol::PacketType::StopMatchMode:
+        m_active = false;
+        qInfo().noquote() << QStringLiteral("客户端请求退出服务端匹配模式，恢复整帧推流");
+        return true;
+    default:
+        return true; // 服务端只接收上传/停止两类包，其余类型忽略
+    }
+}
+
+bool MatchStreamSession::loadModel(const StreamProtocol::ModelUpload& upload)
+{
+    // 服务端以同一模板图像与学习参数重建模型，结果与客户端本地学习一致
+    if (!m_templateManager.learnTemplate(upload.templateImage, upload.templateImage, upload.learnParams)) {
+        qWarning().noquote() << QStringLiteral("服务端模板学习失败，保持整帧推流");
+        m_active = false;
+        return false;
+    }
+    m_findParams = upload.findParams;
+    m_findParams.compactResults = true; // 结果帧只回传旋转框，不需要逐个拷贝特征点
+    m_thumbnailInterval = upload.thumbnailInterval;
+    m_thumbnailScale = upload.thumbnailScale;
+    m_framesSinceThumbnail = 0;
+    m_active = true;
+    qInfo().noquote() << QStringLiteral("服务端匹配模式已启用：模板 %1x%2，缩略图间隔 %3 帧")
+                          .arg(upload.templateImage.cols)
+                          .arg(upload.templateImage.rows)
+                          .arg(m_thumbnailInterval);
+    return true;
+}
+
+bool MatchStreamSession::shouldSendFrame(uint16_t streamId, uint64_t captureTimeUs) const
+{
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end()) {
+        return false;
+    }
+    const StreamState& state = it->second;
+    if (state.hasSingleShot || state.request.maxFps <= 0.f || state.lastSentUs == 0) {
+        return true;
+    }
+    const uint64_t intervalUs = static_cast<uint64_t>(1e6 / state.request.maxFps);
+    return captureTimeUs >= state.lastSentUs + intervalUs;
+}
+
+std::vector<std::vector<uint8_t>> MatchStreamSession::packFrame(const cv::Mat& sensorFrame, uint16_t streamId,
+                                                                uint32_t frameId, uint64_t captureTimeUs)
+{
+    std::vector<std::vector<uint8_t>> packets;
+    auto it = m_streams.find(streamId);
+    if (it == m_streams.end() || !shouldSendFrame(streamId, captureTimeUs)) {
+        return packets;
+    }
+    StreamState& state = it->second;
+    const StreamProtocol::StreamRequest& request = state.hasSingleShot ? state.singleShot : state.request;
+
+    StreamProtocol::FrameDescriptor desc;
+    desc.frameId = frameId;
+    desc.captureTimeUs = captureTimeUs;
+    std::vector<uint8_t> payload;
+    if (!StreamProtocol::encodeFramePayload(sensorFrame, request, desc, payload)) {
+        return packets;
+    }
+    desc.streamId = streamId;
+    state.hasSingleShot = false; // 单帧请求只生效一次，之后回到持续请求
+    state.lastSentUs = captureTimeUs;
+
+    // 数据分片带流编号与 transferId，多路流在同一端口交错发送时客户端仍能各自重组
+    return StreamProtocol::packetizeFrame(desc, m_nextTransferId++, payload);
+}
+
+std::vector<std::vector<uint8_t>> MatchStreamSession::processFrame(const cv::Mat& frame, uint32_t frameId,
+                                                                   uint64_t captureTimeUs, uint32_t encodedFrameBytes)
+{
+    std::vector<std::vector<uint8_t>> packets;
+    if (!m_active || frame.empty()) {
+        return packets;
+    }
+
+    StreamProtocol::ResultFrame resultFrame;
+    resultFrame.frameId = frameId;
+    resultFrame.captureTimeUs = captureTimeUs;
+    resultFrame.frameBytes = encodedFrameBytes;
+    resultFrame.results = m_templateManager.matchTemplate(frame, m_findParams);
+    resultFrame.serverLatencyUs = static_cast<uint32_t>(nowUs() - captureTimeUs);
+
+    const uint32_t transferId = m_nextTransferId++;
+    packets = StreamProtocol::packetize(StreamProtocol::PacketType::MatchResults, transferId,
+                                        StreamProtocol::encodeResultFrame(resultFrame));
+
+    if (m_thumbnailInterval > 0 && ++m_framesSinceThumbnail >= m_thumbnailInterval) {
+        m_framesSinceThumbnail = 0;
+        const std::vector<uint8_t> thumb = StreamProtocol::encodeThumbnail(frameId, frame, m_thumbnailScale);
+        for (auto& packet : StreamProtocol::packetize(StreamProtocol::PacketType::Thumbnail, m_nextTransferId++, thumb)) {
+            packets.push_back(std::move(packet));
+        }
+    }
+    return packets;
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <opencv2/core.hpp>
+#include "../TemplateManager.h"
+#include "../client/StreamProtocol.h"
+#include "template/template_global.h"
+
+// 推流服务端的匹配会话：接收客户端上传的模板与匹配参数，在相机侧完成匹配，
+// 每帧只回传紧凑的 MatchResult 记录（可选低频缩略图），替代整帧 JPEG 推流。
+class TEMPLATE_EXPORT MatchStreamSession {
+public:
+    MatchStreamSession() = default;
+
+    // 处理客户端发来的扩展协议包，需要回发给客户端的数据报写入 replies；非扩展包返回 false
+    bool handleClientDatagram(const uint8_t* data, size_t size, std::vector<std::vector<uint8_t>>& replies);
+    // 是否处于服务端匹配模式（为 false 时服务端按原协议推整帧）
+    bool matchModeActive() const { return m_active; }
+    // 对一帧执行匹配，返回待发送的数据报（结果包 + 按间隔附带的缩略图）
+    // captureTimeUs: 采集时间戳（steady_clock 微秒）；encodedFrameBytes: 该帧按整帧推流时的 JPEG 字节数，可为 0
+    std::vector<std::vector<uint8_t>> processFrame(const cv::Mat& frame, uint32_t frameId,
+                                                   uint64_t captureTimeUs, uint32_t encodedFrameBytes = 0);
+
+    // 协商模式：按客户端对该路流的请求判断本帧是否需要发送（帧率限制）
+    bool shouldSendFrame(uint16_t streamId, uint64_t captureTimeUs) const;
+    // 协商模式：按请求裁剪/降采样/编码整帧，返回 FrameHeader 包 + FrameData 分片；客户端未发请求时返回空
+    std::vector<std::vector<uint8_t>> packFrame(const cv::Mat& sensorFrame, uint16_t streamId,
+                                                uint32_t frameId, uint64_t captureTimeUs);
+    bool hasStreamRequest(uint16_t streamId) const { return m_streams.count(streamId) > 0; }
+
+    static uint64_t nowUs();
+
+private:
+    bool loadModel(const StreamProtocol::ModelUpload& upload);
+
+private:
+    TemplateManager m_templateManager;
+    FindMatchParams m_findParams;
+    StreamProtocol::ChunkAssembler m_assembler;
+    uint32_t m_nextTransferId = 1;
+    uint16_t m_thumbnailInterval = 0;
+    float    m_thumbnailScale = 0.25f;
+    uint32_t m_framesSinceThumbnail = 0;
+    bool     m_active = false;
+
+    struct StreamState {
+        StreamProtocol::StreamRequest request;      // 持续请求
+        StreamProtocol::StreamRequest singleShot;   // 待发送的单帧请求
+        bool     hasSingleShot = false;
+        uint64_t lastSentUs = 0;
+    };
+    std::map<uint16_t, StreamState> m_streams;
+};
@@ -0,0 +1,437 @@
+// 模板匹配一致性测试：在 SyntheticBenchmark 生成的同一批合成场景上对比两条实现路径或两种配置，
+// 每个用例对应一项功能，由 ctest 逐个运行（TemplateTests <用例名>）。失败时输出对比详情（JSON）。
+// 精度/速度数值由 TemplateBenchmark 输出，这里只判断结果是否一致、指标是否回退。
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QPainterPath>
+#include <QTemporaryDir>
+#include <QTransform>
+#include <QtTest>
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include "template/core/MatchSuppressor.h"
+#include "template/core/PathBatchTransformer.h"
+#include "template/core/SyntheticBenchmark.h"
+
+namespace {
+// 与 TemplateBenchmark 的缺省参数一致，场景数减少以控制用例耗时
+SyntheticBenchmark::Options testOptions()
+{
+    SyntheticBenchmark::Options options;
+    options.scenesPerCondition = 2;
+    options.instancesPerScene = 3;
+    options.learn.angleRange = 360.0;
+    options.learn.angle_step = 1.f;
+    options.learn.scale_min = 0.95f;
+    options.learn.scale_max = 1.05f;
+    options.learn.scale_step = 0.05f;
+    options.find.scoreThreshold = 70.0;
+    options.find.maxCount = options.instancesPerScene + 2;
+    options.find.compactResults = true;
+    return options;
+}
+
+QByteArray describe(const QJsonObject& details)
+{
+    return QJsonDocument(details).toJson(QJsonDocument::Compact);
+}
+} // namespace
+
+class TemplateTests : public QObject {
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    // 同一场景重复生成的图像与重复匹配的结果完全相同
+    void determinism();
+    // 由粗到精搜索与各层独立全图搜索的结果一致（同一目标、同一离散模板），召回不降
+    void coarseToFine();
+    // 以真值位姿（加上一帧量级的偏移）作为跟踪先验，matchAround 能重新找到全图搜索找到的每个目标
+    void trackingPriors();
+    // 单次匹配内部 2/4/8 线程与单线程的结果完全相同
+    void matchThreads();
+    // 密集料盘上 1 万个合成候选：网格去重（MatchSuppressor）与逐一比较的接受集合相同（距离与 IoU 两种判据）
+    void suppression();
+    // 粗角度步长（2°/4°）下开启亚像素位姿精修：召回不降、位置/角度误差不升
+    void poseRefinement();
+    // 模型包保存后加载到新的 TemplateManager，匹配结果与原模型完全相同
+    void modelReload();
+    // 角度分 4 段并行学习（learnAngleSplits）与不分段学习的模型匹配结果完全相同
+    void angleSplits();
+    // 排版路径批量变换（PathBatchTransformer）与逐点换算（QTransform 摆放、拖拽后再逐点经振镜单应）一致
+    void pathBatch();
+    // 按需生成模型（缓存不限、不开 hotFirst）每次搜索覆盖全部角度区间：场景内各姿态的目标召回不低于普通模型
+    void lazyModel();
+
+private:
+    SyntheticBenchmark::Options m_options = testOptions();
+};
+
+void TemplateTests::initTestCase()
+{
+    // 单线程匹配，结果与耗时不受机器核数影响；需要多线程的用例自行切换并恢复
+    TemplateManager::setMaxMatchThreads(1);
+}
+
+void TemplateTests::determinism()
+{
+    const SyntheticBenchmark benchmark(m_options);
+    const std::vector<SyntheticBenchmark::Shape> shapes = SyntheticBenchmark::builtinShapes();
+    int differentImages = 0;
+    // 第二条路径重新生成场景再匹配，同时比较两次生成的图像
+    const SyntheticBenchmark::MatchPath regenerated = [&](const TemplateManager& manager, int shapeIndex,
+                                                          const SyntheticBenchmark::Scene& scene) {
+        const SyntheticBenchmark::Scene again =
+            benchmark.generateScene(shapes[static_cast<size_t>(shapeIndex)], shapeIndex, scene.condition, scene.index);
+        differentImages += cv::norm(scene.image, again.image, cv::NORM_INF) > 0.0 ? 1 : 0;
+        return manager.runMatchJob(TemplateManager::makeMatchJob(again.image, m_options.find));
+    };
+    const SyntheticBenchmark::Comparison comparison = benchmark.comparePaths(
+        m_options.learn, SyntheticBenchmark::findPath(m_options.find), regenerated, SyntheticBenchmark::Tolerance());
+    QJsonObject details = SyntheticBenchmark::toJsonObject(comparison, QStringLiteral("first"), QStringLiteral("second"));
+    details.insert(QStringLiteral("differentImages"), differentImages);
+    QVERIFY2(comparison.learned && comparison.identical && differentImages == 0, describe(details).constData());
+}
+
+void TemplateTests::coarseToFine()
+{
+    FindMatchParams exhaustive = m_options.find;
+    exhaustive.coarseToFine = false;
+    FindMatchParams hierarchical = m_options.find;
+    hierarchical.coarseToFine = true;
+    // 两条路径最终都由第 0 层引擎给出结果，同一目标应落在同一离散模板上；
+    // 窗口搜索与全图搜索的亚像素插值只差舍入，位置/分数略放宽
+    SyntheticBenchmark::Tolerance tolerance;
+    tolerance.position = 0.05;
+    tolerance.score = 1e-3;
+    const SyntheticBenchmark benchmark(m_options);
+    const SyntheticBenchmark::Comparison comparison = benchmark.comparePaths(
+        m_options.learn, SyntheticBenchmark::findPath(exhaustive), SyntheticBenchmark::findPath(hierarchical), tolerance);
+    const QJsonObject details = SyntheticBenchmark::toJsonObject(comparison, QStringLiteral("exhaustive"), QStringLiteral("coarseToFine"));
+    QVERIFY2(comparison.learned && comparison.identical && comparison.rhs.recall >= comparison.lhs.recall,
+             describe(details).constData());
+}
+
+void TemplateTests::trackingPriors()
+{
+    // 先验相对真值的偏移，模拟帧间运动（在 PosePrior 缺省带宽之内）
+    const cv::Point2f priorOffset(3.f, -2.f);
+    constexpr double kPriorAngleOffset = 2.0;
+
+    const SyntheticBenchmark benchmark(m_options);
+    int expected = 0; // 全图搜索命中的实例，先验路径必须重新找到
+    int lost = 0;
+    const std::vector<SyntheticBenchmark::Shape> shapes = SyntheticBenchmark::builtinShapes();
+    for (size_t s = 0; s < shapes.size(); ++s) {
+        const int shapeIndex = static_cast<int>(s);
+        TemplateManager manager;
+        QVERIFY2(benchmark.learn(shapes[s], m_options.learn, manager), qPrintable(shapes[s].name));
+        const cv::Point2f trainCenter = manager.trainCenter();
+        for (const SyntheticBenchmark::Scene& scene : benchmark.generateScenes(shapes[s], shapeIndex)) {
+            const std::vector<MatchResult> full = manager.matchTemplate(scene.image, m_options.find);
+            std::vector<TemplateManager::PosePrior> priors;
+            std::vector<char> foundByFull;
+            for (const SyntheticBenchmark::Instance& instance : scene.truth) {
+                const cv::Point2f center = SyntheticBenchmark::truthCenter(instance, trainCenter);
+                TemplateManager::PosePrior prior;
+                prior.center = center + priorOffset;
+                prior.angle = instance.angle + kPriorAngleOffset;
+                prior.scale = instance.scale;
+                priors.push_back(prior);
+                foundByFull.push_back(std::any_of(full.begin(), full.end(), [&](const MatchResult& result) {
+                    return benchmark.hitsTruth(result, center, instance);
+                }) ? 1 : 0);
+            }
+            std::vector<char> found;
+            const std::vector<MatchResult> results = manager.matchAround(scene.image, priors, m_options.find, found);
+            for (size_t t = 0; t < scene.truth.size(); ++t) {
+                if (!foundByFull[t]) {
+                    continue;
+                }
+                ++expected;
+                const cv::Point2f center = SyntheticBenchmark::truthCenter(scene.truth[t], trainCenter);
+                lost += found[t] && benchmark.hitsTruth(results[t], center, scene.truth[t]) ? 0 : 1;
+            }
+        }
+    }
+    const QJsonObject details{{QStringLiteral("foundByFullSearch"), expected}, {QStringLiteral("lost"), lost}};
+    QVERIFY2(expected > 0 && lost == 0, describe(details).constData());
+}
+
+void TemplateTests::matchThreads()
+{
+    // 线程数是全局设置，每次匹配前按路径切换
+    const auto threadsPath = [this](int threads) -> SyntheticBenchmark::MatchPath {
+        return [this, threads](const TemplateManager& manager, int, const SyntheticBenchmark::Scene& scene) {
+            TemplateManager::setMaxMatchThreads(threads);
+            return manager.runMatchJob(TemplateManager::makeMatchJob(scene.image, m_options.find));
+        };
+    };
+    const SyntheticBenchmark benchmark(m_options);
+    for (int threads : {2, 4, 8}) {
+        const SyntheticBenchmark::Comparison comparison =
+            benchmark.comparePaths(m_options.learn, threadsPath(1), threadsPath(threads), SyntheticBenchmark::Tolerance());
+        TemplateManager::setMaxMatchThreads(1);
+        QJsonObject details = SyntheticBenchmark::toJsonObject(comparison, QStringLiteral("singleThread"), QStringLiteral("multiThread"));
+        details.insert(QStringLiteral("threads"), threads);
+        QVERIFY2(comparison.learned && comparison.identical, describe(details).constData());
+    }
+}
+
+void TemplateTests::suppression()
+{
+    // 20×20 个目标、间距略大于目标尺寸（彼此贴近），每个目标 25 个位姿抖动的候选
+    constexpr int    kTrayColumns = 20;
+    constexpr int    kTrayRows = 20;
+    constexpr int    kCandidatesPerTarget = 25;
+    constexpr double kPitch = 44.0;
+    constexpr double kIouThreshold = 0.5;
+    const cv::Size2f objectSize(40.f, 24.f);
+
+    cv::RNG rng(m_options.seed);
+    std::vector<MatchResult> candidates;
+    candidates.reserve(static_cast<size_t>(kTrayColumns * kTrayRows * kCandidatesPerTarget));
+    for (int row = 0; row < kTrayRows; ++row) {
+        for (int column = 0; column < kTrayColumns; ++column) {
+            for (int k = 0; k < kCandidatesPerTarget; ++k) {
+                MatchResult candidate;
+                candidate.center = cv::Point2f(static_cast<float>(kPitch * (column + 1) + rng.uniform(-3.0, 3.0)),
+                                               static_cast<float>(kPitch * (row + 1) + rng.uniform(-3.0, 3.0)));
+                candidate.angle = rng.uniform(-3.0, 3.0);
+                candidate.scale = rng.uniform(0.95, 1.05);
+                candidate.score = rng.uniform(0.5, 1.0);
+                candidate.featureSize = objectSize * static_cast<float>(candidate.scale);
+                candidate.rotatedRect = cv::RotatedRect(candidate.center, candidate.featureSize, static_cast<float>(candidate.angle));
+                candidate.Roiarea = candidate.rotatedRect.boundingRect();
+                candidates.push_back(candidate);
+            }
+        }
+    }
+    std::stable_sort(candidates.begin(), candidates.end(), [](const MatchResult& lhs, const MatchResult& rhs) {
+        return lhs.score > rhs.score;
+    });
+    // 与 TemplateManager 一致的距离阈值：特征外接框对角线的 0.3 倍，至少 10 像素
+    const auto distanceThreshold = [](const MatchResult& candidate) {
+        return std::max(10.0, std::hypot(static_cast<double>(candidate.featureSize.width),
+                                         static_cast<double>(candidate.featureSize.height)) * 0.3);
+    };
+    const double cellSize = distanceThreshold(candidates.front());
+
+    for (double iouThreshold : {0.0, kIouThreshold}) {
+        QElapsedTimer timer;
+        timer.start();
+        MatchSuppressor suppressor(cellSize, iouThreshold);
+        std::vector<char> gridAccepted(candidates.size(), 0);
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            gridAccepted[i] = suppressor.tryAccept(candidates[i], distanceThreshold(candidates[i])) ? 1 : 0;
+        }
+        const double gridMs = timer.nsecsElapsed() / 1e6;
+
+        // 逐一与全部已接受结果比较（O(n²)），作为参照
+        timer.restart();
+        std::vector<char> naiveAccepted(candidates.size(), 0);
+        std::vector<size_t> accepted;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            const cv::RotatedRect rect = MatchSuppressor::effectiveRect(candidates[i]);
+            const double threshold = distanceThreshold(candidates[i]);
+            const bool duplicate = std::any_of(accepted.begin(), accepted.end(), [&](size_t index) {
+                if (iouThreshold > 0.0) {
+                    return MatchSuppressor::rotatedIoU(rect, MatchSuppressor::effectiveRect(candidates[index])) >= iouThreshold;
+                }
+                const cv::Point2f d = candidates[i].center - candidates[index].center;
+                return static_cast<double>(d.x) * d.x + static_cast<double>(d.y) * d.y <= threshold * threshold;
+            });
+            if (!duplicate) {
+                accepted.push_back(i);
+                naiveAccepted[i] = 1;
+            }
+        }
+        const double naiveMs = timer.nsecsElapsed() / 1e6;
+
+        int mismatches = 0;
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            mismatches += gridAccepted[i] != naiveAccepted[i] ? 1 : 0;
+        }
+        qInfo().noquote() << QStringLiteral("%1 个候选（%2 判据）：接受 %3 个，网格去重 %4 ms，逐一比较 %5 ms")
+                              .arg(static_cast<int>(candidates.size()))
+                              .arg(iouThreshold > 0.0 ? QStringLiteral("IoU") : QStringLiteral("距离"))
+                              .arg(static_cast<int>(accepted.size()))
+                              .arg(gridMs, 0, 'f', 2)
+                              .arg(naiveMs, 0, 'f', 2);
+        const QJsonObject details{{QStringLiteral("iouThreshold"), iouThreshold}, {QStringLiteral("mismatches"), mismatches}};
+        QVERIFY2(mismatches == 0, describe(details).constData());
+    }
+}
+
+void TemplateTests::poseRefinement()
+{
+    FindMatchParams plain = m_options.find;
+    plain.refinePose = false;
+    FindMatchParams refined = m_options.find;
+    refined.refinePose = true;
+    const SyntheticBenchmark benchmark(m_options);
+    for (float angleStep : {2.f, 4.f}) {
+        MatchParams learnParams = m_options.learn;
+        learnParams.angle_step = angleStep;
+        const SyntheticBenchmark::Comparison comparison = benchmark.comparePaths(
+            learnParams, SyntheticBenchmark::findPath(plain), SyntheticBenchmark::findPath(refined), SyntheticBenchmark::Tolerance());
+        QJsonObject details = SyntheticBenchmark::toJsonObject(comparison, QStringLiteral("plain"), QStringLiteral("refined"));
+        details.insert(QStringLiteral("angleStep"), static_cast<double>(angleStep));
+        QVERIFY2(comparison.learned && comparison.rhs.recall >= comparison.lhs.recall
+                     && comparison.rhs.meanPositionError <= comparison.lhs.meanPositionError
+                     && comparison.rhs.meanAngleError <= comparison.lhs.meanAngleError,
+                 describe(details).constData());
+    }
+}
+
+void TemplateTests::modelReload()
+{
+    QTemporaryDir root;
+    QVERIFY(root.isValid());
+    // 每个形状第一次用到时保存模型包并加载到新的管理器，之后的场景都由加载的模型匹配
+    std::vector<std::unique_ptr<TemplateManager>> reloaded(SyntheticBenchmark::builtinShapes().size());
+    int failures = 0;
+    double learnMs = 0.0;
+    double loadMs = 0.0;
+    const SyntheticBenchmark::MatchPath reloadedPath = [&](const TemplateManager& manager, int shapeIndex,
+                                                           const SyntheticBenchmark::Scene& scene) {
+        std::unique_ptr<TemplateManager>& loaded = reloaded[static_cast<size_t>(shapeIndex)];
+        if (!loaded) {
+            const QString directory = root.filePath(QString::number(shapeIndex));
+            loaded = std::make_unique<TemplateManager>();
+            const bool saved = manager.saveModel(directory);
+            QElapsedTimer timer;
+            timer.start();
+            failures += saved && loaded->loadModel(directory) ? 0 : 1;
+            loadMs += timer.nsecsElapsed() / 1e6;
+            learnMs += manager.learnMs();
+        }
+        return loaded->runMatchJob(TemplateManager::makeMatchJob(scene.image, m_options.find));
+    };
+    const SyntheticBenchmark benchmark(m_options);
+    const SyntheticBenchmark::Comparison comparison = benchmark.comparePaths(
+        m_options.learn, SyntheticBenchmark::findPath(m_options.find), reloadedPath, SyntheticBenchmark::Tolerance());
+    qInfo().noquote() << QStringLiteral("模型包：学习合计 %1 ms，加载合计 %2 ms").arg(learnMs, 0, 'f', 1).arg(loadMs, 0, 'f', 1);
+    QJsonObject details = SyntheticBenchmark::toJsonObject(comparison, QStringLiteral("learned"), QStringLiteral("reloaded"));
+    details.insert(QStringLiteral("failures"), failures);
+    QVERIFY2(comparison.learned && comparison.identical && failures == 0, describe(details).constData());
+}
+
+void TemplateTests::angleSplits()
+{
+    constexpr int kSplits = 4;
+    MatchParams wholeParams = m_options.learn;
+    wholeParams.learnAngleSplits = 1;
+    wholeParams.lazyModel = false;
+    MatchParams splitParams = wholeParams;
+    splitParams.learnAngleSplits = kSplits;
+    const SyntheticBenchmark benchmark(m_options);
+    const std::vector<SyntheticBenchmark::Shape> shapes = SyntheticBenchmark::builtinShapes();
+    // 每个形状第一次用到时按分段参数另学一个模型
+    std::vector<std::unique_ptr<TemplateManager>> splitManagers(shapes.size());
+    int failures = 0;
+    double wholeLearnMs = 0.0;
+    double splitLearnMs = 0.0;
+    const SyntheticBenchmark::MatchPath splitPath = [&](const TemplateManager& manager, int shapeIndex,
+                                                        const SyntheticBenchmark::Scene& scene) {
+        std::unique_ptr<TemplateManager>& split = splitManagers[static_cast<size_t>(shapeIndex)];
+        if (!split) {
+            split = std::make_unique<TemplateManager>();
+            failures += benchmark.learn(shapes[static_cast<size_t>(shapeIndex)], splitParams, *split) ? 0 : 1;
+            wholeLearnMs += manager.learnMs();
+            splitLearnMs += split->learnMs();
+        }
+        return split->runMatchJob(TemplateManager::makeMatchJob(scene.image, m_options.find));
+    };
+    const SyntheticBenchmark::Comparison comparison = benchmark.comparePaths(
+        wholeParams, SyntheticBenchmark::findPath(m_options.find), splitPath, SyntheticBenchmark::Tolerance());
+    qInfo().noquote() << QStringLiteral("角度分 %1 段学习：不分段合计 %2 ms，分段合计 %3 ms")
+                          .arg(kSplits)
+                          .arg(wholeLearnMs, 0, 'f', 1)
+                          .arg(splitLearnMs, 0, 'f', 1);
+    QJsonObject details = SyntheticBenchmark::toJsonObject(comparison, QStringLiteral("whole"), QStringLiteral("split"));
+    details.insert(QStringLiteral("failures"), failures);
+    QVERIFY2(comparison.learned && comparison.identical && failures == 0, describe(details).constData());
+}
+
+void TemplateTests::pathBatch()
+{
+    constexpr int    kInstances = 64;
+    constexpr double kTolerance = 1e-2; // 振镜坐标，只允许单精度舍入
+    QPainterPath path;
+    path.addRect(0.0, 0.0, 120.0, 60.0);
+    path.moveTo(10.0, 80.0);
+    path.cubicTo(40.0, 140.0, 90.0, 20.0, 130.0, 90.0);
+    const PathBatchTransformer batch(path);
+    QVERIFY(!batch.isEmpty());
+
+    // 图像 → 振镜的单应（带透视项），与摆放后的一次拖拽
+    const cv::Matx33d galvoFromImage(1.02, 0.01, 5.0, -0.02, 0.98, -3.0, 1e-5, -2e-5, 1.0);
+    QTransform drag;
+    drag.translate(7.5, -3.0);
+    drag.rotate(4.0);
+    const cv::Point2f pivot(60.f, 45.f);
+    std::vector<cv::Matx33d> transforms;
+    std::vector<QTransform> placements;
+    for (int i = 0; i < kInstances; ++i) {
+        const cv::Point2f offset(static_cast<float>((i * 37) % 500), static_cast<float>(i * 13));
+        const double angle = 7.5 * i;
+        transforms.push_back(galvoFromImage * PathBatchTransformer::fromQTransform(drag) * PathBatchTransformer::rigid(pivot, offset, angle));
+        QTransform placement;
+        placement.translate(pivot.x + offset.x, pivot.y + offset.y);
+        placement.rotate(angle);
+        placement.translate(-pivot.x, -pivot.y);
+        placements.push_back(placement);
+    }
+    const std::vector<cv::Point2f> points = batch.transform(transforms);
+    const size_t count = static_cast<size_t>(batch.pointCount());
+    QCOMPARE(points.size(), count * static_cast<size_t>(kInstances));
+
+    double maxError = 0.0;
+    for (int i = 0; i < kInstances; ++i) {
+        const QPainterPath display = batch.toPainterPath(points.data() + static_cast<size_t>(i) * count);
+        QCOMPARE(static_cast<size_t>(display.elementCount()), count);
+        for (size_t k = 0; k < count; ++k) {
+            const cv::Point2f& source = batch.points()[k];
+            const QPointF placed = drag.map(placements[static_cast<size_t>(i)].map(QPointF(source.x, source.y)));
+            const cv::Vec3d galvo = galvoFromImage * cv::Vec3d(placed.x(), placed.y(), 1.0);
+            const cv::Point2f& actual = points[static_cast<size_t>(i) * count + k];
+            maxError = std::max(maxError, std::hypot(galvo[0] / galvo[2] - actual.x, galvo[1] / galvo[2] - actual.y));
+        }
+    }
+    const QJsonObject details{{QStringLiteral("points"), static_cast<int>(points.size())}, {QStringLiteral("maxError"), maxError}};
+    QVERIFY2(maxError <= kTolerance, describe(details).constData());
+}
+
+void TemplateTests::lazyModel()
+{
+    MatchParams lazyParams = m_options.learn;
+    lazyParams.lazyModel = true;
+    lazyParams.lazyCacheBins = 0;
+    lazyParams.lazyHotFirst = false;
+    const SyntheticBenchmark benchmark(m_options);
+    const std::vector<SyntheticBenchmark::Shape> shapes = SyntheticBenchmark::builtinShapes();
+    // 每个形状第一次用到时另学一个按需模型；同一场景的多个实例角度互不相关，只搜热点区间会漏检
+    std::vector<std::unique_ptr<TemplateManager>> lazyManagers(shapes.size());
+    int failures = 0;
+    const SyntheticBenchmark::MatchPath lazyPath = [&](const TemplateManager&, int shapeIndex, const SyntheticBenchmark::Scene& scene) {
+        std::unique_ptr<TemplateManager>& lazy = lazyManagers[static_cast<size_t>(shapeIndex)];
+        if (!lazy) {
+            lazy = std::make_unique<TemplateManager>();
+            failures += benchmark.learn(shapes[static_cast<size_t>(shapeIndex)], lazyParams, *lazy) ? 0 : 1;
+        }
+        return lazy->runMatchJob(TemplateManager::makeMatchJob(scene.image, m_options.find));
+    };
+    const SyntheticBenchmark::Comparison comparison = benchmark.comparePaths(
+        m_options.learn, SyntheticBenchmark::findPath(m_options.find), lazyPath, SyntheticBenchmark::Tolerance());
+    QJsonObject details = SyntheticBenchmark::toJsonObject(comparison, QStringLiteral("full"), QStringLiteral("lazy"));
+    details.insert(QStringLiteral("failures"), failures);
+    QVERIFY2(comparison.learned && failures == 0 && comparison.rhs.recall >= comparison.lhs.recall,
+             describe(details).constData());
+}
+
+QTEST_GUILESS_MAIN(TemplateTests)
+#include "templateTests.moc"
@@ -1,3 +1,17 @@
+if(BSCV_BUILTIN_MATCHER)
+    # 使用仓库内的形状匹配引擎（tools/shapematch）：头文件取 tools/bscv，无运行时 DLL。
+    # 引擎是静态库，只能链接进 TemplateMatchPlugin（BSCV_MATCHER_LIBRARIES）；其它目标只用到 BSCV 头文件中的类型，
+    # 链接 BSCV_LIBRARIES（仅头文件与 OpenCV），否则各自带一份引擎代码，ShapeMatchEngine 的 RTTI 不唯一
+    set(BSCV_FOUND TRUE)
+    set(BSCV_INCLUDE_DIRS "${CMAKE_CURRENT_LIST_DIR}" CACHE STRING "BSCV_INCLUDE_DIRS" FORCE)
+    set(BSCV_LIBRARIES BSCVHeaders CACHE STRING "BSCV_LIBRARIES" FORCE)
+    set(BSCV_MATCHER_LIBRARIES BSCVShapeMatch CACHE STRING "BSCV_MATCHER_LIBRARIES" FORCE)
+    set(BSCV_DLLS "" CACHE STRING "BSCV_DLLS" FORCE)
+    include(FindPackageHandleStandardArgs)
+    find_package_handle_standard_args(BSCV DEFAULT_MSG BSCV_INCLUDE_DIRS BSCV_LIBRARIES)
+    return()
+endif()
+
 if(WIN32)
     # 标记找到 BSCV（使用仓库内的预编译库与头文件）
     set(BSCV_FOUND TRUE)
@@ -14,6 +28,8 @@ if(WIN32)
     # 形成按配置选择的库列表，并使用标准变量名 BSCV_LIBRARIES
     set(BSCV_LIBRARIES "$<$<CONFIG:Debug>:${libFiles_DEBUG}>$<$<CONFIG:Release>:${libFiles_RELEASE}>" CACHE STRING "BSCV_LIBRARIES" FORCE)
     set(BSCV_DLLS "$<$<CONFIG:Debug>:${dllFiles_DEBUG}>$<$<CONFIG:Release>:${dllFiles_RELEASE}>" CACHE STRING "BSCV_DLLS" FORCE)
+    # 预编译库是 DLL 导入库，多个目标链接也只有一份实现
+    set(BSCV_MATCHER_LIBRARIES "${BSCV_LIBRARIES}" CACHE STRING "BSCV_MATCHER_LIBRARIES" FORCE)
 
     # 如果仓库内包含 OpenCV 头与 opencv_world 库，则优先使用仓库内的 OpenCV
     if(EXISTS "${CMAKE_CURRENT_LIST_DIR}/bscv/include/opencv2")
@@ -26,6 +42,7 @@ if(WIN32)
             set(OpenCV_LIBS "$<$<CONFIG:Debug>:${local_opencv_debug}>$<$<CONFIG:Release>:${local_opencv_release}>" CACHE STRING "OpenCV libs (from BSCV)" FORCE)
             # 把本地 OpenCV 库追加到 BSCV_LIBRARIES，这样上层 target_link_libraries 使用 ${BSCV_LIBRARIES} 会包含 OpenCV
             set(BSCV_LIBRARIES "$<$<CONFIG:Debug>:${libFiles_DEBUG};${local_opencv_debug}>$<$<CONFIG:Release>:${libFiles_RELEASE};${local_opencv_release}>" CACHE STRING "BSCV_LIBRARIES" FORCE)
+            set(BSCV_MATCHER_LIBRARIES "${BSCV_LIBRARIES}" CACHE STRING "BSCV_MATCHER_LIBRARIES" FORCE)
             # 同时把 include 追加（冗余但安全）
             set(BSCV_INCLUDE_DIRS "${BSCV_INCLUDE_DIRS};${OpenCV_INCLUDE_DIRS}" CACHE STRING "BSCV_INCLUDE_DIRS" FORCE)
             set(BSCV_OPENCV_INCLUDED TRUE CACHE BOOL "BSCV includes local OpenCV" FORCE)
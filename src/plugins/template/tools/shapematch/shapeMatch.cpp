@@ -0,0 +1,1037 @@
+#include "shapeMatch.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <opencv2/imgproc.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+
+namespace TIGER_BSVISION
+{
+    namespace
+    {
+        constexpr int kVoteMin = 5;         // 3×3 邻域内同方向至少 5 票才保留，抑制噪声方向
+        constexpr int kFeatureBorder = 2;   // 模板特征不取图像边缘 2 像素（梯度受边界填充影响）
+        constexpr int kFeatureNmsRadius = 2;
+        constexpr float kDefaultStrongThresh = 60.0f;
+        constexpr int kModelVersion = 1;
+
+        using ResponseLut = std::array<std::array<uint8_t, 256>, 2>; // 方向位掩膜的低/高字节 → 响应
+
+        int quantizeAngle(float p_degrees, int p_labelCount)
+        {
+            float a = std::fmod(p_degrees, 360.0f);
+            if (a < 0.0f)
+            {
+                a += 360.0f;
+            }
+            const int bin16 = static_cast<int>(a * (16.0f / 360.0f)) & 15;
+            return p_labelCount == 8 ? (bin16 & 7) : bin16; // 8 方向时反向梯度归为同一方向
+        }
+
+        // 同方向 4 分，相邻方向 1 分，其余 0 分（方向按 labelCount 循环）
+        std::vector<ResponseLut> buildResponseLuts(int p_labelCount)
+        {
+            std::vector<ResponseLut> luts(p_labelCount);
+            for (int label = 0; label < p_labelCount; ++label)
+            {
+                for (int part = 0; part < 2; ++part)
+                {
+                    for (int value = 0; value < 256; ++value)
+                    {
+                        uint8_t best = 0;
+                        for (int bit = 0; bit < 8; ++bit)
+                        {
+                            const int other = bit + part * 8;
+                            if (!(value & (1 << bit)) || other >= p_labelCount)
+                            {
+                                continue;
+                            }
+                            const int diff = std::abs(other - label);
+                            const int circular = std::min(diff, p_labelCount - diff);
+                            const uint8_t score = circular == 0 ? 4 : (circular == 1 ? 1 : 0);
+                            best = std::max(best, score);
+                        }
+                        luts[label][part][value] = best;
+                    }
+                }
+            }
+            return luts;
+        }
+
+        const std::vector<ResponseLut> &responseLuts(int p_labelCount)
+        {
+            static const std::vector<ResponseLut> luts8 = buildResponseLuts(8);
+            static const std::vector<ResponseLut> luts16 = buildResponseLuts(16);
+            return p_labelCount == 8 ? luts8 : luts16;
+        }
+
+        inline uint8_t lookupResponse(const ResponseLut &p_lut, uint16_t p_bits)
+        {
+            return std::max(p_lut[0][p_bits & 0xFF], p_lut[1][p_bits >> 8]);
+        }
+
+        cv::Mat toGray(const cv::Mat &p_src)
+        {
+            if (p_src.channels() == 1)
+            {
+                return p_src;
+            }
+            cv::Mat gray;
+            cv::cvtColor(p_src, gray, p_src.channels() == 3 ? cv::COLOR_BGR2GRAY : cv::COLOR_BGRA2GRAY);
+            return gray;
+        }
+
+        void computeGradient(const cv::Mat &p_gray, cv::Mat &p_magnitude, cv::Mat &p_angle)
+        {
+            cv::Mat smoothed;
+            cv::GaussianBlur(p_gray, smoothed, cv::Size(5, 5), 0, 0, cv::BORDER_REPLICATE);
+            cv::Mat dx, dy;
+            cv::Sobel(smoothed, dx, CV_32F, 1, 0, 3, 1.0, 0.0, cv::BORDER_REPLICATE);
+            cv::Sobel(smoothed, dy, CV_32F, 0, 1, 3, 1.0, 0.0, cv::BORDER_REPLICATE);
+            cv::cartToPolar(dx, dy, p_magnitude, p_angle, true);
+        }
+
+        // 累加一行响应：acc[i] += src[i]
+        inline void accumulateRow(uint16_t *p_acc, const uint8_t *p_src, int p_count)
+        {
+            int i = 0;
+#if CV_SIMD128
+            for (; i <= p_count - 16; i += 16)
+            {
+                cv::v_uint16x8 lo, hi;
+                cv::v_expand(cv::v_load(p_src + i), lo, hi);
+                cv::v_store(p_acc + i, cv::v_add_wrap(cv::v_load(p_acc + i), lo));
+                cv::v_store(p_acc + i + 8, cv::v_add_wrap(cv::v_load(p_acc + i + 8), hi));
+            }
+#endif
+            for (; i < p_count; ++i)
+            {
+                p_acc[i] = static_cast<uint16_t>(p_acc[i] + p_src[i]);
+            }
+        }
+
+        // 抛物线拟合亚像素偏移，结果限制在 ±0.5
+        float parabolaOffset(int p_left, int p_center, int p_right)
+        {
+            const float denom = static_cast<float>(p_left - 2 * p_center + p_right);
+            if (denom >= 0.0f)
+            {
+                return 0.0f;
+            }
+            return std::clamp(0.5f * static_cast<float>(p_left - p_right) / denom, -0.5f, 0.5f);
+        }
+    }
+
+    ShapeMatchEngine::ShapeMatchEngine(const ShapeMatchEngine &p_other)
+        : ITemplMatch(), m_model(p_other.m_model)
+    {
+    }
+
+    bool ShapeMatchEngine::extractFeatures(const cv::Mat &p_gray, const cv::Mat &p_mask, Model &p_model)
+    {
+        cv::Mat magnitude, angle;
+        computeGradient(p_gray, magnitude, angle);
+
+        struct Scored
+        {
+            BaseFeature feature;
+            float magnitude;
+        };
+        std::vector<Scored> candidates;
+        for (int y = kFeatureBorder; y < p_gray.rows - kFeatureBorder; ++y)
+        {
+            const float *mag = magnitude.ptr<float>(y);
+            const float *ang = angle.ptr<float>(y);
+            const uchar *mask = p_mask.empty() ? nullptr : p_mask.ptr<uchar>(y);
+            for (int x = kFeatureBorder; x < p_gray.cols - kFeatureBorder; ++x)
+            {
+                if (mag[x] <= p_model.strongThresh || (mask && mask[x] == 0))
+                {
+                    continue;
+                }
+                // 局部非极大值抑制：邻域内有更强梯度则跳过
+                bool isMax = true;
+                for (int dy = -kFeatureNmsRadius; dy <= kFeatureNmsRadius && isMax; ++dy)
+                {
+                    const int yy = y + dy;
+                    if (yy < 0 || yy >= p_gray.rows)
+                    {
+                        continue;
+                    }
+                    const float *row = magnitude.ptr<float>(yy);
+                    for (int dx = -kFeatureNmsRadius; dx <= kFeatureNmsRadius; ++dx)
+                    {
+                        const int xx = x + dx;
+                        if (xx >= 0 && xx < p_gray.cols && row[xx] > mag[x])
+                        {
+                            isMax = false;
+                            break;
+                        }
+                    }
+                }
+                if (isMax)
+                {
+                    candidates.push_back({{static_cast<float>(x), static_cast<float>(y), ang[x]}, mag[x]});
+                }
+            }
+        }
+        if (candidates.size() < kMinFeatures)
+        {
+            return false;
+        }
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const Scored &lhs, const Scored &rhs) { return lhs.magnitude > rhs.magnitude; });
+
+        // 按梯度强度优先、最小间距约束挑选分散的特征点；点数不足时逐步缩小间距
+        const size_t target = std::clamp<size_t>(p_model.numFeatures, kMinFeatures, kMaxFeatures);
+        float distance = static_cast<float>(candidates.size() / target + 1);
+        std::vector<BaseFeature> picked;
+        while (true)
+        {
+            picked.clear();
+            const float minDist2 = distance * distance;
+            for (const Scored &candidate : candidates)
+            {
+                bool farEnough = true;
+                for (const BaseFeature &existing : picked)
+                {
+                    const float dx = existing.x - candidate.feature.x;
+                    const float dy = existing.y - candidate.feature.y;
+                    if (dx * dx + dy * dy < minDist2)
+                    {
+                        farEnough = false;
+                        break;
+                    }
+                }
+                if (farEnough)
+                {
+                    picked.push_back(candidate.feature);
+                    if (picked.size() >= target)
+                    {
+                        break;
+                    }
+                }
+            }
+            if (picked.size() >= target || distance <= 1.0f)
+            {
+                break;
+            }
+            distance -= 1.0f;
+        }
+        if (picked.size() < kMinFeatures)
+        {
+            return false;
+        }
+
+        std::vector<cv::Point2f> points;
+        points.reserve(picked.size());
+        for (const BaseFeature &feature : picked)
+        {
+            points.emplace_back(feature.x, feature.y);
+        }
+        p_model.center = cv::minAreaRect(points).center;
+        p_model.features = std::move(picked);
+        return true;
+    }
+
+    void ShapeMatchEngine::buildTemplates(Model &p_model)
+    {
+        std::vector<float> angles;
+        if (p_model.angleStep <= 0.0f || p_model.angleExtent <= 0.0f)
+        {
+            angles.push_back(p_model.angleStart);
+        }
+        else
+        {
+            // 整圈范围不重复生成首尾同一角度
+            const bool fullCircle = p_model.angleExtent >= 360.0f - 1e-3f;
+            const int steps = static_cast<int>(std::floor(p_model.angleExtent / p_model.angleStep + 1e-4f));
+            for (int i = 0; i <= steps; ++i)
+            {
+                const float a = p_model.angleStart + p_model.angleStep * static_cast<float>(i);
+                if (fullCircle && i > 0 && a >= p_model.angleStart + 360.0f - 1e-3f)
+                {
+                    break;
+                }
+                angles.push_back(a);
+            }
+        }
+
+        std::vector<float> scales;
+        const float scaleLow = std::min(p_model.scaleMin, p_model.scaleMax);
+        const float scaleHigh = std::max(p_model.scaleMin, p_model.scaleMax);
+        if (p_model.scaleStep <= 0.0f || scaleHigh - scaleLow < 1e-6f)
+        {
+            scales.push_back(scaleLow > 0.0f ? scaleLow : 1.0f);
+        }
+        else
+        {
+            const int steps = static_cast<int>(std::floor((scaleHigh - scaleLow) / p_model.scaleStep + 1e-4f));
+            for (int i = 0; i <= steps; ++i)
+            {
+                scales.push_back(scaleLow + p_model.scaleStep * static_cast<float>(i));
+            }
+        }
+
+        p_model.templates.clear();
+        p_model.templates.reserve(angles.size() * scales.size());
+        FeatureStore &store = p_model.store;
+        store = FeatureStore();
+        const size_t capacity = angles.size() * scales.size() * p_model.features.size();
+        store.x.reserve(capacity);
+        store.y.reserve(capacity);
+        store.label.reserve(capacity);
+        std::vector<cv::Point> positions(p_model.features.size());
+        std::vector<int> labels(p_model.features.size());
+        for (float scale : scales)
+        {
+            for (float angle : angles)
+            {
+                const cv::Matx23d rotation = cv::getRotationMatrix2D(p_model.center, angle, scale);
+                const cv::Matx23f affine(rotation);
+                // 方向向量只做旋转；getRotationMatrix2D 线性部分为 scale*[cos sin; -sin cos]
+                const float rad = angle * static_cast<float>(CV_PI / 180.0);
+                const float c = std::cos(rad);
+                const float s = std::sin(rad);
+
+                int minX = INT32_MAX, minY = INT32_MAX, maxX = INT32_MIN, maxY = INT32_MIN;
+                for (size_t i = 0; i < p_model.features.size(); ++i)
+                {
+                    const BaseFeature &feature = p_model.features[i];
+                    const cv::Point2f moved(affine(0, 0) * feature.x + affine(0, 1) * feature.y + affine(0, 2),
+                                            affine(1, 0) * feature.x + affine(1, 1) * feature.y + affine(1, 2));
+                    positions[i] = cv::Point(cvRound(moved.x), cvRound(moved.y));
+                    minX = std::min(minX, positions[i].x);
+                    minY = std::min(minY, positions[i].y);
+                    maxX = std::max(maxX, positions[i].x);
+                    maxY = std::max(maxY, positions[i].y);
+
+                    const float featureRad = feature.angle * static_cast<float>(CV_PI / 180.0);
+                    const float gx = std::cos(featureRad);
+                    const float gy = std::sin(featureRad);
+                    const float rotated = std::atan2(-s * gx + c * gy, c * gx + s * gy) * static_cast<float>(180.0 / CV_PI);
+                    int label = quantizeAngle(rotated, p_model.labelCount);
+                    if (p_model.polarity == cptOpposite)
+                    {
+                        label = (label + 8) & 15; // 反极性：期望搜索图中梯度方向相反
+                    }
+                    labels[i] = label;
+                }
+
+                if (maxX - minX >= INT16_MAX || maxY - minY >= INT16_MAX)
+                {
+                    continue; // 坐标按 int16 存放
+                }
+
+                ShapeTemplate shape;
+                shape.angle = angle;
+                shape.scale = scale;
+                shape.toLocal = affine;
+                shape.toLocal(0, 2) -= static_cast<float>(minX);
+                shape.toLocal(1, 2) -= static_cast<float>(minY);
+                shape.tlX = minX;
+                shape.tlY = minY;
+                shape.width = maxX - minX + 1;
+                shape.height = maxY - minY + 1;
+                shape.first = static_cast<uint32_t>(store.size());
+                for (size_t i = 0; i < p_model.features.size(); ++i)
+                {
+                    const int16_t x = static_cast<int16_t>(positions[i].x - minX);
+                    const int16_t y = static_cast<int16_t>(positions[i].y - minY);
+                    // 缩小时多个特征可能落到同一像素，只保留第一个，避免重复计分
+                    bool duplicate = false;
+                    for (size_t j = shape.first; j < store.size() && !duplicate; ++j)
+                    {
+                        duplicate = store.x[j] == x && store.y[j] == y;
+                    }
+                    if (!duplicate)
+                    {
+                        store.x.push_back(x);
+                        store.y.push_back(y);
+                        store.label.push_back(static_cast<uint8_t>(labels[i]));
+                    }
+                }
+                shape.count = static_cast<uint32_t>(store.size() - shape.first);
+                p_model.templates.push_back(shape);
+            }
+        }
+        // 缩小时去重的特征不再占用预留空间
+        store.x.shrink_to_fit();
+        store.y.shrink_to_fit();
+        store.label.shrink_to_fit();
+    }
+
+    bool ShapeMatchEngine::create_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                              float _angle_start, float _angle_extent,
+                                              float _angle_step, float _scale_min, float _scale_max, float _scale_step,
+                                              float _weak_thresh, float _strong_thresh,
+                                              size_t _num_features,
+                                              CPolarityType _type)
+    {
+        clear();
+        const cv::Mat image = _image.getMat();
+        if (image.empty())
+        {
+            return false;
+        }
+        const cv::Mat mask = _mask.getMat();
+        if (!mask.empty() && (mask.size() != image.size() || mask.type() != CV_8UC1))
+        {
+            return false;
+        }
+
+        auto model = std::make_shared<Model>();
+        model->polarity = _type;
+        model->labelCount = _type == cptIgnore ? 8 : 16;
+        model->angleStart = _angle_start;
+        model->angleExtent = _angle_extent;
+        model->angleStep = _angle_step;
+        model->scaleMin = _scale_min;
+        model->scaleMax = _scale_max;
+        model->scaleStep = _scale_step;
+        model->weakThresh = _weak_thresh;
+        model->strongThresh = _strong_thresh;
+        model->numFeatures = _num_features;
+        if (!extractFeatures(toGray(image), mask, *model))
+        {
+            return false;
+        }
+        buildTemplates(*model);
+        if (model->templates.empty())
+        {
+            return false;
+        }
+        m_model = std::move(model);
+        return true;
+    }
+
+    bool ShapeMatchEngine::createShapeModelFromEdges(const std::vector<cv::Point2f> &p_points, const std::vector<float> &p_angles,
+                                                     float p_angleStart, float p_angleExtent, float p_angleStep,
+                                                     float p_scaleMin, float p_scaleMax, float p_scaleStep,
+                                                     float p_weakThresh, size_t p_numFeatures, CPolarityType p_type)
+    {
+        clear();
+        if (p_points.size() != p_angles.size() || p_points.size() < kMinFeatures)
+        {
+            return false;
+        }
+
+        auto model = std::make_shared<Model>();
+        model->polarity = p_type;
+        model->labelCount = p_type == cptIgnore ? 8 : 16;
+        model->angleStart = p_angleStart;
+        model->angleExtent = p_angleExtent;
+        model->angleStep = p_angleStep;
+        model->scaleMin = p_scaleMin;
+        model->scaleMax = p_scaleMax;
+        model->scaleStep = p_scaleStep;
+        model->weakThresh = p_weakThresh; // 搜索时的梯度阈值；strongThresh 只用于提取特征，保持默认
+        model->numFeatures = p_numFeatures;
+
+        // 边缘点按轮廓顺序给出，等间隔抽取即沿轮廓均匀分布
+        const size_t target = std::min(p_points.size(), std::clamp<size_t>(p_numFeatures, kMinFeatures, kMaxFeatures));
+        std::vector<cv::Point2f> points;
+        points.reserve(target);
+        model->features.reserve(target);
+        for (size_t i = 0; i < target; ++i)
+        {
+            const size_t index = i * p_points.size() / target;
+            float angle = std::fmod(p_angles[index], 360.0f);
+            if (angle < 0.0f)
+            {
+                angle += 360.0f;
+            }
+            model->features.push_back({p_points[index].x, p_points[index].y, angle});
+            points.push_back(p_points[index]);
+        }
+        model->center = cv::minAreaRect(points).center;
+
+        buildTemplates(*model);
+        if (model->templates.empty())
+        {
+            return false;
+        }
+        m_model = std::move(model);
+        return true;
+    }
+
+    bool ShapeMatchEngine::create_one_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                                  float _weak_thresh, float _strong_thresh,
+                                                  size_t _num_features, CPolarityType _type)
+    {
+        return create_shape_model(_image, _mask, 0.0f, 0.0f, 0.0f, 1.0f, 1.0f, 0.0f,
+                                  _weak_thresh, _strong_thresh, _num_features, _type);
+    }
+
+    void ShapeMatchEngine::prepareSearch(const cv::Mat &p_gray, const cv::Mat &p_mask)
+    {
+        const Model &model = *m_model;
+        const int rows = p_gray.rows;
+        const int cols = p_gray.cols;
+
+        // 1. 梯度方向量化 + 3×3 投票
+        cv::Mat magnitude, angle;
+        computeGradient(p_gray, magnitude, angle);
+        cv::Mat bins(p_gray.size(), CV_8U);
+        for (int y = 0; y < rows; ++y)
+        {
+            const float *ang = angle.ptr<float>(y);
+            uchar *bin = bins.ptr<uchar>(y);
+            for (int x = 0; x < cols; ++x)
+            {
+                bin[x] = static_cast<uchar>(quantizeAngle(ang[x], model.labelCount));
+            }
+        }
+        m_quantized.create(p_gray.size(), CV_16U);
+        m_quantized.setTo(cv::Scalar::all(0));
+        for (int y = 1; y < rows - 1; ++y)
+        {
+            const float *mag = magnitude.ptr<float>(y);
+            const uchar *mask = p_mask.empty() ? nullptr : p_mask.ptr<uchar>(y);
+            uint16_t *out = m_quantized.ptr<uint16_t>(y);
+            for (int x = 1; x < cols - 1; ++x)
+            {
+                if (mag[x] <= model.weakThresh || (mask && mask[x] == 0))
+                {
+                    continue;
+                }
+                int histogram[16] = {0};
+                for (int dy = -1; dy <= 1; ++dy)
+                {
+                    const uchar *bin = bins.ptr<uchar>(y + dy);
+                    ++histogram[bin[x - 1]];
+                    ++histogram[bin[x]];
+                    ++histogram[bin[x + 1]];
+                }
+                const int *best = std::max_element(histogram, histogram + model.labelCount);
+                if (*best >= kVoteMin)
+                {
+                    out[x] = static_cast<uint16_t>(1u << (best - histogram));
+                }
+            }
+        }
+
+        // 2. 方向扩散：每个像素合并其右下 T×T 邻域的方向位，步长 T 的粗搜索不会漏掉峰值
+        const int T = kSpread;
+        m_spread.create(p_gray.size(), CV_16U);
+        m_spread.setTo(cv::Scalar::all(0));
+        for (int r = 0; r < T && r < rows; ++r)
+        {
+            for (int c = 0; c < T && c < cols; ++c)
+            {
+                cv::Mat dst = m_spread(cv::Rect(0, 0, cols - c, rows - r));
+                cv::bitwise_or(dst, m_quantized(cv::Rect(c, r, cols - c, rows - r)), dst);
+            }
+        }
+
+        // 3. 响应图按 T×T 相位线性化：相位 (ox, oy) 的网格 (gx, gy) 对应像素 (gx*T+ox, gy*T+oy)
+        m_gridCols = (cols + T - 1) / T;
+        m_gridRows = (rows + T - 1) / T;
+        const int gridArea = m_gridCols * m_gridRows;
+        const std::vector<ResponseLut> &luts = responseLuts(model.labelCount);
+        m_linear.resize(model.labelCount);
+        for (int label = 0; label < model.labelCount; ++label)
+        {
+            cv::Mat &memory = m_linear[label];
+            memory.create(T * T, gridArea, CV_8U);
+            memory.setTo(cv::Scalar::all(0));
+            const ResponseLut &lut = luts[label];
+            for (int y = 0; y < rows; ++y)
+            {
+                const uint16_t *spread = m_spread.ptr<uint16_t>(y);
+                const int oy = y % T;
+                const int rowBase = (y / T) * m_gridCols;
+                for (int x = 0; x < cols; ++x)
+                {
+                    if (spread[x] == 0)
+                    {
+                        continue;
+                    }
+                    memory.ptr<uchar>(oy * T + x % T)[rowBase + x / T] = lookupResponse(lut, spread[x]);
+                }
+            }
+        }
+    }
+
+    void ShapeMatchEngine::accumulate(const ShapeTemplate &p_templ, int p_cols, int p_rows)
+    {
+        const int T = kSpread;
+        m_acc.assign(static_cast<size_t>(p_cols) * static_cast<size_t>(p_rows), 0);
+        const FeatureStore &store = m_model->store;
+        const uint32_t end = p_templ.first + p_templ.count;
+        for (uint32_t i = p_templ.first; i < end; ++i)
+        {
+            const int x = store.x[i];
+            const int y = store.y[i];
+            const uchar *memory = m_linear[store.label[i]].ptr<uchar>((y % T) * T + x % T)
+                                  + (y / T) * m_gridCols + x / T;
+            for (int gy = 0; gy < p_rows; ++gy)
+            {
+                accumulateRow(m_acc.data() + static_cast<size_t>(gy) * p_cols, memory + gy * m_gridCols, p_cols);
+            }
+        }
+    }
+
+    int ShapeMatchEngine::fineScore(const ShapeTemplate &p_templ, int p_x, int p_y) const
+    {
+        const std::vector<ResponseLut> &luts = responseLuts(m_model->labelCount);
+        const FeatureStore &store = m_model->store;
+        const uint32_t end = p_templ.first + p_templ.count;
+        int score = 0;
+        for (uint32_t i = p_templ.first; i < end; ++i)
+        {
+            const int x = p_x + store.x[i];
+            const int y = p_y + store.y[i];
+            if (x < 0 || y < 0 || x >= m_quantized.cols || y >= m_quantized.rows)
+            {
+                continue;
+            }
+            score += lookupResponse(luts[store.label[i]], m_quantized.at<uint16_t>(y, x));
+        }
+        return score;
+    }
+
+    Match ShapeMatchEngine::buildMatch(const Candidate &p_candidate) const
+    {
+        const ShapeTemplate &shape = m_model->templates[p_candidate.templateId];
+        const int T = kSpread;
+
+        // 粗位置只精确到 T 像素：在未扩散的量化图上逐像素细化，再用抛物线拟合亚像素
+        const int originX = p_candidate.gridX * T - 2;
+        const int originY = p_candidate.gridY * T - 2;
+        const int window = T + 4;
+        std::vector<int> scores(static_cast<size_t>(window * window));
+        for (int dy = 0; dy < window; ++dy)
+        {
+            for (int dx = 0; dx < window; ++dx)
+            {
+                scores[dy * window + dx] = fineScore(shape, originX + dx, originY + dy);
+            }
+        }
+        int bestX = 2;
+        int bestY = 2;
+        int bestScore = -1;
+        for (int dy = 1; dy < window - 1; ++dy)
+        {
+            for (int dx = 1; dx < window - 1; ++dx)
+            {
+                if (scores[dy * window + dx] > bestScore)
+                {
+                    bestScore = scores[dy * window + dx];
+                    bestX = dx;
+                    bestY = dy;
+                }
+            }
+        }
+        float subX = 0.0f;
+        float subY = 0.0f;
+        if (bestScore > 0)
+        {
+            subX = parabolaOffset(scores[bestY * window + bestX - 1], bestScore, scores[bestY * window + bestX + 1]);
+            subY = parabolaOffset(scores[(bestY - 1) * window + bestX], bestScore, scores[(bestY + 1) * window + bestX]);
+        }
+        else
+        {
+            bestX = 2;
+            bestY = 2;
+        }
+
+        Match match;
+        match.x = originX + bestX;
+        match.y = originY + bestY;
+        match.xPrecise = static_cast<float>(match.x) + subX;
+        match.yPrecise = static_cast<float>(match.y) + subY;
+        match.angle = shape.angle;
+        match.scale = shape.scale;
+        match.init_angle = shape.angle;
+        match.init_scale = shape.scale;
+        match.similarity = 100.0f * static_cast<float>(p_candidate.score)
+                           / static_cast<float>(4 * std::max<size_t>(1, shape.count));
+        match.class_id = "default";
+        match.template_id = p_candidate.templateId;
+        match.templ = expandTemplate(*m_model, shape);
+        match.width = shape.width;
+        match.height = shape.height;
+
+        // mat：训练图坐标 → 搜索图坐标
+        match.mat = cv::Mat::eye(3, 3, CV_32F);
+        for (int r = 0; r < 2; ++r)
+        {
+            for (int c = 0; c < 3; ++c)
+            {
+                match.mat.at<float>(r, c) = shape.toLocal(r, c);
+            }
+        }
+        match.mat.at<float>(0, 2) += match.xPrecise;
+        match.mat.at<float>(1, 2) += match.yPrecise;
+
+        match.pts.reserve(m_model->features.size());
+        for (const BaseFeature &feature : m_model->features)
+        {
+            match.pts.push_back(match.transPt(cv::Point2f(feature.x, feature.y)));
+        }
+        return match;
+    }
+
+    std::vector<Match> ShapeMatchEngine::find_shape_model(cv::InputArray _image, cv::InputArray _mask, float _threshold)
+    {
+        std::vector<Match> matches;
+        if (isEmpty())
+        {
+            return matches;
+        }
+        const cv::Mat image = _image.getMat();
+        if (image.empty())
+        {
+            return matches;
+        }
+        const cv::Mat mask = _mask.getMat();
+        CV_Assert(mask.empty() || (mask.size() == image.size() && mask.type() == CV_8UC1));
+
+        prepareSearch(toGray(image), mask);
+
+        const int T = kSpread;
+        const float threshold = std::clamp(_threshold, 0.0f, 100.0f);
+        std::vector<Candidate> candidates;
+        for (size_t id = 0; id < m_model->templates.size(); ++id)
+        {
+            const ShapeTemplate &shape = m_model->templates[id];
+            const int featureCount = static_cast<int>(shape.count);
+            const int cols = m_gridCols - (shape.width - 1) / T;
+            const int rows = m_gridRows - (shape.height - 1) / T;
+            if (featureCount == 0 || cols <= 0 || rows <= 0)
+            {
+                continue;
+            }
+            accumulate(shape, cols, rows);
+
+            const int minScore = std::max(1, static_cast<int>(std::ceil(threshold / 100.0f * 4.0f * static_cast<float>(featureCount))));
+            for (int gy = 0; gy < rows; ++gy)
+            {
+                const uint16_t *row = m_acc.data() + static_cast<size_t>(gy) * cols;
+                for (int gx = 0; gx < cols; ++gx)
+                {
+                    const int score = row[gx];
+                    if (score < minScore)
+                    {
+                        continue;
+                    }
+                    // 只保留 3×3 网格内的局部极大
+                    bool isMax = true;
+                    for (int dy = -1; dy <= 1 && isMax; ++dy)
+                    {
+                        const int yy = gy + dy;
+                        if (yy < 0 || yy >= rows)
+                        {
+                            continue;
+                        }
+                        const uint16_t *neighbour = m_acc.data() + static_cast<size_t>(yy) * cols;
+                        for (int dx = -1; dx <= 1; ++dx)
+                        {
+                            const int xx = gx + dx;
+                            if (xx >= 0 && xx < cols && neighbour[xx] > score)
+                            {
+                                isMax = false;
+                                break;
+                            }
+                        }
+                    }
+                    if (isMax)
+                    {
+                        candidates.push_back({static_cast<int>(id), gx, gy, score});
+                    }
+                }
+            }
+        }
+
+        // 跨模板非极大值抑制：按归一化分数排序，中心距离小于半个模板尺寸的视为同一目标
+        auto normalized = [this](const Candidate &c) {
+            return static_cast<float>(c.score) / static_cast<float>(m_model->templates[c.templateId].count);
+        };
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [&normalized](const Candidate &lhs, const Candidate &rhs) { return normalized(lhs) > normalized(rhs); });
+        auto centerOf = [this](const Candidate &c) {
+            const ShapeTemplate &shape = m_model->templates[c.templateId];
+            const cv::Point2f &center = m_model->center;
+            return cv::Point2f(shape.toLocal(0, 0) * center.x + shape.toLocal(0, 1) * center.y + shape.toLocal(0, 2) + static_cast<float>(c.gridX * kSpread),
+                               shape.toLocal(1, 0) * center.x + shape.toLocal(1, 1) * center.y + shape.toLocal(1, 2) + static_cast<float>(c.gridY * kSpread));
+        };
+        std::vector<Candidate> kept;
+        std::vector<cv::Point2f> keptCenters;
+        std::vector<float> keptRadius;
+        for (const Candidate &candidate : candidates)
+        {
+            const cv::Point2f center = centerOf(candidate);
+            bool suppressed = false;
+            for (size_t i = 0; i < kept.size(); ++i)
+            {
+                const cv::Point2f d = center - keptCenters[i];
+                if (d.x * d.x + d.y * d.y < keptRadius[i] * keptRadius[i])
+                {
+                    suppressed = true;
+                    break;
+                }
+            }
+            if (suppressed)
+            {
+                continue;
+            }
+            const ShapeTemplate &shape = m_model->templates[candidate.templateId];
+            kept.push_back(candidate);
+            keptCenters.push_back(center);
+            keptRadius.push_back(std::max(static_cast<float>(kSpread), 0.5f * static_cast<float>(std::min(shape.width, shape.height))));
+        }
+
+        matches.reserve(kept.size());
+        for (const Candidate &candidate : kept)
+        {
+            matches.push_back(buildMatch(candidate));
+        }
+        std::stable_sort(matches.begin(), matches.end(),
+                         [](const Match &lhs, const Match &rhs) { return lhs.similarity > rhs.similarity; });
+        return matches;
+    }
+
+    std::vector<Match> ShapeMatchEngine::find_pic_model(cv::InputArray _image, cv::InputArray _model, cv::InputArray _mask,
+                                                        cv::InputArray _model_mask, float _threshold,
+                                                        float _angle_start, float _angle_extent,
+                                                        float _angle_step, float _scale_min,
+                                                        float _scale_max, float _scale_step,
+                                                        float _weak_thresh, size_t _num_features)
+    {
+        ShapeMatchEngine engine;
+        if (!engine.create_shape_model(_model, _model_mask, _angle_start, _angle_extent, _angle_step,
+                                       _scale_min, _scale_max, _scale_step,
+                                       _weak_thresh, kDefaultStrongThresh, _num_features, cptIgnore))
+        {
+            return {};
+        }
+        return engine.find_shape_model(_image, _mask, _threshold);
+    }
+
+    Template ShapeMatchEngine::getTempl(int p_id) const
+    {
+        if (isEmpty() || p_id < 0 || p_id >= static_cast<int>(m_model->templates.size()))
+        {
+            return Template();
+        }
+        return expandTemplate(*m_model, m_model->templates[p_id]);
+    }
+
+    Template ShapeMatchEngine::expandTemplate(const Model &p_model, const ShapeTemplate &p_templ)
+    {
+        Template templ;
+        templ.tl_x = p_templ.tlX;
+        templ.tl_y = p_templ.tlY;
+        templ.width = p_templ.width;
+        templ.height = p_templ.height;
+        templ.pyramid_level = 0;
+        templ.features.reserve(p_templ.count);
+        const uint32_t end = p_templ.first + p_templ.count;
+        for (uint32_t i = p_templ.first; i < end; ++i)
+        {
+            templ.features.emplace_back(p_model.store.x[i], p_model.store.y[i], p_model.store.label[i]);
+        }
+        return templ;
+    }
+
+    ShapeMatchEngine::MemoryUsage ShapeMatchEngine::memoryUsage() const
+    {
+        MemoryUsage usage;
+        if (!m_model)
+        {
+            return usage;
+        }
+        usage.templates = m_model->templates.size();
+        usage.features = m_model->store.size();
+        usage.featureBytes = m_model->store.bytes();
+        usage.templateBytes = m_model->templates.capacity() * sizeof(ShapeTemplate);
+        usage.baseBytes = sizeof(Model) + m_model->features.capacity() * sizeof(BaseFeature);
+        return usage;
+    }
+
+    size_t ShapeMatchEngine::templateBytes(int p_id) const
+    {
+        if (isEmpty() || p_id < 0 || p_id >= static_cast<int>(m_model->templates.size()))
+        {
+            return 0;
+        }
+        return sizeof(ShapeTemplate) + m_model->templates[p_id].count * (2 * sizeof(int16_t) + sizeof(uint8_t));
+    }
+
+    float ShapeMatchEngine::getAngle(int p_id) const
+    {
+        if (isEmpty() || p_id < 0 || p_id >= static_cast<int>(m_model->templates.size()))
+        {
+            return 0.0f;
+        }
+        return m_model->templates[p_id].angle;
+    }
+
+    float ShapeMatchEngine::getScale(int p_id) const
+    {
+        if (isEmpty() || p_id < 0 || p_id >= static_cast<int>(m_model->templates.size()))
+        {
+            return 1.0f;
+        }
+        return m_model->templates[p_id].scale;
+    }
+
+    // 只保存基准特征与生成参数，读取时重新生成旋转/缩放模板，文件与模板数量无关
+    bool ShapeMatchEngine::write_shape_model(const cv::String _fileName) const
+    {
+        if (isEmpty())
+        {
+            return false;
+        }
+        try
+        {
+            cv::FileStorage fs(_fileName, cv::FileStorage::WRITE);
+            if (!fs.isOpened())
+            {
+                return false;
+            }
+            const Model &model = *m_model;
+            cv::Mat features(static_cast<int>(model.features.size()), 3, CV_32F);
+            for (int i = 0; i < features.rows; ++i)
+            {
+                features.at<float>(i, 0) = model.features[i].x;
+                features.at<float>(i, 1) = model.features[i].y;
+                features.at<float>(i, 2) = model.features[i].angle;
+            }
+            fs << "engine" << "ShapeMatchEngine";
+            fs << "version" << kModelVersion;
+            fs << "polarity" << static_cast<int>(model.polarity);
+            fs << "center" << model.center;
+            fs << "angle_start" << model.angleStart;
+            fs << "angle_extent" << model.angleExtent;
+            fs << "angle_step" << model.angleStep;
+            fs << "scale_min" << model.scaleMin;
+            fs << "scale_max" << model.scaleMax;
+            fs << "scale_step" << model.scaleStep;
+            fs << "weak_thresh" << model.weakThresh;
+            fs << "strong_thresh" << model.strongThresh;
+            fs << "num_features" << static_cast<int>(model.numFeatures);
+            fs << "features" << features;
+            return true;
+        }
+        catch (const cv::Exception &)
+        {
+            return false;
+        }
+    }
+
+    bool ShapeMatchEngine::read_shape_model(const cv::String _fileName)
+    {
+        try
+        {
+            cv::FileStorage fs(_fileName, cv::FileStorage::READ);
+            if (!fs.isOpened() || static_cast<std::string>(fs["engine"]) != "ShapeMatchEngine"
+                || static_cast<int>(fs["version"]) != kModelVersion)
+            {
+                return false;
+            }
+            auto model = std::make_shared<Model>();
+            const int polarity = static_cast<int>(fs["polarity"]);
+            if (polarity < cptIgnore || polarity >= cptMax)
+            {
+                return false;
+            }
+            model->polarity = static_cast<CPolarityType>(polarity);
+            model->labelCount = model->polarity == cptIgnore ? 8 : 16;
+            fs["center"] >> model->center;
+            fs["angle_start"] >> model->angleStart;
+            fs["angle_extent"] >> model->angleExtent;
+            fs["angle_step"] >> model->angleStep;
+            fs["scale_min"] >> model->scaleMin;
+            fs["scale_max"] >> model->scaleMax;
+            fs["scale_step"] >> model->scaleStep;
+            fs["weak_thresh"] >> model->weakThresh;
+            fs["strong_thresh"] >> model->strongThresh;
+            model->numFeatures = static_cast<size_t>(std::max(0, static_cast<int>(fs["num_features"])));
+            cv::Mat features;
+            fs["features"] >> features;
+            if (features.empty() || features.cols != 3 || features.type() != CV_32F)
+            {
+                return false;
+            }
+            model->features.reserve(features.rows);
+            for (int i = 0; i < features.rows; ++i)
+            {
+                model->features.push_back({features.at<float>(i, 0), features.at<float>(i, 1), features.at<float>(i, 2)});
+            }
+            buildTemplates(*model);
+            if (model->templates.empty())
+            {
+                return false;
+            }
+            m_model = std::move(model);
+            return true;
+        }
+        catch (const cv::Exception &)
+        {
+            return false;
+        }
+    }
+
+    bool ShapeMatchEngine::isEmpty() const
+    {
+        return !m_model || m_model->templates.empty();
+    }
+
+    void ShapeMatchEngine::clear()
+    {
+        m_model.reset();
+    }
+
+    cv::Point2f Match::transPt(cv::Point2f p_pt) const
+    {
+        if (mat.rows < 2 || mat.cols < 3)
+        {
+            return p_pt;
+        }
+        cv::Mat m;
+        if (mat.type() == CV_32F)
+        {
+            m = mat;
+        }
+        else
+        {
+            mat.convertTo(m, CV_32F);
+        }
+        const float x = m.at<float>(0, 0) * p_pt.x + m.at<float>(0, 1) * p_pt.y + m.at<float>(0, 2);
+        const float y = m.at<float>(1, 0) * p_pt.x + m.at<float>(1, 1) * p_pt.y + m.at<float>(1, 2);
+        if (m.rows >= 3)
+        {
+            const float w = m.at<float>(2, 0) * p_pt.x + m.at<float>(2, 1) * p_pt.y + m.at<float>(2, 2);
+            if (std::abs(w) > 1e-12f && std::abs(w - 1.0f) > 1e-6f)
+            {
+                return cv::Point2f(x / w, y / w);
+            }
+        }
+        return cv::Point2f(x, y);
+    }
+
+    std::vector<cv::Point2f> Match::transPts(std::vector<cv::Point2f> p_pts) const
+    {
+        for (cv::Point2f &pt : p_pts)
+        {
+            pt = transPt(pt);
+        }
+        return p_pts;
+    }
+
+    ITemplMatch *newTemplMatch()
+    {
+        return new ShapeMatchEngine();
+    }
+
+    ITemplMatch *newTemplMatch(ITemplMatch *p_templMatch)
+    {
+        if (const auto *engine = dynamic_cast<const ShapeMatchEngine *>(p_templMatch))
+        {
+            return new ShapeMatchEngine(*engine);
+        }
+        return new ShapeMatchEngine();
+    }
+}
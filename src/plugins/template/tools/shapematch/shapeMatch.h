@@ -0,0 +1,157 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <opencv2/core.hpp>
+#include <bscv/templmatch.h>
+
+namespace TIGER_BSVISION
+{
+    // 仓库内的形状匹配引擎，实现与预编译 BSCV 相同的 ITemplMatch 接口，供没有 BSCV 的平台（Linux）构建使用，
+    // 也可作为与 BSCV 对比性能/精度的基准。
+    // 流程：梯度方向量化（3×3 投票）→ T×T 方向扩散 → 按方向查表得到响应图 → 按 T×T 相位线性化，
+    // 每个模板特征对应线性内存中的一段连续行，逐行 SIMD 累加得到步长为 T 的粗相似度图，再在原分辨率上细化位置。
+    // 旋转/缩放模板由基准特征点经仿射变换生成，不对每个角度重新提取特征。
+    // 全部旋转/缩放模板的特征按结构数组存放在模型内一块连续存储中（int16 坐标、8 位方向，每个特征 5 字节），
+    // 模板只记录自己的区间；累加时顺序读取，缓存命中率高，同样内存可容纳更多零件。
+    // 单个实例非线程安全：搜索缓冲按实例复用；多线程请通过 newTemplMatch(ITemplMatch*) 克隆，克隆共享只读模型。
+    class ShapeMatchEngine : public ITemplMatch
+    {
+    public:
+        static constexpr int kSpread = 4;            // 方向扩散邻域 T，也是粗搜索步长
+        static constexpr size_t kMaxFeatures = 8191; // 保证 16 位累加不溢出（每点最高 4 分）
+        static constexpr size_t kMinFeatures = 8;    // 少于此数的模板视为无效
+
+        ShapeMatchEngine() = default;
+        ShapeMatchEngine(const ShapeMatchEngine &p_other);
+        ShapeMatchEngine &operator=(const ShapeMatchEngine &) = delete;
+
+        bool create_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                float _angle_start, float _angle_extent,
+                                float _angle_step, float _scale_min, float _scale_max, float _scale_step,
+                                float _weak_thresh, float _strong_thresh,
+                                size_t _num_features,
+                                CPolarityType _type) override;
+        bool create_one_shape_model(cv::InputArray _image, cv::InputArray _mask,
+                                    float _weak_thresh, float _strong_thresh,
+                                    size_t _num_features, CPolarityType _type) override;
+
+        std::vector<Match> find_shape_model(cv::InputArray _image, cv::InputArray _mask, float _threshold) override;
+        std::vector<Match> find_pic_model(cv::InputArray _image, cv::InputArray _model, cv::InputArray _mask,
+                                          cv::InputArray _model_mask, float _threshold,
+                                          float _angle_start, float _angle_extent,
+                                          float _angle_step, float _scale_min,
+                                          float _scale_max, float _scale_step,
+                                          float _weak_thresh, size_t _num_features) override;
+
+        // 由已知边缘点直接生成模型（如矢量路径采样），跳过梯度计算与特征提取：p_points 为训练图坐标，
+        // p_angles 为对应的梯度方向（度），p_weakThresh 为搜索图梯度阈值。点数多于 p_numFeatures 时沿输入顺序等间隔抽取
+        bool createShapeModelFromEdges(const std::vector<cv::Point2f> &p_points, const std::vector<float> &p_angles,
+                                       float p_angleStart, float p_angleExtent, float p_angleStep,
+                                       float p_scaleMin, float p_scaleMax, float p_scaleStep,
+                                       float p_weakThresh, size_t p_numFeatures, CPolarityType p_type);
+
+        Template getTempl(int p_id) const override;
+        float getAngle(int p_id) const override;
+        float getScale(int p_id) const override;
+
+        bool write_shape_model(const cv::String _fileName) const override;
+        bool read_shape_model(const cv::String _fileName) override;
+
+        bool isEmpty() const override;
+        void clear() override;
+
+        struct MemoryUsage
+        {
+            size_t templates = 0;     // 旋转/缩放模板（变体）数
+            size_t features = 0;      // 全部模板的特征总数
+            size_t featureBytes = 0;  // 特征存储（坐标 + 方向）
+            size_t templateBytes = 0; // 模板头（位姿、外接框、特征区间）
+            size_t baseBytes = 0;     // 基准特征（生成模板与输出特征点用）
+            size_t totalBytes() const { return featureBytes + templateBytes + baseBytes; }
+        };
+        // 模型占用的内存；克隆共享同一模型，不重复计算
+        MemoryUsage memoryUsage() const;
+        // 单个模板（变体）占用的字节数：模板头 + 特征，越界返回 0
+        size_t templateBytes(int p_id) const;
+
+    private:
+        struct BaseFeature
+        {
+            float x;     // 训练图坐标
+            float y;
+            float angle; // 梯度方向（度，0~360）
+        };
+
+        // 结构数组：第 i 个特征为 (x[i], y[i], label[i])，坐标相对所属模板外接框左上角
+        struct FeatureStore
+        {
+            std::vector<int16_t> x;
+            std::vector<int16_t> y;
+            std::vector<uint8_t> label;
+
+            size_t size() const { return label.size(); }
+            size_t bytes() const { return x.capacity() * sizeof(int16_t) + y.capacity() * sizeof(int16_t) + label.capacity(); }
+        };
+
+        struct ShapeTemplate
+        {
+            float angle;
+            float scale;
+            cv::Matx23f toLocal; // 训练图坐标 → 模板外接框坐标
+            int tlX;             // 外接框在训练图中的位置
+            int tlY;
+            int width;
+            int height;
+            uint32_t first;      // 特征在 FeatureStore 中的区间 [first, first + count)
+            uint32_t count;
+        };
+
+        struct Model
+        {
+            std::vector<BaseFeature> features;
+            cv::Point2f center;  // 旋转/缩放中心（特征点最小外接矩形中心）
+            CPolarityType polarity = cptIgnore;
+            int labelCount = 8;  // 忽略极性时 8 个方向（180° 周期），否则 16 个方向（360° 周期）
+            float angleStart = 0.f;
+            float angleExtent = 0.f;
+            float angleStep = 1.f;
+            float scaleMin = 1.f;
+            float scaleMax = 1.f;
+            float scaleStep = 0.01f;
+            float weakThresh = 30.f;
+            float strongThresh = 60.f;
+            size_t numFeatures = 64;
+            std::vector<ShapeTemplate> templates;
+            FeatureStore store;
+        };
+
+        struct Candidate
+        {
+            int templateId;
+            int gridX;
+            int gridY;
+            int score;
+        };
+
+        static bool extractFeatures(const cv::Mat &p_gray, const cv::Mat &p_mask, Model &p_model);
+        static void buildTemplates(Model &p_model);
+        // 展开为接口使用的 Template（getTempl/输出匹配结果时才需要）
+        static Template expandTemplate(const Model &p_model, const ShapeTemplate &p_templ);
+
+        void prepareSearch(const cv::Mat &p_gray, const cv::Mat &p_mask);
+        void accumulate(const ShapeTemplate &p_templ, int p_cols, int p_rows);
+        int fineScore(const ShapeTemplate &p_templ, int p_x, int p_y) const;
+        Match buildMatch(const Candidate &p_candidate) const;
+
+        std::shared_ptr<const Model> m_model;
+
+        // 以下为搜索缓冲，跨调用复用
+        cv::Mat m_quantized;            // CV_16U，每像素至多一个方向位
+        cv::Mat m_spread;               // CV_16U，T×T 邻域方向位的并集
+        std::vector<cv::Mat> m_linear;  // 每个方向一块：T*T 行 × (gridRows*gridCols) 列
+        std::vector<uint16_t> m_acc;
+        int m_gridCols = 0;
+        int m_gridRows = 0;
+    };
+}